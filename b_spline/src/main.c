@@ -1,81 +1,324 @@
 #include <SDL2/SDL.h>
 
+#include "arclength.h"
+#include "bspline.h"
+#include "draw.h"
+#include "grid.h"
+
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define N_POINTS 4
-#define DEGREE 3
-#define N_KNOTS N_POINTS + DEGREE
+#define DEFAULT_DEGREE 2
+#define DEFAULT_N_POINTS 4
+#define N_ARC_LENGTH_SAMPLES 64
+#define N_ARC_LENGTH_INTERVALS 4
 
 const double POINT_RADIUS = 10.0;
-const int INTERP_RES = 100;
+const int MAX_SEGMENTS = 4096;
+const double FLATNESS_TOLERANCE = 0.25;
 
 /**
- * A simple point structure.
+ * Banded basis matrix of the samples of the curve
+ *
+ * The knot span s is divided into span_segments[s - degree] uniform segments.
+ * Sample k only depends on the control points from spans[k] - degree to spans[k],
+ * with the weights in values[k * (degree + 1) ...].
+ * The knots, the degree and the segment counts of the last build are kept to notice their change.
  */
-typedef struct Point
+typedef struct SampleBasis
 {
-    double x;
-    double y;
-} Point;
+    int n_samples;
+    int degree;
+    int n_knots;
+    int n_spans;
+    double* knots;
+    int* span_segments;
+    int* spans;
+    double* values;
+    double* left;
+    double* right;
+} SampleBasis;
 
+void init_sample_basis(SampleBasis* basis)
+{
+    memset(basis, 0, sizeof(SampleBasis));
+}
 
-/*
+void destroy_sample_basis(SampleBasis* basis)
+{
+    free(basis->knots);
+    free(basis->span_segments);
+    free(basis->spans);
+    free(basis->values);
+    free(basis->left);
+    free(basis->right);
+    init_sample_basis(basis);
+}
 
-Normalized B-spline
-k: degree
-u: position
-*/ 
-double base_spline(int i, int k, double u, double *knots)
+/**
+ * Calculate the i-th control point of the first derivative curve.
+ */
+Point calc_derivative_point(const BSpline* spline, int i)
 {
-    if (k == 1) {
-        return (knots[i] <= u && u < knots[i + 1]) ? 1.0 : 0.0;
+    const int p = spline->degree;
+    double length = spline->knots[i + p + 1] - spline->knots[i + 1];
+    Point d = {0.0, 0.0};
+
+    if (length > 0.0) {
+        d.x = p * (spline->points[i + 1].x - spline->points[i].x) / length;
+        d.y = p * (spline->points[i + 1].y - spline->points[i].y) / length;
     }
+    return d;
+}
 
-    double left = 0.0, right = 0.0;
+/**
+ * Calculate the number of segments of each knot span, which keeps the polyline within the tolerance of the curve.
+ *
+ * The second derivative in the span is bounded by its control points, and a segment of h parameter length
+ * deviates at most h^2 / 8 times that bound from the curve (Wang's formula for B-splines).
+ * The counts are reduced proportionally when their sum would exceed the maximum.
+ */
+int calc_span_segments(const BSpline* spline, double tolerance, int max_segments, int* span_segments)
+{
+    const int p = spline->degree;
+    const int n_spans = spline->n_points - p;
+    int n_segments = 0;
 
-    if (knots[i + k - 1] != knots[i]) {
-        left = (u - knots[i]) / (knots[i + k - 1] - knots[i]) * base_spline(i, k-1, u, knots);
+    for (int s = p; s < spline->n_points; ++s) {
+        double length = spline->knots[s + 1] - spline->knots[s];
+        double max_curvature = 0.0;
+        for (int i = s - p; i <= s - 2; ++i) {
+            double span_length = spline->knots[i + p + 1] - spline->knots[i + 2];
+            if (span_length > 0.0) {
+                Point d0 = calc_derivative_point(spline, i);
+                Point d1 = calc_derivative_point(spline, i + 1);
+                double x = (p - 1) * (d1.x - d0.x) / span_length;
+                double y = (p - 1) * (d1.y - d0.y) / span_length;
+                max_curvature = fmax(max_curvature, sqrt(x * x + y * y));
+            }
+        }
+        span_segments[s - p] = (length > 0.0) ? (int)ceil(length * sqrt(max_curvature / (8.0 * tolerance))) : 0;
+        if (length > 0.0 && span_segments[s - p] < 1) {
+            span_segments[s - p] = 1;
+        }
+        n_segments += span_segments[s - p];
+    }
+    if (n_segments > max_segments && max_segments > n_spans) {
+        int n_reduced = 0;
+        for (int s = 0; s < n_spans; ++s) {
+            if (span_segments[s] > 1) {
+                span_segments[s] = 1 + (int)((long long)(span_segments[s] - 1) * (max_segments - n_spans) / (n_segments - n_spans));
+            }
+            n_reduced += span_segments[s];
+        }
+        n_segments = n_reduced;
     }
+    return n_segments;
+}
 
-    if (knots[i + k] != knots[i + 1]) {
-        right = (knots[i + k] - u) / (knots[i + k] - knots[i + 1]) * base_spline(i+1, k-1, u, knots);
+/**
+ * Round the segment counts of the spans up to powers of two, with hysteresis.
+ *
+ * The counts follow the control points, so nearly every drag would change one of them and rebuild the basis matrix.
+ * A count of the last build is kept while it is enough for the span and at most four times more than needed,
+ * so the matrix is only rebuilt when the curvature of a span has changed a lot.
+ * The largest counts are halved while their sum exceeds the maximum.
+ */
+int quantize_span_segments(const SampleBasis* basis, int n_spans, int max_segments, int* span_segments)
+{
+    const bool has_previous = (basis->values != NULL && basis->n_spans == n_spans);
+    int n_segments = 0;
+    int max_count = 0;
+    int count;
+
+    for (int s = 0; s < n_spans; ++s) {
+        if (span_segments[s] == 0) {
+            continue;
+        }
+        if (has_previous && basis->span_segments[s] >= span_segments[s] && basis->span_segments[s] < 4 * span_segments[s]) {
+            count = basis->span_segments[s];
+        }
+        else {
+            for (count = 1; count < span_segments[s]; count *= 2) {
+            }
+        }
+        span_segments[s] = count;
+        n_segments += count;
+        max_count = (count > max_count) ? count : max_count;
+    }
+    while (n_segments > max_segments && max_count > 1) {
+        n_segments = 0;
+        for (int s = 0; s < n_spans; ++s) {
+            if (span_segments[s] == max_count) {
+                span_segments[s] /= 2;
+            }
+            n_segments += span_segments[s];
+        }
+        max_count /= 2;
     }
+    return n_segments;
+}
 
-    return left + right;
+bool is_sample_basis_valid(const SampleBasis* basis, const BSpline* spline, const int* span_segments)
+{
+    return basis->values != NULL
+        && basis->degree == spline->degree
+        && basis->n_knots == spline->n_knots
+        && memcmp(basis->knots, spline->knots, spline->n_knots * sizeof(double)) == 0
+        && memcmp(basis->span_segments, span_segments, basis->n_spans * sizeof(int)) == 0;
 }
 
-Point de_boor(Point *points, double u, double *knots)
+/**
+ * Rebuild the basis matrix of the samples when the knots, the degree or the segment counts of the spans have changed.
+ */
+bool update_sample_basis(SampleBasis* basis, const BSpline* spline, const int* span_segments)
 {
-    Point res = {0};
-    double N;
-    for (int i = 0; i < N_POINTS; i++) {
-        N = base_spline(i, DEGREE, u, knots);
-        res.x += N * points[i].x;
-        res.y += N * points[i].y;
-    }
-    return res;
+    const int n_values = spline->degree + 1;
+    const int n_spans = spline->n_points - spline->degree;
+    int n_samples;
+    int k;
+
+    if (is_sample_basis_valid(basis, spline, span_segments)) {
+        return true;
+    }
+    n_samples = 1;
+    for (int s = 0; s < n_spans; ++s) {
+        n_samples += span_segments[s];
+    }
+    destroy_sample_basis(basis);
+    basis->knots = (double*)malloc(spline->n_knots * sizeof(double));
+    basis->span_segments = (int*)malloc(n_spans * sizeof(int));
+    basis->spans = (int*)malloc(n_samples * sizeof(int));
+    basis->values = (double*)malloc(n_samples * n_values * sizeof(double));
+    basis->left = (double*)malloc(n_values * sizeof(double));
+    basis->right = (double*)malloc(n_values * sizeof(double));
+    if (basis->knots == NULL || basis->span_segments == NULL || basis->spans == NULL || basis->values == NULL
+        || basis->left == NULL || basis->right == NULL) {
+        printf("[ERROR] Unable to allocate memory for the basis matrix!\n");
+        destroy_sample_basis(basis);
+        return false;
+    }
+    basis->n_samples = n_samples;
+    basis->degree = spline->degree;
+    basis->n_knots = spline->n_knots;
+    basis->n_spans = n_spans;
+    memcpy(basis->knots, spline->knots, spline->n_knots * sizeof(double));
+    memcpy(basis->span_segments, span_segments, n_spans * sizeof(int));
+
+    k = 0;
+    for (int s = spline->degree; s < spline->n_points; ++s) {
+        for (int j = 0; j < span_segments[s - spline->degree]; ++j) {
+            double t = spline->knots[s] + (spline->knots[s + 1] - spline->knots[s]) * j / span_segments[s - spline->degree];
+            basis->spans[k] = s;
+            calc_basis_functions(spline, s, t, &(basis->values[k * n_values]), basis->left, basis->right);
+            ++k;
+        }
+    }
+    // the end of the domain closes the last span
+    basis->spans[k] = spline->n_points - 1;
+    calc_basis_functions(spline, spline->n_points - 1, spline->knots[spline->n_points], &(basis->values[k * n_values]), basis->left, basis->right);
+    return true;
 }
 
+/**
+ * Evaluate the samples of the curve as the product of the banded basis matrix and the control points.
+ */
+void interpolate_curve(Point *interp_points, const BSpline *spline, const SampleBasis *basis) {
+    const int n_values = basis->degree + 1;
 
-void interpolate_curve(Point *interp_points, Point *points, SDL_Renderer *renderer, double *knots) {
-    for (int k = 0; k < INTERP_RES; k++) {
-        float t = (float)k / (INTERP_RES - 1);
-        interp_points[k] = de_boor(points, t, knots);
+    for (int k = 0; k < basis->n_samples; k++) {
+        const Point* points = &(spline->points[basis->spans[k] - basis->degree]);
+        const double* values = &(basis->values[k * n_values]);
+        Point sample = {0};
+        for (int j = 0; j < n_values; ++j) {
+            sample.x += values[j] * points[j].x;
+            sample.y += values[j] * points[j].y;
+        }
+        interp_points[k] = sample;
     }
 }
 
-void draw_curve(SDL_Renderer *renderer, Point *interp_points) {
+void draw_curve(SDL_Renderer *renderer, DrawBuffer *buffer, Point *interp_points, int n_interp_points) {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    for (int i = 0; i < INTERP_RES - 1; i++) {
-        SDL_RenderDrawLine(renderer, interp_points[i].x, interp_points[i].y,
-                           interp_points[i + 1].x, interp_points[i + 1].y);
+    draw_polyline(renderer, buffer, interp_points, n_interp_points);
+}
+
+/**
+ * Draw the samples of the curve with a single call.
+ */
+void draw_samples(SDL_Renderer *renderer, DrawBuffer *buffer, const Point *samples, int n_samples) {
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
+    draw_points(renderer, buffer, samples, n_samples);
+}
+
+/**
+ * B-spline with the work points of its evaluation for the arc length table
+ */
+typedef struct SplineEvaluation
+{
+    const BSpline* spline;
+    Point* work;
+} SplineEvaluation;
+
+/**
+ * Calculate the derivative of the B-spline for the arc length table.
+ */
+Point calc_curve_derivative(const void* data, double u)
+{
+    const SplineEvaluation* evaluation = (const SplineEvaluation*)data;
+
+    return calc_b_spline_derivative(evaluation->spline, u, evaluation->work);
+}
+
+/**
+ * Sample the curve at equal arc lengths.
+ * Only the lengths of the knot spans which have been invalidated since the last call are integrated again.
+ * The work array has room for degree + 1 points.
+ */
+void calc_arc_length_samples(Point* samples, const BSpline* spline, ArcLengthTable* table, Point* work)
+{
+    SplineEvaluation evaluation = {spline, work};
+    ArcLengthCurve curve = {calc_curve_derivative, &evaluation};
+    double parameters[N_ARC_LENGTH_SAMPLES];
+
+    update_arc_length_table(table, &curve);
+    calc_equal_length_parameters(table, &curve, N_ARC_LENGTH_SAMPLES, parameters);
+    for (int k = 0; k < N_ARC_LENGTH_SAMPLES; ++k) {
+        samples[k] = de_boor(spline, parameters[k], work);
+    }
+}
+
+/**
+ * Place the control points in a zigzag over the window.
+ */
+void init_points(BSpline* spline)
+{
+    Point* points = spline->points;
+
+    if (spline->n_points == 4) {
+        points[0].x = 200;
+        points[0].y = 200;
+        points[1].x = 400;
+        points[1].y = 200;
+        points[2].x = 300;
+        points[2].y = 400;
+        points[3].x = 500;
+        points[3].y = 400;
+        return;
+    }
+    for (int i = 0; i < spline->n_points; ++i) {
+        points[i].x = 100 + 600.0 * i / (spline->n_points - 1);
+        points[i].y = (i % 2 == 0) ? 200 : 400;
     }
 }
 
 /**
  * C/SDL2 framework for experimentation with curves.
+ *
+ * Usage: bspline [degree] [number of control points]
  */
 int main(int argc, char* argv[])
 {
@@ -85,35 +328,77 @@ int main(int argc, char* argv[])
     SDL_Event event;
     SDL_Renderer* renderer;
 
-    const int N = 4;
-
     int mouse_x, mouse_y;
-    int i;
-
-    Point* selected_point = NULL;
-    Point points[N_POINTS];
-    Point interp_points[INTERP_RES];
-    points[0].x = 200;
-    points[0].y = 200;
-    points[1].x = 400;
-    points[1].y = 200;
-    points[2].x = 300;
-    points[2].y = 400;
-    points[3].x = 500;
-    points[3].y = 400;
-
-    double knots[N_KNOTS];
-    knots[0] = 0.0;
-    knots[1] = 0.0;
-    knots[2] = 0.0;
-    knots[3] = 0.5;
-    knots[4] = 1.0;
-    knots[5] = 1.0;
-    knots[6] = 1.6;
+    int degree, n_points;
+
+    BSpline spline;
+    SampleBasis basis;
+    DrawBuffer buffer;
+    Point* points;
+    PointGrid grid;
+    ArcLengthTable table;
+    Point samples[N_ARC_LENGTH_SAMPLES];
+    int first_span, last_span;
+    int selected_index = -1;
+    // the curve is only recalculated when its control points have changed,
+    // and the window is only redrawn when something has changed
+    bool is_curve_dirty = true;
+    bool need_redraw = true;
+    int max_segments;
+    int* span_segments;
+    Point* interp_points;
+    Point* work;
+
+    degree = (argc > 1) ? atoi(argv[1]) : DEFAULT_DEGREE;
+    n_points = (argc > 2) ? atoi(argv[2]) : DEFAULT_N_POINTS;
+    if (!create_b_spline(&spline, degree, n_points)) {
+        return 1;
+    }
+    // every non-empty span needs at least one segment
+    max_segments = (n_points > MAX_SEGMENTS) ? n_points : MAX_SEGMENTS;
+    span_segments = (int*)malloc(n_points * sizeof(int));
+    interp_points = (Point*)malloc((max_segments + 1) * sizeof(Point));
+    work = (Point*)malloc((degree + 1) * sizeof(Point));
+    if (span_segments == NULL || interp_points == NULL || work == NULL) {
+        printf("[ERROR] Unable to allocate memory for the curve samples!\n");
+        free(span_segments);
+        free(interp_points);
+        free(work);
+        destroy_b_spline(&spline);
+        return 1;
+    }
+    set_clamped_knots(&spline);
+    init_points(&spline);
+    init_sample_basis(&basis);
+    init_draw_buffer(&buffer);
+    points = spline.points;
+    init_point_grid(&grid, POINT_RADIUS);
+    if (!build_point_grid(&grid, points, spline.n_points)) {
+        free(span_segments);
+        free(interp_points);
+        free(work);
+        destroy_b_spline(&spline);
+        return 1;
+    }
+    if (!create_arc_length_table(&table, &(spline.knots[degree]), n_points - degree, N_ARC_LENGTH_INTERVALS)) {
+        destroy_point_grid(&grid);
+        free(span_segments);
+        free(interp_points);
+        free(work);
+        destroy_b_spline(&spline);
+        return 1;
+    }
 
     error_code = SDL_Init(SDL_INIT_EVERYTHING);
     if (error_code != 0) {
         printf("[ERROR] SDL initialization error: %s\n", SDL_GetError());
+        destroy_draw_buffer(&buffer);
+        destroy_arc_length_table(&table);
+        destroy_point_grid(&grid);
+        free(span_segments);
+        free(interp_points);
+        free(work);
+        destroy_b_spline(&spline);
         return error_code;
     }
 
@@ -126,29 +411,64 @@ int main(int argc, char* argv[])
 
     need_run = true;
     while (need_run) {
-        while (SDL_PollEvent(&event)) {
+        if (need_redraw) {
+            SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+            SDL_RenderClear(renderer);
+            // Draw the control points
+            SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
+            draw_control_points(renderer, &buffer, points, spline.n_points, POINT_RADIUS);
+            // Draw the segments
+            SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
+            draw_polyline(renderer, &buffer, points, spline.n_points);
+
+            if (is_curve_dirty) {
+                calc_span_segments(&spline, FLATNESS_TOLERANCE, max_segments, span_segments);
+                quantize_span_segments(&basis, spline.n_points - spline.degree, max_segments, span_segments);
+                calc_arc_length_samples(samples, &spline, &table, work);
+            }
+            if (is_curve_dirty && update_sample_basis(&basis, &spline, span_segments)) {
+                interpolate_curve(interp_points, &spline, &basis);
+                is_curve_dirty = false;
+            }
+            if (!is_curve_dirty) {
+                draw_curve(renderer, &buffer, interp_points, basis.n_samples);
+            }
+            draw_samples(renderer, &buffer, samples, N_ARC_LENGTH_SAMPLES);
+
+            // Display the results
+            SDL_RenderPresent(renderer);
+            need_redraw = false;
+        }
+
+        // wait for the next events instead of spinning
+        if (SDL_WaitEvent(&event) == 0) {
+            printf("[ERROR] SDL event error: %s\n", SDL_GetError());
+            break;
+        }
+        do {
             switch (event.type) {
             case SDL_MOUSEBUTTONDOWN:
                 SDL_GetMouseState(&mouse_x, &mouse_y);
-                selected_point = NULL;
-                for (int i = 0; i < N_POINTS; ++i) {
-                    double dx = points[i].x - mouse_x;
-                    double dy = points[i].y - mouse_y;
-                    double distance = sqrt(dx * dx + dy * dy);
-                    if (distance < POINT_RADIUS) {
-                        selected_point = points + i;
-                    }
-                }
+                selected_index = find_nearest_point(&grid, mouse_x, mouse_y);
                 break;
             case SDL_MOUSEMOTION:
-                if (selected_point != NULL) {
+                if (selected_index >= 0) {
                     SDL_GetMouseState(&mouse_x, &mouse_y);
-                    selected_point->x = mouse_x;
-                    selected_point->y = mouse_y;
+                    points[selected_index].x = mouse_x;
+                    points[selected_index].y = mouse_y;
+                    set_grid_point(&grid, selected_index, mouse_x, mouse_y);
+                    // only the spans of the moved control point change their lengths
+                    get_point_spans(&spline, selected_index, &first_span, &last_span);
+                    invalidate_arc_length_spans(&table, first_span, last_span);
+                    is_curve_dirty = true;
+                    need_redraw = true;
                 }
                 break;
             case SDL_MOUSEBUTTONUP:
-                selected_point = NULL;
+                selected_index = -1;
+                break;
+            case SDL_WINDOWEVENT:
+                need_redraw = true;
                 break;
             case SDL_KEYDOWN:
             case SDL_SCANCODE_Q:
@@ -158,35 +478,20 @@ int main(int argc, char* argv[])
                 need_run = false;
                 break;
             }
-        }
-
-
-        // TODO: optimize for efficient redraw
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-        SDL_RenderClear(renderer);
-        // Draw the control points
-        SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
-        for (int i = 0; i < N_POINTS; ++i) {
-            SDL_RenderDrawLine(renderer, points[i].x - POINT_RADIUS, points[i].y, points[i].x + POINT_RADIUS, points[i].y);
-            SDL_RenderDrawLine(renderer, points[i].x, points[i].y - POINT_RADIUS, points[i].x, points[i].y + POINT_RADIUS);
-        }
-        // Draw the segments
-        SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
-        for (int i = 1; i < N_POINTS; ++i) {
-            SDL_RenderDrawLine(renderer, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
-        }
-
-        interpolate_curve(interp_points, points, renderer, knots);
-        draw_curve(renderer, interp_points);
-
-
-        // Display the results
-        SDL_RenderPresent(renderer);
+        } while (SDL_PollEvent(&event));
     }
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+    destroy_sample_basis(&basis);
+    destroy_draw_buffer(&buffer);
+    destroy_arc_length_table(&table);
+    destroy_point_grid(&grid);
+    free(span_segments);
+    free(interp_points);
+    free(work);
+    destroy_b_spline(&spline);
 
     return 0;
 }
@@ -1,69 +1,53 @@
 #include <SDL2/SDL.h>
 
+#include "bezier.h"
+#include "draw.h"
+
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 const double POINT_RADIUS = 10.0;
 const int N_POINTS = 4;
 const int INTERP_RES = 100;
 
 /**
- * A simple point structure.
+ * Sample the curve from its polynomial form, which is converted once per edit.
  */
-typedef struct Point
-{
-    double x;
-    double y;
-} Point;
-
-// TODO: implement look up table for factorial
-unsigned long binomial_coefficient(int n, int k)
-{
-    if (k > n) return 0;
-    if (k == 0 || k == n) return 1;
-    unsigned long res = 1;
-    for (int i = 1; i <= k; i++) {
-        res *= n - (k - i);
-        res /= i;
-    }
-    return res;
-}
-
-// compute the k-th bernstein polynomial of n-th degree at t
-double bernstein(int n, int k, double t)
-{
-    return binomial_coefficient(n, k) * pow(t, k) * pow(1 - t, n - k);
-}
-
-Point approx(Point *points, double t)
+void interpolate_curve(SDL_Renderer *renderer, Point *interp_points, const BezierPolynomial *polynomial)
 {
-    Point sum = {0};
-    double B;
-    // degree of bernstein polynomials is the same as the number of control points - 1
-    for (int i = 0; i < N_POINTS; i++) {
-        B = bernstein(N_POINTS - 1, i, t);
-        sum.x += points[i].x * B;
-        sum.y += points[i].y * B;
+    for (int k = 0; k < INTERP_RES; k++) {
+        double t = (float)k / (INTERP_RES - 1);
+        interp_points[k] = calc_bezier_polynomial_point(polynomial, t);
     }
-    return sum;
 }
 
-void interpolate_curve(SDL_Renderer *renderer, Point *interp_points, Point *points)
+/**
+ * Find the nearest point within POINT_RADIUS of the position, or NULL.
+ * A grid is not worth it for the few control points, but the squared distances are compared as in the other tools.
+ */
+Point* find_nearest_point(Point *points, int n_points, double x, double y)
 {
-    for (int k = 0; k < INTERP_RES; k++) {
-        double t = (float)k / (INTERP_RES - 1);
-        interp_points[k] = approx(points, t);
+    double min_distance = POINT_RADIUS * POINT_RADIUS;
+    Point* nearest = NULL;
+
+    for (int i = 0; i < n_points; ++i) {
+        double dx = points[i].x - x;
+        double dy = points[i].y - y;
+        double distance = dx * dx + dy * dy;
+        if (distance < min_distance) {
+            min_distance = distance;
+            nearest = points + i;
+        }
     }
+    return nearest;
 }
 
-void draw_curve(SDL_Renderer *renderer, Point *interp_points)
+void draw_curve(SDL_Renderer *renderer, DrawBuffer *buffer, Point *interp_points)
 {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    for (int i = 0; i < INTERP_RES - 1; i++) {
-        SDL_RenderDrawLine(renderer, interp_points[i].x, interp_points[i].y,
-                           interp_points[i + 1].x, interp_points[i + 1].y);
-    }
+    draw_polyline(renderer, buffer, interp_points, INTERP_RES);
 }
 
 /**
@@ -82,9 +66,16 @@ int main(int argc, char* argv[])
     int mouse_x, mouse_y;
     int i;
 
+    // the curve is only recalculated when its control points have changed,
+    // and the window is only redrawn when something has changed
+    bool is_curve_dirty = true;
+    bool need_redraw = true;
+
     Point* selected_point = NULL;
     Point points[N_POINTS];
+    BezierPolynomial polynomial;
     Point interp_points[INTERP_RES];
+    DrawBuffer buffer;
     points[0].x = 200;
     points[0].y = 200;
     points[1].x = 400;
@@ -93,11 +84,15 @@ int main(int argc, char* argv[])
     points[2].y = 400;
     points[3].x = 500;
     points[3].y = 400;
-
+    if (!create_bezier_polynomial(&polynomial, N_POINTS)) {
+        return 1;
+    }
+    init_draw_buffer(&buffer);
 
     error_code = SDL_Init(SDL_INIT_EVERYTHING);
     if (error_code != 0) {
         printf("[ERROR] SDL initialization error: %s\n", SDL_GetError());
+        destroy_bezier_polynomial(&polynomial);
         return error_code;
     }
 
@@ -110,31 +105,55 @@ int main(int argc, char* argv[])
 
     need_run = true;
     while (need_run) {
-        // process events
-        while (SDL_PollEvent(&event)) {
+        // render graphics
+        if (need_redraw) {
+            SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+            SDL_RenderClear(renderer);
+            // Draw the control points
+            SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
+            draw_control_points(renderer, &buffer, points, N_POINTS, POINT_RADIUS);
+            // Draw the segments
+            SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
+            draw_polyline(renderer, &buffer, points, N_POINTS);
+
+            if (is_curve_dirty) {
+                update_bezier_polynomial(&polynomial, points, N_POINTS);
+                interpolate_curve(renderer, interp_points, &polynomial);
+                is_curve_dirty = false;
+            }
+            draw_curve(renderer, &buffer, interp_points);
+
+            // Display the results
+            SDL_RenderPresent(renderer);
+            need_redraw = false;
+        }
+
+        // wait for the next events instead of spinning
+        if (SDL_WaitEvent(&event) == 0) {
+            printf("[ERROR] SDL event error: %s\n", SDL_GetError());
+            break;
+        }
+        do {
             switch (event.type) {
             case SDL_MOUSEBUTTONDOWN:
                 SDL_GetMouseState(&mouse_x, &mouse_y);
-                selected_point = NULL;
-                for (int i = 0; i < N_POINTS; ++i) {
-                    double dx = points[i].x - mouse_x;
-                    double dy = points[i].y - mouse_y;
-                    double distance = sqrt(dx * dx + dy * dy);
-                    if (distance < POINT_RADIUS) {
-                        selected_point = points + i;
-                    }
-                }
+                selected_point = find_nearest_point(points, N_POINTS, mouse_x, mouse_y);
                 break;
             case SDL_MOUSEMOTION:
                 if (selected_point != NULL) {
                     SDL_GetMouseState(&mouse_x, &mouse_y);
                     selected_point->x = mouse_x;
                     selected_point->y = mouse_y;
+                    is_curve_dirty = true;
+                    need_redraw = true;
                 }
                 break;
             case SDL_MOUSEBUTTONUP:
                 selected_point = NULL;
                 break;
+            case SDL_WINDOWEVENT:
+                need_redraw = true;
+                break;
             case SDL_KEYDOWN:
                 switch (event.key.keysym.sym) {
                     case SDLK_q:
@@ -146,36 +165,14 @@ int main(int argc, char* argv[])
                 need_run = false;
                 break;
             }
-        }
-
-        // render graphics
-        // NOTE: It has not optimized for efficient redraw!
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-        SDL_RenderClear(renderer);
-        // Draw the control points
-        SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
-        for (int i = 0; i < N_POINTS; ++i) {
-            SDL_RenderDrawLine(renderer, points[i].x - POINT_RADIUS, points[i].y, points[i].x + POINT_RADIUS, points[i].y);
-            SDL_RenderDrawLine(renderer, points[i].x, points[i].y - POINT_RADIUS, points[i].x, points[i].y + POINT_RADIUS);
-        }
-        // Draw the segments
-        SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
-        for (int i = 1; i < N_POINTS; ++i) {
-            SDL_RenderDrawLine(renderer, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
-        }
-
-
-        interpolate_curve(renderer, interp_points, points);
-        draw_curve(renderer, interp_points);
-
-        // Display the results
-        SDL_RenderPresent(renderer);
-
+        } while (SDL_PollEvent(&event));
     }
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+    destroy_draw_buffer(&buffer);
+    destroy_bezier_polynomial(&polynomial);
 
     return 0;
 }
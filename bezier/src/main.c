@@ -1,93 +1,285 @@
 #include <SDL2/SDL.h>
 
+#include "bezier.h"
+#include "closest.h"
+#include "draw.h"
+#include "grid.h"
+
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 const double POINT_RADIUS = 10.0;
 const int N_POINTS = 4;
 const int INTERP_RES = 100;
+#define MAX_SUBDIVISION_DEPTH 10
+// the larger control polygons are flattened by uniform sampling instead of subdivision
+#define MAX_SUBDIVISION_POINTS 16
+// a subdivision of MAX_SUBDIVISION_DEPTH levels has at most 2^MAX_SUBDIVISION_DEPTH pieces
+#define MAX_INTERP_POINTS ((1 << MAX_SUBDIVISION_DEPTH) + 1)
+const double FLATNESS_TOLERANCE = 0.25;
 int guide_line = 0;
 
 /**
- * A simple point structure.
+ * Growable set of control points
+ *
+ * The work array holds the levels of the de Casteljau algorithm for the guide lines,
+ * so the control points are not copied for every redraw.
  */
-typedef struct Point
+typedef struct ControlPoints
 {
-    double x;
-    double y;
-} Point;
+    int n_points;
+    int capacity;
+    Point* points;
+    Point* work;
+} ControlPoints;
 
 
 /*
 TODO:
-dynamic addition and removal of controll points by user
-more compact data structures (curve_t, linked list for control points)
 generate a random controll points at program start
 */
 
-// De Casteljau algorithm
-Point de_casteljau(SDL_Renderer *renderer, Point *points, float t, int display_lines)
+bool create_control_points(ControlPoints *control_points, int capacity)
 {
-    Point pts[N_POINTS];
-
-    for (int i = 0; i < N_POINTS; i++) {
-        pts[i] = points[i];
+    control_points->n_points = 0;
+    control_points->capacity = capacity;
+    control_points->points = (Point*)malloc(capacity * sizeof(Point));
+    control_points->work = (Point*)malloc(capacity * sizeof(Point));
+    if (control_points->points == NULL || control_points->work == NULL) {
+        printf("[ERROR] Unable to allocate memory for the control points!\n");
+        free(control_points->points);
+        free(control_points->work);
+        return false;
     }
+    return true;
+}
 
-    if (display_lines) {
-        for (int k = 0; k < N_POINTS - 1; k++) {
-            for(int i = 0; i < N_POINTS - k - 1; i++) {
-                pts[i].x = t*pts[i].x + (1-t)*pts[i+1].x;
-                pts[i].y = t*pts[i].y + (1-t)*pts[i+1].y;
-            }
+void destroy_control_points(ControlPoints *control_points)
+{
+    free(control_points->points);
+    free(control_points->work);
+}
 
-            // draw line segments
-            for(int i = 0; i < N_POINTS - k - 1; i++) {
-                SDL_RenderDrawLine(renderer, pts[i].x, pts[i].y, pts[i+1].x, pts[i+1].y);
-            }
+/**
+ * Double the capacity of the arrays.
+ */
+bool grow_control_points(ControlPoints *control_points)
+{
+    Point** arrays[] = {&control_points->points, &control_points->work};
+    Point* array;
+
+    for (int i = 0; i < 2; i++) {
+        array = (Point*)realloc(*arrays[i], 2 * control_points->capacity * sizeof(Point));
+        if (array == NULL) {
+            printf("[ERROR] Unable to allocate memory for the control points!\n");
+            return false;
         }
+        *arrays[i] = array;
     }
-    else {
-        for (int k = 0; k < N_POINTS - 1; k++) {
-            for(int i = 0; i < N_POINTS - k - 1; i++) {
-                pts[i].x = t*pts[i].x + (1-t)*pts[i+1].x;
-                pts[i].y = t*pts[i].y + (1-t)*pts[i+1].y;
-            }
+    control_points->capacity *= 2;
+    return true;
+}
+
+/**
+ * Insert a control point before the index.
+ */
+bool insert_control_point(ControlPoints *control_points, int index, double x, double y)
+{
+    int n_moved = control_points->n_points - index;
+
+    if (control_points->n_points == control_points->capacity && !grow_control_points(control_points)) {
+        return false;
+    }
+    memmove(&control_points->points[index + 1], &control_points->points[index], n_moved * sizeof(Point));
+    control_points->points[index].x = x;
+    control_points->points[index].y = y;
+    ++control_points->n_points;
+    return true;
+}
+
+bool add_control_point(ControlPoints *control_points, double x, double y)
+{
+    return insert_control_point(control_points, control_points->n_points, x, y);
+}
+
+void remove_control_point(ControlPoints *control_points, int index)
+{
+    int n_moved = control_points->n_points - index - 1;
+
+    memmove(&control_points->points[index], &control_points->points[index + 1], n_moved * sizeof(Point));
+    --control_points->n_points;
+}
+
+/**
+ * Calculate the distance of the point from the segment.
+ */
+double calc_segment_distance(Point a, Point b, Point p)
+{
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double length = dx * dx + dy * dy;
+    double t = (length > 0.0) ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length : 0.0;
+
+    t = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+    return hypot(a.x + t * dx - p.x, a.y + t * dy - p.y);
+}
+
+/**
+ * Find the segment of the control polygon under the position, or -1.
+ * The segment i connects the control points i and i + 1.
+ */
+int find_polygon_segment(const ControlPoints *control_points, double x, double y)
+{
+    const Point* points = control_points->points;
+    Point p = {x, y};
+
+    for (int i = 0; i + 1 < control_points->n_points; ++i) {
+        if (calc_segment_distance(points[i], points[i + 1], p) < POINT_RADIUS) {
+            return i;
         }
     }
+    return -1;
+}
 
-    return pts[0];
+/**
+ * Check whether the inner control points are within the tolerance of the chord.
+ * The curve is in the convex hull of its control points, so it is within the tolerance too.
+ */
+bool is_flat(const Point *points, int n_points, double tolerance)
+{
+    for (int i = 1; i < n_points - 1; i++) {
+        if (calc_segment_distance(points[0], points[n_points - 1], points[i]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
 }
 
-void interpolate_curve(SDL_Renderer *renderer, Point *interp_points, Point *points)
+/**
+ * Flatten the curve into a polyline by adaptive subdivision, until the pieces are within the flatness tolerance.
+ * The pending pieces are kept on a fixed stack, which holds at most one piece per subdivision level.
+ * Returns the number of the points of the polyline.
+ */
+int subdivide_curve(Point *interp_points, const ControlPoints *control_points)
 {
-    SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
-    for (int k = 0; k < INTERP_RES; k++) {
-        float t = (float)k / (INTERP_RES - 1);
-        interp_points[k].x = 0;
-        interp_points[k].y = 0;
-
-        Point p;
-        if (k != 0 && k == guide_line) {
-            p = de_casteljau(renderer, points, t, 1);
+    const int n_points = control_points->n_points;
+    Point stack[(MAX_SUBDIVISION_DEPTH + 1) * MAX_SUBDIVISION_POINTS];
+    int depths[MAX_SUBDIVISION_DEPTH + 1];
+    int n_pending;
+    int n_interp_points;
+    Point* piece;
+    int depth;
+
+    memcpy(stack, control_points->points, n_points * sizeof(Point));
+    depths[0] = 0;
+    n_pending = 1;
+    interp_points[0] = stack[0];
+    n_interp_points = 1;
+    while (n_pending > 0) {
+        piece = &stack[(n_pending - 1) * n_points];
+        depth = depths[n_pending - 1];
+        if (depth == MAX_SUBDIVISION_DEPTH || is_flat(piece, n_points, FLATNESS_TOLERANCE)) {
+            interp_points[n_interp_points++] = piece[n_points - 1];
+            --n_pending;
+            continue;
         }
-        else {
-            p = de_casteljau(renderer, points, t, 0);
+        // the right half goes below the left one, so that the pieces are output in order
+        Point left[MAX_SUBDIVISION_POINTS];
+        split_bezier_curve(piece, n_points, 0.5, left, piece);
+        for (int i = 0; i < n_points; i++) {
+            stack[n_pending * n_points + i] = left[i];
         }
+        depths[n_pending - 1] = depth + 1;
+        depths[n_pending] = depth + 1;
+        ++n_pending;
+    }
+    return n_interp_points;
+}
+
+/**
+ * Flatten the curve into a polyline of uniform parameter steps.
+ * The step count comes from the bound of the second derivative (Wang's formula),
+ * and the points are evaluated in O(n) steps each.
+ * Returns the number of the points of the polyline.
+ */
+int sample_curve(Point *interp_points, const ControlPoints *control_points)
+{
+    const int degree = control_points->n_points - 1;
+    const Point* points = control_points->points;
+    double max_difference = 0.0;
+    double n_segments;
 
-        interp_points[k].x = p.x;
-        interp_points[k].y = p.y;
+    for (int i = 0; i + 2 <= degree; i++) {
+        max_difference = fmax(max_difference, hypot(points[i].x - 2.0 * points[i + 1].x + points[i + 2].x,
+                                                     points[i].y - 2.0 * points[i + 1].y + points[i + 2].y));
     }
+    n_segments = ceil(sqrt(degree * (degree - 1) * max_difference / (8.0 * FLATNESS_TOLERANCE)));
+    n_segments = fmax(1.0, fmin(n_segments, MAX_INTERP_POINTS - 1));
+    for (int k = 0; k <= (int)n_segments; k++) {
+        interp_points[k] = calc_bezier_point(points, control_points->n_points, k / n_segments);
+    }
+    return (int)n_segments + 1;
 }
 
-void draw_curve(SDL_Renderer *renderer, Point *interp_points)
+/**
+ * Flatten the curve into a polyline from the first to the last control point.
+ * Returns the number of the points of the polyline.
+ */
+int interpolate_curve(Point *interp_points, const ControlPoints *control_points)
+{
+    if (control_points->n_points <= MAX_SUBDIVISION_POINTS) {
+        return subdivide_curve(interp_points, control_points);
+    }
+    return sample_curve(interp_points, control_points);
+}
+
+// draw the intermediate segments of the de Casteljau algorithm at the selected sample
+void draw_guide_lines(SDL_Renderer *renderer, DrawBuffer *buffer, ControlPoints *control_points)
+{
+    // the guide lines move from the last control point towards the first one
+    const double t = 1.0 - (double)guide_line / (INTERP_RES - 1);
+    Point* level = control_points->work;
+
+    if (guide_line != 0) {
+        SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
+        calc_de_casteljau_level(control_points->points, control_points->n_points, t, level);
+        for (int n_level = control_points->n_points - 1; n_level >= 2; n_level--) {
+            draw_polyline(renderer, buffer, level, n_level);
+            calc_de_casteljau_level(level, n_level, t, level);
+        }
+    }
+}
+
+void draw_curve(SDL_Renderer *renderer, DrawBuffer *buffer, Point *interp_points, int n_interp_points)
 {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    for (int i = 0; i < INTERP_RES - 1; i++) {
-        SDL_RenderDrawLine(renderer, interp_points[i].x, interp_points[i].y,
-                           interp_points[i + 1].x, interp_points[i + 1].y);
+    draw_polyline(renderer, buffer, interp_points, n_interp_points);
+}
+
+/**
+ * Subdivide the curve of the control points for the closest point queries.
+ */
+bool update_closest_curve(ClosestPointCurve *closest_curve, const ControlPoints *control_points)
+{
+    return update_closest_point_curve(closest_curve, control_points->points, control_points->n_points);
+}
+
+/**
+ * Draw the line from the cursor to the closest point of the curve.
+ */
+void draw_closest_point(SDL_Renderer *renderer, const ClosestPointCurve *closest_curve, Point cursor)
+{
+    double parameter;
+    Point closest;
+
+    if (!find_closest_points(closest_curve, &cursor, 1, &parameter, &closest)) {
+        return;
     }
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
+    SDL_RenderDrawLineF(renderer, (float)cursor.x, (float)cursor.y, (float)closest.x, (float)closest.y);
 }
 
 static inline void bounds_check()
@@ -100,8 +292,33 @@ static inline void bounds_check()
     }
 }
 
+/**
+ * Place the given number of control points on a wave over the window.
+ */
+bool init_control_points(ControlPoints *control_points, int n_points)
+{
+    bool is_added = true;
+
+    if (n_points <= N_POINTS) {
+        is_added &= add_control_point(control_points, 200, 200);
+        is_added &= add_control_point(control_points, 400, 200);
+        is_added &= add_control_point(control_points, 300, 400);
+        is_added &= add_control_point(control_points, 500, 400);
+        return is_added;
+    }
+    for (int i = 0; i < n_points; i++) {
+        is_added &= add_control_point(control_points, 100 + 600.0 * i / (n_points - 1), 300 + 200 * sin(i * 0.5));
+    }
+    return is_added;
+}
+
 /**
  * C/SDL2 framework for experimentation with curves.
+ *
+ * Usage: bezier [number of control points]
+ * The right mouse button removes the control point under the cursor, or inserts a new one into the segment
+ * of the control polygon under the cursor, or appends a new one to the end of the polygon.
+ * The cursor is connected to its closest point of the curve.
  */
 int main(int argc, char* argv[])
 {
@@ -111,27 +328,50 @@ int main(int argc, char* argv[])
     SDL_Event event;
     SDL_Renderer* renderer;
 
-    const int N = 4;
-
     int mouse_x, mouse_y;
-    int i;
+    int index;
 
-    Point* selected_point = NULL;
-    Point points[N_POINTS];
-    Point interp_points[INTERP_RES];
-    points[0].x = 200;
-    points[0].y = 200;
-    points[1].x = 400;
-    points[1].y = 200;
-    points[2].x = 300;
-    points[2].y = 400;
-    points[3].x = 500;
-    points[3].y = 400;
+    // the curve is only recalculated when its control points have changed,
+    // and the window is only redrawn when something has changed
+    bool is_curve_dirty = true;
+    // the subdivision for the closest points takes O(n^2) steps per piece, so it is only rebuilt after a drag
+    bool is_closest_curve_dirty = true;
+    bool need_redraw = true;
 
+    ControlPoints control_points;
+    PointGrid grid;
+    ClosestPointCurve closest_curve;
+    DrawBuffer buffer;
+    bool has_cursor = false;
+    Point cursor;
+    int selected_index = -1;
+    Point interp_points[MAX_INTERP_POINTS];
+    int n_interp_points = 0;
+
+    if (!create_control_points(&control_points, N_POINTS)) {
+        return 1;
+    }
+    init_point_grid(&grid, POINT_RADIUS);
+    if (!init_control_points(&control_points, (argc > 1) ? atoi(argv[1]) : N_POINTS)
+        || !build_point_grid(&grid, control_points.points, control_points.n_points)) {
+        destroy_point_grid(&grid);
+        destroy_control_points(&control_points);
+        return 1;
+    }
+    if (!create_closest_point_curve(&closest_curve, control_points.n_points)) {
+        destroy_point_grid(&grid);
+        destroy_control_points(&control_points);
+        return 1;
+    }
+    init_draw_buffer(&buffer);
 
     error_code = SDL_Init(SDL_INIT_EVERYTHING);
     if (error_code != 0) {
         printf("[ERROR] SDL initialization error: %s\n", SDL_GetError());
+        destroy_draw_buffer(&buffer);
+        destroy_closest_point_curve(&closest_curve);
+        destroy_point_grid(&grid);
+        destroy_control_points(&control_points);
         return error_code;
     }
 
@@ -144,34 +384,98 @@ int main(int argc, char* argv[])
 
     need_run = true;
     while (need_run) {
-        // process events
-        while (SDL_PollEvent(&event)) {
+        // render graphics
+        if (need_redraw) {
+            SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+            SDL_RenderClear(renderer);
+            // Draw the control points
+            SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
+            draw_control_points(renderer, &buffer, control_points.points, control_points.n_points, POINT_RADIUS);
+            // Draw the segments
+            SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
+            draw_polyline(renderer, &buffer, control_points.points, control_points.n_points);
+
+            draw_guide_lines(renderer, &buffer, &control_points);
+            if (is_curve_dirty) {
+                n_interp_points = interpolate_curve(interp_points, &control_points);
+                is_closest_curve_dirty = true;
+                is_curve_dirty = false;
+            }
+            if (is_closest_curve_dirty && selected_index < 0) {
+                if (!update_closest_curve(&closest_curve, &control_points)) {
+                    need_run = false;
+                }
+                is_closest_curve_dirty = false;
+            }
+            draw_curve(renderer, &buffer, interp_points, n_interp_points);
+            // the closest point of the dragged curve is hidden until it is released
+            if (has_cursor && !is_closest_curve_dirty) {
+                draw_closest_point(renderer, &closest_curve, cursor);
+            }
+
+            // Display the results
+            SDL_RenderPresent(renderer);
+            need_redraw = false;
+        }
+
+        // wait for the next events instead of spinning
+        if (SDL_WaitEvent(&event) == 0) {
+            printf("[ERROR] SDL event error: %s\n", SDL_GetError());
+            break;
+        }
+        do {
             switch (event.type) {
             case SDL_MOUSEBUTTONDOWN:
                 SDL_GetMouseState(&mouse_x, &mouse_y);
-                selected_point = NULL;
-                for (int i = 0; i < N_POINTS; ++i) {
-                    double dx = points[i].x - mouse_x;
-                    double dy = points[i].y - mouse_y;
-                    double distance = sqrt(dx * dx + dy * dy);
-                    if (distance < POINT_RADIUS) {
-                        selected_point = points + i;
+                if (event.button.button == SDL_BUTTON_RIGHT) {
+                    index = find_nearest_point(&grid, mouse_x, mouse_y);
+                    if (index >= 0) {
+                        // the curve needs at least two control points
+                        if (control_points.n_points > 2) {
+                            remove_control_point(&control_points, index);
+                        }
+                    }
+                    else {
+                        index = find_polygon_segment(&control_points, mouse_x, mouse_y);
+                        insert_control_point(&control_points, (index >= 0) ? index + 1 : control_points.n_points, mouse_x, mouse_y);
                     }
+                    // the indices after the changed point are shifted
+                    if (!build_point_grid(&grid, control_points.points, control_points.n_points)) {
+                        need_run = false;
+                    }
+                    selected_index = -1;
+                    is_curve_dirty = true;
+                    need_redraw = true;
+                    break;
                 }
+                selected_index = find_nearest_point(&grid, mouse_x, mouse_y);
                 break;
             case SDL_MOUSEMOTION:
-                if (selected_point != NULL) {
-                    SDL_GetMouseState(&mouse_x, &mouse_y);
-                    selected_point->x = mouse_x;
-                    selected_point->y = mouse_y;
+                SDL_GetMouseState(&mouse_x, &mouse_y);
+                if (selected_index >= 0) {
+                    control_points.points[selected_index].x = mouse_x;
+                    control_points.points[selected_index].y = mouse_y;
+                    set_grid_point(&grid, selected_index, mouse_x, mouse_y);
+                    is_curve_dirty = true;
                 }
+                cursor.x = mouse_x;
+                cursor.y = mouse_y;
+                has_cursor = true;
+                need_redraw = true;
                 break;
             case SDL_MOUSEBUTTONUP:
-                selected_point = NULL;
+                if (selected_index >= 0) {
+                    need_redraw = true;
+                }
+                selected_index = -1;
                 break;
             case SDL_MOUSEWHEEL:
                 guide_line += event.wheel.y;
                 bounds_check();
+                need_redraw = true;
+                break;
+            case SDL_WINDOWEVENT:
+                need_redraw = true;
                 break;
             case SDL_KEYDOWN:
                 switch (event.key.keysym.sym) {
@@ -184,36 +488,16 @@ int main(int argc, char* argv[])
                 need_run = false;
                 break;
             }
-        }
-
-        // render graphics
-        // NOTE: It has not optimized for efficient redraw!
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-        SDL_RenderClear(renderer);
-        // Draw the control points
-        SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
-        for (int i = 0; i < N_POINTS; ++i) {
-            SDL_RenderDrawLine(renderer, points[i].x - POINT_RADIUS, points[i].y, points[i].x + POINT_RADIUS, points[i].y);
-            SDL_RenderDrawLine(renderer, points[i].x, points[i].y - POINT_RADIUS, points[i].x, points[i].y + POINT_RADIUS);
-        }
-        // Draw the segments
-        SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
-        for (int i = 1; i < N_POINTS; ++i) {
-            SDL_RenderDrawLine(renderer, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
-        }
-
-
-        interpolate_curve(renderer, interp_points, points);
-        draw_curve(renderer, interp_points);
-
-        // Display the results
-        SDL_RenderPresent(renderer);
-
+        } while (SDL_PollEvent(&event));
     }
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+    destroy_draw_buffer(&buffer);
+    destroy_closest_point_curve(&closest_curve);
+    destroy_point_grid(&grid);
+    destroy_control_points(&control_points);
 
     return 0;
 }
@@ -2,6 +2,7 @@
 #define APP_H
 
 #include "camera.h"
+#include "loader.h"
 #include "scene.h"
 
 #include <SDL2/SDL.h>
@@ -19,6 +20,7 @@ typedef struct App
     double uptime;
     Camera camera;
     Scene scene;
+    Loader loader;
 } App;
 
 /**
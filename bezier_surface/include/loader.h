@@ -0,0 +1,39 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "scene.h"
+
+#include <SDL2/SDL.h>
+
+/**
+ * Background jobs which prepare the startup assets of the scene
+ */
+typedef struct Loader
+{
+    Scene* scene;
+    const char* texture_filename;
+    SDL_Surface* texture_surface;
+    SDL_Thread* texture_thread;
+    SDL_Thread* surface_thread;
+    SDL_atomic_t is_texture_decoded;
+    SDL_atomic_t is_surface_evaluated;
+} Loader;
+
+/**
+ * Start decoding the texture and evaluating the initial surface on worker threads.
+ * It does not require the SDL or the OpenGL context to be initialized.
+ */
+void start_loader(Loader* loader, Scene* scene, const char* texture_filename);
+
+/**
+ * Hand over the finished assets to the scene.
+ * It has to be called from the thread which owns the OpenGL context.
+ */
+void poll_loader(Loader* loader);
+
+/**
+ * Wait for the running jobs and release the unused results.
+ */
+void stop_loader(Loader* loader);
+
+#endif /* LOADER_H */
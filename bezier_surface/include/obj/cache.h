@@ -0,0 +1,29 @@
+#ifndef OBJ_CACHE_H
+#define OBJ_CACHE_H
+
+#include "model.h"
+
+#include <stddef.h>
+
+#define MODEL_CACHE_VERSION 2
+#define MODEL_CACHE_EXTENSION ".cache"
+#define MODEL_CACHE_ALIGNMENT 64
+
+/**
+ * Set the name of the cache file which belongs to the OBJ file.
+ */
+int get_cache_filename(char* cache_filename, size_t max_length, const char* filename);
+
+/**
+ * Load the model from the cache file when it is valid for the current state of the OBJ file.
+ * The source and the sections are checked against their hashes in the header.
+ * The arrays of the model point into the mapped cache file.
+ */
+int load_model_cache(Model* model, const char* cache_filename, const char* filename);
+
+/**
+ * Save the model into a cache file which belongs to the current state of the OBJ file.
+ */
+int save_model_cache(const Model* model, const char* cache_filename, const char* filename);
+
+#endif /* OBJ_CACHE_H */
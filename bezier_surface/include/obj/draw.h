@@ -1,6 +1,7 @@
 #ifndef OBJ_DRAW_H
 #define OBJ_DRAW_H
 
+#include "mesh.h"
 #include "model.h"
 
 /**
@@ -13,4 +14,9 @@ void draw_model(const Model* model);
  */
 void draw_triangles(const Model* model);
 
+/**
+ * Draw the mesh with a single indexed draw call.
+ */
+void draw_mesh(const Mesh* mesh);
+
 #endif /* OBJ_DRAW_H */
@@ -0,0 +1,96 @@
+#ifndef OBJ_BVH_H
+#define OBJ_BVH_H
+
+#include "model.h"
+
+#define BVH_PACKET_SIZE 4
+#define NO_HIT -1
+
+/**
+ * Node of the bounding volume hierarchy, two nodes fill a cache line
+ *
+ * The children of an inner node (count is zero) are at the first and the first + 1 indices.
+ * A leaf refers to count triangles from the first one.
+ */
+typedef struct BvhNode
+{
+    float min[3];
+    int first;
+    float max[3];
+    int count;
+} BvhNode;
+
+/**
+ * Triangle prepared for the intersection tests
+ */
+typedef struct BvhTriangle
+{
+    float origin[3];
+    float edge_1[3];
+    float edge_2[3];
+    int triangle_index;
+} BvhTriangle;
+
+/**
+ * Bounding volume hierarchy over the triangles of a model
+ */
+typedef struct Bvh
+{
+    int n_nodes;
+    int n_triangles;
+    BvhNode* nodes;
+    BvhTriangle* triangles;
+    void* node_memory;
+} Bvh;
+
+/**
+ * Ray with the maximal distance of the hits
+ */
+typedef struct Ray
+{
+    float origin[3];
+    float direction[3];
+    float max_distance;
+} Ray;
+
+/**
+ * Closest hit of a ray with the barycentric coordinates on the triangle
+ *
+ * The triangle index is NO_HIT when the ray does not hit the model.
+ */
+typedef struct RayHit
+{
+    float distance;
+    float u;
+    float v;
+    int triangle_index;
+} RayHit;
+
+/**
+ * Initialize the bvh structure.
+ */
+void init_bvh(Bvh* bvh);
+
+/**
+ * Build the hierarchy by binned surface area heuristic.
+ * The subtrees are built in parallel.
+ * The model is rejected when its triangles refer to missing vertices.
+ */
+int build_bvh(Bvh* bvh, const Model* model);
+
+/**
+ * Find the closest hits of the rays, in packets of BVH_PACKET_SIZE rays.
+ */
+void intersect_rays(const Bvh* bvh, const Ray* rays, int n_rays, RayHit* hits);
+
+/**
+ * Check whether the rays hit any triangle, in packets of BVH_PACKET_SIZE rays.
+ */
+void occlude_rays(const Bvh* bvh, const Ray* rays, int n_rays, int* is_occluded);
+
+/**
+ * Release the allocated memory of the bvh.
+ */
+void free_bvh(Bvh* bvh);
+
+#endif /* OBJ_BVH_H */
@@ -0,0 +1,75 @@
+#ifndef OBJ_COMPACT_H
+#define OBJ_COMPACT_H
+
+#include "mesh.h"
+
+#include <stddef.h>
+
+/**
+ * Quantized vertex of 16 bytes
+ *
+ * The position is relative to the bounding box and the texture coordinates to their bounds,
+ * both as 16 bit unsigned values. The normal is octahedral encoded as two 16 bit signed values.
+ */
+typedef struct CompactVertex
+{
+    unsigned short position[4];
+    short normal[2];
+    unsigned short texture[2];
+} CompactVertex;
+
+/**
+ * Compressed, memory saving representation of a mesh
+ *
+ * The indices are stored as differences from the previous index,
+ * in zigzag encoded variable length integers (7 bits per byte).
+ */
+typedef struct CompactMesh
+{
+    int n_vertices;
+    int n_indices;
+    float position_offset[4];
+    float position_scale[4];
+    float texture_offset[2];
+    float texture_scale[2];
+    CompactVertex* vertices;
+    unsigned char* index_data;
+    size_t index_data_size;
+} CompactMesh;
+
+/**
+ * Initialize the compact mesh structure.
+ */
+void init_compact_mesh(CompactMesh* compact_mesh);
+
+/**
+ * Quantize the vertices and compress the indices of the mesh.
+ */
+int encode_compact_mesh(CompactMesh* compact_mesh, const Mesh* mesh);
+
+/**
+ * Decode the compact mesh into a newly allocated mesh.
+ */
+int decode_compact_mesh(const CompactMesh* compact_mesh, Mesh* mesh);
+
+/**
+ * Decode the vertices into an interleaved render buffer of MESH_VERTEX_SIZE floats per vertex.
+ */
+void decode_compact_vertices(const CompactMesh* compact_mesh, float* vertices);
+
+/**
+ * Decode the indices into a 16 or 32 bit index buffer.
+ */
+int decode_compact_indices(const CompactMesh* compact_mesh, void* indices, int index_size);
+
+/**
+ * Calculate the memory which is used by the compact mesh.
+ */
+size_t calc_compact_mesh_size(const CompactMesh* compact_mesh);
+
+/**
+ * Release the allocated memory of the compact mesh.
+ */
+void free_compact_mesh(CompactMesh* compact_mesh);
+
+#endif /* OBJ_COMPACT_H */
@@ -0,0 +1,70 @@
+#ifndef OBJ_HALFEDGE_H
+#define OBJ_HALFEDGE_H
+
+#include "model.h"
+
+#define NO_HALF_EDGE -1
+
+/**
+ * The half edges of a triangle are consecutive, from its corners to the next ones.
+ */
+#define NEXT_HALF_EDGE(h) ((h) % 3 == 2 ? (h) - 2 : (h) + 1)
+#define PREV_HALF_EDGE(h) ((h) % 3 == 0 ? (h) + 2 : (h) - 1)
+#define HALF_EDGE_FACE(h) ((h) / 3)
+
+/**
+ * Half edge adjacency of the triangles of a model in flat arrays
+ *
+ * The half edge 3 * t + k starts from the k-th corner of the t-th triangle.
+ * The twin of a boundary (or unmatched non-manifold) half edge is NO_HALF_EDGE.
+ * The outgoing half edge of a boundary vertex is a boundary half edge.
+ */
+typedef struct HalfEdgeMesh
+{
+    int n_vertices;
+    int n_half_edges;
+    int n_boundary_edges;
+    int n_non_manifold_edges;
+    int* vertices;
+    int* twins;
+    int* vertex_edges;
+} HalfEdgeMesh;
+
+/**
+ * Initialize the half edge mesh structure.
+ */
+void init_half_edge_mesh(HalfEdgeMesh* mesh);
+
+/**
+ * Build the half edges of the model by matching the edges in buckets of their smaller vertex index.
+ * The model is rejected when its triangles refer to missing vertices.
+ */
+int build_half_edge_mesh(HalfEdgeMesh* mesh, const Model* model);
+
+/**
+ * Get the vertex where the half edge ends.
+ */
+int get_target_vertex(const HalfEdgeMesh* mesh, int half_edge);
+
+/**
+ * Check whether the vertex is on the boundary of the mesh.
+ */
+int is_boundary_vertex(const HalfEdgeMesh* mesh, int vertex_index);
+
+/**
+ * Collect the neighbour vertices around the vertex and return their number (at most max_neighbours).
+ * Only the fan of the outgoing half edge is walked, when several fans meet at a non-manifold vertex.
+ */
+int collect_vertex_neighbours(const HalfEdgeMesh* mesh, int vertex_index, int* neighbours, int max_neighbours);
+
+/**
+ * Collect the triangles which share an edge with the triangle and return their number.
+ */
+int collect_face_neighbours(const HalfEdgeMesh* mesh, int triangle_index, int neighbours[3]);
+
+/**
+ * Release the allocated memory of the half edge mesh.
+ */
+void free_half_edge_mesh(HalfEdgeMesh* mesh);
+
+#endif /* OBJ_HALFEDGE_H */
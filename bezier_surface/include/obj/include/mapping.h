@@ -0,0 +1,30 @@
+#ifndef OBJ_MAPPING_H
+#define OBJ_MAPPING_H
+
+#include <stddef.h>
+
+/**
+ * Private view of a whole file
+ *
+ * The content can be modified without changing the file (copy-on-write).
+ * It is always followed by a terminating zero byte,
+ * so the parsers can look one character past the end.
+ */
+typedef struct FileMapping
+{
+    char* data;
+    size_t size;
+    int is_mapped;
+} FileMapping;
+
+/**
+ * Map the file into memory, or read it into a buffer when mapping is not possible.
+ */
+int map_file(FileMapping* mapping, const char* filename);
+
+/**
+ * Release the mapped content of the file.
+ */
+void unmap_file(FileMapping* mapping);
+
+#endif /* OBJ_MAPPING_H */
@@ -6,6 +6,8 @@
 
 #define INVALID_VERTEX_INDEX 0
 
+#include "mapping.h"
+
 /**
  * Three dimensional vertex
  */
@@ -45,6 +47,9 @@ typedef struct Triangle
 
 /**
  * Three dimensional model with texture
+ *
+ * The element arrays are either allocated separately
+ * or point into the mapped cache file.
  */
 typedef struct Model
 {
@@ -56,6 +61,7 @@ typedef struct Model
     TextureVertex* texture_vertices;
     Vertex* normals;
     Triangle* triangles;
+    FileMapping cache;
 } Model;
 
 /**
@@ -84,4 +90,10 @@ void allocate_model(Model* model);
  */
 void free_model(Model* model);
 
+/**
+ * Check whether the triangles only refer to existing elements.
+ * The vertex indices start from one, the missing texture and normal indices are the invalid index.
+ */
+int has_valid_indices(const Model* model);
+
 #endif /* OBJ_MODEL_H */
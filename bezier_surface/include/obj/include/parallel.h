@@ -0,0 +1,28 @@
+#ifndef OBJ_PARALLEL_H
+#define OBJ_PARALLEL_H
+
+/**
+ * Task which processes the items of the [begin, end) range
+ */
+typedef void (*RangeTask)(void* data, int begin, int end);
+
+/**
+ * Get the number of threads used by the parallel operations.
+ */
+int get_thread_count();
+
+/**
+ * Set the number of threads used by the parallel operations.
+ * Zero selects the number of online processors.
+ */
+void set_thread_count(int n_threads);
+
+/**
+ * Split the items into contiguous ranges and process them on separate threads.
+ * A range contains at least min_range_size items, so small inputs stay on the calling thread.
+ * The ranges run on a persistent pool of worker threads and on the calling thread.
+ * The pool runs one call at a time, so a call made from a task or while another call is running stays on its own thread.
+ */
+void parallel_for(int n_items, int min_range_size, RangeTask task, void* data);
+
+#endif /* OBJ_PARALLEL_H */
@@ -3,9 +3,40 @@
 
 #include "model.h"
 
+/**
+ * Axis aligned bounding box
+ */
+typedef struct BoundingBox
+{
+    Vertex min;
+    Vertex max;
+} BoundingBox;
+
 /**
  * Scale the loaded model.
  */
 void scale_model(Model* model, double sx, double sy, double sz);
 
+/**
+ * Translate the loaded model.
+ */
+void translate_model(Model* model, double dx, double dy, double dz);
+
+/**
+ * Transform the vertices by the affine matrix (column-major, like in OpenGL)
+ * and the normals by its normal matrix (the inverse transpose of the upper 3x3 part).
+ */
+void transform_model(Model* model, const double matrix[16]);
+
+/**
+ * Move the center of the bounding box to the origin and scale the model uniformly,
+ * so that the longest side of the bounding box has the given size.
+ */
+void fit_model(Model* model, double size);
+
+/**
+ * Calculate the bounding box of the vertices of the model.
+ */
+void calc_bounding_box(const Model* model, BoundingBox* bounding_box);
+
 #endif /* OBJ_TRANSFORM_H */
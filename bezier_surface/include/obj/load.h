@@ -3,51 +3,90 @@
 
 #include "model.h"
 
-#include <stdio.h>
+/**
+ * Line aligned part of the OBJ file, which is processed by a single thread
+ */
+typedef struct Chunk
+{
+    const char* text;
+    const char* end;
+    int n_vertices;
+    int n_texture_vertices;
+    int n_normals;
+    int n_triangles;
+    int vertex_offset;
+    int texture_vertex_offset;
+    int normal_offset;
+    int triangle_offset;
+    int is_valid;
+} Chunk;
 
 /**
  * Load OBJ model from file.
+ * The binary cache of the file is used when it is valid and rebuilt when it is not.
  */
 int load_model(Model* model, const char* filename);
 
 /**
- * Count the elements in the model and set counts in the structure.
+ * Read OBJ model from the text of the file.
+ */
+int read_model(Model* model, const char* filename);
+
+/**
+ * Split the text into line aligned chunks and return the number of chunks.
+ */
+int split_into_chunks(Chunk* chunks, int max_n_chunks, const char* text, const char* end);
+
+/**
+ * Count the elements in the chunk.
+ */
+void count_elements(Chunk* chunk);
+
+/**
+ * Calculate the offsets of the chunks and set the total counts in the model.
+ */
+void calc_chunk_offsets(Model* model, Chunk* chunks, int n_chunks);
+
+/**
+ * Read the elements of the chunk into their global positions of the allocated model.
+ */
+int read_elements(Model* model, const Chunk* chunk);
+
+/**
+ * Convert the negative, relative indices of the triangle to absolute ones,
+ * by the indices of the next vertex, texture vertex and normal.
  */
-void count_elements(Model* model, FILE* file);
+void resolve_relative_indices(Triangle* triangle, int vertex_index, int texture_index, int normal_index);
 
 /**
- * Read the elements of the model and fill the structure with values.
+ * Find the end of the line which starts at the text.
  */
-int read_elements(Model* model, FILE* file);
+const char* find_line_end(const char* text, const char* end);
 
 /**
  * Determine the type of the element which is stored in a line of the OBJ file.
  */
-ElementType calc_element_type(const char* text);
+ElementType calc_element_type(const char* text, const char* end);
 
 /**
  * Read the data of the vertex.
  */
-int read_vertex(Vertex* vertex, const char* text);
+int read_vertex(Vertex* vertex, const char* text, const char* end);
 
 /**
  * Read texture vertex data.
  */
-int read_texture_vertex(TextureVertex* texture_vertex, const char* text);
+int read_texture_vertex(TextureVertex* texture_vertex, const char* text, const char* end);
 
 /**
  * Read normal vector data.
  */
-int read_normal(Vertex* normal, const char* text);
+int read_normal(Vertex* normal, const char* text, const char* end);
 
 /**
  * Read triangle data.
+ * The missing texture and normal indices are set to the invalid index.
  */
-int read_triangle(Triangle* triangle, const char* text);
-
-/**
- * Check that the character is a numeric character.
- */
-int is_numeric(char c);
+int read_triangle(Triangle* triangle, const char* text, const char* end);
 
 #endif /* OBJ_LOAD_H */
@@ -0,0 +1,51 @@
+#ifndef OBJ_MESH_H
+#define OBJ_MESH_H
+
+#include "model.h"
+
+#define MESH_VERTEX_SIZE 8
+#define MESH_CACHE_SIZE 16
+#define MAX_SHORT_INDEXED_VERTICES 65536
+
+/**
+ * Indexed triangle mesh with interleaved vertex data, ready to draw
+ *
+ * A vertex consists of the position, the normal and the texture coordinates (x y z nx ny nz u v).
+ * The indices are 16 bit (unsigned short) or 32 bit (unsigned int) values, according to the index size.
+ */
+typedef struct Mesh
+{
+    int n_vertices;
+    int n_indices;
+    int index_size;
+    float* vertices;
+    void* indices;
+} Mesh;
+
+/**
+ * Initialize the mesh structure.
+ */
+void init_mesh(Mesh* mesh);
+
+/**
+ * Build the mesh from the unique vertex, texture and normal index triples of the model.
+ * The triangles are reordered for the post-transform vertex cache and the vertices for fetch locality.
+ */
+int build_mesh(Mesh* mesh, const Model* model);
+
+/**
+ * Reorder the triangles for a vertex cache of the given size (Tipsify).
+ */
+int optimize_vertex_cache(unsigned int* indices, int n_indices, int n_vertices, int cache_size);
+
+/**
+ * Renumber the vertices in the order of their first use and move the vertex data accordingly.
+ */
+int optimize_vertex_fetch(float* vertices, unsigned int* indices, int n_indices, int n_vertices);
+
+/**
+ * Release the allocated memory of the mesh.
+ */
+void free_mesh(Mesh* mesh);
+
+#endif /* OBJ_MESH_H */
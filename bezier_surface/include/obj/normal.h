@@ -0,0 +1,29 @@
+#ifndef OBJ_NORMAL_H
+#define OBJ_NORMAL_H
+
+#include "model.h"
+
+#define DEFAULT_CREASE_ANGLE 60.0
+
+/**
+ * Weighting of the triangle normals around a vertex
+ */
+typedef enum {
+    AREA_WEIGHTED_NORMALS,
+    ANGLE_WEIGHTED_NORMALS
+} NormalWeighting;
+
+/**
+ * Check whether there is a triangle point without normal index.
+ */
+int has_missing_normals(const Model* model);
+
+/**
+ * Generate the missing normals of the triangle points from the triangles around their vertices.
+ * The triangles around a vertex which are joined by edges within the crease angle (in degrees) are averaged,
+ * so the sharp edges are kept.
+ * The new normals are appended to the normals of the model.
+ */
+int generate_normals(Model* model, NormalWeighting weighting, double crease_angle);
+
+#endif /* OBJ_NORMAL_H */
@@ -0,0 +1,23 @@
+#ifndef OBJ_NUMBER_H
+#define OBJ_NUMBER_H
+
+/**
+ * Parse a decimal floating point number with optional sign, fraction and exponent.
+ * It does not depend on the locale and does not read past the end.
+ * Returns the pointer after the number or NULL, when the text does not start with a number.
+ */
+const char* parse_double(const char* text, const char* end, double* value);
+
+/**
+ * Parse a decimal integer with optional sign.
+ * Returns the pointer after the number or NULL, when the text does not start with a number
+ * or the number does not fit into an int.
+ */
+const char* parse_int(const char* text, const char* end, int* value);
+
+/**
+ * Skip the spaces and tabulators.
+ */
+const char* skip_spaces(const char* text, const char* end);
+
+#endif /* OBJ_NUMBER_H */
@@ -0,0 +1,68 @@
+#ifndef OBJ_SIMPLIFY_H
+#define OBJ_SIMPLIFY_H
+
+#include "model.h"
+
+#define MAX_LOD_LEVELS 16
+#define LOD_PIXEL_ERROR 1.0
+
+/**
+ * Settings of the simplification
+ *
+ * The locked seam vertices have different texture coordinates or normals in their triangles.
+ * The levels are simplified to the ratio of the triangles of the previous level,
+ * until the number of the triangles drops below the minimum.
+ */
+typedef struct SimplifyOptions
+{
+    int preserve_boundaries;
+    int preserve_seams;
+    double level_ratio;
+    int min_triangles;
+} SimplifyOptions;
+
+/**
+ * Simplified versions of a model from the full detail (level 0)
+ *
+ * The error of a level is the largest distance of the collapses
+ * relative to the diagonal of the bounding box.
+ */
+typedef struct LodChain
+{
+    int n_levels;
+    Model levels[MAX_LOD_LEVELS];
+    double errors[MAX_LOD_LEVELS];
+} LodChain;
+
+/**
+ * Set the default options: preserved boundaries and seams, halving levels.
+ */
+void init_simplify_options(SimplifyOptions* options);
+
+/**
+ * Simplify the model to the given number of triangles by quadric error edge collapses.
+ */
+int simplify_model(Model* result, const Model* model, int target_triangles, const SimplifyOptions* options);
+
+/**
+ * Build the levels of detail by continuing the collapses from level to level.
+ */
+int build_lod_chain(LodChain* chain, const Model* model, const SimplifyOptions* options);
+
+/**
+ * Calculate the size of an object on the screen in pixels (the field of view is in degrees).
+ */
+double calc_projected_size(double size, double distance, double fov, int viewport_height);
+
+/**
+ * Select the coarsest level whose error is below LOD_PIXEL_ERROR
+ * at the projected size (in pixels) of the bounding box diagonal.
+ */
+int select_lod(const LodChain* chain, double projected_size);
+
+/**
+ * Release the models of the chain.
+ */
+void free_lod_chain(LodChain* chain);
+
+#endif /* OBJ_SIMPLIFY_H */
@@ -0,0 +1,1110 @@
+#include "bvh.h"
+#include "parallel.h"
+
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define N_BINS 16
+#define MIN_BINS 4
+#define MAX_LEAF_SIZE 8
+#define MAX_DEPTH 60
+#define MAX_STACK_SIZE 64
+#define TRAVERSAL_COST 1.0f
+#define CACHE_LINE_SIZE 64
+#define MIN_PRIMITIVE_RANGE 16384
+#define MIN_BINNING_RANGE 65536
+#define MAX_BINNING_RANGES 64
+#define MIN_SUBTREE_SIZE 4096
+#define SUBTREES_PER_THREAD 4
+#define MAX_SUBTREES 256
+#define MIN_PACKET_RANGE 16
+
+/**
+ * Bounds and center of a triangle
+ */
+typedef struct Primitive
+{
+    float min[3];
+    float max[3];
+    float center[3];
+} Primitive;
+
+/**
+ * Bounds of the triangles and their centers in a range
+ */
+typedef struct RangeBounds
+{
+    float min[3];
+    float max[3];
+    float center_min[3];
+    float center_max[3];
+} RangeBounds;
+
+/**
+ * Bin of the triangle centers along an axis
+ */
+typedef struct Bin
+{
+    float min[3];
+    float max[3];
+    int count;
+} Bin;
+
+/**
+ * Bins of the three axes, the small nodes use fewer bins
+ */
+typedef struct Bins
+{
+    int n_bins;
+    Bin bins[3][N_BINS];
+} Bins;
+
+/**
+ * Candidate split of a node
+ */
+typedef struct Split
+{
+    int axis;
+    int bin;
+    int n_bins;
+    float cost;
+} Split;
+
+/**
+ * Range of the triangle indices which is not processed yet
+ */
+typedef struct PendingNode
+{
+    int node_index;
+    int begin;
+    int end;
+    int depth;
+} PendingNode;
+
+/**
+ * Subtree which is built into its own node array
+ */
+typedef struct Subtree
+{
+    PendingNode root;
+    BvhNode* nodes;
+    int n_nodes;
+} Subtree;
+
+typedef struct BuildJob
+{
+    const Model* model;
+    Primitive* primitives;
+    int* indices;
+    int begin;
+    int end;
+    int n_ranges;
+    const RangeBounds* bounds;
+    RangeBounds range_bounds[MAX_BINNING_RANGES];
+    Bins range_bins[MAX_BINNING_RANGES];
+    Subtree subtrees[MAX_SUBTREES];
+    Bvh* bvh;
+} BuildJob;
+
+/**
+ * Packet of rays in structure of arrays layout
+ *
+ * The maximal distance is negative in the lanes which are finished or not used.
+ */
+typedef struct RayPacket
+{
+    float origin[3][BVH_PACKET_SIZE];
+    float direction[3][BVH_PACKET_SIZE];
+    float inverse_direction[3][BVH_PACKET_SIZE];
+    float max_distance[BVH_PACKET_SIZE];
+    float u[BVH_PACKET_SIZE];
+    float v[BVH_PACKET_SIZE];
+    int triangle_index[BVH_PACKET_SIZE];
+} RayPacket;
+
+typedef struct TraceJob
+{
+    const Bvh* bvh;
+    const Ray* rays;
+    int n_rays;
+    RayHit* hits;
+    int* is_occluded;
+} TraceJob;
+
+void init_bvh(Bvh* bvh)
+{
+    memset(bvh, 0, sizeof(Bvh));
+}
+
+static float min_float(float a, float b)
+{
+    return (a < b) ? a : b;
+}
+
+static float max_float(float a, float b)
+{
+    return (a > b) ? a : b;
+}
+
+static void init_range_bounds(RangeBounds* bounds)
+{
+    int k;
+
+    for (k = 0; k < 3; ++k) {
+        bounds->min[k] = FLT_MAX;
+        bounds->max[k] = -FLT_MAX;
+        bounds->center_min[k] = FLT_MAX;
+        bounds->center_max[k] = -FLT_MAX;
+    }
+}
+
+static void merge_range_bounds(RangeBounds* bounds, const RangeBounds* other)
+{
+    int k;
+
+    for (k = 0; k < 3; ++k) {
+        bounds->min[k] = min_float(bounds->min[k], other->min[k]);
+        bounds->max[k] = max_float(bounds->max[k], other->max[k]);
+        bounds->center_min[k] = min_float(bounds->center_min[k], other->center_min[k]);
+        bounds->center_max[k] = max_float(bounds->center_max[k], other->center_max[k]);
+    }
+}
+
+static float calc_half_area(const float* min, const float* max)
+{
+    float dx = max[0] - min[0];
+    float dy = max[1] - min[1];
+    float dz = max[2] - min[2];
+
+    return dx * dy + dy * dz + dz * dx;
+}
+
+/**
+ * Calculate the bounds of the [begin, end) range of the triangles.
+ */
+static void calc_primitives(void* data, int begin, int end)
+{
+    BuildJob* job = (BuildJob*)data;
+    const Triangle* triangle;
+    const Vertex* vertex;
+    Primitive* primitive;
+    float position[3];
+    int i, j, k;
+
+    for (i = begin; i < end; ++i) {
+        triangle = &(job->model->triangles[i]);
+        primitive = &(job->primitives[i]);
+        for (j = 0; j < 3; ++j) {
+            vertex = &(job->model->vertices[triangle->points[j].vertex_index]);
+            position[0] = (float)vertex->x;
+            position[1] = (float)vertex->y;
+            position[2] = (float)vertex->z;
+            for (k = 0; k < 3; ++k) {
+                if (j == 0 || position[k] < primitive->min[k]) primitive->min[k] = position[k];
+                if (j == 0 || position[k] > primitive->max[k]) primitive->max[k] = position[k];
+            }
+        }
+        for (k = 0; k < 3; ++k) {
+            primitive->center[k] = (primitive->min[k] + primitive->max[k]) * 0.5f;
+        }
+        job->indices[i] = i;
+    }
+}
+
+/**
+ * Collect the bounds of the triangles in the [begin, end) index range.
+ */
+static void calc_bounds(const Primitive* primitives, const int* indices, int begin, int end, RangeBounds* bounds)
+{
+    const Primitive* primitive;
+    int i, k;
+
+    init_range_bounds(bounds);
+    for (i = begin; i < end; ++i) {
+        primitive = &(primitives[indices[i]]);
+        for (k = 0; k < 3; ++k) {
+            bounds->min[k] = min_float(bounds->min[k], primitive->min[k]);
+            bounds->max[k] = max_float(bounds->max[k], primitive->max[k]);
+            bounds->center_min[k] = min_float(bounds->center_min[k], primitive->center[k]);
+            bounds->center_max[k] = max_float(bounds->center_max[k], primitive->center[k]);
+        }
+    }
+}
+
+/**
+ * Calculate the scales which map the center bounds to the bins, zero for the flat axes.
+ */
+static void calc_bin_scales(const RangeBounds* bounds, int n_bins, float* scales)
+{
+    float extent;
+    int axis;
+
+    for (axis = 0; axis < 3; ++axis) {
+        extent = bounds->center_max[axis] - bounds->center_min[axis];
+        scales[axis] = (extent > 0.0f) ? (n_bins * (1.0f - FLT_EPSILON)) / extent : 0.0f;
+    }
+}
+
+static int calc_bin_count(int count)
+{
+    if (count >= N_BINS) {
+        return N_BINS;
+    }
+    return (count > MIN_BINS) ? count : MIN_BINS;
+}
+
+static int calc_bin_index(const RangeBounds* bounds, const float* scales, int n_bins, int axis, float center)
+{
+    int bin;
+
+    bin = (int)((center - bounds->center_min[axis]) * scales[axis]);
+    return (bin < n_bins) ? bin : n_bins - 1;
+}
+
+/**
+ * Put the triangles of the [begin, end) index range into the bins of the axes.
+ */
+static void fill_bins(const Primitive* primitives, const int* indices, int begin, int end, const RangeBounds* bounds, int n_bins, Bins* bins)
+{
+    const Primitive* primitive;
+    Bin* bin;
+    float scales[3];
+    int axis;
+    int i, k;
+
+    calc_bin_scales(bounds, n_bins, scales);
+    bins->n_bins = n_bins;
+    for (axis = 0; axis < 3; ++axis) {
+        for (i = 0; i < n_bins; ++i) {
+            bin = &(bins->bins[axis][i]);
+            for (k = 0; k < 3; ++k) {
+                bin->min[k] = FLT_MAX;
+                bin->max[k] = -FLT_MAX;
+            }
+            bin->count = 0;
+        }
+    }
+    for (i = begin; i < end; ++i) {
+        primitive = &(primitives[indices[i]]);
+        for (axis = 0; axis < 3; ++axis) {
+            if (scales[axis] == 0.0f) {
+                continue;
+            }
+            bin = &(bins->bins[axis][calc_bin_index(bounds, scales, n_bins, axis, primitive->center[axis])]);
+            for (k = 0; k < 3; ++k) {
+                bin->min[k] = min_float(bin->min[k], primitive->min[k]);
+                bin->max[k] = max_float(bin->max[k], primitive->max[k]);
+            }
+            ++bin->count;
+        }
+    }
+}
+
+static void merge_bins(Bins* bins, const Bins* other)
+{
+    Bin* bin;
+    const Bin* other_bin;
+    int axis;
+    int i, k;
+
+    for (axis = 0; axis < 3; ++axis) {
+        for (i = 0; i < bins->n_bins; ++i) {
+            bin = &(bins->bins[axis][i]);
+            other_bin = &(other->bins[axis][i]);
+            for (k = 0; k < 3; ++k) {
+                bin->min[k] = min_float(bin->min[k], other_bin->min[k]);
+                bin->max[k] = max_float(bin->max[k], other_bin->max[k]);
+            }
+            bin->count += other_bin->count;
+        }
+    }
+}
+
+/**
+ * Find the cheapest split between the bins by the surface area heuristic.
+ * The cost is relative to the cost of intersecting a triangle.
+ */
+static void find_split(const RangeBounds* bounds, const Bins* bins, Split* split)
+{
+    float left_min[3], left_max[3];
+    float right_min[3], right_max[3];
+    float right_areas[N_BINS];
+    int right_counts[N_BINS];
+    float parent_area;
+    float cost;
+    const Bin* bin;
+    int left_count;
+    int axis;
+    int i, k;
+
+    split->axis = -1;
+    split->bin = 0;
+    split->n_bins = bins->n_bins;
+    split->cost = FLT_MAX;
+    parent_area = calc_half_area(bounds->min, bounds->max);
+    for (axis = 0; axis < 3; ++axis) {
+        if (bounds->center_max[axis] <= bounds->center_min[axis]) {
+            continue;
+        }
+        for (k = 0; k < 3; ++k) {
+            right_min[k] = FLT_MAX;
+            right_max[k] = -FLT_MAX;
+        }
+        for (i = bins->n_bins - 1; i > 0; --i) {
+            bin = &(bins->bins[axis][i]);
+            for (k = 0; k < 3; ++k) {
+                right_min[k] = min_float(right_min[k], bin->min[k]);
+                right_max[k] = max_float(right_max[k], bin->max[k]);
+            }
+            right_counts[i - 1] = (i < bins->n_bins - 1 ? right_counts[i] : 0) + bin->count;
+            right_areas[i - 1] = calc_half_area(right_min, right_max);
+        }
+        for (k = 0; k < 3; ++k) {
+            left_min[k] = FLT_MAX;
+            left_max[k] = -FLT_MAX;
+        }
+        left_count = 0;
+        for (i = 0; i < bins->n_bins - 1; ++i) {
+            bin = &(bins->bins[axis][i]);
+            for (k = 0; k < 3; ++k) {
+                left_min[k] = min_float(left_min[k], bin->min[k]);
+                left_max[k] = max_float(left_max[k], bin->max[k]);
+            }
+            left_count += bin->count;
+            if (left_count == 0 || right_counts[i] == 0) {
+                continue;
+            }
+            cost = TRAVERSAL_COST + (calc_half_area(left_min, left_max) * left_count + right_areas[i] * right_counts[i]) / parent_area;
+            if (cost < split->cost) {
+                split->axis = axis;
+                split->bin = i;
+                split->cost = cost;
+            }
+        }
+    }
+}
+
+/**
+ * Move the triangles of the left side before the ones of the right side and return the boundary.
+ */
+static int partition(const Primitive* primitives, int* indices, int begin, int end, const RangeBounds* bounds, const Split* split)
+{
+    float scales[3];
+    int i, j;
+    int index;
+
+    if (split->axis < 0) {
+        return (begin + end) / 2;
+    }
+    calc_bin_scales(bounds, split->n_bins, scales);
+    i = begin;
+    j = end - 1;
+    while (i <= j) {
+        if (calc_bin_index(bounds, scales, split->n_bins, split->axis, primitives[indices[i]].center[split->axis]) <= split->bin) {
+            ++i;
+        }
+        else {
+            index = indices[i];
+            indices[i] = indices[j];
+            indices[j] = index;
+            --j;
+        }
+    }
+    return i;
+}
+
+static void set_node_bounds(BvhNode* node, const RangeBounds* bounds)
+{
+    memcpy(node->min, bounds->min, sizeof(node->min));
+    memcpy(node->max, bounds->max, sizeof(node->max));
+}
+
+/**
+ * Decide whether the node is a leaf and split its range otherwise.
+ * Return the boundary of the children or zero for a leaf.
+ */
+static int split_node(const Primitive* primitives, int* indices, const PendingNode* pending, const RangeBounds* bounds, const Bins* bins)
+{
+    Split split;
+    int count;
+    int middle;
+
+    count = pending->end - pending->begin;
+    if (count <= 1 || pending->depth >= MAX_DEPTH) {
+        return 0;
+    }
+    find_split(bounds, bins, &split);
+    if (count <= MAX_LEAF_SIZE && split.cost >= count) {
+        return 0;
+    }
+    middle = partition(primitives, indices, pending->begin, pending->end, bounds, &split);
+    if (middle <= pending->begin || middle >= pending->end) {
+        middle = (pending->begin + pending->end) / 2;
+    }
+    return middle;
+}
+
+/**
+ * Build the subtree recursively into the node array.
+ * The children are allocated in pairs, so that siblings share a cache line.
+ */
+static void build_subtree(const Primitive* primitives, int* indices, BvhNode* nodes, int* n_nodes, const PendingNode* pending)
+{
+    RangeBounds bounds;
+    Bins bins;
+    PendingNode child;
+    BvhNode* node;
+    int middle;
+    int children;
+
+    calc_bounds(primitives, indices, pending->begin, pending->end, &bounds);
+    fill_bins(primitives, indices, pending->begin, pending->end, &bounds,
+        calc_bin_count(pending->end - pending->begin), &bins);
+    node = &(nodes[pending->node_index]);
+    set_node_bounds(node, &bounds);
+    middle = split_node(primitives, indices, pending, &bounds, &bins);
+    if (middle == 0) {
+        node->first = pending->begin;
+        node->count = pending->end - pending->begin;
+        return;
+    }
+    children = *n_nodes;
+    *n_nodes += 2;
+    node->first = children;
+    node->count = 0;
+
+    child.depth = pending->depth + 1;
+    child.node_index = children;
+    child.begin = pending->begin;
+    child.end = middle;
+    build_subtree(primitives, indices, nodes, n_nodes, &child);
+    child.node_index = children + 1;
+    child.begin = middle;
+    child.end = pending->end;
+    build_subtree(primitives, indices, nodes, n_nodes, &child);
+}
+
+static void calc_bounds_ranges(void* data, int begin, int end)
+{
+    BuildJob* job = (BuildJob*)data;
+    int count = job->end - job->begin;
+    int range;
+
+    for (range = begin; range < end; ++range) {
+        calc_bounds(job->primitives, job->indices,
+            job->begin + (int)((long long)count * range / job->n_ranges),
+            job->begin + (int)((long long)count * (range + 1) / job->n_ranges),
+            &(job->range_bounds[range]));
+    }
+}
+
+static void fill_bins_ranges(void* data, int begin, int end)
+{
+    BuildJob* job = (BuildJob*)data;
+    int count = job->end - job->begin;
+    int range;
+
+    for (range = begin; range < end; ++range) {
+        fill_bins(job->primitives, job->indices,
+            job->begin + (int)((long long)count * range / job->n_ranges),
+            job->begin + (int)((long long)count * (range + 1) / job->n_ranges),
+            job->bounds, N_BINS, &(job->range_bins[range]));
+    }
+}
+
+/**
+ * Split a node of the top levels, where the bounds and the bins are collected in parallel.
+ */
+static int split_top_node(BuildJob* job, const PendingNode* pending)
+{
+    RangeBounds bounds;
+    Bins bins;
+    int i;
+
+    job->begin = pending->begin;
+    job->end = pending->end;
+    job->n_ranges = (pending->end - pending->begin) / MIN_BINNING_RANGE + 1;
+    if (job->n_ranges > get_thread_count()) {
+        job->n_ranges = get_thread_count();
+    }
+    if (job->n_ranges > MAX_BINNING_RANGES) {
+        job->n_ranges = MAX_BINNING_RANGES;
+    }
+
+    parallel_for(job->n_ranges, 1, calc_bounds_ranges, job);
+    bounds = job->range_bounds[0];
+    for (i = 1; i < job->n_ranges; ++i) {
+        merge_range_bounds(&bounds, &(job->range_bounds[i]));
+    }
+    job->bounds = &bounds;
+    parallel_for(job->n_ranges, 1, fill_bins_ranges, job);
+    bins = job->range_bins[0];
+    for (i = 1; i < job->n_ranges; ++i) {
+        merge_bins(&bins, &(job->range_bins[i]));
+    }
+
+    set_node_bounds(&(job->bvh->nodes[pending->node_index]), &bounds);
+    return split_node(job->primitives, job->indices, pending, &bounds, &bins);
+}
+
+static void build_subtrees(void* data, int begin, int end)
+{
+    BuildJob* job = (BuildJob*)data;
+    Subtree* subtree;
+    PendingNode root;
+    int i;
+
+    for (i = begin; i < end; ++i) {
+        subtree = &(job->subtrees[i]);
+        subtree->nodes = (BvhNode*)malloc((2 * (size_t)(subtree->root.end - subtree->root.begin) + 2) * sizeof(BvhNode));
+        if (subtree->nodes == NULL) {
+            continue;
+        }
+        root = subtree->root;
+        root.node_index = 0;
+        subtree->n_nodes = 2;
+        build_subtree(job->primitives, job->indices, subtree->nodes, &(subtree->n_nodes), &root);
+    }
+}
+
+/**
+ * Append the nodes of the subtree to the hierarchy and relocate its child indices.
+ */
+static void append_subtree(Bvh* bvh, const Subtree* subtree)
+{
+    BvhNode* node;
+    int offset;
+    int i;
+
+    offset = bvh->n_nodes - 2;
+    bvh->nodes[subtree->root.node_index] = subtree->nodes[0];
+    memcpy(&(bvh->nodes[bvh->n_nodes]), &(subtree->nodes[2]), (subtree->n_nodes - 2) * sizeof(BvhNode));
+    bvh->n_nodes += subtree->n_nodes - 2;
+    node = &(bvh->nodes[subtree->root.node_index]);
+    if (node->count == 0) {
+        node->first += offset;
+    }
+    for (i = bvh->n_nodes - (subtree->n_nodes - 2); i < bvh->n_nodes; ++i) {
+        node = &(bvh->nodes[i]);
+        if (node->count == 0) {
+            node->first += offset;
+        }
+    }
+}
+
+/**
+ * Split the largest ranges on the top levels until there are enough subtrees for the threads.
+ */
+static int build_top_levels(BuildJob* job, int* n_subtrees)
+{
+    PendingNode* pending;
+    PendingNode node;
+    Bvh* bvh = job->bvh;
+    int max_subtrees;
+    int largest;
+    int middle;
+    int i;
+
+    max_subtrees = get_thread_count() * SUBTREES_PER_THREAD;
+    if (max_subtrees > MAX_SUBTREES - 1) {
+        max_subtrees = MAX_SUBTREES - 1;
+    }
+    *n_subtrees = 1;
+    pending = &(job->subtrees[0].root);
+    pending->node_index = 0;
+    pending->begin = 0;
+    pending->end = bvh->n_triangles;
+    pending->depth = 0;
+    while (*n_subtrees < max_subtrees) {
+        largest = 0;
+        for (i = 1; i < *n_subtrees; ++i) {
+            if (job->subtrees[i].root.end - job->subtrees[i].root.begin
+                > job->subtrees[largest].root.end - job->subtrees[largest].root.begin) {
+                largest = i;
+            }
+        }
+        node = job->subtrees[largest].root;
+        if (node.end - node.begin < MIN_SUBTREE_SIZE) {
+            break;
+        }
+        middle = split_top_node(job, &node);
+        if (middle == 0) {
+            break;
+        }
+        bvh->nodes[node.node_index].first = bvh->n_nodes;
+        bvh->nodes[node.node_index].count = 0;
+        job->subtrees[largest].root.node_index = bvh->n_nodes;
+        job->subtrees[largest].root.end = middle;
+        job->subtrees[largest].root.depth = node.depth + 1;
+        job->subtrees[*n_subtrees].root.node_index = bvh->n_nodes + 1;
+        job->subtrees[*n_subtrees].root.begin = middle;
+        job->subtrees[*n_subtrees].root.end = node.end;
+        job->subtrees[*n_subtrees].root.depth = node.depth + 1;
+        bvh->n_nodes += 2;
+        ++(*n_subtrees);
+    }
+
+    for (i = 0; i < *n_subtrees; ++i) {
+        job->subtrees[i].nodes = NULL;
+    }
+    parallel_for(*n_subtrees, 1, build_subtrees, job);
+    for (i = 0; i < *n_subtrees; ++i) {
+        if (job->subtrees[i].nodes == NULL) {
+            return FALSE;
+        }
+        append_subtree(bvh, &(job->subtrees[i]));
+    }
+    return TRUE;
+}
+
+static void calc_bvh_triangles(void* data, int begin, int end)
+{
+    BuildJob* job = (BuildJob*)data;
+    const Triangle* triangle;
+    const Vertex* vertices[3];
+    BvhTriangle* bvh_triangle;
+    int i, j;
+
+    for (i = begin; i < end; ++i) {
+        bvh_triangle = &(job->bvh->triangles[i]);
+        bvh_triangle->triangle_index = job->indices[i];
+        triangle = &(job->model->triangles[job->indices[i]]);
+        for (j = 0; j < 3; ++j) {
+            vertices[j] = &(job->model->vertices[triangle->points[j].vertex_index]);
+        }
+        bvh_triangle->origin[0] = (float)vertices[0]->x;
+        bvh_triangle->origin[1] = (float)vertices[0]->y;
+        bvh_triangle->origin[2] = (float)vertices[0]->z;
+        bvh_triangle->edge_1[0] = (float)(vertices[1]->x - vertices[0]->x);
+        bvh_triangle->edge_1[1] = (float)(vertices[1]->y - vertices[0]->y);
+        bvh_triangle->edge_1[2] = (float)(vertices[1]->z - vertices[0]->z);
+        bvh_triangle->edge_2[0] = (float)(vertices[2]->x - vertices[0]->x);
+        bvh_triangle->edge_2[1] = (float)(vertices[2]->y - vertices[0]->y);
+        bvh_triangle->edge_2[2] = (float)(vertices[2]->z - vertices[0]->z);
+    }
+}
+
+int build_bvh(Bvh* bvh, const Model* model)
+{
+    BuildJob* job;
+    int n_subtrees;
+    int is_built;
+    int i;
+
+    init_bvh(bvh);
+    if (model->n_triangles == 0) {
+        return FALSE;
+    }
+    if (has_valid_indices(model) == FALSE) {
+        printf("ERROR: The triangles of the bvh refer to missing vertices!\n");
+        return FALSE;
+    }
+    job = (BuildJob*)malloc(sizeof(BuildJob));
+    if (job == NULL) {
+        return FALSE;
+    }
+    job->model = model;
+    job->bvh = bvh;
+    job->primitives = (Primitive*)malloc(model->n_triangles * sizeof(Primitive));
+    job->indices = (int*)malloc(model->n_triangles * sizeof(int));
+    bvh->node_memory = malloc((2 * (size_t)model->n_triangles + 2) * sizeof(BvhNode) + CACHE_LINE_SIZE);
+    bvh->triangles = (BvhTriangle*)malloc(model->n_triangles * sizeof(BvhTriangle));
+    if (job->primitives == NULL || job->indices == NULL || bvh->node_memory == NULL || bvh->triangles == NULL) {
+        printf("ERROR: Unable to allocate memory for the bvh!\n");
+        free(job->primitives);
+        free(job->indices);
+        free(job);
+        free_bvh(bvh);
+        return FALSE;
+    }
+    bvh->nodes = (BvhNode*)(((uintptr_t)bvh->node_memory + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+    bvh->n_triangles = model->n_triangles;
+
+    // the root is followed by an unused node to align the pairs of the children
+    memset(&(bvh->nodes[1]), 0, sizeof(BvhNode));
+    bvh->n_nodes = 2;
+    parallel_for(model->n_triangles, MIN_PRIMITIVE_RANGE, calc_primitives, job);
+    is_built = build_top_levels(job, &n_subtrees);
+    for (i = 0; i < n_subtrees; ++i) {
+        free(job->subtrees[i].nodes);
+    }
+    if (is_built) {
+        parallel_for(model->n_triangles, MIN_PRIMITIVE_RANGE, calc_bvh_triangles, job);
+    }
+    else {
+        printf("ERROR: Unable to allocate memory for the bvh!\n");
+        free_bvh(bvh);
+    }
+    free(job->primitives);
+    free(job->indices);
+    free(job);
+    return is_built;
+}
+
+/**
+ * Intersect the rays of the packet with the box of the node.
+ * Return the mask of the hitting lanes and the closest entry distance.
+ */
+static int intersect_packet_box(const RayPacket* packet, const BvhNode* node, float* entry)
+{
+    float distances[BVH_PACKET_SIZE];
+    int mask;
+    int i;
+#ifdef __SSE2__
+    __m128 near_distance = _mm_setzero_ps();
+    __m128 far_distance = _mm_loadu_ps(packet->max_distance);
+    __m128 origin, inverse_direction;
+    __m128 t_min, t_max;
+    int k;
+
+    for (k = 0; k < 3; ++k) {
+        origin = _mm_loadu_ps(packet->origin[k]);
+        inverse_direction = _mm_loadu_ps(packet->inverse_direction[k]);
+        t_min = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->min[k]), origin), inverse_direction);
+        t_max = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->max[k]), origin), inverse_direction);
+        near_distance = _mm_max_ps(near_distance, _mm_min_ps(t_min, t_max));
+        far_distance = _mm_min_ps(far_distance, _mm_max_ps(t_min, t_max));
+    }
+    mask = _mm_movemask_ps(_mm_cmple_ps(near_distance, far_distance));
+    _mm_storeu_ps(distances, near_distance);
+#else
+    float near_distance, far_distance;
+    float t_min, t_max, t;
+    int k;
+
+    mask = 0;
+    for (i = 0; i < BVH_PACKET_SIZE; ++i) {
+        near_distance = 0.0f;
+        far_distance = packet->max_distance[i];
+        for (k = 0; k < 3; ++k) {
+            t_min = (node->min[k] - packet->origin[k][i]) * packet->inverse_direction[k][i];
+            t_max = (node->max[k] - packet->origin[k][i]) * packet->inverse_direction[k][i];
+            if (t_min > t_max) {
+                t = t_min;
+                t_min = t_max;
+                t_max = t;
+            }
+            near_distance = max_float(near_distance, t_min);
+            far_distance = min_float(far_distance, t_max);
+        }
+        if (near_distance <= far_distance) {
+            mask |= 1 << i;
+        }
+        distances[i] = near_distance;
+    }
+#endif
+    *entry = FLT_MAX;
+    for (i = 0; i < BVH_PACKET_SIZE; ++i) {
+        if ((mask & (1 << i)) && distances[i] < *entry) {
+            *entry = distances[i];
+        }
+    }
+    return mask;
+}
+
+/**
+ * Intersect the rays of the packet with the triangle (Moller-Trumbore),
+ * store the closer hits and return the mask of the hitting lanes.
+ */
+static int intersect_packet_triangle(RayPacket* packet, const BvhTriangle* triangle)
+{
+    int mask;
+    int i;
+#ifdef __SSE2__
+    __m128 dx = _mm_loadu_ps(packet->direction[0]);
+    __m128 dy = _mm_loadu_ps(packet->direction[1]);
+    __m128 dz = _mm_loadu_ps(packet->direction[2]);
+    __m128 e1x = _mm_set1_ps(triangle->edge_1[0]);
+    __m128 e1y = _mm_set1_ps(triangle->edge_1[1]);
+    __m128 e1z = _mm_set1_ps(triangle->edge_1[2]);
+    __m128 e2x = _mm_set1_ps(triangle->edge_2[0]);
+    __m128 e2y = _mm_set1_ps(triangle->edge_2[1]);
+    __m128 e2z = _mm_set1_ps(triangle->edge_2[2]);
+    __m128 tx = _mm_sub_ps(_mm_loadu_ps(packet->origin[0]), _mm_set1_ps(triangle->origin[0]));
+    __m128 ty = _mm_sub_ps(_mm_loadu_ps(packet->origin[1]), _mm_set1_ps(triangle->origin[1]));
+    __m128 tz = _mm_sub_ps(_mm_loadu_ps(packet->origin[2]), _mm_set1_ps(triangle->origin[2]));
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 inverse_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverse_det);
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverse_det);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse_det);
+    __m128 max_distance = _mm_loadu_ps(packet->max_distance);
+    __m128 zero = _mm_setzero_ps();
+    __m128 hit;
+
+    hit = _mm_cmpneq_ps(det, zero);
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, zero));
+    hit = _mm_and_ps(hit, _mm_cmplt_ps(t, max_distance));
+    mask = _mm_movemask_ps(hit);
+    if (mask == 0) {
+        return 0;
+    }
+    _mm_storeu_ps(packet->max_distance, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, max_distance)));
+    _mm_storeu_ps(packet->u, _mm_or_ps(_mm_and_ps(hit, u), _mm_andnot_ps(hit, _mm_loadu_ps(packet->u))));
+    _mm_storeu_ps(packet->v, _mm_or_ps(_mm_and_ps(hit, v), _mm_andnot_ps(hit, _mm_loadu_ps(packet->v))));
+#else
+    float p[3], q[3], s[3];
+    float det, inverse_det;
+    float u, v, t;
+
+    mask = 0;
+    for (i = 0; i < BVH_PACKET_SIZE; ++i) {
+        p[0] = packet->direction[1][i] * triangle->edge_2[2] - packet->direction[2][i] * triangle->edge_2[1];
+        p[1] = packet->direction[2][i] * triangle->edge_2[0] - packet->direction[0][i] * triangle->edge_2[2];
+        p[2] = packet->direction[0][i] * triangle->edge_2[1] - packet->direction[1][i] * triangle->edge_2[0];
+        det = triangle->edge_1[0] * p[0] + triangle->edge_1[1] * p[1] + triangle->edge_1[2] * p[2];
+        if (det == 0.0f) {
+            continue;
+        }
+        inverse_det = 1.0f / det;
+        s[0] = packet->origin[0][i] - triangle->origin[0];
+        s[1] = packet->origin[1][i] - triangle->origin[1];
+        s[2] = packet->origin[2][i] - triangle->origin[2];
+        u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse_det;
+        q[0] = s[1] * triangle->edge_1[2] - s[2] * triangle->edge_1[1];
+        q[1] = s[2] * triangle->edge_1[0] - s[0] * triangle->edge_1[2];
+        q[2] = s[0] * triangle->edge_1[1] - s[1] * triangle->edge_1[0];
+        v = (packet->direction[0][i] * q[0] + packet->direction[1][i] * q[1] + packet->direction[2][i] * q[2]) * inverse_det;
+        t = (triangle->edge_2[0] * q[0] + triangle->edge_2[1] * q[1] + triangle->edge_2[2] * q[2]) * inverse_det;
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < packet->max_distance[i]) {
+            packet->max_distance[i] = t;
+            packet->u[i] = u;
+            packet->v[i] = v;
+            mask |= 1 << i;
+        }
+    }
+    if (mask == 0) {
+        return 0;
+    }
+#endif
+    for (i = 0; i < BVH_PACKET_SIZE; ++i) {
+        if (mask & (1 << i)) {
+            packet->triangle_index[i] = triangle->triangle_index;
+        }
+    }
+    return mask;
+}
+
+static float calc_max_distance(const RayPacket* packet)
+{
+    float max_distance;
+    int i;
+
+    max_distance = packet->max_distance[0];
+    for (i = 1; i < BVH_PACKET_SIZE; ++i) {
+        if (packet->max_distance[i] > max_distance) {
+            max_distance = packet->max_distance[i];
+        }
+    }
+    return max_distance;
+}
+
+/**
+ * Traverse the hierarchy with the packet, visiting the nearer child first.
+ * For the any hit queries a lane is finished by its first hit.
+ */
+static void trace_packet(const Bvh* bvh, RayPacket* packet, int is_any_hit)
+{
+    int stack[MAX_STACK_SIZE];
+    float entries[MAX_STACK_SIZE];
+    const BvhNode* node;
+    int stack_size;
+    int node_index;
+    int left_mask, right_mask;
+    float left_entry, right_entry;
+    float entry;
+    int mask;
+    int lane;
+    int i;
+
+    if (intersect_packet_box(packet, &(bvh->nodes[0]), &entry) == 0) {
+        return;
+    }
+    stack_size = 0;
+    node_index = 0;
+    while (node_index >= 0) {
+        node = &(bvh->nodes[node_index]);
+        if (node->count == 0) {
+            left_mask = intersect_packet_box(packet, &(bvh->nodes[node->first]), &left_entry);
+            right_mask = intersect_packet_box(packet, &(bvh->nodes[node->first + 1]), &right_entry);
+            if (left_mask && right_mask) {
+                if (left_entry <= right_entry) {
+                    stack[stack_size] = node->first + 1;
+                    entries[stack_size++] = right_entry;
+                    node_index = node->first;
+                }
+                else {
+                    stack[stack_size] = node->first;
+                    entries[stack_size++] = left_entry;
+                    node_index = node->first + 1;
+                }
+                continue;
+            }
+            if (left_mask) {
+                node_index = node->first;
+                continue;
+            }
+            if (right_mask) {
+                node_index = node->first + 1;
+                continue;
+            }
+        }
+        else {
+            for (i = node->first; i < node->first + node->count; ++i) {
+                mask = intersect_packet_triangle(packet, &(bvh->triangles[i]));
+                if (is_any_hit && mask) {
+                    for (lane = 0; lane < BVH_PACKET_SIZE; ++lane) {
+                        if (mask & (1 << lane)) {
+                            packet->max_distance[lane] = -1.0f;
+                        }
+                    }
+                    if (calc_max_distance(packet) < 0.0f) {
+                        return;
+                    }
+                }
+            }
+        }
+        // the far children which are behind the found hits are skipped
+        node_index = -1;
+        while (stack_size > 0) {
+            --stack_size;
+            if (entries[stack_size] <= calc_max_distance(packet)) {
+                node_index = stack[stack_size];
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Load the rays of the packet, the missing lanes are disabled.
+ */
+static void load_packet(RayPacket* packet, const Ray* rays, int n_rays)
+{
+    int i, k;
+
+    for (i = 0; i < BVH_PACKET_SIZE; ++i) {
+        packet->triangle_index[i] = NO_HIT;
+        packet->u[i] = 0.0f;
+        packet->v[i] = 0.0f;
+        if (i >= n_rays) {
+            for (k = 0; k < 3; ++k) {
+                packet->origin[k][i] = 0.0f;
+                packet->direction[k][i] = 0.0f;
+                packet->inverse_direction[k][i] = FLT_MAX;
+            }
+            packet->max_distance[i] = -1.0f;
+            continue;
+        }
+        for (k = 0; k < 3; ++k) {
+            packet->origin[k][i] = rays[i].origin[k];
+            packet->direction[k][i] = rays[i].direction[k];
+            packet->inverse_direction[k][i] = 1.0f / rays[i].direction[k];
+        }
+        packet->max_distance[i] = rays[i].max_distance;
+    }
+}
+
+static void intersect_packets(void* data, int begin, int end)
+{
+    TraceJob* job = (TraceJob*)data;
+    RayPacket packet;
+    RayHit* hit;
+    int first, count;
+    int p, i;
+
+    for (p = begin; p < end; ++p) {
+        first = p * BVH_PACKET_SIZE;
+        count = job->n_rays - first < BVH_PACKET_SIZE ? job->n_rays - first : BVH_PACKET_SIZE;
+        load_packet(&packet, &(job->rays[first]), count);
+        trace_packet(job->bvh, &packet, FALSE);
+        for (i = 0; i < count; ++i) {
+            hit = &(job->hits[first + i]);
+            hit->triangle_index = packet.triangle_index[i];
+            hit->distance = packet.max_distance[i];
+            hit->u = packet.u[i];
+            hit->v = packet.v[i];
+        }
+    }
+}
+
+static void occlude_packets(void* data, int begin, int end)
+{
+    TraceJob* job = (TraceJob*)data;
+    RayPacket packet;
+    int first, count;
+    int p, i;
+
+    for (p = begin; p < end; ++p) {
+        first = p * BVH_PACKET_SIZE;
+        count = job->n_rays - first < BVH_PACKET_SIZE ? job->n_rays - first : BVH_PACKET_SIZE;
+        load_packet(&packet, &(job->rays[first]), count);
+        trace_packet(job->bvh, &packet, TRUE);
+        for (i = 0; i < count; ++i) {
+            job->is_occluded[first + i] = (packet.triangle_index[i] != NO_HIT);
+        }
+    }
+}
+
+void intersect_rays(const Bvh* bvh, const Ray* rays, int n_rays, RayHit* hits)
+{
+    TraceJob job;
+    int i;
+
+    if (bvh->n_nodes == 0) {
+        for (i = 0; i < n_rays; ++i) {
+            hits[i].triangle_index = NO_HIT;
+            hits[i].distance = rays[i].max_distance;
+        }
+        return;
+    }
+    job.bvh = bvh;
+    job.rays = rays;
+    job.n_rays = n_rays;
+    job.hits = hits;
+    job.is_occluded = NULL;
+    parallel_for((n_rays + BVH_PACKET_SIZE - 1) / BVH_PACKET_SIZE, MIN_PACKET_RANGE, intersect_packets, &job);
+}
+
+void occlude_rays(const Bvh* bvh, const Ray* rays, int n_rays, int* is_occluded)
+{
+    TraceJob job;
+
+    if (bvh->n_nodes == 0) {
+        memset(is_occluded, 0, n_rays * sizeof(int));
+        return;
+    }
+    job.bvh = bvh;
+    job.rays = rays;
+    job.n_rays = n_rays;
+    job.hits = NULL;
+    job.is_occluded = is_occluded;
+    parallel_for((n_rays + BVH_PACKET_SIZE - 1) / BVH_PACKET_SIZE, MIN_PACKET_RANGE, occlude_packets, &job);
+}
+
+void free_bvh(Bvh* bvh)
+{
+    if (bvh->node_memory != NULL) {
+        free(bvh->node_memory);
+    }
+    if (bvh->triangles != NULL) {
+        free(bvh->triangles);
+    }
+    init_bvh(bvh);
+}
@@ -0,0 +1,294 @@
+#include "cache.h"
+#include "mapping.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#define CACHE_MAGIC "OBJCACHE"
+#define BYTE_ORDER_MARK 0x01020304u
+
+#define VERTEX_SECTION 0
+#define TEXTURE_VERTEX_SECTION 1
+#define NORMAL_SECTION 2
+#define TRIANGLE_SECTION 3
+#define N_SECTIONS 4
+
+/**
+ * Location of an element array in the cache file
+ */
+typedef struct CacheSection
+{
+    uint64_t offset;
+    uint64_t size;
+} CacheSection;
+
+/**
+ * Header at the start of the cache file
+ *
+ * The sections store the arrays of the model in their in-memory layout,
+ * including the unused first elements of the vertex arrays.
+ * The hashes of the source file and of the sections catch the edits which keep the size and the time
+ * of the source, and the truncated or corrupted sections.
+ */
+typedef struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t element_sizes[N_SECTIONS];
+    uint64_t source_size;
+    int64_t source_mtime;
+    int32_t n_vertices;
+    int32_t n_texture_vertices;
+    int32_t n_normals;
+    int32_t n_triangles;
+    CacheSection sections[N_SECTIONS];
+    uint64_t file_size;
+    uint64_t source_hash;
+    uint64_t payload_hash;
+} CacheHeader;
+
+#define HASH_SEED 14695981039346656037ULL
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/**
+ * Continue the hash with the bytes of the data.
+ * The bytes are consumed as 64 bit words, so the whole source file can be hashed on every load.
+ */
+static uint64_t calc_hash(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t word;
+    size_t i;
+
+    for (i = 0; i + sizeof(word) <= size; i += sizeof(word)) {
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * HASH_MULTIPLIER;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * HASH_MULTIPLIER;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+static int calc_source_hash(const char* filename, uint64_t* hash)
+{
+    FileMapping mapping;
+
+    if (map_file(&mapping, filename) == FALSE) {
+        return FALSE;
+    }
+    *hash = calc_hash(mapping.data, mapping.size, HASH_SEED);
+    unmap_file(&mapping);
+    return TRUE;
+}
+
+static uint64_t calc_payload_hash(const CacheHeader* header, const void* const* arrays)
+{
+    uint64_t hash;
+    int i;
+
+    hash = HASH_SEED;
+    for (i = 0; i < N_SECTIONS; ++i) {
+        hash = calc_hash(arrays[i], header->sections[i].size, hash);
+    }
+    return hash;
+}
+
+static uint64_t align_offset(uint64_t offset)
+{
+    return (offset + MODEL_CACHE_ALIGNMENT - 1) / MODEL_CACHE_ALIGNMENT * MODEL_CACHE_ALIGNMENT;
+}
+
+static void init_header(CacheHeader* header, const Model* model, const struct stat* source_status, uint64_t source_hash)
+{
+    uint64_t offset;
+    int i;
+
+    memset(header, 0, sizeof(CacheHeader));
+    memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+    header->version = MODEL_CACHE_VERSION;
+    header->byte_order = BYTE_ORDER_MARK;
+    header->element_sizes[VERTEX_SECTION] = sizeof(Vertex);
+    header->element_sizes[TEXTURE_VERTEX_SECTION] = sizeof(TextureVertex);
+    header->element_sizes[NORMAL_SECTION] = sizeof(Vertex);
+    header->element_sizes[TRIANGLE_SECTION] = sizeof(Triangle);
+    header->source_size = (uint64_t)source_status->st_size;
+    header->source_mtime = (int64_t)source_status->st_mtime;
+    header->n_vertices = model->n_vertices;
+    header->n_texture_vertices = model->n_texture_vertices;
+    header->n_normals = model->n_normals;
+    header->n_triangles = model->n_triangles;
+    header->sections[VERTEX_SECTION].size = (uint64_t)(model->n_vertices + 1) * sizeof(Vertex);
+    header->sections[TEXTURE_VERTEX_SECTION].size = (uint64_t)(model->n_texture_vertices + 1) * sizeof(TextureVertex);
+    header->sections[NORMAL_SECTION].size = (uint64_t)(model->n_normals + 1) * sizeof(Vertex);
+    header->sections[TRIANGLE_SECTION].size = (uint64_t)model->n_triangles * sizeof(Triangle);
+
+    offset = sizeof(CacheHeader);
+    for (i = 0; i < N_SECTIONS; ++i) {
+        offset = align_offset(offset);
+        header->sections[i].offset = offset;
+        offset += header->sections[i].size;
+    }
+    header->file_size = offset;
+    header->source_hash = source_hash;
+}
+
+int get_cache_filename(char* cache_filename, size_t max_length, const char* filename)
+{
+    int length;
+
+    length = snprintf(cache_filename, max_length, "%s%s", filename, MODEL_CACHE_EXTENSION);
+    if (length < 0 || (size_t)length >= max_length) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int load_model_cache(Model* model, const char* cache_filename, const char* filename)
+{
+    struct stat source_status;
+    CacheHeader expected;
+    const CacheHeader* header;
+    const void* arrays[N_SECTIONS];
+    uint64_t source_hash;
+    FileMapping mapping;
+    Model counts;
+    int i;
+
+    if (stat(filename, &source_status) != 0 || calc_source_hash(filename, &source_hash) == FALSE) {
+        return FALSE;
+    }
+    if (map_file(&mapping, cache_filename) == FALSE) {
+        return FALSE;
+    }
+    if (mapping.size < sizeof(CacheHeader)) {
+        unmap_file(&mapping);
+        return FALSE;
+    }
+    header = (const CacheHeader*)mapping.data;
+    if (header->n_vertices < 0 || header->n_texture_vertices < 0
+        || header->n_normals < 0 || header->n_triangles < 0) {
+        unmap_file(&mapping);
+        return FALSE;
+    }
+
+    // the header of a valid cache is the same as the one which would be written now, and its sections are intact
+    counts.n_vertices = header->n_vertices;
+    counts.n_texture_vertices = header->n_texture_vertices;
+    counts.n_normals = header->n_normals;
+    counts.n_triangles = header->n_triangles;
+    init_header(&expected, &counts, &source_status, source_hash);
+    expected.payload_hash = header->payload_hash;
+    if (memcmp(header, &expected, sizeof(CacheHeader)) != 0 || mapping.size != expected.file_size) {
+        unmap_file(&mapping);
+        return FALSE;
+    }
+    for (i = 0; i < N_SECTIONS; ++i) {
+        arrays[i] = mapping.data + header->sections[i].offset;
+    }
+    if (calc_payload_hash(header, arrays) != header->payload_hash) {
+        unmap_file(&mapping);
+        return FALSE;
+    }
+
+    init_model(model);
+    model->n_vertices = header->n_vertices;
+    model->n_texture_vertices = header->n_texture_vertices;
+    model->n_normals = header->n_normals;
+    model->n_triangles = header->n_triangles;
+    model->vertices = (Vertex*)(mapping.data + header->sections[VERTEX_SECTION].offset);
+    model->texture_vertices = (TextureVertex*)(mapping.data + header->sections[TEXTURE_VERTEX_SECTION].offset);
+    model->normals = (Vertex*)(mapping.data + header->sections[NORMAL_SECTION].offset);
+    model->triangles = (Triangle*)(mapping.data + header->sections[TRIANGLE_SECTION].offset);
+    model->cache = mapping;
+    // the payload hash does not protect against a crafted cache, and the indices are cheap to check
+    if (has_valid_indices(model) == FALSE) {
+        free_model(model);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Write the section and the padding before it.
+ */
+static int write_section(FILE* file, const void* data, const CacheSection* section)
+{
+    static const char padding[MODEL_CACHE_ALIGNMENT] = {0};
+    long position;
+
+    position = ftell(file);
+    if (position < 0 || (uint64_t)position > section->offset) {
+        return FALSE;
+    }
+    if (fwrite(padding, 1, section->offset - position, file) != section->offset - position) {
+        return FALSE;
+    }
+    if (section->size > 0 && fwrite(data, 1, section->size, file) != section->size) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int save_model_cache(const Model* model, const char* cache_filename, const char* filename)
+{
+    struct stat source_status;
+    CacheHeader header;
+    const void* arrays[N_SECTIONS];
+    uint64_t source_hash;
+    char temp_filename[1024];
+    FILE* file;
+    int success;
+
+    if (stat(filename, &source_status) != 0 || calc_source_hash(filename, &source_hash) == FALSE) {
+        return FALSE;
+    }
+    init_header(&header, model, &source_status, source_hash);
+    arrays[VERTEX_SECTION] = model->vertices;
+    arrays[TEXTURE_VERTEX_SECTION] = model->texture_vertices;
+    arrays[NORMAL_SECTION] = model->normals;
+    arrays[TRIANGLE_SECTION] = model->triangles;
+    header.payload_hash = calc_payload_hash(&header, arrays);
+
+    // write into a temporary file first, so concurrent loaders never see a partial cache
+    if (snprintf(temp_filename, sizeof(temp_filename), "%s.%d.tmp", cache_filename, (int)getpid()) >= (int)sizeof(temp_filename)) {
+        return FALSE;
+    }
+    file = fopen(temp_filename, "wb");
+    if (file == NULL) {
+        return FALSE;
+    }
+    success = (fwrite(&header, sizeof(CacheHeader), 1, file) == 1)
+        && write_section(file, arrays[VERTEX_SECTION], &(header.sections[VERTEX_SECTION]))
+        && write_section(file, arrays[TEXTURE_VERTEX_SECTION], &(header.sections[TEXTURE_VERTEX_SECTION]))
+        && write_section(file, arrays[NORMAL_SECTION], &(header.sections[NORMAL_SECTION]))
+        && write_section(file, arrays[TRIANGLE_SECTION], &(header.sections[TRIANGLE_SECTION]));
+    if (fclose(file) != 0) {
+        success = FALSE;
+    }
+    if (success == FALSE) {
+        remove(temp_filename);
+        return FALSE;
+    }
+#ifdef _WIN32
+    remove(cache_filename);
+#endif
+    if (rename(temp_filename, cache_filename) != 0) {
+        remove(temp_filename);
+        return FALSE;
+    }
+    return TRUE;
+}
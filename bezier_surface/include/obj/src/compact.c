@@ -0,0 +1,329 @@
+#include "compact.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define QUANTIZATION_STEPS 65535.0f
+#define NORMAL_STEPS 32767.0f
+#define MAX_VARINT_SIZE 5
+#define MIN_DECODE_RANGE 16384
+
+void init_compact_mesh(CompactMesh* compact_mesh)
+{
+    memset(compact_mesh, 0, sizeof(CompactMesh));
+}
+
+/**
+ * Find the offset and the scale which map the [min, max] range to [0, 65535].
+ */
+static void calc_quantization(const float* vertices, int n_vertices, int component, float* offset, float* scale)
+{
+    float min_value;
+    float max_value;
+    float value;
+    int i;
+
+    min_value = vertices[component];
+    max_value = vertices[component];
+    for (i = 1; i < n_vertices; ++i) {
+        value = vertices[i * MESH_VERTEX_SIZE + component];
+        min_value = fminf(min_value, value);
+        max_value = fmaxf(max_value, value);
+    }
+    *offset = min_value;
+    *scale = (max_value > min_value) ? (max_value - min_value) / QUANTIZATION_STEPS : 1.0f;
+}
+
+static unsigned short quantize(float value, float offset, float scale)
+{
+    return (unsigned short)fminf(fmaxf((value - offset) / scale + 0.5f, 0.0f), QUANTIZATION_STEPS);
+}
+
+static short quantize_snorm(float value)
+{
+    return (short)lrintf(fminf(fmaxf(value, -1.0f), 1.0f) * NORMAL_STEPS);
+}
+
+/**
+ * Project the normal onto the octahedron and unfold the lower half onto the plane.
+ */
+static void encode_octahedral(const float* normal, short* encoded)
+{
+    float sum;
+    float u, v;
+    float folded_u;
+
+    sum = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    if (sum == 0.0f) {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+    u = normal[0] / sum;
+    v = normal[1] / sum;
+    if (normal[2] < 0.0f) {
+        folded_u = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        v = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = folded_u;
+    }
+    encoded[0] = quantize_snorm(u);
+    encoded[1] = quantize_snorm(v);
+}
+
+static size_t write_varint(unsigned char* data, uint32_t value)
+{
+    size_t size;
+
+    size = 0;
+    while (value >= 0x80) {
+        data[size++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    data[size++] = (unsigned char)value;
+    return size;
+}
+
+static unsigned int get_index(const Mesh* mesh, int i)
+{
+    if (mesh->index_size == sizeof(unsigned short)) {
+        return ((const unsigned short*)mesh->indices)[i];
+    }
+    return ((const unsigned int*)mesh->indices)[i];
+}
+
+int encode_compact_mesh(CompactMesh* compact_mesh, const Mesh* mesh)
+{
+    const float* vertex;
+    CompactVertex* compact_vertex;
+    unsigned char* index_data;
+    int32_t delta;
+    unsigned int previous;
+    unsigned int index;
+    int k;
+    int i;
+
+    init_compact_mesh(compact_mesh);
+    compact_mesh->vertices = (CompactVertex*)malloc((mesh->n_vertices + 1) * sizeof(CompactVertex));
+    index_data = (unsigned char*)malloc((size_t)mesh->n_indices * MAX_VARINT_SIZE + 1);
+    if (compact_mesh->vertices == NULL || index_data == NULL) {
+        free(index_data);
+        free_compact_mesh(compact_mesh);
+        return FALSE;
+    }
+    compact_mesh->n_vertices = mesh->n_vertices;
+    compact_mesh->n_indices = mesh->n_indices;
+
+    for (k = 0; k < 3; ++k) {
+        calc_quantization(mesh->vertices, mesh->n_vertices, k,
+            &(compact_mesh->position_offset[k]), &(compact_mesh->position_scale[k]));
+    }
+    compact_mesh->position_offset[3] = 0.0f;
+    compact_mesh->position_scale[3] = 0.0f;
+    for (k = 0; k < 2; ++k) {
+        calc_quantization(mesh->vertices, mesh->n_vertices, 6 + k,
+            &(compact_mesh->texture_offset[k]), &(compact_mesh->texture_scale[k]));
+    }
+
+    for (i = 0; i < mesh->n_vertices; ++i) {
+        vertex = &(mesh->vertices[i * MESH_VERTEX_SIZE]);
+        compact_vertex = &(compact_mesh->vertices[i]);
+        for (k = 0; k < 3; ++k) {
+            compact_vertex->position[k] = quantize(vertex[k],
+                compact_mesh->position_offset[k], compact_mesh->position_scale[k]);
+        }
+        compact_vertex->position[3] = 0;
+        encode_octahedral(&(vertex[3]), compact_vertex->normal);
+        for (k = 0; k < 2; ++k) {
+            compact_vertex->texture[k] = quantize(vertex[6 + k],
+                compact_mesh->texture_offset[k], compact_mesh->texture_scale[k]);
+        }
+    }
+
+    // after the fetch optimization the consecutive indices are close to each other
+    previous = 0;
+    compact_mesh->index_data_size = 0;
+    for (i = 0; i < mesh->n_indices; ++i) {
+        index = get_index(mesh, i);
+        delta = (int32_t)(index - previous);
+        compact_mesh->index_data_size += write_varint(&(index_data[compact_mesh->index_data_size]),
+            ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        previous = index;
+    }
+    compact_mesh->index_data = (unsigned char*)realloc(index_data, compact_mesh->index_data_size + 1);
+    if (compact_mesh->index_data == NULL) {
+        compact_mesh->index_data = index_data;
+    }
+
+    return TRUE;
+}
+
+typedef struct DecodeJob
+{
+    const CompactMesh* compact_mesh;
+    float* vertices;
+} DecodeJob;
+
+/**
+ * Unfold the octahedral encoded normal and normalize it.
+ */
+static void decode_octahedral(const short* encoded, float* normal)
+{
+    float x, y, z;
+    float folded_x;
+    float length;
+
+    x = encoded[0] / NORMAL_STEPS;
+    y = encoded[1] / NORMAL_STEPS;
+    z = 1.0f - fabsf(x) - fabsf(y);
+    if (z < 0.0f) {
+        folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+    }
+    length = sqrtf(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+static void decode_vertex_range(void* data, int begin, int end)
+{
+    DecodeJob* job = (DecodeJob*)data;
+    const CompactMesh* compact_mesh = job->compact_mesh;
+    const CompactVertex* compact_vertex;
+    float* vertex;
+    int i;
+#ifdef __SSE2__
+    // the position and the texture coordinates of a vertex are converted in one register each
+    __m128 position_offset = _mm_loadu_ps(compact_mesh->position_offset);
+    __m128 position_scale = _mm_loadu_ps(compact_mesh->position_scale);
+    __m128 texture_offset = _mm_setr_ps(compact_mesh->texture_offset[0], compact_mesh->texture_offset[1], 0.0f, 0.0f);
+    __m128 texture_scale = _mm_setr_ps(compact_mesh->texture_scale[0], compact_mesh->texture_scale[1], 0.0f, 0.0f);
+    __m128i zero = _mm_setzero_si128();
+    __m128i packed;
+    __m128 position, texture;
+    float converted[4];
+
+    for (i = begin; i < end; ++i) {
+        compact_vertex = &(compact_mesh->vertices[i]);
+        vertex = &(job->vertices[i * MESH_VERTEX_SIZE]);
+        packed = _mm_loadu_si128((const __m128i*)compact_vertex);
+        position = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero));
+        position = _mm_add_ps(_mm_mul_ps(position, position_scale), position_offset);
+        texture = _mm_cvtepi32_ps(_mm_unpackhi_epi16(_mm_srli_si128(packed, 4), zero));
+        texture = _mm_add_ps(_mm_mul_ps(texture, texture_scale), texture_offset);
+        _mm_storeu_ps(converted, position);
+        vertex[0] = converted[0];
+        vertex[1] = converted[1];
+        vertex[2] = converted[2];
+        decode_octahedral(compact_vertex->normal, &(vertex[3]));
+        _mm_storel_pi((__m64*)&(vertex[6]), texture);
+    }
+#else
+    int k;
+
+    for (i = begin; i < end; ++i) {
+        compact_vertex = &(compact_mesh->vertices[i]);
+        vertex = &(job->vertices[i * MESH_VERTEX_SIZE]);
+        for (k = 0; k < 3; ++k) {
+            vertex[k] = compact_vertex->position[k] * compact_mesh->position_scale[k] + compact_mesh->position_offset[k];
+        }
+        decode_octahedral(compact_vertex->normal, &(vertex[3]));
+        for (k = 0; k < 2; ++k) {
+            vertex[6 + k] = compact_vertex->texture[k] * compact_mesh->texture_scale[k] + compact_mesh->texture_offset[k];
+        }
+    }
+#endif
+}
+
+void decode_compact_vertices(const CompactMesh* compact_mesh, float* vertices)
+{
+    DecodeJob job;
+
+    job.compact_mesh = compact_mesh;
+    job.vertices = vertices;
+    parallel_for(compact_mesh->n_vertices, MIN_DECODE_RANGE, decode_vertex_range, &job);
+}
+
+int decode_compact_indices(const CompactMesh* compact_mesh, void* indices, int index_size)
+{
+    const unsigned char* data;
+    const unsigned char* end;
+    uint32_t value;
+    uint32_t index;
+    int shift;
+    int i;
+
+    data = compact_mesh->index_data;
+    end = data + compact_mesh->index_data_size;
+    index = 0;
+    for (i = 0; i < compact_mesh->n_indices; ++i) {
+        // most deltas fit into a single byte
+        value = 0;
+        shift = 0;
+        while (data < end && (*data & 0x80)) {
+            value |= (uint32_t)(*data & 0x7F) << shift;
+            shift += 7;
+            ++data;
+        }
+        if (data == end) {
+            return FALSE;
+        }
+        value |= (uint32_t)(*data) << shift;
+        ++data;
+        index += (value >> 1) ^ (0u - (value & 1));
+        if (index_size == sizeof(unsigned short)) {
+            ((unsigned short*)indices)[i] = (unsigned short)index;
+        }
+        else {
+            ((unsigned int*)indices)[i] = index;
+        }
+    }
+    return TRUE;
+}
+
+int decode_compact_mesh(const CompactMesh* compact_mesh, Mesh* mesh)
+{
+    init_mesh(mesh);
+    mesh->index_size = (compact_mesh->n_vertices <= MAX_SHORT_INDEXED_VERTICES)
+        ? sizeof(unsigned short) : sizeof(unsigned int);
+    mesh->vertices = (float*)malloc((compact_mesh->n_vertices + 1) * MESH_VERTEX_SIZE * sizeof(float));
+    mesh->indices = malloc(((size_t)compact_mesh->n_indices + 1) * mesh->index_size);
+    if (mesh->vertices == NULL || mesh->indices == NULL) {
+        free_mesh(mesh);
+        return FALSE;
+    }
+    decode_compact_vertices(compact_mesh, mesh->vertices);
+    if (decode_compact_indices(compact_mesh, mesh->indices, mesh->index_size) == FALSE) {
+        free_mesh(mesh);
+        return FALSE;
+    }
+    mesh->n_vertices = compact_mesh->n_vertices;
+    mesh->n_indices = compact_mesh->n_indices;
+    return TRUE;
+}
+
+size_t calc_compact_mesh_size(const CompactMesh* compact_mesh)
+{
+    return sizeof(CompactMesh)
+        + compact_mesh->n_vertices * sizeof(CompactVertex)
+        + compact_mesh->index_data_size;
+}
+
+void free_compact_mesh(CompactMesh* compact_mesh)
+{
+    if (compact_mesh->vertices != NULL) {
+        free(compact_mesh->vertices);
+    }
+    if (compact_mesh->index_data != NULL) {
+        free(compact_mesh->index_data);
+    }
+    init_compact_mesh(compact_mesh);
+}
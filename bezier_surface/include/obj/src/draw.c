@@ -39,3 +39,25 @@ void draw_triangles(const Model* model)
 
     glEnd();
 }
+
+void draw_mesh(const Mesh* mesh)
+{
+    GLsizei stride;
+    GLenum index_type;
+
+    stride = MESH_VERTEX_SIZE * sizeof(float);
+    index_type = (mesh->index_size == sizeof(unsigned short)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    glVertexPointer(3, GL_FLOAT, stride, mesh->vertices);
+    glNormalPointer(GL_FLOAT, stride, mesh->vertices + 3);
+    glTexCoordPointer(2, GL_FLOAT, stride, mesh->vertices + 6);
+    glDrawElements(GL_TRIANGLES, mesh->n_indices, index_type, mesh->indices);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
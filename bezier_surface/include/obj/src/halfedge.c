@@ -0,0 +1,323 @@
+#include "halfedge.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_HALF_EDGE_RANGE 16384
+#define MIN_BUCKET_RANGE 4096
+#define MAX_BUCKET_RANGES 64
+#define MAX_INSERTION_SORT_SIZE 16
+
+/**
+ * Half edge in the bucket of its smaller vertex, keyed by the other vertex
+ */
+typedef struct EdgeEntry
+{
+    int other_vertex;
+    int half_edge;
+} EdgeEntry;
+
+typedef struct MatchJob
+{
+    const Model* model;
+    HalfEdgeMesh* mesh;
+    const int* bucket_offsets;
+    EdgeEntry* entries;
+    int n_buckets;
+    int n_ranges;
+    int n_non_manifold_edges[MAX_BUCKET_RANGES];
+} MatchJob;
+
+void init_half_edge_mesh(HalfEdgeMesh* mesh)
+{
+    memset(mesh, 0, sizeof(HalfEdgeMesh));
+}
+
+static int compare_edge_entries(const void* a, const void* b)
+{
+    const EdgeEntry* entry_a = (const EdgeEntry*)a;
+    const EdgeEntry* entry_b = (const EdgeEntry*)b;
+
+    if (entry_a->other_vertex != entry_b->other_vertex) {
+        return (entry_a->other_vertex < entry_b->other_vertex) ? -1 : 1;
+    }
+    return (entry_a->half_edge < entry_b->half_edge) ? -1 : (entry_a->half_edge > entry_b->half_edge);
+}
+
+/**
+ * Sort the bucket by the other vertex, most buckets are short.
+ */
+static void sort_bucket(EdgeEntry* entries, int count)
+{
+    EdgeEntry entry;
+    int i, j;
+
+    if (count > MAX_INSERTION_SORT_SIZE) {
+        qsort(entries, count, sizeof(EdgeEntry), compare_edge_entries);
+        return;
+    }
+    for (i = 1; i < count; ++i) {
+        entry = entries[i];
+        j = i;
+        while (j > 0 && compare_edge_entries(&entry, &entries[j - 1]) < 0) {
+            entries[j] = entries[j - 1];
+            --j;
+        }
+        entries[j] = entry;
+    }
+}
+
+static void set_half_edge_vertices(void* data, int begin, int end)
+{
+    MatchJob* job = (MatchJob*)data;
+    int h;
+
+    for (h = begin; h < end; ++h) {
+        job->mesh->vertices[h] = job->model->triangles[h / 3].points[h % 3].vertex_index;
+        job->mesh->twins[h] = NO_HALF_EDGE;
+    }
+}
+
+/**
+ * Pair the opposite half edges in the runs of the same edge.
+ * A run of more than two half edges is a non-manifold edge.
+ */
+static int match_run(HalfEdgeMesh* mesh, const EdgeEntry* run, int count)
+{
+    int i, j;
+    int h, g;
+
+    for (i = 0; i < count; ++i) {
+        h = run[i].half_edge;
+        if (mesh->twins[h] != NO_HALF_EDGE) {
+            continue;
+        }
+        for (j = i + 1; j < count; ++j) {
+            g = run[j].half_edge;
+            if (mesh->twins[g] == NO_HALF_EDGE && mesh->vertices[g] != mesh->vertices[h]) {
+                mesh->twins[h] = g;
+                mesh->twins[g] = h;
+                break;
+            }
+        }
+    }
+    return count > 2;
+}
+
+/**
+ * Match the edges in the buckets of the [begin, end) ranges of the vertices.
+ */
+static void match_buckets(void* data, int begin, int end)
+{
+    MatchJob* job = (MatchJob*)data;
+    EdgeEntry* entries;
+    int first, last;
+    int count;
+    int run;
+    int range;
+    int v, i;
+
+    for (range = begin; range < end; ++range) {
+        first = (int)((long long)job->n_buckets * range / job->n_ranges);
+        last = (int)((long long)job->n_buckets * (range + 1) / job->n_ranges);
+        job->n_non_manifold_edges[range] = 0;
+        for (v = first; v < last; ++v) {
+            entries = &(job->entries[job->bucket_offsets[v]]);
+            count = job->bucket_offsets[v + 1] - job->bucket_offsets[v];
+            sort_bucket(entries, count);
+            for (i = 0; i < count; i += run) {
+                run = 1;
+                while (i + run < count && entries[i + run].other_vertex == entries[i].other_vertex) {
+                    ++run;
+                }
+                if (run > 1 && entries[i].other_vertex >= 0) {
+                    job->n_non_manifold_edges[range] += match_run(job->mesh, &(entries[i]), run);
+                }
+            }
+        }
+    }
+}
+
+static int allocate_half_edge_mesh(HalfEdgeMesh* mesh, const Model* model)
+{
+    mesh->n_vertices = model->n_vertices;
+    mesh->n_half_edges = model->n_triangles * 3;
+    mesh->vertices = (int*)malloc((mesh->n_half_edges + 1) * sizeof(int));
+    mesh->twins = (int*)malloc((mesh->n_half_edges + 1) * sizeof(int));
+    mesh->vertex_edges = (int*)malloc((mesh->n_vertices + 1) * sizeof(int));
+    if (mesh->vertices == NULL || mesh->twins == NULL || mesh->vertex_edges == NULL) {
+        free_half_edge_mesh(mesh);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int build_half_edge_mesh(HalfEdgeMesh* mesh, const Model* model)
+{
+    MatchJob job;
+    int* bucket_offsets;
+    int v, w;
+    int h;
+
+    init_half_edge_mesh(mesh);
+    if (has_valid_indices(model) == FALSE) {
+        printf("ERROR: The triangles of the half edges refer to missing vertices!\n");
+        return FALSE;
+    }
+    if (allocate_half_edge_mesh(mesh, model) == FALSE) {
+        printf("ERROR: Unable to allocate memory for the half edges!\n");
+        return FALSE;
+    }
+    bucket_offsets = (int*)calloc(mesh->n_vertices + 2, sizeof(int));
+    job.entries = (EdgeEntry*)malloc((mesh->n_half_edges + 1) * sizeof(EdgeEntry));
+    if (bucket_offsets == NULL || job.entries == NULL) {
+        printf("ERROR: Unable to allocate memory for the half edges!\n");
+        free(bucket_offsets);
+        free(job.entries);
+        free_half_edge_mesh(mesh);
+        return FALSE;
+    }
+    job.model = model;
+    job.mesh = mesh;
+    job.bucket_offsets = bucket_offsets;
+    parallel_for(mesh->n_half_edges, MIN_HALF_EDGE_RANGE, set_half_edge_vertices, &job);
+
+    // counting sort of the edges by their smaller vertex
+    for (h = 0; h < mesh->n_half_edges; ++h) {
+        v = mesh->vertices[h];
+        w = mesh->vertices[NEXT_HALF_EDGE(h)];
+        ++bucket_offsets[(v < w ? v : w) + 1];
+    }
+    for (v = 0; v <= mesh->n_vertices; ++v) {
+        bucket_offsets[v + 1] += bucket_offsets[v];
+    }
+    for (h = 0; h < mesh->n_half_edges; ++h) {
+        v = mesh->vertices[h];
+        w = mesh->vertices[NEXT_HALF_EDGE(h)];
+        if (v == w) {
+            // the degenerate edges are never matched
+            job.entries[bucket_offsets[v]].other_vertex = -1;
+            job.entries[bucket_offsets[v]++].half_edge = h;
+        }
+        else if (v < w) {
+            job.entries[bucket_offsets[v]].other_vertex = w;
+            job.entries[bucket_offsets[v]++].half_edge = h;
+        }
+        else {
+            job.entries[bucket_offsets[w]].other_vertex = v;
+            job.entries[bucket_offsets[w]++].half_edge = h;
+        }
+    }
+    memmove(&(bucket_offsets[1]), bucket_offsets, (mesh->n_vertices + 1) * sizeof(int));
+    bucket_offsets[0] = 0;
+
+    job.n_buckets = mesh->n_vertices + 1;
+    job.n_ranges = job.n_buckets / MIN_BUCKET_RANGE + 1;
+    if (job.n_ranges > get_thread_count()) {
+        job.n_ranges = get_thread_count();
+    }
+    if (job.n_ranges > MAX_BUCKET_RANGES) {
+        job.n_ranges = MAX_BUCKET_RANGES;
+    }
+    parallel_for(job.n_ranges, 1, match_buckets, &job);
+    mesh->n_non_manifold_edges = 0;
+    for (v = 0; v < job.n_ranges; ++v) {
+        mesh->n_non_manifold_edges += job.n_non_manifold_edges[v];
+    }
+
+    // the boundary half edges are preferred, so that the fans can be walked in one direction
+    for (v = 0; v <= mesh->n_vertices; ++v) {
+        mesh->vertex_edges[v] = NO_HALF_EDGE;
+    }
+    mesh->n_boundary_edges = 0;
+    for (h = 0; h < mesh->n_half_edges; ++h) {
+        v = mesh->vertices[h];
+        if (mesh->twins[h] == NO_HALF_EDGE) {
+            ++mesh->n_boundary_edges;
+            mesh->vertex_edges[v] = h;
+        }
+        else if (mesh->vertex_edges[v] == NO_HALF_EDGE) {
+            mesh->vertex_edges[v] = h;
+        }
+    }
+
+    free(bucket_offsets);
+    free(job.entries);
+    return TRUE;
+}
+
+int get_target_vertex(const HalfEdgeMesh* mesh, int half_edge)
+{
+    return mesh->vertices[NEXT_HALF_EDGE(half_edge)];
+}
+
+int is_boundary_vertex(const HalfEdgeMesh* mesh, int vertex_index)
+{
+    int half_edge;
+
+    half_edge = mesh->vertex_edges[vertex_index];
+    return half_edge != NO_HALF_EDGE && mesh->twins[half_edge] == NO_HALF_EDGE;
+}
+
+int collect_vertex_neighbours(const HalfEdgeMesh* mesh, int vertex_index, int* neighbours, int max_neighbours)
+{
+    int first;
+    int half_edge;
+    int incoming;
+    int n_neighbours;
+
+    first = mesh->vertex_edges[vertex_index];
+    if (first == NO_HALF_EDGE) {
+        return 0;
+    }
+    n_neighbours = 0;
+    half_edge = first;
+    do {
+        if (n_neighbours >= max_neighbours) {
+            return n_neighbours;
+        }
+        neighbours[n_neighbours++] = get_target_vertex(mesh, half_edge);
+        incoming = PREV_HALF_EDGE(half_edge);
+        half_edge = mesh->twins[incoming];
+        if (half_edge == NO_HALF_EDGE) {
+            // the fan ends at the other boundary edge
+            if (n_neighbours < max_neighbours) {
+                neighbours[n_neighbours++] = mesh->vertices[incoming];
+            }
+            return n_neighbours;
+        }
+    } while (half_edge != first);
+    return n_neighbours;
+}
+
+int collect_face_neighbours(const HalfEdgeMesh* mesh, int triangle_index, int neighbours[3])
+{
+    int n_neighbours;
+    int twin;
+    int k;
+
+    n_neighbours = 0;
+    for (k = 0; k < 3; ++k) {
+        twin = mesh->twins[triangle_index * 3 + k];
+        if (twin != NO_HALF_EDGE) {
+            neighbours[n_neighbours++] = HALF_EDGE_FACE(twin);
+        }
+    }
+    return n_neighbours;
+}
+
+void free_half_edge_mesh(HalfEdgeMesh* mesh)
+{
+    if (mesh->vertices != NULL) {
+        free(mesh->vertices);
+    }
+    if (mesh->twins != NULL) {
+        free(mesh->twins);
+    }
+    if (mesh->vertex_edges != NULL) {
+        free(mesh->vertex_edges);
+    }
+    init_half_edge_mesh(mesh);
+}
@@ -1,4 +1,5 @@
 #include "info.h"
+#include "transform.h"
 
 #include <stdio.h>
 
@@ -12,47 +13,16 @@ void print_model_info(const Model* model)
 
 void print_bounding_box(const Model* model)
 {
-    int i;
-    double x, y, z;
-    double min_x, max_x, min_y, max_y, min_z, max_z;
+    BoundingBox bounding_box;
 
     if (model->n_vertices == 0) {
         return;
     }
 
-    min_x = model->vertices[0].x;
-    max_x = model->vertices[0].x;
-    min_y = model->vertices[0].y;
-    max_y = model->vertices[0].y;
-    min_z = model->vertices[0].z;
-    max_z = model->vertices[0].z;
-
-    for (i = 0; i < model->n_vertices; ++i) {
-        x = model->vertices[i].x;
-        y = model->vertices[i].y;
-        z = model->vertices[i].z;
-        if (x < min_x) {
-            min_x = x;
-        }
-        else if (x > max_x) {
-            max_x = x;
-        }
-        if (y < min_y) {
-            min_y = y;
-        }
-        else if (y > max_y) {
-            max_y = y;
-        }
-        if (z < min_z) {
-            min_z = z;
-        }
-        else if (z > max_z) {
-            max_z = z;
-        }
-    }
+    calc_bounding_box(model, &bounding_box);
 
     printf("Bounding box:\n");
-    printf("x in [%lf, %lf]\n", min_x, max_x);
-    printf("y in [%lf, %lf]\n", min_y, max_y);
-    printf("z in [%lf, %lf]\n", min_z, max_z);
+    printf("x in [%lf, %lf]\n", bounding_box.min.x, bounding_box.max.x);
+    printf("y in [%lf, %lf]\n", bounding_box.min.y, bounding_box.max.y);
+    printf("z in [%lf, %lf]\n", bounding_box.min.z, bounding_box.max.z);
 }
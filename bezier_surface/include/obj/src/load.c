@@ -1,79 +1,237 @@
 #include "load.h"
+#include "cache.h"
+#include "mapping.h"
+#include "normal.h"
+#include "number.h"
+#include "parallel.h"
 
-#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
-#define LINE_BUFFER_SIZE 1024
+#define MAX_CHUNKS 64
+#define MIN_CHUNK_SIZE (1 << 20)
+#define MAX_FILENAME_LENGTH 1024
+
+static void count_chunk_elements(void* data, int begin, int end)
+{
+    Chunk* chunks = (Chunk*)data;
+    int i;
+
+    for (i = begin; i < end; ++i) {
+        count_elements(&chunks[i]);
+    }
+}
+
+typedef struct ReadJob
+{
+    Model* model;
+    Chunk* chunks;
+} ReadJob;
+
+static void read_chunk_elements(void* data, int begin, int end)
+{
+    ReadJob* job = (ReadJob*)data;
+    int i;
+
+    for (i = begin; i < end; ++i) {
+        job->chunks[i].is_valid = read_elements(job->model, &(job->chunks[i]));
+    }
+}
 
 int load_model(Model* model, const char* filename)
 {
-    FILE* obj_file;
+    char cache_filename[MAX_FILENAME_LENGTH];
+    int has_cache_filename;
+
+    has_cache_filename = get_cache_filename(cache_filename, sizeof(cache_filename), filename);
+    if (has_cache_filename && load_model_cache(model, cache_filename, filename)) {
+        printf("Load model '%s' from '%s' ...\n", filename, cache_filename);
+        return TRUE;
+    }
+    if (read_model(model, filename) == FALSE) {
+        return FALSE;
+    }
+    if (has_cache_filename && save_model_cache(model, cache_filename, filename) == FALSE) {
+        printf("Unable to save the model cache '%s'!\n", cache_filename);
+    }
+    return TRUE;
+}
+
+int read_model(Model* model, const char* filename)
+{
+    FileMapping mapping;
+    Chunk chunks[MAX_CHUNKS];
+    ReadJob read_job;
+    int n_chunks;
     int success;
+    int i;
 
-    obj_file = fopen(filename, "r");
     printf("Load model '%s' ...\n", filename);
-    if (obj_file == NULL) {
+    if (map_file(&mapping, filename) == FALSE) {
         printf("ERROR: Unable to open '%s' file!\n", filename);
         return FALSE;
     }
+    n_chunks = split_into_chunks(chunks, MAX_CHUNKS, mapping.data, mapping.data + mapping.size);
     printf("Count the elements ...\n");
-    count_elements(model, obj_file);
+    parallel_for(n_chunks, 1, count_chunk_elements, chunks);
+    calc_chunk_offsets(model, chunks, n_chunks);
     printf("Allocate memory for model ...\n");
     allocate_model(model);
     printf("Read model data ...\n");
-    fseek(obj_file, 0, SEEK_SET);
-    success = read_elements(model, obj_file);
+    read_job.model = model;
+    read_job.chunks = chunks;
+    parallel_for(n_chunks, 1, read_chunk_elements, &read_job);
+    unmap_file(&mapping);
+    success = TRUE;
+    for (i = 0; i < n_chunks; ++i) {
+        if (chunks[i].is_valid == FALSE) {
+            success = FALSE;
+        }
+    }
     if (success == FALSE) {
         printf("ERROR: Unable to read the model data!\n");
+        free_model(model);
         return FALSE;
     }
+    if (has_valid_indices(model) == FALSE) {
+        printf("ERROR: The faces refer to missing vertices, texture vertices or normals!\n");
+        free_model(model);
+        return FALSE;
+    }
+    if (has_missing_normals(model)) {
+        printf("Generate the missing normals ...\n");
+        if (generate_normals(model, ANGLE_WEIGHTED_NORMALS, DEFAULT_CREASE_ANGLE) == FALSE) {
+            free_model(model);
+            return FALSE;
+        }
+    }
     return TRUE;
 }
 
-void count_elements(Model* model, FILE* file)
+int split_into_chunks(Chunk* chunks, int max_n_chunks, const char* text, const char* end)
 {
-    char line[LINE_BUFFER_SIZE];
+    const char* start;
+    const char* chunk_end;
+    long long size;
+    int n_chunks;
+    int i;
 
-    init_model(model);
-    while (fgets(line, LINE_BUFFER_SIZE, file) != NULL) {
-        switch (calc_element_type(line)) {
+    start = text;
+    size = end - start;
+    n_chunks = (int)(size / MIN_CHUNK_SIZE) + 1;
+    if (n_chunks > get_thread_count()) {
+        n_chunks = get_thread_count();
+    }
+    if (n_chunks > max_n_chunks) {
+        n_chunks = max_n_chunks;
+    }
+    for (i = 0; i < n_chunks; ++i) {
+        chunk_end = start + size * (i + 1) / n_chunks;
+        if (chunk_end < text) {
+            chunk_end = text;
+        }
+        // move the boundary after the end of the line
+        if (chunk_end < end) {
+            chunk_end = find_line_end(chunk_end, end);
+        }
+        if (chunk_end < end) {
+            ++chunk_end;
+        }
+        chunks[i].text = text;
+        chunks[i].end = chunk_end;
+        text = chunk_end;
+    }
+    return n_chunks;
+}
+
+void count_elements(Chunk* chunk)
+{
+    const char* text;
+    const char* line_end;
+
+    chunk->n_vertices = 0;
+    chunk->n_texture_vertices = 0;
+    chunk->n_normals = 0;
+    chunk->n_triangles = 0;
+    text = chunk->text;
+    while (text < chunk->end) {
+        line_end = find_line_end(text, chunk->end);
+        switch (calc_element_type(text, line_end)) {
         case NONE:
             break;
         case VERTEX:
-            ++model->n_vertices;
+            ++chunk->n_vertices;
             break;
         case TEXTURE_VERTEX:
-            ++model->n_texture_vertices;
+            ++chunk->n_texture_vertices;
             break;
         case NORMAL:
-            ++model->n_normals;
+            ++chunk->n_normals;
             break;
         case FACE:
-            ++model->n_triangles;
+            ++chunk->n_triangles;
             break;
         }
+        text = line_end + 1;
     }
 }
 
-int read_elements(Model* model, FILE* file)
+void calc_chunk_offsets(Model* model, Chunk* chunks, int n_chunks)
 {
-    char line[LINE_BUFFER_SIZE];
+    int i;
+
+    init_model(model);
+    for (i = 0; i < n_chunks; ++i) {
+        chunks[i].vertex_offset = model->n_vertices;
+        chunks[i].texture_vertex_offset = model->n_texture_vertices;
+        chunks[i].normal_offset = model->n_normals;
+        chunks[i].triangle_offset = model->n_triangles;
+        model->n_vertices += chunks[i].n_vertices;
+        model->n_texture_vertices += chunks[i].n_texture_vertices;
+        model->n_normals += chunks[i].n_normals;
+        model->n_triangles += chunks[i].n_triangles;
+    }
+}
+
+void resolve_relative_indices(Triangle* triangle, int vertex_index, int texture_index, int normal_index)
+{
+    int k;
+
+    for (k = 0; k < 3; ++k) {
+        if (triangle->points[k].vertex_index < 0) {
+            triangle->points[k].vertex_index += vertex_index;
+        }
+        if (triangle->points[k].texture_index < 0) {
+            triangle->points[k].texture_index += texture_index;
+        }
+        if (triangle->points[k].normal_index < 0) {
+            triangle->points[k].normal_index += normal_index;
+        }
+    }
+}
+
+int read_elements(Model* model, const Chunk* chunk)
+{
+    const char* text;
+    const char* line_end;
     int vertex_index;
     int texture_index;
     int normal_index;
     int triangle_index;
     int success;
 
-    allocate_model(model);
-    vertex_index = 1;
-    texture_index = 1;
-    normal_index = 1;
-    triangle_index = 0;
-    while (fgets(line, LINE_BUFFER_SIZE, file) != NULL) {
-        switch (calc_element_type(line)) {
+    vertex_index = chunk->vertex_offset + 1;
+    texture_index = chunk->texture_vertex_offset + 1;
+    normal_index = chunk->normal_offset + 1;
+    triangle_index = chunk->triangle_offset;
+    text = chunk->text;
+    while (text < chunk->end) {
+        line_end = find_line_end(text, chunk->end);
+        switch (calc_element_type(text, line_end)) {
         case NONE:
             break;
         case VERTEX:
-            success = read_vertex(&(model->vertices[vertex_index]), line);
+            success = read_vertex(&(model->vertices[vertex_index]), text, line_end);
             if (success == FALSE) {
                 printf("Unable to read vertex data!\n");
                 return FALSE;
@@ -81,7 +239,7 @@ int read_elements(Model* model, FILE* file)
             ++vertex_index;
             break;
         case TEXTURE_VERTEX:
-            success = read_texture_vertex(&(model->texture_vertices[texture_index]), line);
+            success = read_texture_vertex(&(model->texture_vertices[texture_index]), text, line_end);
             if (success == FALSE) {
                 printf("Unable to read texture vertex data!\n");
                 return FALSE;
@@ -89,7 +247,7 @@ int read_elements(Model* model, FILE* file)
             ++texture_index;
             break;
         case NORMAL:
-            success = read_normal(&(model->normals[normal_index]), line);
+            success = read_normal(&(model->normals[normal_index]), text, line_end);
             if (success == FALSE) {
                 printf("Unable to read normal vector data!\n");
                 return FALSE;
@@ -97,217 +255,169 @@ int read_elements(Model* model, FILE* file)
             ++normal_index;
             break;
         case FACE:
-            success = read_triangle(&(model->triangles[triangle_index]), line);
+            success = read_triangle(&(model->triangles[triangle_index]), text, line_end);
             if (success == FALSE) {
                 printf("Unable to read triangle face data!\n");
                 return FALSE;
             }
+            resolve_relative_indices(&(model->triangles[triangle_index]), vertex_index, texture_index, normal_index);
             ++triangle_index;
             break;
         }
+        text = line_end + 1;
     }
     return TRUE;
 }
 
-ElementType calc_element_type(const char* text)
+const char* find_line_end(const char* text, const char* end)
 {
-    int i;
+    const char* line_end;
 
-    i = 0;
-    while (text[i] != 0) {
-        if (text[i] == 'v') {
-            if (text[i + 1] == 't') {
-                return TEXTURE_VERTEX;
-            }
-            else if (text[i + 1] == 'n') {
-                return NORMAL;
-            }
-            else {
-                return VERTEX;
-            }
+    line_end = (const char*)memchr(text, '\n', end - text);
+    if (line_end == NULL) {
+        return end;
+    }
+    return line_end;
+}
+
+ElementType calc_element_type(const char* text, const char* end)
+{
+    while (text < end && (*text == ' ' || *text == '\t')) {
+        ++text;
+    }
+    if (end - text < 2) {
+        return NONE;
+    }
+    if (text[0] == 'v') {
+        if (text[1] == ' ' || text[1] == '\t') {
+            return VERTEX;
         }
-        else if (text[i] == 'f') {
-            return FACE;
+        else if (text[1] == 't') {
+            return TEXTURE_VERTEX;
         }
-        else if (text[i] != ' ' && text[i] != '\t') {
-            return NONE;
+        else if (text[1] == 'n') {
+            return NORMAL;
         }
-        ++i;
+    }
+    else if (text[0] == 'f' && (text[1] == ' ' || text[1] == '\t')) {
+        return FACE;
     }
     return NONE;
 }
 
-int read_vertex(Vertex* vertex, const char* text)
+/**
+ * Skip the element type keyword at the start of the line.
+ */
+static const char* skip_keyword(const char* text, const char* end)
 {
-    int i;
-
-    i = 0;
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
+    text = skip_spaces(text, end);
+    while (text < end && *text != ' ' && *text != '\t') {
+        ++text;
     }
-    if (text[i] != 0) {
-        vertex->x = atof(&text[i]);
-    }
-    else {
+    return text;
+}
+
+/**
+ * Read the next space separated real value of the line.
+ */
+static const char* read_value(double* value, const char* text, const char* end)
+{
+    return parse_double(skip_spaces(text, end), end, value);
+}
+
+int read_vertex(Vertex* vertex, const char* text, const char* end)
+{
+    text = skip_keyword(text, end);
+    text = read_value(&(vertex->x), text, end);
+    if (text == NULL) {
         printf("The x value of vertex is missing!\n");
         return FALSE;
     }
-    while (text[i] != 0 && text[i] != ' ') {
-        ++i;
-    }
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
-    }
-    if (text[i] != 0) {
-        vertex->y = atof(&text[i]);
-    }
-    else {
+    text = read_value(&(vertex->y), text, end);
+    if (text == NULL) {
         printf("The y value of vertex is missing!\n");
         return FALSE;
     }
-    while (text[i] != 0 && text[i] != ' ') {
-        ++i;
-    }
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
-    }
-    if (text[i] != 0) {
-        vertex->z = atof(&text[i]);
-    }
-    else {
+    text = read_value(&(vertex->z), text, end);
+    if (text == NULL) {
         printf("The z value of vertex is missing!\n");
         return FALSE;
     }
     return TRUE;
 }
 
-int read_texture_vertex(TextureVertex* texture_vertex, const char* text)
+int read_texture_vertex(TextureVertex* texture_vertex, const char* text, const char* end)
 {
-    int i;
-
-    i = 0;
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
-    }
-    if (text[i] != 0) {
-        texture_vertex->u = atof(&text[i]);
-    }
-    else {
+    text = skip_keyword(text, end);
+    text = read_value(&(texture_vertex->u), text, end);
+    if (text == NULL) {
         printf("The u value of texture vertex is missing!\n");
         return FALSE;
     }
-    while (text[i] != 0 && text[i] != ' ') {
-        ++i;
-    }
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
-    }
-    if (text[i] != 0) {
-        texture_vertex->v = atof(&text[i]);
-    }
-    else {
+    text = read_value(&(texture_vertex->v), text, end);
+    if (text == NULL) {
         printf("The v value of texture vertex is missing!\n");
         return FALSE;
     }
     return TRUE;
 }
 
-int read_normal(Vertex* normal, const char* text)
+int read_normal(Vertex* normal, const char* text, const char* end)
 {
-    int i;
-
-    i = 0;
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
-    }
-    if (text[i] != 0) {
-        normal->x = atof(&text[i]);
-    }
-    else {
+    text = skip_keyword(text, end);
+    text = read_value(&(normal->x), text, end);
+    if (text == NULL) {
         printf("The x value of normal vector is missing!\n");
         return FALSE;
     }
-    while (text[i] != 0 && text[i] != ' ') {
-        ++i;
-    }
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
-    }
-    if (text[i] != 0) {
-        normal->y = atof(&text[i]);
-    }
-    else {
+    text = read_value(&(normal->y), text, end);
+    if (text == NULL) {
         printf("The y value of normal vector is missing!\n");
         return FALSE;
     }
-    while (text[i] != 0 && text[i] != ' ') {
-        ++i;
-    }
-    while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-        ++i;
-    }
-    if (text[i] != 0) {
-        normal->z = atof(&text[i]);
-    }
-    else {
+    text = read_value(&(normal->z), text, end);
+    if (text == NULL) {
         printf("The z value of normal vector is missing!\n");
         return FALSE;
     }
     return TRUE;
 }
 
-int read_triangle(Triangle* triangle, const char* text)
+int read_triangle(Triangle* triangle, const char* text, const char* end)
 {
+    FacePoint* point;
     int point_index;
-    int i;
 
-    i = 0;
+    text = skip_keyword(text, end);
     for (point_index = 0; point_index < 3; ++point_index) {
-        while (text[i] != 0 && is_numeric(text[i]) == FALSE) {
-            ++i;
-        }
-        if (text[i] != 0) {
-            triangle->points[point_index].vertex_index = atoi(&text[i]);
-        }
-        else {
+        point = &(triangle->points[point_index]);
+        point->texture_index = INVALID_VERTEX_INDEX;
+        point->normal_index = INVALID_VERTEX_INDEX;
+        text = parse_int(skip_spaces(text, end), end, &(point->vertex_index));
+        if (text == NULL) {
             printf("The vertex index of the %d. points is missing!\n", point_index + 1);
             return FALSE;
         }
-        while (text[i] != 0 && text[i] != '/') {
-            ++i;
-        }
-        ++i;
-        if (text[i] != 0) {
-            triangle->points[point_index].texture_index = atoi(&text[i]);
-        }
-        else {
-            printf("The texture index of the %d. points is missing!\n", point_index + 1);
-            return FALSE;
+        // the accepted forms are v, v/vt, v//vn and v/vt/vn
+        if (text == end || *text != '/') {
+            continue;
         }
-        while (text[i] != 0 && text[i] != '/') {
-            ++i;
+        ++text;
+        if (text < end && *text != '/') {
+            text = parse_int(text, end, &(point->texture_index));
+            if (text == NULL) {
+                printf("The texture index of the %d. points is invalid!\n", point_index + 1);
+                return FALSE;
+            }
         }
-        ++i;
-        if (text[i] != 0) {
-            triangle->points[point_index].normal_index = atoi(&text[i]);
+        if (text == end || *text != '/') {
+            continue;
         }
-        else {
+        text = parse_int(text + 1, end, &(point->normal_index));
+        if (text == NULL) {
             printf("The normal index of the %d. points is missing!\n", point_index + 1);
             return FALSE;
         }
-        while (text[i] != 0 && text[i] != ' ') {
-            ++i;
-        }
     }
     return TRUE;
 }
-
-int is_numeric(char c)
-{
-    if ((c >= '0' && c <= '9') || c == '-' || c == '.') {
-        return TRUE;
-    }
-    else {
-        return FALSE;
-    }
-}
@@ -0,0 +1,103 @@
+#include "mapping.h"
+#include "model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static int read_file(FileMapping* mapping, const char* filename)
+{
+    FILE* file;
+    char* buffer;
+    long size;
+
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        return FALSE;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(file);
+        return FALSE;
+    }
+    buffer = (char*)malloc(size + 1);
+    if (buffer == NULL) {
+        fclose(file);
+        return FALSE;
+    }
+    if (fread(buffer, 1, size, file) != (size_t)size) {
+        free(buffer);
+        fclose(file);
+        return FALSE;
+    }
+    fclose(file);
+    buffer[size] = 0;
+
+    mapping->data = buffer;
+    mapping->size = size;
+    mapping->is_mapped = FALSE;
+    return TRUE;
+}
+
+int map_file(FileMapping* mapping, const char* filename)
+{
+#ifndef _WIN32
+    struct stat status;
+    long page_size;
+    void* data;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return FALSE;
+    }
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        return FALSE;
+    }
+    page_size = sysconf(_SC_PAGESIZE);
+    // The tail of the last page is zero filled, which gives the terminating zero for free.
+    // Files which end exactly on a page boundary are read into a buffer instead.
+    if (status.st_size > 0 && page_size > 0 && status.st_size % page_size != 0) {
+        data = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            return read_file(mapping, filename);
+        }
+        posix_madvise(data, status.st_size, POSIX_MADV_SEQUENTIAL);
+        mapping->data = (char*)data;
+        mapping->size = status.st_size;
+        mapping->is_mapped = TRUE;
+        return TRUE;
+    }
+    close(fd);
+#endif
+    return read_file(mapping, filename);
+}
+
+void unmap_file(FileMapping* mapping)
+{
+    if (mapping->data == NULL) {
+        return;
+    }
+#ifndef _WIN32
+    if (mapping->is_mapped) {
+        munmap(mapping->data, mapping->size);
+    }
+    else {
+        free(mapping->data);
+    }
+#else
+    free(mapping->data);
+#endif
+    mapping->data = NULL;
+    mapping->size = 0;
+}
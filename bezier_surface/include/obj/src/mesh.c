@@ -0,0 +1,382 @@
+#include "mesh.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EMPTY_SLOT -1
+
+void init_mesh(Mesh* mesh)
+{
+    mesh->n_vertices = 0;
+    mesh->n_indices = 0;
+    mesh->index_size = sizeof(unsigned int);
+    mesh->vertices = NULL;
+    mesh->indices = NULL;
+}
+
+static uint32_t hash_face_point(const FacePoint* point)
+{
+    uint32_t hash;
+
+    hash = (uint32_t)point->vertex_index * 0x9E3779B1u;
+    hash ^= (uint32_t)point->texture_index * 0x85EBCA77u;
+    hash ^= (uint32_t)point->normal_index * 0xC2B2AE3Du;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+static int is_same_face_point(const FacePoint* a, const FacePoint* b)
+{
+    return a->vertex_index == b->vertex_index
+        && a->texture_index == b->texture_index
+        && a->normal_index == b->normal_index;
+}
+
+/**
+ * Assign the same vertex to the equal face points and collect the first occurrences.
+ * Returns the number of unique face points or -1 on allocation failure.
+ */
+static int find_unique_face_points(const Model* model, unsigned int* indices, const FacePoint** unique_points)
+{
+    const FacePoint* point;
+    int* table;
+    uint32_t mask;
+    uint32_t slot;
+    int n_corners;
+    int n_unique;
+    int i;
+
+    n_corners = model->n_triangles * 3;
+    mask = 1;
+    while (mask < (uint32_t)n_corners * 2) {
+        mask <<= 1;
+    }
+    table = (int*)malloc(mask * sizeof(int));
+    if (table == NULL) {
+        return -1;
+    }
+    memset(table, 0xFF, mask * sizeof(int));
+    --mask;
+
+    n_unique = 0;
+    for (i = 0; i < n_corners; ++i) {
+        point = &(model->triangles[i / 3].points[i % 3]);
+        slot = hash_face_point(point) & mask;
+        while (table[slot] != EMPTY_SLOT && is_same_face_point(unique_points[table[slot]], point) == FALSE) {
+            slot = (slot + 1) & mask;
+        }
+        if (table[slot] == EMPTY_SLOT) {
+            table[slot] = n_unique;
+            unique_points[n_unique] = point;
+            ++n_unique;
+        }
+        indices[i] = table[slot];
+    }
+    free(table);
+    return n_unique;
+}
+
+static int is_valid_index(int index, int n_elements)
+{
+    return index >= 0 && index <= n_elements;
+}
+
+static void set_mesh_vertex(float* vertex, const Model* model, const FacePoint* point)
+{
+    const Vertex* position;
+    const Vertex* normal;
+    const TextureVertex* texture_vertex;
+    static const Vertex zero_vertex = {0.0, 0.0, 0.0};
+    static const TextureVertex zero_texture_vertex = {0.0, 0.0};
+
+    position = is_valid_index(point->vertex_index, model->n_vertices)
+        ? &(model->vertices[point->vertex_index]) : &zero_vertex;
+    normal = is_valid_index(point->normal_index, model->n_normals)
+        ? &(model->normals[point->normal_index]) : &zero_vertex;
+    texture_vertex = is_valid_index(point->texture_index, model->n_texture_vertices)
+        ? &(model->texture_vertices[point->texture_index]) : &zero_texture_vertex;
+
+    vertex[0] = position->x;
+    vertex[1] = position->y;
+    vertex[2] = position->z;
+    vertex[3] = normal->x;
+    vertex[4] = normal->y;
+    vertex[5] = normal->z;
+    vertex[6] = texture_vertex->u;
+    vertex[7] = 1.0 - texture_vertex->v;
+}
+
+int build_mesh(Mesh* mesh, const Model* model)
+{
+    const FacePoint** unique_points;
+    unsigned int* indices;
+    unsigned short* short_indices;
+    int n_indices;
+    int n_vertices;
+    int i;
+
+    init_mesh(mesh);
+    n_indices = model->n_triangles * 3;
+    indices = (unsigned int*)malloc((n_indices + 1) * sizeof(unsigned int));
+    unique_points = (const FacePoint**)malloc((n_indices + 1) * sizeof(FacePoint*));
+    if (indices == NULL || unique_points == NULL) {
+        free(indices);
+        free(unique_points);
+        return FALSE;
+    }
+
+    n_vertices = find_unique_face_points(model, indices, unique_points);
+    if (n_vertices < 0) {
+        free(indices);
+        free(unique_points);
+        return FALSE;
+    }
+    mesh->vertices = (float*)malloc((n_vertices + 1) * MESH_VERTEX_SIZE * sizeof(float));
+    if (mesh->vertices == NULL) {
+        free(indices);
+        free(unique_points);
+        return FALSE;
+    }
+    for (i = 0; i < n_vertices; ++i) {
+        set_mesh_vertex(&(mesh->vertices[i * MESH_VERTEX_SIZE]), model, unique_points[i]);
+    }
+    free(unique_points);
+
+    if (optimize_vertex_cache(indices, n_indices, n_vertices, MESH_CACHE_SIZE) == FALSE
+        || optimize_vertex_fetch(mesh->vertices, indices, n_indices, n_vertices) == FALSE) {
+        free(indices);
+        free_mesh(mesh);
+        return FALSE;
+    }
+
+    mesh->n_vertices = n_vertices;
+    mesh->n_indices = n_indices;
+    if (n_vertices <= MAX_SHORT_INDEXED_VERTICES) {
+        // the indices are narrowed in place
+        short_indices = (unsigned short*)indices;
+        for (i = 0; i < n_indices; ++i) {
+            short_indices[i] = (unsigned short)indices[i];
+        }
+        mesh->index_size = sizeof(unsigned short);
+    }
+    mesh->indices = indices;
+
+    return TRUE;
+}
+
+/**
+ * Working arrays of the vertex cache optimization
+ */
+typedef struct CacheOptimizer
+{
+    int* live_counts;
+    int* offsets;
+    int* adjacency;
+    int* time_stamps;
+    int* dead_end_stack;
+    int* candidates;
+    char* is_emitted;
+    unsigned int* output;
+    int stack_size;
+    int cursor;
+} CacheOptimizer;
+
+static void free_cache_optimizer(CacheOptimizer* optimizer)
+{
+    free(optimizer->live_counts);
+    free(optimizer->offsets);
+    free(optimizer->adjacency);
+    free(optimizer->time_stamps);
+    free(optimizer->dead_end_stack);
+    free(optimizer->candidates);
+    free(optimizer->is_emitted);
+    free(optimizer->output);
+}
+
+/**
+ * Allocate the arrays and collect the triangles around the vertices.
+ */
+static int init_cache_optimizer(CacheOptimizer* optimizer, const unsigned int* indices, int n_indices, int n_vertices)
+{
+    int max_degree;
+    int i;
+
+    optimizer->live_counts = (int*)calloc(n_vertices, sizeof(int));
+    optimizer->offsets = (int*)malloc((n_vertices + 1) * sizeof(int));
+    optimizer->adjacency = (int*)malloc(n_indices * sizeof(int));
+    optimizer->time_stamps = (int*)calloc(n_vertices, sizeof(int));
+    optimizer->dead_end_stack = (int*)malloc(n_indices * sizeof(int));
+    optimizer->candidates = NULL;
+    optimizer->is_emitted = (char*)calloc(n_indices / 3, sizeof(char));
+    optimizer->output = (unsigned int*)malloc(n_indices * sizeof(unsigned int));
+    optimizer->stack_size = 0;
+    optimizer->cursor = 0;
+    if (optimizer->live_counts == NULL || optimizer->offsets == NULL || optimizer->adjacency == NULL
+        || optimizer->time_stamps == NULL || optimizer->dead_end_stack == NULL
+        || optimizer->is_emitted == NULL || optimizer->output == NULL) {
+        return FALSE;
+    }
+
+    for (i = 0; i < n_indices; ++i) {
+        ++optimizer->live_counts[indices[i]];
+    }
+    optimizer->offsets[0] = 0;
+    max_degree = 0;
+    for (i = 0; i < n_vertices; ++i) {
+        optimizer->offsets[i + 1] = optimizer->offsets[i] + optimizer->live_counts[i];
+        if (optimizer->live_counts[i] > max_degree) {
+            max_degree = optimizer->live_counts[i];
+        }
+    }
+    for (i = 0; i < n_indices; ++i) {
+        optimizer->adjacency[optimizer->offsets[indices[i]]++] = i / 3;
+    }
+    for (i = n_vertices; i > 0; --i) {
+        optimizer->offsets[i] = optimizer->offsets[i - 1];
+    }
+    optimizer->offsets[0] = 0;
+
+    optimizer->candidates = (int*)malloc(max_degree * 3 * sizeof(int));
+    return optimizer->candidates != NULL;
+}
+
+/**
+ * Find the next fanning vertex in the dead-end stack or in the input order.
+ */
+static int skip_dead_end(CacheOptimizer* optimizer, int n_vertices)
+{
+    int vertex;
+
+    while (optimizer->stack_size > 0) {
+        --optimizer->stack_size;
+        vertex = optimizer->dead_end_stack[optimizer->stack_size];
+        if (optimizer->live_counts[vertex] > 0) {
+            return vertex;
+        }
+    }
+    while (optimizer->cursor < n_vertices) {
+        if (optimizer->live_counts[optimizer->cursor] > 0) {
+            return optimizer->cursor;
+        }
+        ++optimizer->cursor;
+    }
+    return -1;
+}
+
+int optimize_vertex_cache(unsigned int* indices, int n_indices, int n_vertices, int cache_size)
+{
+    CacheOptimizer optimizer;
+    int n_candidates;
+    int time;
+    int fanning_vertex;
+    int best_priority;
+    int priority;
+    int n_output;
+    int vertex;
+    int triangle;
+    int i, k;
+
+    if (n_indices < 3) {
+        return TRUE;
+    }
+    if (init_cache_optimizer(&optimizer, indices, n_indices, n_vertices) == FALSE) {
+        free_cache_optimizer(&optimizer);
+        return FALSE;
+    }
+
+    n_output = 0;
+    time = cache_size + 1;
+    fanning_vertex = skip_dead_end(&optimizer, n_vertices);
+    while (fanning_vertex >= 0) {
+        // emit all remaining triangles around the fanning vertex
+        n_candidates = 0;
+        for (i = optimizer.offsets[fanning_vertex]; i < optimizer.offsets[fanning_vertex + 1]; ++i) {
+            triangle = optimizer.adjacency[i];
+            if (optimizer.is_emitted[triangle]) {
+                continue;
+            }
+            for (k = 0; k < 3; ++k) {
+                vertex = indices[triangle * 3 + k];
+                optimizer.output[n_output++] = vertex;
+                optimizer.dead_end_stack[optimizer.stack_size++] = vertex;
+                optimizer.candidates[n_candidates++] = vertex;
+                --optimizer.live_counts[vertex];
+                if (time - optimizer.time_stamps[vertex] > cache_size) {
+                    optimizer.time_stamps[vertex] = time;
+                    ++time;
+                }
+            }
+            optimizer.is_emitted[triangle] = TRUE;
+        }
+
+        // prefer the candidates which stay in the cache while their remaining triangles are emitted
+        fanning_vertex = -1;
+        best_priority = -1;
+        for (i = 0; i < n_candidates; ++i) {
+            vertex = optimizer.candidates[i];
+            if (optimizer.live_counts[vertex] > 0) {
+                priority = 0;
+                if (time - optimizer.time_stamps[vertex] + 2 * optimizer.live_counts[vertex] <= cache_size) {
+                    priority = time - optimizer.time_stamps[vertex];
+                }
+                if (priority > best_priority) {
+                    best_priority = priority;
+                    fanning_vertex = vertex;
+                }
+            }
+        }
+        if (fanning_vertex < 0) {
+            fanning_vertex = skip_dead_end(&optimizer, n_vertices);
+        }
+    }
+    memcpy(indices, optimizer.output, n_output * sizeof(unsigned int));
+
+    free_cache_optimizer(&optimizer);
+    return TRUE;
+}
+
+int optimize_vertex_fetch(float* vertices, unsigned int* indices, int n_indices, int n_vertices)
+{
+    float* ordered_vertices;
+    int* remap;
+    int n_ordered;
+    int i;
+
+    remap = (int*)malloc((n_vertices + 1) * sizeof(int));
+    ordered_vertices = (float*)malloc((n_vertices + 1) * MESH_VERTEX_SIZE * sizeof(float));
+    if (remap == NULL || ordered_vertices == NULL) {
+        free(remap);
+        free(ordered_vertices);
+        return FALSE;
+    }
+    memset(remap, 0xFF, n_vertices * sizeof(int));
+
+    n_ordered = 0;
+    for (i = 0; i < n_indices; ++i) {
+        if (remap[indices[i]] < 0) {
+            remap[indices[i]] = n_ordered;
+            memcpy(&(ordered_vertices[n_ordered * MESH_VERTEX_SIZE]),
+                   &(vertices[indices[i] * MESH_VERTEX_SIZE]),
+                   MESH_VERTEX_SIZE * sizeof(float));
+            ++n_ordered;
+        }
+        indices[i] = remap[indices[i]];
+    }
+    memcpy(vertices, ordered_vertices, n_ordered * MESH_VERTEX_SIZE * sizeof(float));
+
+    free(remap);
+    free(ordered_vertices);
+    return TRUE;
+}
+
+void free_mesh(Mesh* mesh)
+{
+    if (mesh->vertices != NULL) {
+        free(mesh->vertices);
+    }
+    if (mesh->indices != NULL) {
+        free(mesh->indices);
+    }
+    init_mesh(mesh);
+}
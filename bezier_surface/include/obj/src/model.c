@@ -12,6 +12,9 @@ void init_model(Model* model)
     model->texture_vertices = NULL;
     model->normals = NULL;
     model->triangles = NULL;
+    model->cache.data = NULL;
+    model->cache.size = 0;
+    model->cache.is_mapped = FALSE;
 }
 
 void allocate_model(Model* model)
@@ -24,10 +27,20 @@ void allocate_model(Model* model)
         (Vertex*)malloc((model->n_normals + 1) * sizeof(Vertex));
     model->triangles =
         (Triangle*)malloc(model->n_triangles * sizeof(Triangle));
+
+    // the unused first elements belong to the invalid index
+    model->vertices[INVALID_VERTEX_INDEX] = (Vertex){0.0, 0.0, 0.0};
+    model->texture_vertices[INVALID_VERTEX_INDEX] = (TextureVertex){0.0, 0.0};
+    model->normals[INVALID_VERTEX_INDEX] = (Vertex){0.0, 0.0, 0.0};
 }
 
 void free_model(Model* model)
 {
+    if (model->cache.data != NULL) {
+        unmap_file(&(model->cache));
+        init_model(model);
+        return;
+    }
     if (model->vertices != NULL) {
         free(model->vertices);
     }
@@ -42,3 +55,21 @@ void free_model(Model* model)
     }
     init_model(model);
 }
+
+int has_valid_indices(const Model* model)
+{
+    const FacePoint* point;
+    int i, k;
+
+    for (i = 0; i < model->n_triangles; ++i) {
+        for (k = 0; k < 3; ++k) {
+            point = &(model->triangles[i].points[k]);
+            if (point->vertex_index < 1 || point->vertex_index > model->n_vertices
+                || point->texture_index < 0 || point->texture_index > model->n_texture_vertices
+                || point->normal_index < 0 || point->normal_index > model->n_normals) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
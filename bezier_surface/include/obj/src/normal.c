@@ -0,0 +1,465 @@
+#include "normal.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_TRIANGLE_RANGE 16384
+#define MIN_VERTEX_RANGE 16384
+#define SMOOTH_ANGLE 180.0
+
+typedef struct NormalJob
+{
+    Model* model;
+    NormalWeighting weighting;
+    int is_smooth;
+    double min_cosine;
+    Vertex* face_normals;
+    double* weights;
+    int* corner_offsets;
+    int* corners;
+    int* local_indices;
+    int* vertex_normal_offsets;
+    Vertex* normals;
+    struct CornerEdge* edges;
+    int* parents;
+    int* cluster_normals;
+    int* buckets;
+    Vertex* sums;
+} NormalJob;
+
+int has_missing_normals(const Model* model)
+{
+    int i, k;
+
+    for (i = 0; i < model->n_triangles; ++i) {
+        for (k = 0; k < 3; ++k) {
+            if (model->triangles[i].points[k].normal_index == INVALID_VERTEX_INDEX) {
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+static int get_vertex_index(const Model* model, const FacePoint* point)
+{
+    if (point->vertex_index < 0 || point->vertex_index > model->n_vertices) {
+        return INVALID_VERTEX_INDEX;
+    }
+    return point->vertex_index;
+}
+
+static double calc_length(const Vertex* v)
+{
+    return sqrt(v->x * v->x + v->y * v->y + v->z * v->z);
+}
+
+/**
+ * Calculate the unit normals of the [begin, end) range of the triangles and the weights of their corners.
+ */
+static void calc_face_normals(void* data, int begin, int end)
+{
+    NormalJob* job = (NormalJob*)data;
+    const Model* model = job->model;
+    const Vertex* corners[3];
+    Vertex edges[3];
+    Vertex* normal;
+    double lengths[3];
+    double length;
+    double cosine;
+    double weight;
+    int i, k;
+
+    for (i = begin; i < end; ++i) {
+        for (k = 0; k < 3; ++k) {
+            corners[k] = &(model->vertices[get_vertex_index(model, &(model->triangles[i].points[k]))]);
+        }
+        for (k = 0; k < 3; ++k) {
+            edges[k].x = corners[(k + 1) % 3]->x - corners[k]->x;
+            edges[k].y = corners[(k + 1) % 3]->y - corners[k]->y;
+            edges[k].z = corners[(k + 1) % 3]->z - corners[k]->z;
+            lengths[k] = calc_length(&edges[k]);
+        }
+        normal = &(job->face_normals[i]);
+        normal->x = edges[0].y * edges[1].z - edges[0].z * edges[1].y;
+        normal->y = edges[0].z * edges[1].x - edges[0].x * edges[1].z;
+        normal->z = edges[0].x * edges[1].y - edges[0].y * edges[1].x;
+        length = calc_length(normal);
+        if (length > 0.0) {
+            normal->x /= length;
+            normal->y /= length;
+            normal->z /= length;
+        }
+        for (k = 0; k < 3; ++k) {
+            if (job->weighting == AREA_WEIGHTED_NORMALS || length == 0.0) {
+                weight = length * 0.5;
+            }
+            else {
+                // the angle between the outgoing edge and the reversed incoming edge
+                cosine = -(edges[k].x * edges[(k + 2) % 3].x + edges[k].y * edges[(k + 2) % 3].y + edges[k].z * edges[(k + 2) % 3].z)
+                    / (lengths[k] * lengths[(k + 2) % 3]);
+                weight = acos(cosine < -1.0 ? -1.0 : (cosine > 1.0 ? 1.0 : cosine));
+            }
+            job->weights[i * 3 + k] = weight;
+        }
+    }
+}
+
+/**
+ * Other vertex of an edge at a corner, with the index of the corner among the corners of its vertex
+ */
+typedef struct CornerEdge
+{
+    int vertex_index;
+    int corner;
+} CornerEdge;
+
+static int compare_corner_edges(const void* a, const void* b)
+{
+    const CornerEdge* first = (const CornerEdge*)a;
+    const CornerEdge* second = (const CornerEdge*)b;
+
+    if (first->vertex_index != second->vertex_index) {
+        return (first->vertex_index < second->vertex_index) ? -1 : 1;
+    }
+    return first->corner - second->corner;
+}
+
+static int find_cluster(int* parents, int corner)
+{
+    int root;
+    int next;
+
+    root = corner;
+    while (parents[root] != root) {
+        root = parents[root];
+    }
+    while (parents[corner] != root) {
+        next = parents[corner];
+        parents[corner] = root;
+        corner = next;
+    }
+    return root;
+}
+
+static int is_within_crease(const NormalJob* job, const int* corners, int a, int b)
+{
+    const Vertex* first = &(job->face_normals[corners[a] / 3]);
+    const Vertex* second = &(job->face_normals[corners[b] / 3]);
+
+    return first->x * second->x + first->y * second->y + first->z * second->z >= job->min_cosine;
+}
+
+/**
+ * Join the corners of the vertex whose triangles share an edge and are within the crease angle.
+ * The corners are linked by the other vertices of their edges, so sorting the edges by them
+ * brings the corners of the same edge next to each other.
+ */
+static void find_crease_clusters(const NormalJob* job, const int* corners, int n_corners,
+                                 CornerEdge* edges, int* parents)
+{
+    const Triangle* triangles = job->model->triangles;
+    int corner;
+    int i, j, k, l;
+
+    for (i = 0; i < n_corners; ++i) {
+        parents[i] = (job->is_smooth) ? 0 : i;
+    }
+    if (job->is_smooth) {
+        return;
+    }
+    for (i = 0; i < n_corners; ++i) {
+        corner = corners[i];
+        for (k = 1; k <= 2; ++k) {
+            edges[2 * i + k - 1].vertex_index = get_vertex_index(job->model, &(triangles[corner / 3].points[(corner + k) % 3]));
+            edges[2 * i + k - 1].corner = i;
+        }
+    }
+    qsort(edges, 2 * n_corners, sizeof(CornerEdge), compare_corner_edges);
+    for (i = 0; i < 2 * n_corners; i = j) {
+        for (j = i + 1; j < 2 * n_corners && edges[j].vertex_index == edges[i].vertex_index; ++j) {
+        }
+        // an edge of a manifold mesh has two triangles, the others are compared pairwise
+        for (k = i; k < j; ++k) {
+            for (l = k + 1; l < j; ++l) {
+                if (is_within_crease(job, corners, edges[k].corner, edges[l].corner)) {
+                    parents[find_cluster(parents, edges[k].corner)] = find_cluster(parents, edges[l].corner);
+                }
+            }
+        }
+    }
+}
+
+static unsigned int calc_normal_hash(const Vertex* normal)
+{
+    uint64_t words[3];
+    uint64_t hash;
+    int k;
+
+    memcpy(words, normal, sizeof(words));
+    hash = 14695981039346656037ULL;
+    for (k = 0; k < 3; ++k) {
+        hash = (hash ^ words[k]) * 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+    return (unsigned int)hash;
+}
+
+/**
+ * Find the normal among the distinct normals of the vertex through the hash table, or append it.
+ */
+static int insert_normal(Vertex* normals, int* n_normals, int* buckets, int n_buckets, const Vertex* normal)
+{
+    int bucket;
+
+    bucket = (int)(calc_normal_hash(normal) & (unsigned int)(n_buckets - 1));
+    while (buckets[bucket] >= 0) {
+        if (normals[buckets[bucket]].x == normal->x && normals[buckets[bucket]].y == normal->y
+            && normals[buckets[bucket]].z == normal->z) {
+            return buckets[bucket];
+        }
+        bucket = (bucket + 1) & (n_buckets - 1);
+    }
+    normals[*n_normals] = *normal;
+    buckets[bucket] = *n_normals;
+    return (*n_normals)++;
+}
+
+/**
+ * Calculate the distinct normals of the [begin, end) range of the vertices.
+ * The corners of a vertex are grouped into the clusters of the triangles within the crease angle,
+ * and the weighted face normals of a cluster are summed once, in O(k log k) steps for k corners.
+ * The normals are stored from the first corner slot of the vertex, because a vertex has at most as many normals as corners,
+ * and the work arrays of a vertex are at its corner slots too, so the ranges can be processed on separate threads.
+ */
+static void calc_vertex_normals(void* data, int begin, int end)
+{
+    NormalJob* job = (NormalJob*)data;
+    const Triangle* triangles = job->model->triangles;
+    const Vertex* face_normal;
+    const int* corners;
+    int* parents;
+    int* cluster_normals;
+    int* buckets;
+    Vertex* sums;
+    Vertex* normals;
+    Vertex normal;
+    double weight;
+    double length;
+    int offset;
+    int n_corners;
+    int n_normals;
+    int n_buckets;
+    int corner;
+    int root;
+    int v, i;
+
+    for (v = begin; v < end; ++v) {
+        offset = job->corner_offsets[v];
+        corners = &(job->corners[offset]);
+        n_corners = job->corner_offsets[v + 1] - offset;
+        normals = &(job->normals[offset]);
+        parents = &(job->parents[offset]);
+        cluster_normals = &(job->cluster_normals[offset]);
+        sums = &(job->sums[offset]);
+        buckets = &(job->buckets[2 * offset]);
+        n_normals = 0;
+        job->vertex_normal_offsets[v] = 0;
+        if (n_corners == 0) {
+            continue;
+        }
+        find_crease_clusters(job, corners, n_corners, &(job->edges[2 * offset]), parents);
+        for (i = 0; i < n_corners; ++i) {
+            sums[i].x = 0.0;
+            sums[i].y = 0.0;
+            sums[i].z = 0.0;
+            cluster_normals[i] = -1;
+        }
+        for (i = 0; i < n_corners; ++i) {
+            root = find_cluster(parents, i);
+            face_normal = &(job->face_normals[corners[i] / 3]);
+            weight = job->weights[corners[i]];
+            sums[root].x += face_normal->x * weight;
+            sums[root].y += face_normal->y * weight;
+            sums[root].z += face_normal->z * weight;
+        }
+        // the size of the table is a power of two within the 2 * n_corners slots, which is more than the number of clusters
+        for (n_buckets = 1; 2 * n_buckets <= n_corners; n_buckets *= 2) {
+        }
+        n_buckets *= 2;
+        for (i = 0; i < n_buckets; ++i) {
+            buckets[i] = -1;
+        }
+        for (i = 0; i < n_corners; ++i) {
+            corner = corners[i];
+            if (triangles[corner / 3].points[corner % 3].normal_index != INVALID_VERTEX_INDEX) {
+                continue;
+            }
+            root = find_cluster(parents, i);
+            if (cluster_normals[root] < 0) {
+                normal = sums[root];
+                length = calc_length(&normal);
+                if (length > 0.0) {
+                    normal.x /= length;
+                    normal.y /= length;
+                    normal.z /= length;
+                }
+                else {
+                    normal = job->face_normals[corner / 3];
+                }
+                cluster_normals[root] = insert_normal(normals, &n_normals, buckets, n_buckets, &normal);
+            }
+            job->local_indices[corner] = cluster_normals[root];
+        }
+        job->vertex_normal_offsets[v] = n_normals;
+    }
+}
+
+static void set_normal_indices(void* data, int begin, int end)
+{
+    NormalJob* job = (NormalJob*)data;
+    Model* model = job->model;
+    FacePoint* point;
+    int first_normal;
+    int i, k;
+
+    first_normal = model->n_normals + 1;
+    for (i = begin; i < end; ++i) {
+        for (k = 0; k < 3; ++k) {
+            point = &(model->triangles[i].points[k]);
+            if (point->normal_index == INVALID_VERTEX_INDEX) {
+                point->normal_index = first_normal
+                    + job->vertex_normal_offsets[get_vertex_index(model, point)]
+                    + job->local_indices[i * 3 + k];
+            }
+        }
+    }
+}
+
+/**
+ * Sort the corners of the triangles by their vertices (counting sort).
+ */
+static void sort_corners(NormalJob* job)
+{
+    const Model* model = job->model;
+    int n_corners;
+    int v, c;
+
+    n_corners = model->n_triangles * 3;
+    for (v = 0; v <= model->n_vertices + 1; ++v) {
+        job->corner_offsets[v] = 0;
+    }
+    for (c = 0; c < n_corners; ++c) {
+        ++job->corner_offsets[get_vertex_index(model, &(model->triangles[c / 3].points[c % 3])) + 1];
+    }
+    for (v = 0; v <= model->n_vertices; ++v) {
+        job->corner_offsets[v + 1] += job->corner_offsets[v];
+    }
+    for (c = 0; c < n_corners; ++c) {
+        v = get_vertex_index(model, &(model->triangles[c / 3].points[c % 3]));
+        job->corners[job->corner_offsets[v]++] = c;
+    }
+    for (v = model->n_vertices; v > 0; --v) {
+        job->corner_offsets[v] = job->corner_offsets[v - 1];
+    }
+    job->corner_offsets[0] = 0;
+}
+
+/**
+ * Move the normals from the corner slots next to each other and convert the counts to offsets.
+ */
+static int compact_normals(NormalJob* job)
+{
+    int n_new_normals;
+    int count;
+    int v, j;
+
+    n_new_normals = 0;
+    for (v = 0; v <= job->model->n_vertices; ++v) {
+        count = job->vertex_normal_offsets[v];
+        for (j = 0; j < count; ++j) {
+            job->normals[n_new_normals + j] = job->normals[job->corner_offsets[v] + j];
+        }
+        job->vertex_normal_offsets[v] = n_new_normals;
+        n_new_normals += count;
+    }
+    return n_new_normals;
+}
+
+static void free_normal_job(NormalJob* job)
+{
+    free(job->face_normals);
+    free(job->weights);
+    free(job->corner_offsets);
+    free(job->corners);
+    free(job->local_indices);
+    free(job->vertex_normal_offsets);
+    free(job->edges);
+    free(job->parents);
+    free(job->cluster_normals);
+    free(job->buckets);
+    free(job->sums);
+}
+
+int generate_normals(Model* model, NormalWeighting weighting, double crease_angle)
+{
+    NormalJob job;
+    Vertex* normals;
+    int n_corners;
+    int n_new_normals;
+
+    if (model->cache.data != NULL) {
+        printf("ERROR: The normals of a cached model can not be extended!\n");
+        return FALSE;
+    }
+    n_corners = model->n_triangles * 3;
+    normals = (Vertex*)realloc(model->normals, (model->n_normals + 1 + n_corners) * sizeof(Vertex));
+    if (normals == NULL) {
+        printf("ERROR: Unable to allocate memory for the normals!\n");
+        return FALSE;
+    }
+    model->normals = normals;
+
+    job.model = model;
+    job.weighting = weighting;
+    job.is_smooth = (crease_angle >= SMOOTH_ANGLE);
+    job.min_cosine = cos(crease_angle * M_PI / 180.0);
+    job.face_normals = (Vertex*)malloc((model->n_triangles + 1) * sizeof(Vertex));
+    job.weights = (double*)malloc((n_corners + 1) * sizeof(double));
+    job.corner_offsets = (int*)malloc((model->n_vertices + 2) * sizeof(int));
+    job.corners = (int*)malloc((n_corners + 1) * sizeof(int));
+    job.local_indices = (int*)malloc((n_corners + 1) * sizeof(int));
+    job.vertex_normal_offsets = (int*)malloc((model->n_vertices + 1) * sizeof(int));
+    job.normals = &(model->normals[model->n_normals + 1]);
+    job.edges = (CornerEdge*)malloc((2 * n_corners + 1) * sizeof(CornerEdge));
+    job.parents = (int*)malloc((n_corners + 1) * sizeof(int));
+    job.cluster_normals = (int*)malloc((n_corners + 1) * sizeof(int));
+    job.buckets = (int*)malloc((2 * n_corners + 1) * sizeof(int));
+    job.sums = (Vertex*)malloc((n_corners + 1) * sizeof(Vertex));
+    if (job.face_normals == NULL || job.weights == NULL || job.corner_offsets == NULL
+        || job.corners == NULL || job.local_indices == NULL || job.vertex_normal_offsets == NULL
+        || job.edges == NULL || job.parents == NULL || job.cluster_normals == NULL
+        || job.buckets == NULL || job.sums == NULL) {
+        printf("ERROR: Unable to allocate memory for the normals!\n");
+        free_normal_job(&job);
+        return FALSE;
+    }
+
+    parallel_for(model->n_triangles, MIN_TRIANGLE_RANGE, calc_face_normals, &job);
+    sort_corners(&job);
+    parallel_for(model->n_vertices + 1, MIN_VERTEX_RANGE, calc_vertex_normals, &job);
+    n_new_normals = compact_normals(&job);
+    parallel_for(model->n_triangles, MIN_TRIANGLE_RANGE, set_normal_indices, &job);
+    model->n_normals += n_new_normals;
+    normals = (Vertex*)realloc(model->normals, (model->n_normals + 1) * sizeof(Vertex));
+    if (normals != NULL) {
+        model->normals = normals;
+    }
+
+    free_normal_job(&job);
+    return TRUE;
+}
@@ -0,0 +1,204 @@
+#include "number.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_MANTISSA_DIGITS 19
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+#define MAX_EXACT_POWER 22
+#define MAX_EXPONENT 100000
+#define SLOW_BUFFER_SIZE 800
+
+static const double POWERS_OF_TEN[MAX_EXACT_POWER + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int is_digit(char c)
+{
+    return (unsigned)(c - '0') < 10;
+}
+
+/**
+ * Correctly rounded conversion for the numbers which do not fit into the fast path.
+ * The digits are rewritten without the decimal point, so strtod does not depend on the locale.
+ */
+static double parse_double_slow(const char* text, const char* end, int exponent)
+{
+    char buffer[SLOW_BUFFER_SIZE];
+    int n_digits;
+    int is_fraction;
+    int is_leading;
+
+    n_digits = 0;
+    is_fraction = 0;
+    is_leading = 1;
+    while (text < end) {
+        if (*text == '.') {
+            is_fraction = 1;
+        }
+        else {
+            if (*text != '0' || is_leading == 0) {
+                is_leading = 0;
+                if (n_digits < SLOW_BUFFER_SIZE - 16) {
+                    buffer[n_digits++] = *text;
+                }
+                else {
+                    ++exponent;
+                }
+            }
+            exponent -= is_fraction;
+        }
+        ++text;
+    }
+    if (n_digits == 0) {
+        return 0.0;
+    }
+    snprintf(buffer + n_digits, 16, "e%d", exponent);
+    return strtod(buffer, NULL);
+}
+
+const char* parse_double(const char* text, const char* end, double* value)
+{
+    const char* p;
+    const char* digits;
+    const char* digits_end;
+    const char* exponent_end;
+    uint64_t mantissa;
+    int n_digits;
+    int exponent;
+    int exponent_value;
+    int explicit_exponent;
+    int is_negative;
+    int is_exponent_negative;
+    int is_truncated;
+    double result;
+
+    p = text;
+    is_negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        is_negative = (*p == '-');
+        ++p;
+    }
+
+    digits = p;
+    mantissa = 0;
+    n_digits = 0;
+    exponent = 0;
+    is_truncated = 0;
+    while (p < end && is_digit(*p)) {
+        if (n_digits < MAX_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + (*p - '0');
+            n_digits += (mantissa != 0);
+        }
+        else {
+            ++exponent;
+            is_truncated |= (*p != '0');
+        }
+        ++p;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && is_digit(*p)) {
+            if (n_digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (*p - '0');
+                n_digits += (mantissa != 0);
+                --exponent;
+            }
+            else {
+                is_truncated |= (*p != '0');
+            }
+            ++p;
+        }
+    }
+    if (p == digits || (p == digits + 1 && *digits == '.')) {
+        return NULL;
+    }
+
+    digits_end = p;
+    explicit_exponent = 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        exponent_end = p + 1;
+        is_exponent_negative = 0;
+        if (exponent_end < end && (*exponent_end == '-' || *exponent_end == '+')) {
+            is_exponent_negative = (*exponent_end == '-');
+            ++exponent_end;
+        }
+        if (exponent_end < end && is_digit(*exponent_end)) {
+            exponent_value = 0;
+            while (exponent_end < end && is_digit(*exponent_end)) {
+                if (exponent_value < MAX_EXPONENT) {
+                    exponent_value = exponent_value * 10 + (*exponent_end - '0');
+                }
+                ++exponent_end;
+            }
+            explicit_exponent = is_exponent_negative ? -exponent_value : exponent_value;
+            p = exponent_end;
+        }
+    }
+    exponent += explicit_exponent;
+
+    if (mantissa == 0 && is_truncated == 0) {
+        result = 0.0;
+    }
+    else if (is_truncated == 0 && mantissa <= MAX_EXACT_MANTISSA
+        && exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER) {
+        // both operands are exact, so the single rounding gives the correct result
+        result = (double)mantissa;
+        if (exponent < 0) {
+            result /= POWERS_OF_TEN[-exponent];
+        }
+        else {
+            result *= POWERS_OF_TEN[exponent];
+        }
+    }
+    else {
+        result = parse_double_slow(digits, digits_end, explicit_exponent);
+    }
+
+    *value = is_negative ? -result : result;
+    return p;
+}
+
+const char* parse_int(const char* text, const char* end, int* value)
+{
+    const char* p;
+    unsigned int result;
+    unsigned int limit;
+    unsigned int digit;
+    int is_negative;
+
+    p = text;
+    is_negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        is_negative = (*p == '-');
+        ++p;
+    }
+    if (p == end || is_digit(*p) == 0) {
+        return NULL;
+    }
+    // the magnitude of INT_MIN is one more than INT_MAX
+    limit = is_negative ? (unsigned int)INT_MAX + 1u : (unsigned int)INT_MAX;
+    result = 0;
+    while (p < end && is_digit(*p)) {
+        digit = (unsigned int)(*p - '0');
+        if (result > (limit - digit) / 10) {
+            // a wrapped index could refer to an existing vertex
+            return NULL;
+        }
+        result = result * 10 + digit;
+        ++p;
+    }
+    *value = is_negative ? -(int)(result - 1u) - 1 : (int)result;
+    return p;
+}
+
+const char* skip_spaces(const char* text, const char* end)
+{
+    while (text < end && (*text == ' ' || *text == '\t')) {
+        ++text;
+    }
+    return text;
+}
@@ -0,0 +1,200 @@
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define MAX_THREADS 64
+
+typedef struct RangeJob
+{
+    RangeTask task;
+    void* data;
+    int begin;
+    int end;
+} RangeJob;
+
+/**
+ * Persistent worker threads, which take the ranges of the current parallel_for call
+ *
+ * The workers are started on demand and live until the process exits, so a call only wakes them.
+ * The calling thread takes ranges as well, so the call completes even if no worker could be started.
+ */
+typedef struct ThreadPool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    pthread_mutex_t call_mutex;
+    int n_workers;
+    int thread_count;
+    unsigned int generation;
+    RangeJob* jobs;
+    int n_ranges;
+    int next_range;
+    int n_done;
+} ThreadPool;
+
+static ThreadPool pool;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static int count_processors()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n_processors;
+
+    n_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return n_processors > 0 ? (int)n_processors : 1;
+#endif
+}
+
+static int clamp_thread_count(int n_threads)
+{
+    if (n_threads <= 0) {
+        n_threads = count_processors();
+    }
+    return n_threads < MAX_THREADS ? n_threads : MAX_THREADS;
+}
+
+static void init_pool()
+{
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.work_cond, NULL);
+    pthread_cond_init(&pool.done_cond, NULL);
+    pthread_mutex_init(&pool.call_mutex, NULL);
+    pool.n_workers = 0;
+    pool.thread_count = clamp_thread_count(0);
+    pool.generation = 0;
+    pool.jobs = NULL;
+    pool.n_ranges = 0;
+    pool.next_range = 0;
+    pool.n_done = 0;
+}
+
+int get_thread_count()
+{
+    int n_threads;
+
+    pthread_once(&pool_once, init_pool);
+    pthread_mutex_lock(&pool.mutex);
+    n_threads = pool.thread_count;
+    pthread_mutex_unlock(&pool.mutex);
+    return n_threads;
+}
+
+void set_thread_count(int n_threads)
+{
+    pthread_once(&pool_once, init_pool);
+    pthread_mutex_lock(&pool.mutex);
+    pool.thread_count = clamp_thread_count(n_threads);
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+/**
+ * Take the remaining ranges of the current call, with the mutex of the pool locked.
+ */
+static void run_ranges()
+{
+    RangeJob* job;
+
+    while (pool.next_range < pool.n_ranges) {
+        job = &(pool.jobs[pool.next_range]);
+        pool.next_range++;
+        pthread_mutex_unlock(&pool.mutex);
+        job->task(job->data, job->begin, job->end);
+        pthread_mutex_lock(&pool.mutex);
+        pool.n_done++;
+        if (pool.n_done == pool.n_ranges) {
+            pthread_cond_signal(&pool.done_cond);
+        }
+    }
+}
+
+static void* run_worker(void* argument)
+{
+    unsigned int generation = 0;
+
+    (void)argument;
+    pthread_mutex_lock(&pool.mutex);
+    for (;;) {
+        while (pool.generation == generation) {
+            pthread_cond_wait(&pool.work_cond, &pool.mutex);
+        }
+        generation = pool.generation;
+        run_ranges();
+    }
+    return NULL;
+}
+
+/**
+ * Start workers until there are the given number of them, with the mutex of the pool locked.
+ * A failed start leaves fewer workers, whose ranges the calling thread takes.
+ */
+static void start_workers(int n_workers)
+{
+    pthread_t thread;
+
+    while (pool.n_workers < n_workers) {
+        if (pthread_create(&thread, NULL, run_worker, NULL) != 0) {
+            return;
+        }
+        pthread_detach(thread);
+        pool.n_workers++;
+    }
+}
+
+void parallel_for(int n_items, int min_range_size, RangeTask task, void* data)
+{
+    RangeJob jobs[MAX_THREADS];
+    int n_ranges;
+    int i;
+
+    if (n_items <= 0) {
+        return;
+    }
+    if (min_range_size < 1) {
+        min_range_size = 1;
+    }
+    n_ranges = n_items / min_range_size;
+    if (n_ranges > get_thread_count()) {
+        n_ranges = get_thread_count();
+    }
+    // the pool runs one call at a time, so nested and concurrent calls stay on their own thread
+    if (n_ranges <= 1 || pthread_mutex_trylock(&pool.call_mutex) != 0) {
+        task(data, 0, n_items);
+        return;
+    }
+
+    for (i = 0; i < n_ranges; ++i) {
+        jobs[i].task = task;
+        jobs[i].data = data;
+        jobs[i].begin = (int)((long long)n_items * i / n_ranges);
+        jobs[i].end = (int)((long long)n_items * (i + 1) / n_ranges);
+    }
+    pthread_mutex_lock(&pool.mutex);
+    start_workers(n_ranges - 1);
+    pool.jobs = jobs;
+    pool.n_ranges = n_ranges;
+    pool.next_range = 0;
+    pool.n_done = 0;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work_cond);
+    run_ranges();
+    while (pool.n_done < pool.n_ranges) {
+        pthread_cond_wait(&pool.done_cond, &pool.mutex);
+    }
+    pool.jobs = NULL;
+    pool.n_ranges = 0;
+    pthread_mutex_unlock(&pool.mutex);
+    pthread_mutex_unlock(&pool.call_mutex);
+}
@@ -0,0 +1,861 @@
+#include "simplify.h"
+#include "halfedge.h"
+#include "transform.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_CORNER -1
+#define NO_TARGET -1
+#define NOT_IN_HEAP -1
+#define VERTEX_LOCKED 1
+#define VERTEX_SEAM 2
+#define VERTEX_REMOVED 4
+#define SEAM_NORMAL_COSINE 0.999
+#define MIN_DETERMINANT 1e-12
+#define DEFAULT_LEVEL_RATIO 0.5
+#define DEFAULT_MIN_TRIANGLES 64
+
+/**
+ * Symmetric matrix of the sum of the squared plane distances, weighted by the triangle areas
+ */
+typedef struct Quadric
+{
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;
+} Quadric;
+
+/**
+ * State of the edge collapses
+ *
+ * Every vertex has its cheapest collapse (to a neighbour target) in an indexed min-heap.
+ * The triangles of a vertex are in a linked list of corners (3 * triangle + point index).
+ */
+typedef struct Simplifier
+{
+    const Model* model;
+    int n_vertices;
+    int n_triangles;
+    int n_alive_triangles;
+    Vertex* positions;
+    Quadric* quadrics;
+    Triangle* triangles;
+    unsigned char* is_removed_triangle;
+    unsigned char* vertex_flags;
+    FacePoint* attributes;
+    int* first_corners;
+    int* next_corners;
+    int* targets;
+    Vertex* target_positions;
+    double* costs;
+    int* heap;
+    int* heap_positions;
+    int heap_size;
+    int* stamps;
+    int stamp;
+    int* visits;
+    int visit;
+    int* neighbours;
+    double max_error;
+} Simplifier;
+
+void init_simplify_options(SimplifyOptions* options)
+{
+    options->preserve_boundaries = TRUE;
+    options->preserve_seams = TRUE;
+    options->level_ratio = DEFAULT_LEVEL_RATIO;
+    options->min_triangles = DEFAULT_MIN_TRIANGLES;
+}
+
+static void add_plane_quadric(Quadric* q, double a, double b, double c, double d, double weight)
+{
+    q->a2 += weight * a * a;
+    q->ab += weight * a * b;
+    q->ac += weight * a * c;
+    q->ad += weight * a * d;
+    q->b2 += weight * b * b;
+    q->bc += weight * b * c;
+    q->bd += weight * b * d;
+    q->c2 += weight * c * c;
+    q->cd += weight * c * d;
+    q->d2 += weight * d * d;
+    q->weight += weight;
+}
+
+static void add_quadric(Quadric* q, const Quadric* other)
+{
+    q->a2 += other->a2;
+    q->ab += other->ab;
+    q->ac += other->ac;
+    q->ad += other->ad;
+    q->b2 += other->b2;
+    q->bc += other->bc;
+    q->bd += other->bd;
+    q->c2 += other->c2;
+    q->cd += other->cd;
+    q->d2 += other->d2;
+    q->weight += other->weight;
+}
+
+static double evaluate_quadric(const Quadric* q, const Vertex* p)
+{
+    double error;
+
+    error = q->a2 * p->x * p->x + 2.0 * q->ab * p->x * p->y + 2.0 * q->ac * p->x * p->z + 2.0 * q->ad * p->x
+        + q->b2 * p->y * p->y + 2.0 * q->bc * p->y * p->z + 2.0 * q->bd * p->y
+        + q->c2 * p->z * p->z + 2.0 * q->cd * p->z
+        + q->d2;
+    return (error > 0.0) ? error : 0.0;
+}
+
+/**
+ * Find the position of the minimal error by Cramer's rule, if the quadric is not singular.
+ */
+static int solve_quadric(const Quadric* q, Vertex* p)
+{
+    double det;
+    double scale;
+
+    det = q->a2 * (q->b2 * q->c2 - q->bc * q->bc)
+        - q->ab * (q->ab * q->c2 - q->bc * q->ac)
+        + q->ac * (q->ab * q->bc - q->b2 * q->ac);
+    scale = q->a2 + q->b2 + q->c2;
+    if (fabs(det) <= MIN_DETERMINANT * scale * scale * scale) {
+        return FALSE;
+    }
+    p->x = (-q->ad * (q->b2 * q->c2 - q->bc * q->bc)
+        + q->ab * (q->bd * q->c2 - q->bc * q->cd)
+        - q->ac * (q->bd * q->bc - q->b2 * q->cd)) / det;
+    p->y = (q->a2 * (-q->bd * q->c2 + q->cd * q->bc)
+        + q->ad * (q->ab * q->c2 - q->bc * q->ac)
+        + q->ac * (q->ab * q->cd - q->bd * q->ac)) / det;
+    p->z = (q->a2 * (-q->b2 * q->cd + q->bc * q->bd)
+        - q->ab * (-q->ab * q->cd + q->bd * q->ac)
+        - q->ad * (q->ab * q->bc - q->b2 * q->ac)) / det;
+    return TRUE;
+}
+
+static void calc_normal(const Vertex* a, const Vertex* b, const Vertex* c, Vertex* normal)
+{
+    double ux = b->x - a->x, uy = b->y - a->y, uz = b->z - a->z;
+    double vx = c->x - a->x, vy = c->y - a->y, vz = c->z - a->z;
+
+    normal->x = uy * vz - uz * vy;
+    normal->y = uz * vx - ux * vz;
+    normal->z = ux * vy - uy * vx;
+}
+
+static int contains_vertex(const Triangle* triangle, int vertex_index)
+{
+    return triangle->points[0].vertex_index == vertex_index
+        || triangle->points[1].vertex_index == vertex_index
+        || triangle->points[2].vertex_index == vertex_index;
+}
+
+/**
+ * Get the first corner of the vertex in a living triangle and unlink the removed ones before it.
+ */
+static int get_first_corner(Simplifier* s, int vertex_index)
+{
+    while (s->first_corners[vertex_index] != NO_CORNER
+        && s->is_removed_triangle[s->first_corners[vertex_index] / 3]) {
+        s->first_corners[vertex_index] = s->next_corners[s->first_corners[vertex_index]];
+    }
+    return s->first_corners[vertex_index];
+}
+
+static int get_next_corner(Simplifier* s, int corner)
+{
+    while (s->next_corners[corner] != NO_CORNER && s->is_removed_triangle[s->next_corners[corner] / 3]) {
+        s->next_corners[corner] = s->next_corners[s->next_corners[corner]];
+    }
+    return s->next_corners[corner];
+}
+
+static int compare_heap_items(const Simplifier* s, int i, int j)
+{
+    return s->costs[s->heap[i]] < s->costs[s->heap[j]];
+}
+
+static void swap_heap_items(Simplifier* s, int i, int j)
+{
+    int item;
+
+    item = s->heap[i];
+    s->heap[i] = s->heap[j];
+    s->heap[j] = item;
+    s->heap_positions[s->heap[i]] = i;
+    s->heap_positions[s->heap[j]] = j;
+}
+
+static void sift_up(Simplifier* s, int i)
+{
+    while (i > 0 && compare_heap_items(s, i, (i - 1) / 2)) {
+        swap_heap_items(s, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(Simplifier* s, int i)
+{
+    int child;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= s->heap_size) {
+            return;
+        }
+        if (child + 1 < s->heap_size && compare_heap_items(s, child + 1, child)) {
+            ++child;
+        }
+        if (compare_heap_items(s, child, i) == FALSE) {
+            return;
+        }
+        swap_heap_items(s, i, child);
+        i = child;
+    }
+}
+
+/**
+ * Insert the vertex into the heap or move it after the change of its cost.
+ */
+static void update_heap(Simplifier* s, int vertex_index)
+{
+    int i;
+
+    i = s->heap_positions[vertex_index];
+    if (i == NOT_IN_HEAP) {
+        i = s->heap_size++;
+        s->heap[i] = vertex_index;
+        s->heap_positions[vertex_index] = i;
+    }
+    sift_up(s, i);
+    sift_down(s, s->heap_positions[vertex_index]);
+}
+
+static void remove_from_heap(Simplifier* s, int vertex_index)
+{
+    int item;
+    int i;
+
+    i = s->heap_positions[vertex_index];
+    if (i == NOT_IN_HEAP) {
+        return;
+    }
+    s->heap_positions[vertex_index] = NOT_IN_HEAP;
+    --s->heap_size;
+    if (i == s->heap_size) {
+        return;
+    }
+    item = s->heap[s->heap_size];
+    s->heap[i] = item;
+    s->heap_positions[item] = i;
+    sift_up(s, i);
+    sift_down(s, s->heap_positions[item]);
+}
+
+/**
+ * Check the link condition: the common neighbours of the vertices are the opposite corners of their common triangles,
+ * otherwise the collapse would make the surface non-manifold.
+ */
+static int is_link_valid(Simplifier* s, int v, int w)
+{
+    const Triangle* triangle;
+    int n_common_triangles;
+    int n_common_vertices;
+    int corner;
+    int x, k;
+
+    ++s->stamp;
+    n_common_triangles = 0;
+    for (corner = get_first_corner(s, v); corner != NO_CORNER; corner = get_next_corner(s, corner)) {
+        triangle = &(s->triangles[corner / 3]);
+        if (contains_vertex(triangle, w)) {
+            ++n_common_triangles;
+        }
+        for (k = 0; k < 3; ++k) {
+            s->stamps[triangle->points[k].vertex_index] = s->stamp;
+        }
+    }
+    n_common_vertices = 0;
+    for (corner = get_first_corner(s, w); corner != NO_CORNER; corner = get_next_corner(s, corner)) {
+        triangle = &(s->triangles[corner / 3]);
+        for (k = 0; k < 3; ++k) {
+            x = triangle->points[k].vertex_index;
+            if (x != v && x != w && s->stamps[x] == s->stamp) {
+                s->stamps[x] = 0;
+                ++n_common_vertices;
+            }
+        }
+    }
+    return n_common_vertices == n_common_triangles;
+}
+
+/**
+ * Check whether a triangle of the vertex, which is not shared with the other vertex, would flip by moving the vertex.
+ */
+static int has_flipped_triangle(Simplifier* s, int vertex_index, int other_index, const Vertex* position)
+{
+    const Triangle* triangle;
+    const Vertex* corners[3];
+    Vertex old_normal;
+    Vertex new_normal;
+    int corner;
+    int k;
+
+    for (corner = get_first_corner(s, vertex_index); corner != NO_CORNER; corner = get_next_corner(s, corner)) {
+        triangle = &(s->triangles[corner / 3]);
+        if (contains_vertex(triangle, other_index)) {
+            continue;
+        }
+        for (k = 0; k < 3; ++k) {
+            corners[k] = &(s->positions[triangle->points[k].vertex_index]);
+        }
+        calc_normal(corners[0], corners[1], corners[2], &old_normal);
+        corners[corner % 3] = position;
+        calc_normal(corners[0], corners[1], corners[2], &new_normal);
+        if (old_normal.x * new_normal.x + old_normal.y * new_normal.y + old_normal.z * new_normal.z <= 0.0) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * Find the position and the cost of collapsing the vertex v into the vertex w.
+ * The collapse is valid when it is cheaper than the maximum cost and does not break the topology.
+ */
+static int evaluate_collapse(Simplifier* s, int v, int w, double max_cost, Vertex* position, double* cost)
+{
+    Quadric q;
+    Vertex candidates[4];
+    int n_candidates;
+    double candidate_cost;
+    int i;
+
+    q = s->quadrics[v];
+    add_quadric(&q, &(s->quadrics[w]));
+    n_candidates = 0;
+    candidates[n_candidates++] = s->positions[w];
+    if ((s->vertex_flags[w] & VERTEX_LOCKED) == 0) {
+        if (solve_quadric(&q, &candidates[n_candidates])) {
+            ++n_candidates;
+        }
+        candidates[n_candidates++] = s->positions[v];
+        candidates[n_candidates].x = (s->positions[v].x + s->positions[w].x) * 0.5;
+        candidates[n_candidates].y = (s->positions[v].y + s->positions[w].y) * 0.5;
+        candidates[n_candidates].z = (s->positions[v].z + s->positions[w].z) * 0.5;
+        ++n_candidates;
+    }
+    *cost = DBL_MAX;
+    for (i = 0; i < n_candidates; ++i) {
+        candidate_cost = evaluate_quadric(&q, &candidates[i]);
+        if (candidate_cost < *cost) {
+            *cost = candidate_cost;
+            *position = candidates[i];
+        }
+    }
+    // the topology checks are skipped when a cheaper collapse has been found already
+    if (*cost >= max_cost) {
+        return FALSE;
+    }
+    if (is_link_valid(s, v, w) == FALSE || has_flipped_triangle(s, v, w, position)) {
+        return FALSE;
+    }
+    if ((s->vertex_flags[w] & VERTEX_LOCKED) == 0 && has_flipped_triangle(s, w, v, position)) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Find the cheapest valid collapse of the vertex into one of its neighbours.
+ */
+static void find_collapse(Simplifier* s, int v)
+{
+    const Triangle* triangle;
+    Vertex position;
+    double cost;
+    int corner;
+    int w, k;
+
+    s->costs[v] = DBL_MAX;
+    s->targets[v] = NO_TARGET;
+    if (s->vertex_flags[v] & (VERTEX_LOCKED | VERTEX_REMOVED)) {
+        return;
+    }
+    // the neighbours of the fan are shared by two triangles, but evaluated once
+    ++s->visit;
+    for (corner = get_first_corner(s, v); corner != NO_CORNER; corner = get_next_corner(s, corner)) {
+        triangle = &(s->triangles[corner / 3]);
+        for (k = 1; k < 3; ++k) {
+            w = triangle->points[(corner % 3 + k) % 3].vertex_index;
+            if (s->visits[w] == s->visit) {
+                continue;
+            }
+            s->visits[w] = s->visit;
+            if (w != v && evaluate_collapse(s, v, w, s->costs[v], &position, &cost)) {
+                s->costs[v] = cost;
+                s->targets[v] = w;
+                s->target_positions[v] = position;
+            }
+        }
+    }
+}
+
+/**
+ * Lock the vertices of the boundary edges and flag the seam vertices,
+ * which have different texture coordinates or normals in their triangles.
+ */
+static int flag_vertices(Simplifier* s, const SimplifyOptions* options)
+{
+    const Model* model = s->model;
+    const FacePoint* point;
+    const FacePoint* first;
+    const TextureVertex* t0;
+    const TextureVertex* t1;
+    const Vertex* n0;
+    const Vertex* n1;
+    HalfEdgeMesh mesh;
+    int corner;
+    int v, h;
+
+    for (v = 0; v <= s->n_vertices; ++v) {
+        corner = s->first_corners[v];
+        if (corner == NO_CORNER) {
+            continue;
+        }
+        first = &(s->triangles[corner / 3].points[corner % 3]);
+        s->attributes[v] = *first;
+        for (corner = s->next_corners[corner]; corner != NO_CORNER; corner = s->next_corners[corner]) {
+            point = &(s->triangles[corner / 3].points[corner % 3]);
+            t0 = &(model->texture_vertices[first->texture_index]);
+            t1 = &(model->texture_vertices[point->texture_index]);
+            n0 = &(model->normals[first->normal_index]);
+            n1 = &(model->normals[point->normal_index]);
+            if (t0->u != t1->u || t0->v != t1->v
+                || n0->x * n1->x + n0->y * n1->y + n0->z * n1->z < SEAM_NORMAL_COSINE * sqrt(
+                    (n0->x * n0->x + n0->y * n0->y + n0->z * n0->z) * (n1->x * n1->x + n1->y * n1->y + n1->z * n1->z))) {
+                s->vertex_flags[v] |= VERTEX_SEAM;
+                break;
+            }
+        }
+        if (options->preserve_seams && (s->vertex_flags[v] & VERTEX_SEAM)) {
+            s->vertex_flags[v] |= VERTEX_LOCKED;
+        }
+    }
+
+    if (options->preserve_boundaries) {
+        if (build_half_edge_mesh(&mesh, model) == FALSE) {
+            return FALSE;
+        }
+        for (h = 0; h < mesh.n_half_edges; ++h) {
+            if (mesh.twins[h] == NO_HALF_EDGE) {
+                s->vertex_flags[mesh.vertices[h]] |= VERTEX_LOCKED;
+                s->vertex_flags[get_target_vertex(&mesh, h)] |= VERTEX_LOCKED;
+            }
+        }
+        free_half_edge_mesh(&mesh);
+    }
+    return TRUE;
+}
+
+static int is_valid_model_index(int index, int n_elements)
+{
+    return index >= 0 && index <= n_elements;
+}
+
+/**
+ * Set the quadrics of the vertices from the planes of their triangles.
+ */
+static void calc_quadrics(Simplifier* s)
+{
+    const Triangle* triangle;
+    Vertex normal;
+    double length;
+    double d;
+    int t, k;
+
+    memset(s->quadrics, 0, (s->n_vertices + 1) * sizeof(Quadric));
+    for (t = 0; t < s->n_triangles; ++t) {
+        if (s->is_removed_triangle[t]) {
+            continue;
+        }
+        triangle = &(s->triangles[t]);
+        calc_normal(&(s->positions[triangle->points[0].vertex_index]),
+            &(s->positions[triangle->points[1].vertex_index]),
+            &(s->positions[triangle->points[2].vertex_index]), &normal);
+        length = sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        if (length == 0.0) {
+            continue;
+        }
+        normal.x /= length;
+        normal.y /= length;
+        normal.z /= length;
+        d = -(normal.x * s->positions[triangle->points[0].vertex_index].x
+            + normal.y * s->positions[triangle->points[0].vertex_index].y
+            + normal.z * s->positions[triangle->points[0].vertex_index].z);
+        for (k = 0; k < 3; ++k) {
+            add_plane_quadric(&(s->quadrics[triangle->points[k].vertex_index]), normal.x, normal.y, normal.z, d, length * 0.5);
+        }
+    }
+}
+
+static void free_simplifier(Simplifier* s)
+{
+    free(s->positions);
+    free(s->quadrics);
+    free(s->triangles);
+    free(s->is_removed_triangle);
+    free(s->vertex_flags);
+    free(s->attributes);
+    free(s->first_corners);
+    free(s->next_corners);
+    free(s->targets);
+    free(s->target_positions);
+    free(s->costs);
+    free(s->heap);
+    free(s->heap_positions);
+    free(s->stamps);
+    free(s->visits);
+    free(s->neighbours);
+}
+
+static int init_simplifier(Simplifier* s, const Model* model, const SimplifyOptions* options)
+{
+    const Triangle* triangle;
+    size_t n;
+    int t, k, v;
+
+    memset(s, 0, sizeof(Simplifier));
+    s->model = model;
+    s->n_vertices = model->n_vertices;
+    s->n_triangles = model->n_triangles;
+    n = s->n_vertices + 1;
+    s->positions = (Vertex*)malloc(n * sizeof(Vertex));
+    s->quadrics = (Quadric*)malloc(n * sizeof(Quadric));
+    s->triangles = (Triangle*)malloc((s->n_triangles + 1) * sizeof(Triangle));
+    s->is_removed_triangle = (unsigned char*)calloc(s->n_triangles + 1, 1);
+    s->vertex_flags = (unsigned char*)calloc(n, 1);
+    s->attributes = (FacePoint*)calloc(n, sizeof(FacePoint));
+    s->first_corners = (int*)malloc(n * sizeof(int));
+    s->next_corners = (int*)malloc((s->n_triangles + 1) * 3 * sizeof(int));
+    s->targets = (int*)malloc(n * sizeof(int));
+    s->target_positions = (Vertex*)malloc(n * sizeof(Vertex));
+    s->costs = (double*)malloc(n * sizeof(double));
+    s->heap = (int*)malloc(n * sizeof(int));
+    s->heap_positions = (int*)malloc(n * sizeof(int));
+    s->stamps = (int*)calloc(n, sizeof(int));
+    s->visits = (int*)calloc(n, sizeof(int));
+    s->neighbours = (int*)malloc(n * sizeof(int));
+    if (s->positions == NULL || s->quadrics == NULL || s->triangles == NULL || s->is_removed_triangle == NULL
+        || s->vertex_flags == NULL || s->attributes == NULL || s->first_corners == NULL || s->next_corners == NULL
+        || s->targets == NULL || s->target_positions == NULL || s->costs == NULL
+        || s->heap == NULL || s->heap_positions == NULL || s->stamps == NULL || s->visits == NULL
+        || s->neighbours == NULL) {
+        printf("ERROR: Unable to allocate memory for the simplification!\n");
+        free_simplifier(s);
+        return FALSE;
+    }
+    memcpy(s->positions, model->vertices, n * sizeof(Vertex));
+    memcpy(s->triangles, model->triangles, s->n_triangles * sizeof(Triangle));
+
+    // the invalid and the degenerate triangles are dropped
+    s->n_alive_triangles = 0;
+    for (t = 0; t < s->n_triangles; ++t) {
+        triangle = &(s->triangles[t]);
+        for (k = 0; k < 3; ++k) {
+            if (is_valid_model_index(triangle->points[k].vertex_index, model->n_vertices) == FALSE
+                || is_valid_model_index(triangle->points[k].texture_index, model->n_texture_vertices) == FALSE
+                || is_valid_model_index(triangle->points[k].normal_index, model->n_normals) == FALSE) {
+                s->is_removed_triangle[t] = TRUE;
+            }
+        }
+        if (s->is_removed_triangle[t] == FALSE
+            && (triangle->points[0].vertex_index == triangle->points[1].vertex_index
+            || triangle->points[1].vertex_index == triangle->points[2].vertex_index
+            || triangle->points[2].vertex_index == triangle->points[0].vertex_index)) {
+            s->is_removed_triangle[t] = TRUE;
+        }
+        if (s->is_removed_triangle[t] == FALSE) {
+            ++s->n_alive_triangles;
+        }
+    }
+
+    for (v = 0; v <= s->n_vertices; ++v) {
+        s->first_corners[v] = NO_CORNER;
+        s->heap_positions[v] = NOT_IN_HEAP;
+    }
+    for (t = s->n_triangles - 1; t >= 0; --t) {
+        if (s->is_removed_triangle[t]) {
+            continue;
+        }
+        for (k = 2; k >= 0; --k) {
+            v = s->triangles[t].points[k].vertex_index;
+            s->next_corners[t * 3 + k] = s->first_corners[v];
+            s->first_corners[v] = t * 3 + k;
+        }
+    }
+
+    calc_quadrics(s);
+    if (flag_vertices(s, options) == FALSE) {
+        free_simplifier(s);
+        return FALSE;
+    }
+    s->heap_size = 0;
+    for (v = 1; v <= s->n_vertices; ++v) {
+        find_collapse(s, v);
+        if (s->targets[v] != NO_TARGET) {
+            update_heap(s, v);
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * Collapse the vertex into its target, then update the collapses around the target.
+ */
+static void collapse_vertex(Simplifier* s, int v)
+{
+    const Triangle* triangle;
+    FacePoint* point;
+    int w;
+    int corner;
+    int last_corner;
+    int n_neighbours;
+    int x, i, k;
+
+    w = s->targets[v];
+    if (s->quadrics[v].weight + s->quadrics[w].weight > 0.0) {
+        s->max_error = fmax(s->max_error, sqrt(s->costs[v] / (s->quadrics[v].weight + s->quadrics[w].weight)));
+    }
+    s->positions[w] = s->target_positions[v];
+    add_quadric(&(s->quadrics[w]), &(s->quadrics[v]));
+
+    last_corner = NO_CORNER;
+    for (corner = get_first_corner(s, v); corner != NO_CORNER; corner = get_next_corner(s, corner)) {
+        last_corner = corner;
+        if (contains_vertex(&(s->triangles[corner / 3]), w)) {
+            s->is_removed_triangle[corner / 3] = TRUE;
+            --s->n_alive_triangles;
+            continue;
+        }
+        point = &(s->triangles[corner / 3].points[corner % 3]);
+        point->vertex_index = w;
+        if ((s->vertex_flags[w] & VERTEX_SEAM) == 0) {
+            point->texture_index = s->attributes[w].texture_index;
+            point->normal_index = s->attributes[w].normal_index;
+        }
+    }
+    if (last_corner != NO_CORNER) {
+        s->next_corners[last_corner] = s->first_corners[w];
+        s->first_corners[w] = s->first_corners[v];
+    }
+    s->first_corners[v] = NO_CORNER;
+    s->vertex_flags[v] |= VERTEX_REMOVED;
+    s->vertex_flags[w] |= (s->vertex_flags[v] & VERTEX_SEAM);
+    remove_from_heap(s, v);
+
+    find_collapse(s, w);
+    update_heap(s, w);
+    ++s->visit;
+    n_neighbours = 0;
+    for (corner = get_first_corner(s, w); corner != NO_CORNER; corner = get_next_corner(s, corner)) {
+        triangle = &(s->triangles[corner / 3]);
+        for (k = 1; k < 3; ++k) {
+            x = triangle->points[(corner % 3 + k) % 3].vertex_index;
+            if (s->visits[x] != s->visit) {
+                s->visits[x] = s->visit;
+                s->neighbours[n_neighbours++] = x;
+            }
+        }
+    }
+    for (i = 0; i < n_neighbours; ++i) {
+        find_collapse(s, s->neighbours[i]);
+        update_heap(s, s->neighbours[i]);
+    }
+}
+
+/**
+ * Collapse the cheapest edges until the target number of triangles is reached or there is no valid collapse.
+ */
+static void run_collapses(Simplifier* s, int target_triangles)
+{
+    double cost;
+    int v;
+
+    while (s->n_alive_triangles > target_triangles && s->heap_size > 0) {
+        v = s->heap[0];
+        cost = s->costs[v];
+        if (cost == DBL_MAX) {
+            return;
+        }
+        // the neighbourhood could change since the cost was calculated
+        find_collapse(s, v);
+        if (s->costs[v] > cost) {
+            update_heap(s, v);
+            continue;
+        }
+        collapse_vertex(s, v);
+    }
+}
+
+/**
+ * Copy the living triangles and their referenced elements into a new model.
+ */
+static int extract_model(const Simplifier* s, Model* result)
+{
+    const Model* model = s->model;
+    const Triangle* triangle;
+    FacePoint* point;
+    int* vertex_map;
+    int* texture_map;
+    int* normal_map;
+    int n_triangles;
+    int t, k;
+
+    init_model(result);
+    vertex_map = (int*)calloc(model->n_vertices + 1, sizeof(int));
+    texture_map = (int*)calloc(model->n_texture_vertices + 1, sizeof(int));
+    normal_map = (int*)calloc(model->n_normals + 1, sizeof(int));
+    if (vertex_map == NULL || texture_map == NULL || normal_map == NULL) {
+        printf("ERROR: Unable to allocate memory for the simplified model!\n");
+        free(vertex_map);
+        free(texture_map);
+        free(normal_map);
+        return FALSE;
+    }
+    for (t = 0; t < s->n_triangles; ++t) {
+        if (s->is_removed_triangle[t]) {
+            continue;
+        }
+        triangle = &(s->triangles[t]);
+        for (k = 0; k < 3; ++k) {
+            if (vertex_map[triangle->points[k].vertex_index] == 0) {
+                vertex_map[triangle->points[k].vertex_index] = ++result->n_vertices;
+            }
+            if (triangle->points[k].texture_index != INVALID_VERTEX_INDEX && texture_map[triangle->points[k].texture_index] == 0) {
+                texture_map[triangle->points[k].texture_index] = ++result->n_texture_vertices;
+            }
+            if (triangle->points[k].normal_index != INVALID_VERTEX_INDEX && normal_map[triangle->points[k].normal_index] == 0) {
+                normal_map[triangle->points[k].normal_index] = ++result->n_normals;
+            }
+        }
+        ++result->n_triangles;
+    }
+    allocate_model(result);
+
+    n_triangles = 0;
+    for (t = 0; t < s->n_triangles; ++t) {
+        if (s->is_removed_triangle[t]) {
+            continue;
+        }
+        triangle = &(s->triangles[t]);
+        for (k = 0; k < 3; ++k) {
+            point = &(result->triangles[n_triangles].points[k]);
+            point->vertex_index = vertex_map[triangle->points[k].vertex_index];
+            point->texture_index = texture_map[triangle->points[k].texture_index];
+            point->normal_index = normal_map[triangle->points[k].normal_index];
+            result->vertices[point->vertex_index] = s->positions[triangle->points[k].vertex_index];
+            result->texture_vertices[point->texture_index] = model->texture_vertices[triangle->points[k].texture_index];
+            result->normals[point->normal_index] = model->normals[triangle->points[k].normal_index];
+        }
+        ++n_triangles;
+    }
+
+    free(vertex_map);
+    free(texture_map);
+    free(normal_map);
+    return TRUE;
+}
+
+int simplify_model(Model* result, const Model* model, int target_triangles, const SimplifyOptions* options)
+{
+    Simplifier s;
+    int success;
+
+    if (init_simplifier(&s, model, options) == FALSE) {
+        return FALSE;
+    }
+    run_collapses(&s, target_triangles);
+    success = extract_model(&s, result);
+    free_simplifier(&s);
+    return success;
+}
+
+int build_lod_chain(LodChain* chain, const Model* model, const SimplifyOptions* options)
+{
+    Simplifier s;
+    BoundingBox bounding_box;
+    double diagonal;
+    int n_triangles;
+
+    chain->n_levels = 0;
+    if (init_simplifier(&s, model, options) == FALSE) {
+        return FALSE;
+    }
+    calc_bounding_box(model, &bounding_box);
+    diagonal = sqrt(
+        (bounding_box.max.x - bounding_box.min.x) * (bounding_box.max.x - bounding_box.min.x)
+        + (bounding_box.max.y - bounding_box.min.y) * (bounding_box.max.y - bounding_box.min.y)
+        + (bounding_box.max.z - bounding_box.min.z) * (bounding_box.max.z - bounding_box.min.z));
+
+    while (chain->n_levels < MAX_LOD_LEVELS) {
+        if (extract_model(&s, &(chain->levels[chain->n_levels])) == FALSE) {
+            free_simplifier(&s);
+            free_lod_chain(chain);
+            return FALSE;
+        }
+        chain->errors[chain->n_levels] = (diagonal > 0.0) ? s.max_error / diagonal : 0.0;
+        ++chain->n_levels;
+
+        n_triangles = s.n_alive_triangles;
+        if ((int)(n_triangles * options->level_ratio) < options->min_triangles) {
+            break;
+        }
+        run_collapses(&s, (int)(n_triangles * options->level_ratio));
+        // the level is dropped when the locked vertices prevent the reduction
+        if (s.n_alive_triangles > n_triangles * (1.0 + options->level_ratio) * 0.5) {
+            break;
+        }
+    }
+
+    free_simplifier(&s);
+    return TRUE;
+}
+
+double calc_projected_size(double size, double distance, double fov, int viewport_height)
+{
+    if (distance <= 0.0) {
+        return DBL_MAX;
+    }
+    return size * viewport_height / (2.0 * distance * tan(fov * M_PI / 360.0));
+}
+
+int select_lod(const LodChain* chain, double projected_size)
+{
+    int level;
+
+    for (level = chain->n_levels - 1; level > 0; --level) {
+        if (chain->errors[level] * projected_size <= LOD_PIXEL_ERROR) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+void free_lod_chain(LodChain* chain)
+{
+    int i;
+
+    for (i = 0; i < chain->n_levels; ++i) {
+        free_model(&(chain->levels[i]));
+    }
+    chain->n_levels = 0;
+}
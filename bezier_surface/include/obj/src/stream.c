@@ -0,0 +1,235 @@
+#include "stream.h"
+#include "load.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BATCH_ELEMENT_SIZE (2 * sizeof(Vertex) + sizeof(TextureVertex) + sizeof(Triangle))
+
+/**
+ * State of the streaming
+ */
+typedef struct Stream
+{
+    const StreamHandlers* handlers;
+    int batch_size;
+    Vertex* vertices;
+    TextureVertex* texture_vertices;
+    Vertex* normals;
+    Triangle* triangles;
+    int n_vertices;
+    int n_texture_vertices;
+    int n_normals;
+    int n_triangles;
+    int first_vertex;
+    int first_texture_vertex;
+    int first_normal;
+    int first_triangle;
+} Stream;
+
+int init_stream_settings(StreamSettings* settings, size_t memory_limit)
+{
+    // the text buffer gets half of the limit, but at least the minimal size, and the batches get the rest
+    if (memory_limit < MIN_STREAM_BUFFER_SIZE + BATCH_ELEMENT_SIZE) {
+        printf("ERROR: The %lu bytes memory limit is below the minimal stream buffer and batches!\n", (unsigned long)memory_limit);
+        return FALSE;
+    }
+    settings->buffer_size = memory_limit / 2;
+    if (settings->buffer_size < MIN_STREAM_BUFFER_SIZE) {
+        settings->buffer_size = MIN_STREAM_BUFFER_SIZE;
+    }
+    settings->batch_size = (int)((memory_limit - settings->buffer_size) / BATCH_ELEMENT_SIZE);
+    return TRUE;
+}
+
+size_t calc_stream_memory(const StreamSettings* settings)
+{
+    return settings->buffer_size + (size_t)settings->batch_size * BATCH_ELEMENT_SIZE;
+}
+
+/**
+ * Pass the collected vertices of all types to the handlers.
+ */
+static int flush_vertices(Stream* stream)
+{
+    const StreamHandlers* handlers = stream->handlers;
+    int success;
+
+    success = TRUE;
+    if (stream->n_vertices > 0 && handlers->on_vertices != NULL) {
+        success &= handlers->on_vertices(handlers->data, stream->vertices, stream->first_vertex, stream->n_vertices);
+    }
+    if (stream->n_texture_vertices > 0 && handlers->on_texture_vertices != NULL) {
+        success &= handlers->on_texture_vertices(handlers->data, stream->texture_vertices, stream->first_texture_vertex, stream->n_texture_vertices);
+    }
+    if (stream->n_normals > 0 && handlers->on_normals != NULL) {
+        success &= handlers->on_normals(handlers->data, stream->normals, stream->first_normal, stream->n_normals);
+    }
+    stream->first_vertex += stream->n_vertices;
+    stream->first_texture_vertex += stream->n_texture_vertices;
+    stream->first_normal += stream->n_normals;
+    stream->n_vertices = 0;
+    stream->n_texture_vertices = 0;
+    stream->n_normals = 0;
+    return success;
+}
+
+static int flush_triangles(Stream* stream)
+{
+    const StreamHandlers* handlers = stream->handlers;
+    int success;
+
+    success = TRUE;
+    if (stream->n_triangles > 0 && handlers->on_triangles != NULL) {
+        success = handlers->on_triangles(handlers->data, stream->triangles, stream->first_triangle, stream->n_triangles);
+    }
+    stream->first_triangle += stream->n_triangles;
+    stream->n_triangles = 0;
+    return success;
+}
+
+/**
+ * Read the element of the line into the current batch.
+ */
+static int stream_line(Stream* stream, const char* text, const char* end)
+{
+    Triangle* triangle;
+
+    switch (calc_element_type(text, end)) {
+    case NONE:
+        break;
+    case VERTEX:
+        if (read_vertex(&(stream->vertices[stream->n_vertices]), text, end) == FALSE) {
+            printf("Unable to read vertex data!\n");
+            return FALSE;
+        }
+        if (++stream->n_vertices == stream->batch_size) {
+            return flush_vertices(stream);
+        }
+        break;
+    case TEXTURE_VERTEX:
+        if (read_texture_vertex(&(stream->texture_vertices[stream->n_texture_vertices]), text, end) == FALSE) {
+            printf("Unable to read texture vertex data!\n");
+            return FALSE;
+        }
+        if (++stream->n_texture_vertices == stream->batch_size) {
+            return flush_vertices(stream);
+        }
+        break;
+    case NORMAL:
+        if (read_normal(&(stream->normals[stream->n_normals]), text, end) == FALSE) {
+            printf("Unable to read normal vector data!\n");
+            return FALSE;
+        }
+        if (++stream->n_normals == stream->batch_size) {
+            return flush_vertices(stream);
+        }
+        break;
+    case FACE:
+        triangle = &(stream->triangles[stream->n_triangles]);
+        if (read_triangle(triangle, text, end) == FALSE) {
+            printf("Unable to read triangle face data!\n");
+            return FALSE;
+        }
+        resolve_relative_indices(triangle,
+            stream->first_vertex + stream->n_vertices,
+            stream->first_texture_vertex + stream->n_texture_vertices,
+            stream->first_normal + stream->n_normals);
+        // the vertices always reach the handlers before the faces which refer to them
+        if (flush_vertices(stream) == FALSE) {
+            return FALSE;
+        }
+        if (++stream->n_triangles == stream->batch_size) {
+            return flush_triangles(stream);
+        }
+        break;
+    }
+    return TRUE;
+}
+
+/**
+ * Read the complete lines of the buffer and return the number of processed bytes.
+ */
+static size_t stream_lines(Stream* stream, const char* text, size_t size, int is_last, int* success)
+{
+    const char* start;
+    const char* end;
+    const char* line_end;
+
+    start = text;
+    end = text + size;
+    while (text < end && *success) {
+        line_end = (const char*)memchr(text, '\n', end - text);
+        if (line_end == NULL) {
+            if (is_last == FALSE) {
+                break;
+            }
+            line_end = end;
+        }
+        *success = stream_line(stream, text, line_end);
+        text = (line_end < end) ? line_end + 1 : end;
+    }
+    return text - start;
+}
+
+int stream_model(const char* filename, const StreamSettings* settings, const StreamHandlers* handlers)
+{
+    Stream stream;
+    FILE* file;
+    char* buffer;
+    size_t n_buffered;
+    size_t n_read;
+    size_t n_processed;
+    int is_last;
+    int success;
+
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("ERROR: Unable to open '%s' file!\n", filename);
+        return FALSE;
+    }
+    memset(&stream, 0, sizeof(Stream));
+    stream.handlers = handlers;
+    stream.batch_size = settings->batch_size;
+    stream.first_vertex = 1;
+    stream.first_texture_vertex = 1;
+    stream.first_normal = 1;
+    buffer = (char*)malloc(settings->buffer_size);
+    stream.vertices = (Vertex*)malloc(settings->batch_size * sizeof(Vertex));
+    stream.texture_vertices = (TextureVertex*)malloc(settings->batch_size * sizeof(TextureVertex));
+    stream.normals = (Vertex*)malloc(settings->batch_size * sizeof(Vertex));
+    stream.triangles = (Triangle*)malloc(settings->batch_size * sizeof(Triangle));
+
+    success = (buffer != NULL && stream.vertices != NULL && stream.texture_vertices != NULL
+        && stream.normals != NULL && stream.triangles != NULL);
+    n_buffered = 0;
+    is_last = FALSE;
+    while (success && is_last == FALSE) {
+        n_read = fread(buffer + n_buffered, 1, settings->buffer_size - n_buffered, file);
+        n_buffered += n_read;
+        is_last = (feof(file) || ferror(file));
+        n_processed = stream_lines(&stream, buffer, n_buffered, is_last, &success);
+        if (success && n_processed == 0 && is_last == FALSE) {
+            printf("ERROR: The line does not fit into the %lu bytes stream buffer!\n", (unsigned long)settings->buffer_size);
+            success = FALSE;
+        }
+        memmove(buffer, buffer + n_processed, n_buffered - n_processed);
+        n_buffered -= n_processed;
+    }
+    if (success && ferror(file)) {
+        printf("ERROR: Unable to read '%s' file!\n", filename);
+        success = FALSE;
+    }
+    if (success) {
+        success = flush_vertices(&stream) && flush_triangles(&stream);
+    }
+
+    fclose(file);
+    free(buffer);
+    free(stream.vertices);
+    free(stream.texture_vertices);
+    free(stream.normals);
+    free(stream.triangles);
+    return success;
+}
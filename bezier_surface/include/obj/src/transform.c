@@ -1,12 +1,296 @@
 #include "transform.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MIN_TRANSFORM_RANGE 16384
+#define MIN_BOUNDING_RANGE 65536
+#define MAX_BOUNDING_RANGES 64
+
+typedef struct TransformJob
+{
+    Vertex* vertices;
+    const double* matrix;
+    int is_normalized;
+} TransformJob;
+
+/**
+ * Transform the [begin, end) range of the vertices by the first three rows of the matrix.
+ */
+static void transform_vertices(void* data, int begin, int end)
+{
+    TransformJob* job = (TransformJob*)data;
+    const double* m = job->matrix;
+    Vertex* vertex;
+    double length;
+    int i;
+#ifdef __SSE2__
+    // x and y are processed together in one register, z in the lower half of another one
+    __m128d column_xy[4];
+    __m128d column_z[4];
+    __m128d xy, z, squares;
+    int k;
+
+    for (k = 0; k < 4; ++k) {
+        column_xy[k] = _mm_loadu_pd(&m[k * 4]);
+        column_z[k] = _mm_set_sd(m[k * 4 + 2]);
+    }
+    for (i = begin; i < end; ++i) {
+        vertex = &(job->vertices[i]);
+        xy = _mm_add_pd(_mm_mul_pd(column_xy[0], _mm_set1_pd(vertex->x)), column_xy[3]);
+        z = _mm_add_sd(_mm_mul_sd(column_z[0], _mm_set_sd(vertex->x)), column_z[3]);
+        xy = _mm_add_pd(xy, _mm_mul_pd(column_xy[1], _mm_set1_pd(vertex->y)));
+        z = _mm_add_sd(z, _mm_mul_sd(column_z[1], _mm_set_sd(vertex->y)));
+        xy = _mm_add_pd(xy, _mm_mul_pd(column_xy[2], _mm_set1_pd(vertex->z)));
+        z = _mm_add_sd(z, _mm_mul_sd(column_z[2], _mm_set_sd(vertex->z)));
+        if (job->is_normalized) {
+            squares = _mm_add_sd(_mm_mul_pd(xy, xy), _mm_mul_sd(z, z));
+            length = sqrt(_mm_cvtsd_f64(_mm_add_sd(squares, _mm_unpackhi_pd(squares, squares))));
+            if (length > 0.0) {
+                xy = _mm_div_pd(xy, _mm_set1_pd(length));
+                z = _mm_div_sd(z, _mm_set_sd(length));
+            }
+        }
+        _mm_storeu_pd(&(vertex->x), xy);
+        _mm_store_sd(&(vertex->z), z);
+    }
+#else
+    double x, y, z;
+
+    for (i = begin; i < end; ++i) {
+        vertex = &(job->vertices[i]);
+        x = m[0] * vertex->x + m[4] * vertex->y + m[8] * vertex->z + m[12];
+        y = m[1] * vertex->x + m[5] * vertex->y + m[9] * vertex->z + m[13];
+        z = m[2] * vertex->x + m[6] * vertex->y + m[10] * vertex->z + m[14];
+        if (job->is_normalized) {
+            length = sqrt(x * x + y * y + z * z);
+            if (length > 0.0) {
+                x /= length;
+                y /= length;
+                z /= length;
+            }
+        }
+        vertex->x = x;
+        vertex->y = y;
+        vertex->z = z;
+    }
+#endif
+}
+
+/**
+ * Transform only the vertices of the model, the normals do not change.
+ */
+static void transform_positions(Model* model, const double* matrix)
+{
+    TransformJob job;
+
+    // the first elements belong to the invalid index
+    job.vertices = model->vertices + 1;
+    job.matrix = matrix;
+    job.is_normalized = FALSE;
+    parallel_for(model->n_vertices, MIN_TRANSFORM_RANGE, transform_vertices, &job);
+}
+
+/**
+ * Calculate the normal matrix of the affine transformation as a 4x4 matrix without translation.
+ * The cofactor matrix is used, because the length of the normals is restored anyway.
+ */
+static void calc_normal_matrix(const double* m, double* normal_matrix)
+{
+    double determinant;
+    double sign;
+    int i, j;
+
+    // cofactors of the upper 3x3 part, which form the transpose of the adjugate
+    normal_matrix[0] = m[5] * m[10] - m[9] * m[6];
+    normal_matrix[1] = m[8] * m[6] - m[4] * m[10];
+    normal_matrix[2] = m[4] * m[9] - m[8] * m[5];
+    normal_matrix[4] = m[9] * m[2] - m[1] * m[10];
+    normal_matrix[5] = m[0] * m[10] - m[8] * m[2];
+    normal_matrix[6] = m[8] * m[1] - m[0] * m[9];
+    normal_matrix[8] = m[1] * m[6] - m[5] * m[2];
+    normal_matrix[9] = m[4] * m[2] - m[0] * m[6];
+    normal_matrix[10] = m[0] * m[5] - m[4] * m[1];
+
+    // mirroring transformations have to keep the orientation of the normals
+    determinant = m[0] * normal_matrix[0] + m[4] * normal_matrix[4] + m[8] * normal_matrix[8];
+    sign = (determinant < 0.0) ? -1.0 : 1.0;
+    for (i = 0; i < 3; ++i) {
+        for (j = 0; j < 3; ++j) {
+            normal_matrix[4 * i + j] *= sign;
+        }
+    }
+    normal_matrix[3] = 0.0;
+    normal_matrix[7] = 0.0;
+    normal_matrix[11] = 0.0;
+    normal_matrix[12] = 0.0;
+    normal_matrix[13] = 0.0;
+    normal_matrix[14] = 0.0;
+    normal_matrix[15] = 1.0;
+}
+
+void transform_model(Model* model, const double matrix[16])
+{
+    TransformJob job;
+    double normal_matrix[16];
+
+    transform_positions(model, matrix);
+
+    calc_normal_matrix(matrix, normal_matrix);
+    job.vertices = model->normals + 1;
+    job.matrix = normal_matrix;
+    job.is_normalized = TRUE;
+    parallel_for(model->n_normals, MIN_TRANSFORM_RANGE, transform_vertices, &job);
+}
 
 void scale_model(Model* model, double sx, double sy, double sz)
 {
+    double matrix[16] = {
+        sx, 0.0, 0.0, 0.0,
+        0.0, sy, 0.0, 0.0,
+        0.0, 0.0, sz, 0.0,
+        0.0, 0.0, 0.0, 1.0
+    };
+
+    transform_model(model, matrix);
+}
+
+void translate_model(Model* model, double dx, double dy, double dz)
+{
+    double matrix[16] = {
+        1.0, 0.0, 0.0, 0.0,
+        0.0, 1.0, 0.0, 0.0,
+        0.0, 0.0, 1.0, 0.0,
+        dx, dy, dz, 1.0
+    };
+
+    transform_positions(model, matrix);
+}
+
+void fit_model(Model* model, double size)
+{
+    BoundingBox bounding_box;
+    double matrix[16] = {
+        1.0, 0.0, 0.0, 0.0,
+        0.0, 1.0, 0.0, 0.0,
+        0.0, 0.0, 1.0, 0.0,
+        0.0, 0.0, 0.0, 1.0
+    };
+    double extent;
+    double scale;
+
+    if (model->n_vertices == 0) {
+        return;
+    }
+    calc_bounding_box(model, &bounding_box);
+    extent = fmax(bounding_box.max.x - bounding_box.min.x,
+        fmax(bounding_box.max.y - bounding_box.min.y, bounding_box.max.z - bounding_box.min.z));
+    scale = (extent > 0.0) ? size / extent : 1.0;
+
+    // translation and uniform scaling in a single pass, which does not change the normals
+    matrix[0] = scale;
+    matrix[5] = scale;
+    matrix[10] = scale;
+    matrix[12] = -(bounding_box.min.x + bounding_box.max.x) / 2 * scale;
+    matrix[13] = -(bounding_box.min.y + bounding_box.max.y) / 2 * scale;
+    matrix[14] = -(bounding_box.min.z + bounding_box.max.z) / 2 * scale;
+    transform_positions(model, matrix);
+}
+
+typedef struct BoundingJob
+{
+    const Vertex* vertices;
+    int n_vertices;
+    int n_ranges;
+    BoundingBox boxes[MAX_BOUNDING_RANGES];
+} BoundingJob;
+
+/**
+ * Calculate the bounding boxes of the [begin, end) ranges of the vertices.
+ */
+static void calc_range_bounding_boxes(void* data, int begin, int end)
+{
+    BoundingJob* job = (BoundingJob*)data;
+    const Vertex* vertex;
+    BoundingBox* box;
+    int first, last;
+    int range;
+    int i;
+
+    for (range = begin; range < end; ++range) {
+        first = (int)((long long)job->n_vertices * range / job->n_ranges);
+        last = (int)((long long)job->n_vertices * (range + 1) / job->n_ranges);
+        box = &(job->boxes[range]);
+        box->min = job->vertices[first];
+        box->max = job->vertices[first];
+#ifdef __SSE2__
+        __m128d min_xy = _mm_loadu_pd(&(box->min.x));
+        __m128d max_xy = min_xy;
+        __m128d min_z = _mm_load_sd(&(box->min.z));
+        __m128d max_z = min_z;
+        __m128d xy, z;
+
+        for (i = first + 1; i < last; ++i) {
+            vertex = &(job->vertices[i]);
+            xy = _mm_loadu_pd(&(vertex->x));
+            z = _mm_load_sd(&(vertex->z));
+            min_xy = _mm_min_pd(min_xy, xy);
+            max_xy = _mm_max_pd(max_xy, xy);
+            min_z = _mm_min_sd(min_z, z);
+            max_z = _mm_max_sd(max_z, z);
+        }
+        _mm_storeu_pd(&(box->min.x), min_xy);
+        _mm_storeu_pd(&(box->max.x), max_xy);
+        _mm_store_sd(&(box->min.z), min_z);
+        _mm_store_sd(&(box->max.z), max_z);
+#else
+        for (i = first + 1; i < last; ++i) {
+            vertex = &(job->vertices[i]);
+            box->min.x = fmin(box->min.x, vertex->x);
+            box->min.y = fmin(box->min.y, vertex->y);
+            box->min.z = fmin(box->min.z, vertex->z);
+            box->max.x = fmax(box->max.x, vertex->x);
+            box->max.y = fmax(box->max.y, vertex->y);
+            box->max.z = fmax(box->max.z, vertex->z);
+        }
+#endif
+    }
+}
+
+void calc_bounding_box(const Model* model, BoundingBox* bounding_box)
+{
+    BoundingJob job;
     int i;
 
-    for (i = 0; i < model->n_vertices; ++i) {
-        model->vertices[i].x *= sx;
-        model->vertices[i].y *= sy;
-        model->vertices[i].z *= sz;
+    if (model->n_vertices == 0) {
+        bounding_box->min = (Vertex){0.0, 0.0, 0.0};
+        bounding_box->max = (Vertex){0.0, 0.0, 0.0};
+        return;
+    }
+
+    job.vertices = model->vertices + 1;
+    job.n_vertices = model->n_vertices;
+    job.n_ranges = model->n_vertices / MIN_BOUNDING_RANGE + 1;
+    if (job.n_ranges > get_thread_count()) {
+        job.n_ranges = get_thread_count();
+    }
+    if (job.n_ranges > MAX_BOUNDING_RANGES) {
+        job.n_ranges = MAX_BOUNDING_RANGES;
+    }
+    parallel_for(job.n_ranges, 1, calc_range_bounding_boxes, &job);
+
+    *bounding_box = job.boxes[0];
+    for (i = 1; i < job.n_ranges; ++i) {
+        bounding_box->min.x = fmin(bounding_box->min.x, job.boxes[i].min.x);
+        bounding_box->min.y = fmin(bounding_box->min.y, job.boxes[i].min.y);
+        bounding_box->min.z = fmin(bounding_box->min.z, job.boxes[i].min.z);
+        bounding_box->max.x = fmax(bounding_box->max.x, job.boxes[i].max.x);
+        bounding_box->max.y = fmax(bounding_box->max.y, job.boxes[i].max.y);
+        bounding_box->max.z = fmax(bounding_box->max.z, job.boxes[i].max.z);
     }
 }
@@ -0,0 +1,53 @@
+#ifndef OBJ_STREAM_H
+#define OBJ_STREAM_H
+
+#include "model.h"
+
+#include <stddef.h>
+
+#define DEFAULT_STREAM_MEMORY_LIMIT (16 << 20)
+#define MIN_STREAM_BUFFER_SIZE 4096
+
+/**
+ * Handlers of the element batches
+ *
+ * The first index is the OBJ index of the first element of the batch
+ * (one based for the vertices and zero based for the triangles, like in the Model).
+ * Handlers can be NULL and they can stop the reading by returning FALSE.
+ */
+typedef struct StreamHandlers
+{
+    void* data;
+    int (*on_vertices)(void* data, const Vertex* vertices, int first_index, int count);
+    int (*on_texture_vertices)(void* data, const TextureVertex* texture_vertices, int first_index, int count);
+    int (*on_normals)(void* data, const Vertex* normals, int first_index, int count);
+    int (*on_triangles)(void* data, const Triangle* triangles, int first_index, int count);
+} StreamHandlers;
+
+/**
+ * Sizes of the buffers which are used while streaming
+ */
+typedef struct StreamSettings
+{
+    size_t buffer_size;
+    int batch_size;
+} StreamSettings;
+
+/**
+ * Split the memory limit between the text buffer and the element batches, so that they fit into it together.
+ * Returns FALSE when the limit is smaller than the minimal text buffer and one element of every batch.
+ */
+int init_stream_settings(StreamSettings* settings, size_t memory_limit);
+
+/**
+ * Calculate the memory which is used while streaming with the settings.
+ */
+size_t calc_stream_memory(const StreamSettings* settings);
+
+/**
+ * Read the OBJ file in fixed-size batches, without storing the whole model.
+ * The lines have to fit into the text buffer.
+ */
+int stream_model(const char* filename, const StreamSettings* settings, const StreamHandlers* handlers);
+
+#endif /* OBJ_STREAM_H */
@@ -0,0 +1,837 @@
+#include "bvh.h"
+#include "halfedge.h"
+#include "load.h"
+#include "model.h"
+#include "number.h"
+#include "parallel.h"
+#include "simplify.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the test grid has 2 * 300 * 300 = 180k triangles, about the size of the surfaces of the viewer
+#define GRID_SIZE 300
+#define N_SOUP_TRIANGLES 4000
+#define N_GRID_RAYS 256
+#define N_SOUP_RAYS 1024
+// the hits are calculated in float, the reference in double
+#define DISTANCE_TOLERANCE 1e-4
+#define INVALID_OBJ_FILENAME "test/invalid.obj"
+// the twins are checked against all pairs of half edges on a smaller grid
+#define SMALL_GRID_SIZE 30
+#define MAX_NEIGHBOURS 64
+// the simplified grid keeps its boundary, so its size limits the reduction
+#define SIMPLIFY_GRID_SIZE 60
+#define SIMPLIFY_TARGET 1000
+// the triangles between three locked boundary vertices of a side stand upright, so their projected area is zero
+#define FLIP_TOLERANCE 1e-12
+// each block of the multi chunk file takes about 450 bytes, so the file spans several chunks of 1 MB
+#define CHUNKED_OBJ_FILENAME "test/chunked.obj"
+#define N_CHUNKED_BLOCKS 10000
+#define N_CHUNKED_THREADS 4
+#define MAX_NUMBER_LENGTH 64
+
+static int n_failures = 0;
+
+/**
+ * Report the number of mismatches of a check, and count it as a failure when there is any.
+ */
+static void check(const char* name, int size, int n_mismatches, double max_error, double tolerance)
+{
+    int is_passed;
+
+    is_passed = (n_mismatches == 0 && max_error <= tolerance);
+    printf("%-20s %8d %10d %12.3g %8s\n", name, size, n_mismatches, max_error, is_passed ? "ok" : "FAILED");
+    if (!is_passed) {
+        ++n_failures;
+    }
+}
+
+/**
+ * Pseudo-random number in [0, 1), with the same sequence on every run.
+ */
+static double calc_random(unsigned int* state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return ((*state >> 8) & 0xFFFF) / 65536.0;
+}
+
+/**
+ * Create a wavy height field of size x size quads, two triangles each, over the unit square.
+ * The extra triangles after the grid are left for the caller.
+ */
+static void create_grid_model(Model* model, int size, int n_extra_triangles)
+{
+    Triangle* triangle;
+    Vertex* vertex;
+    int i, j, k;
+    int corners[4];
+
+    init_model(model);
+    model->n_vertices = (size + 1) * (size + 1);
+    model->n_triangles = 2 * size * size + n_extra_triangles;
+    allocate_model(model);
+    for (i = 0; i <= size; ++i) {
+        for (j = 0; j <= size; ++j) {
+            vertex = &(model->vertices[i * (size + 1) + j + 1]);
+            vertex->x = (double)j / size;
+            vertex->y = (double)i / size;
+            vertex->z = 0.1 * sin(7.0 * vertex->x) * cos(5.0 * vertex->y);
+        }
+    }
+    for (i = 0; i < size; ++i) {
+        for (j = 0; j < size; ++j) {
+            corners[0] = i * (size + 1) + j + 1;
+            corners[1] = corners[0] + 1;
+            corners[2] = corners[0] + size + 2;
+            corners[3] = corners[0] + size + 1;
+            for (k = 0; k < 2; ++k) {
+                triangle = &(model->triangles[2 * (i * size + j) + k]);
+                triangle->points[0].vertex_index = corners[0];
+                triangle->points[1].vertex_index = corners[k + 1];
+                triangle->points[2].vertex_index = corners[k + 2];
+            }
+        }
+    }
+    for (i = 0; i < model->n_triangles; ++i) {
+        for (k = 0; k < 3; ++k) {
+            model->triangles[i].points[k].texture_index = INVALID_VERTEX_INDEX;
+            model->triangles[i].points[k].normal_index = INVALID_VERTEX_INDEX;
+        }
+    }
+}
+
+/**
+ * Create overlapping random triangles in the unit cube.
+ */
+static void create_soup_model(Model* model, int n_triangles)
+{
+    unsigned int state = 12345u;
+    Vertex* vertex;
+    double center[3];
+    int i, k;
+
+    init_model(model);
+    model->n_vertices = 3 * n_triangles;
+    model->n_triangles = n_triangles;
+    allocate_model(model);
+    for (i = 0; i < n_triangles; ++i) {
+        for (k = 0; k < 3; ++k) {
+            center[k] = calc_random(&state);
+        }
+        for (k = 0; k < 3; ++k) {
+            vertex = &(model->vertices[3 * i + k + 1]);
+            vertex->x = center[0] + 0.1 * (calc_random(&state) - 0.5);
+            vertex->y = center[1] + 0.1 * (calc_random(&state) - 0.5);
+            vertex->z = center[2] + 0.1 * (calc_random(&state) - 0.5);
+            model->triangles[i].points[k].vertex_index = 3 * i + k + 1;
+            model->triangles[i].points[k].texture_index = INVALID_VERTEX_INDEX;
+            model->triangles[i].points[k].normal_index = INVALID_VERTEX_INDEX;
+        }
+    }
+}
+
+/**
+ * Find the closest hit of the ray by testing every triangle in double.
+ * Return the index of the triangle or NO_HIT, and the closest distance.
+ */
+static int find_hit_reference(const Model* model, const Ray* ray, double* distance)
+{
+    const Vertex* a;
+    const Vertex* b;
+    const Vertex* c;
+    double e1[3], e2[3], s[3], p[3], q[3];
+    double det, u, v, t;
+    int hit_index;
+    int i;
+
+    hit_index = NO_HIT;
+    *distance = ray->max_distance;
+    for (i = 0; i < model->n_triangles; ++i) {
+        a = &(model->vertices[model->triangles[i].points[0].vertex_index]);
+        b = &(model->vertices[model->triangles[i].points[1].vertex_index]);
+        c = &(model->vertices[model->triangles[i].points[2].vertex_index]);
+        e1[0] = b->x - a->x; e1[1] = b->y - a->y; e1[2] = b->z - a->z;
+        e2[0] = c->x - a->x; e2[1] = c->y - a->y; e2[2] = c->z - a->z;
+        s[0] = ray->origin[0] - a->x; s[1] = ray->origin[1] - a->y; s[2] = ray->origin[2] - a->z;
+        p[0] = ray->direction[1] * e2[2] - ray->direction[2] * e2[1];
+        p[1] = ray->direction[2] * e2[0] - ray->direction[0] * e2[2];
+        p[2] = ray->direction[0] * e2[1] - ray->direction[1] * e2[0];
+        q[0] = s[1] * e1[2] - s[2] * e1[1];
+        q[1] = s[2] * e1[0] - s[0] * e1[2];
+        q[2] = s[0] * e1[1] - s[1] * e1[0];
+        det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (det == 0.0) {
+            continue;
+        }
+        u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / det;
+        v = (ray->direction[0] * q[0] + ray->direction[1] * q[1] + ray->direction[2] * q[2]) / det;
+        t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+        if (u >= 0.0 && v >= 0.0 && u + v <= 1.0 && t > 0.0 && t < *distance) {
+            *distance = t;
+            hit_index = i;
+        }
+    }
+    return hit_index;
+}
+
+/**
+ * Check the closest hits and the occlusions of the rays against the brute force reference.
+ * The float tests can disagree at the edges, so a different triangle only counts when its distance differs.
+ */
+static void check_rays(const char* name, const Model* model, const Ray* rays, int n_rays)
+{
+    Bvh bvh;
+    RayHit* hits;
+    int* is_occluded;
+    double distance, error, max_error;
+    int hit_index;
+    int n_mismatches;
+    int i;
+
+    hits = (RayHit*)malloc(n_rays * sizeof(RayHit));
+    is_occluded = (int*)malloc(n_rays * sizeof(int));
+    if (hits == NULL || is_occluded == NULL || build_bvh(&bvh, model) == FALSE) {
+        printf("ERROR: Unable to build the bvh of the %s test!\n", name);
+        free(hits);
+        free(is_occluded);
+        ++n_failures;
+        return;
+    }
+    intersect_rays(&bvh, rays, n_rays, hits);
+    occlude_rays(&bvh, rays, n_rays, is_occluded);
+    n_mismatches = 0;
+    max_error = 0.0;
+    for (i = 0; i < n_rays; ++i) {
+        hit_index = find_hit_reference(model, &(rays[i]), &distance);
+        if ((hit_index == NO_HIT) != (hits[i].triangle_index == NO_HIT)
+            || (hit_index == NO_HIT) != (is_occluded[i] == FALSE)) {
+            ++n_mismatches;
+            continue;
+        }
+        if (hit_index != NO_HIT) {
+            error = fabs(hits[i].distance - distance);
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+    }
+    check(name, model->n_triangles, n_mismatches, max_error, DISTANCE_TOLERANCE);
+    free_bvh(&bvh);
+    free(hits);
+    free(is_occluded);
+}
+
+/**
+ * Trace tilted rays from above the grid and random rays through the triangle soup.
+ * Every fourth soup ray is shortened to its reference hit, so that it stops before the closest triangle.
+ */
+static void test_bvh(void)
+{
+    unsigned int state = 54321u;
+    Model model;
+    Ray* rays;
+    double distance;
+    int i, k;
+
+    rays = (Ray*)malloc(N_SOUP_RAYS * sizeof(Ray));
+    create_grid_model(&model, GRID_SIZE, 0);
+    for (i = 0; i < N_GRID_RAYS; ++i) {
+        rays[i].origin[0] = (float)calc_random(&state);
+        rays[i].origin[1] = (float)calc_random(&state);
+        rays[i].origin[2] = 1.0f;
+        rays[i].direction[0] = (float)(0.4 * (calc_random(&state) - 0.5));
+        rays[i].direction[1] = (float)(0.4 * (calc_random(&state) - 0.5));
+        rays[i].direction[2] = -1.0f;
+        rays[i].max_distance = 10.0f;
+    }
+    check_rays("bvh_grid", &model, rays, N_GRID_RAYS);
+    free_model(&model);
+
+    create_soup_model(&model, N_SOUP_TRIANGLES);
+    for (i = 0; i < N_SOUP_RAYS; ++i) {
+        for (k = 0; k < 3; ++k) {
+            rays[i].origin[k] = (float)(3.0 * calc_random(&state) - 1.0);
+            rays[i].direction[k] = (float)(calc_random(&state) - rays[i].origin[k]);
+        }
+        rays[i].max_distance = 10.0f;
+        if (i % 4 == 0 && find_hit_reference(&model, &(rays[i]), &distance) != NO_HIT) {
+            rays[i].max_distance = (float)(distance * 0.999);
+        }
+    }
+    check_rays("bvh_soup", &model, rays, N_SOUP_RAYS);
+    free_model(&model);
+    free(rays);
+}
+
+/**
+ * Find the twin of the half edge by comparing it to all others, the same way as the bucket matching:
+ * the half edges of an edge are paired in their order, and only with opposite ones.
+ */
+static void calc_twins_reference(const HalfEdgeMesh* mesh, int* twins)
+{
+    int v, w;
+    int h, g;
+
+    for (h = 0; h < mesh->n_half_edges; ++h) {
+        twins[h] = NO_HALF_EDGE;
+    }
+    for (h = 0; h < mesh->n_half_edges; ++h) {
+        v = mesh->vertices[h];
+        w = get_target_vertex(mesh, h);
+        if (twins[h] != NO_HALF_EDGE || v == w) {
+            continue;
+        }
+        for (g = h + 1; g < mesh->n_half_edges; ++g) {
+            if (twins[g] == NO_HALF_EDGE && mesh->vertices[g] == w && get_target_vertex(mesh, g) == v) {
+                twins[h] = g;
+                twins[g] = h;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Count the edges of more than two half edges by comparing every half edge to the earlier ones.
+ */
+static int count_non_manifold_edges_reference(const HalfEdgeMesh* mesh)
+{
+    int n_edges;
+    int count;
+    int v, w, x, y;
+    int h, g;
+
+    n_edges = 0;
+    for (h = 0; h < mesh->n_half_edges; ++h) {
+        v = mesh->vertices[h];
+        w = get_target_vertex(mesh, h);
+        count = 1;
+        for (g = 0; g < mesh->n_half_edges && count > 0; ++g) {
+            x = mesh->vertices[g];
+            y = get_target_vertex(mesh, g);
+            if (g != h && ((x == v && y == w) || (x == w && y == v))) {
+                // only the first half edge of the edge counts it
+                count = (g < h) ? 0 : count + 1;
+            }
+        }
+        if (v != w && count > 2) {
+            ++n_edges;
+        }
+    }
+    return n_edges;
+}
+
+/**
+ * Check the one-rings of the vertices against the vertices of their triangles.
+ */
+static int count_wrong_one_rings(const HalfEdgeMesh* mesh, const Model* model)
+{
+    int neighbours[MAX_NEIGHBOURS];
+    int* is_neighbour;
+    int n_neighbours;
+    int n_wrong;
+    int n_expected;
+    int v, i, k, x;
+
+    is_neighbour = (int*)calloc(model->n_vertices + 1, sizeof(int));
+    n_wrong = 0;
+    for (v = 1; v <= model->n_vertices; ++v) {
+        n_expected = 0;
+        for (i = 0; i < model->n_triangles; ++i) {
+            for (k = 0; k < 3; ++k) {
+                if (model->triangles[i].points[k].vertex_index != v) {
+                    continue;
+                }
+                x = model->triangles[i].points[(k + 1) % 3].vertex_index;
+                n_expected += (is_neighbour[x] != v);
+                is_neighbour[x] = v;
+                x = model->triangles[i].points[(k + 2) % 3].vertex_index;
+                n_expected += (is_neighbour[x] != v);
+                is_neighbour[x] = v;
+            }
+        }
+        n_neighbours = collect_vertex_neighbours(mesh, v, neighbours, MAX_NEIGHBOURS);
+        for (i = 0; i < n_neighbours; ++i) {
+            if (is_neighbour[neighbours[i]] != v) {
+                break;
+            }
+        }
+        if (n_neighbours != n_expected || i < n_neighbours) {
+            ++n_wrong;
+        }
+    }
+    free(is_neighbour);
+    return n_wrong;
+}
+
+/**
+ * Check the twins of a small grid with a non-manifold edge, a repeated triangle and a degenerate one
+ * against all pairs of half edges, and the one-rings, the boundary and the twins of the large grid.
+ */
+static void test_half_edges(void)
+{
+    HalfEdgeMesh mesh;
+    Model model;
+    Triangle* extra;
+    int* twins;
+    int n_mismatches;
+    int n_boundary_edges;
+    int h, k;
+
+    create_grid_model(&model, SMALL_GRID_SIZE, 3);
+    extra = &(model.triangles[2 * SMALL_GRID_SIZE * SMALL_GRID_SIZE]);
+    // a fin on the diagonal of the first quad, the first triangle again and a triangle with a repeated vertex
+    for (k = 0; k < 3; ++k) {
+        extra[0].points[k] = model.triangles[0].points[k];
+        extra[1].points[k] = model.triangles[0].points[k];
+        extra[2].points[k] = model.triangles[5].points[k];
+    }
+    extra[0].points[1].vertex_index = SMALL_GRID_SIZE * (SMALL_GRID_SIZE + 1) + 1;
+    extra[2].points[2].vertex_index = extra[2].points[0].vertex_index;
+    if (build_half_edge_mesh(&mesh, &model) == FALSE) {
+        ++n_failures;
+        free_model(&model);
+        return;
+    }
+    twins = (int*)malloc(mesh.n_half_edges * sizeof(int));
+    calc_twins_reference(&mesh, twins);
+    n_mismatches = 0;
+    for (h = 0; h < mesh.n_half_edges; ++h) {
+        n_mismatches += (mesh.twins[h] != twins[h]);
+    }
+    check("half_edge_twins", model.n_triangles, n_mismatches, 0.0, 0.0);
+    check("non_manifold_edges", model.n_triangles,
+          abs(mesh.n_non_manifold_edges - count_non_manifold_edges_reference(&mesh)), 0.0, 0.0);
+    free(twins);
+    free_half_edge_mesh(&mesh);
+    free_model(&model);
+
+    create_grid_model(&model, SMALL_GRID_SIZE, 0);
+    build_half_edge_mesh(&mesh, &model);
+    check("one_rings", model.n_triangles, count_wrong_one_rings(&mesh, &model), 0.0, 0.0);
+    free_half_edge_mesh(&mesh);
+    free_model(&model);
+
+    create_grid_model(&model, GRID_SIZE, 0);
+    if (build_half_edge_mesh(&mesh, &model) == FALSE) {
+        ++n_failures;
+        free_model(&model);
+        return;
+    }
+    n_mismatches = 0;
+    n_boundary_edges = 0;
+    for (h = 0; h < mesh.n_half_edges; ++h) {
+        if (mesh.twins[h] == NO_HALF_EDGE) {
+            ++n_boundary_edges;
+        }
+        else if (mesh.twins[mesh.twins[h]] != h || mesh.vertices[mesh.twins[h]] != get_target_vertex(&mesh, h)) {
+            ++n_mismatches;
+        }
+    }
+    n_mismatches += abs(n_boundary_edges - 4 * GRID_SIZE) + abs(mesh.n_boundary_edges - 4 * GRID_SIZE);
+    n_mismatches += mesh.n_non_manifold_edges;
+    check("grid_half_edges", model.n_triangles, n_mismatches, 0.0, 0.0);
+    free_half_edge_mesh(&mesh);
+    free_model(&model);
+}
+
+/**
+ * Count the triangles whose normal points downwards, which the collapses must not flip on the height field.
+ */
+static int count_flipped_triangles(const Model* model)
+{
+    const Vertex* a;
+    const Vertex* b;
+    const Vertex* c;
+    int n_flipped;
+    int i;
+
+    n_flipped = 0;
+    for (i = 0; i < model->n_triangles; ++i) {
+        a = &(model->vertices[model->triangles[i].points[0].vertex_index]);
+        b = &(model->vertices[model->triangles[i].points[1].vertex_index]);
+        c = &(model->vertices[model->triangles[i].points[2].vertex_index]);
+        if ((b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x) < -FLIP_TOLERANCE) {
+            ++n_flipped;
+        }
+    }
+    return n_flipped;
+}
+
+/**
+ * Count the mismatches of the simplified grid: missing reduction, invalid indices, flipped triangles,
+ * and a changed boundary or non-manifold edges, which the locked boundary and the link condition prevent.
+ */
+static int count_simplify_mismatches(const Model* model, int target_triangles, int grid_size)
+{
+    HalfEdgeMesh mesh;
+    int n_mismatches;
+
+    if (model->n_triangles > target_triangles || model->n_triangles == 0 || has_valid_indices(model) == FALSE) {
+        return 1;
+    }
+    n_mismatches = count_flipped_triangles(model);
+    if (build_half_edge_mesh(&mesh, model) == FALSE) {
+        return n_mismatches + 1;
+    }
+    n_mismatches += abs(mesh.n_boundary_edges - 4 * grid_size) + mesh.n_non_manifold_edges;
+    free_half_edge_mesh(&mesh);
+    return n_mismatches;
+}
+
+/**
+ * Simplify a grid to a target, and build its chain of levels,
+ * whose triangles have to shrink and whose errors have to grow from level to level.
+ */
+static void test_simplify(void)
+{
+    SimplifyOptions options;
+    LodChain chain;
+    Model model;
+    Model result;
+    int n_mismatches;
+    int level;
+
+    init_simplify_options(&options);
+    create_grid_model(&model, SIMPLIFY_GRID_SIZE, 0);
+    if (simplify_model(&result, &model, SIMPLIFY_TARGET, &options) == FALSE) {
+        ++n_failures;
+        free_model(&model);
+        return;
+    }
+    check("simplify", model.n_triangles, count_simplify_mismatches(&result, SIMPLIFY_TARGET, SIMPLIFY_GRID_SIZE), 0.0, 0.0);
+    free_model(&result);
+
+    if (build_lod_chain(&chain, &model, &options) == FALSE) {
+        ++n_failures;
+        free_model(&model);
+        return;
+    }
+    n_mismatches = (chain.n_levels < 2 || chain.levels[0].n_triangles != model.n_triangles);
+    for (level = 1; level < chain.n_levels; ++level) {
+        n_mismatches += count_simplify_mismatches(&(chain.levels[level]), chain.levels[level - 1].n_triangles - 1,
+                                                  SIMPLIFY_GRID_SIZE);
+        n_mismatches += (chain.errors[level] < chain.errors[level - 1]);
+        // a level is only selected once its error projects below a pixel
+        n_mismatches += (select_lod(&chain, LOD_PIXEL_ERROR / chain.errors[level]) < level);
+    }
+    n_mismatches += (select_lod(&chain, 1e12) != 0);
+    check("lod_chain", chain.n_levels, n_mismatches, 0.0, 0.0);
+    free_lod_chain(&chain);
+    free_model(&model);
+}
+
+/**
+ * Number text with the length which is passed to the parser, the whole text for -1
+ */
+typedef struct NumberCase
+{
+    const char* text;
+    int length;
+} NumberCase;
+
+static const NumberCase DOUBLE_CASES[] = {
+    { "0", -1 }, { "-0.0", -1 }, { "1.5", -1 }, { ".5", -1 }, { "5.", -1 }, { "-.25", -1 },
+    { "1e-5", -1 }, { "-2.5E+3", -1 }, { "6.02214076e23", -1 }, { "1E0", -1 },
+    // more than 19 digits and mantissas above 2^53
+    { "12345678901234567890123", -1 }, { "0.12345678901234567890123456", -1 },
+    { "9007199254740993", -1 }, { "3.14159265358979323846264338327950288", -1 },
+    { "100000000000000000000000000000000001e-35", -1 },
+    // exponents outside of the exact powers of ten
+    { "1e23", -1 }, { "1e-23", -1 }, { "123456e30", -1 }, { "8.5e-30", -1 },
+    { "1.7976931348623157e308", -1 }, { "1e400", -1 }, { "-1e-400", -1 },
+    // denormals
+    { "4.9e-324", -1 }, { "2.2250738585072011e-308", -1 }, { "1e-310", -1 }, { "-3.7e-320", -1 },
+    // incomplete exponents and tokens ending at the end
+    { "2.5e", -1 }, { "1e+", -1 }, { "7E-x", -1 }, { "3.25", 3 }, { "1e25", 3 }, { "-2.5E+3", 5 },
+    { "42 13", -1 }, { "1.5/2", -1 },
+    // no number
+    { "", -1 }, { "-", -1 }, { ".", -1 }, { "+.e5", -1 }, { "x1", -1 }, { "12", 0 }
+};
+
+static const NumberCase INT_CASES[] = {
+    { "0", -1 }, { "-17", -1 }, { "+42", -1 }, { "007", -1 }, { "12/3", -1 }, { "12345", 3 },
+    { "2147483647", -1 }, { "-2147483648", -1 },
+    // out of the int range, which must not wrap to a valid looking index
+    { "2147483648", -1 }, { "-2147483649", -1 }, { "4294967297", -1 }, { "99999999999999999999", -1 },
+    // no number
+    { "", -1 }, { "-", -1 }, { "+/1", -1 }, { "x1", -1 }, { "12", 0 }
+};
+
+/**
+ * Copy the parsed part of the number case, so the reference functions stop at its end.
+ */
+static int copy_number_case(char* buffer, const NumberCase* number_case)
+{
+    int length;
+
+    length = number_case->length < 0 ? (int)strlen(number_case->text) : number_case->length;
+    memcpy(buffer, number_case->text, length);
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * Compare the parsed doubles and their ends with strtod, the values have to be the same bits.
+ */
+static void test_parse_double(void)
+{
+    char buffer[MAX_NUMBER_LENGTH];
+    const char* parsed_end;
+    char* reference_end;
+    double value, reference;
+    int n_cases, n_mismatches;
+    int length;
+    int i;
+
+    n_cases = (int)(sizeof(DOUBLE_CASES) / sizeof(DOUBLE_CASES[0]));
+    n_mismatches = 0;
+    for (i = 0; i < n_cases; ++i) {
+        length = copy_number_case(buffer, &(DOUBLE_CASES[i]));
+        reference = strtod(buffer, &reference_end);
+        parsed_end = parse_double(buffer, buffer + length, &value);
+        if (reference_end == buffer) {
+            if (parsed_end != NULL) {
+                printf("parse_double('%s') read a number\n", buffer);
+                ++n_mismatches;
+            }
+        }
+        else if (parsed_end != reference_end || memcmp(&value, &reference, sizeof(double)) != 0) {
+            printf("parse_double('%s') = %.17g, strtod = %.17g\n", buffer, parsed_end == NULL ? 0.0 : value, reference);
+            ++n_mismatches;
+        }
+    }
+    check("parse_double", n_cases, n_mismatches, 0.0, 0.0);
+}
+
+/**
+ * Compare the parsed ints and their ends with strtol, the numbers outside of the int range have to be rejected.
+ */
+static void test_parse_int(void)
+{
+    char buffer[MAX_NUMBER_LENGTH];
+    const char* parsed_end;
+    char* reference_end;
+    long reference;
+    int value;
+    int is_out_of_range;
+    int n_cases, n_mismatches;
+    int length;
+    int i;
+
+    n_cases = (int)(sizeof(INT_CASES) / sizeof(INT_CASES[0]));
+    n_mismatches = 0;
+    for (i = 0; i < n_cases; ++i) {
+        length = copy_number_case(buffer, &(INT_CASES[i]));
+        errno = 0;
+        reference = strtol(buffer, &reference_end, 10);
+        is_out_of_range = (errno == ERANGE || reference < INT_MIN || reference > INT_MAX);
+        parsed_end = parse_int(buffer, buffer + length, &value);
+        if (reference_end == buffer || is_out_of_range) {
+            if (parsed_end != NULL) {
+                printf("parse_int('%s') accepted %d\n", buffer, value);
+                ++n_mismatches;
+            }
+        }
+        else if (parsed_end != reference_end || value != reference) {
+            printf("parse_int('%s') = %d, strtol = %ld\n", buffer, parsed_end == NULL ? 0 : value, reference);
+            ++n_mismatches;
+        }
+    }
+    check("parse_int", n_cases, n_mismatches, 0.0, 0.0);
+}
+
+/**
+ * Read an OBJ file whose face refers to a vertex after the last one, which has to be rejected.
+ */
+static void test_invalid_indices(void)
+{
+    FILE* file;
+    Model model;
+    int is_read;
+
+    file = fopen(INVALID_OBJ_FILENAME, "w");
+    if (file == NULL) {
+        printf("ERROR: Unable to write '%s'!\n", INVALID_OBJ_FILENAME);
+        ++n_failures;
+        return;
+    }
+    fprintf(file, "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf 1//1 2//1 4//1\n");
+    fclose(file);
+    is_read = read_model(&model, INVALID_OBJ_FILENAME);
+    remove(INVALID_OBJ_FILENAME);
+    if (is_read) {
+        free_model(&model);
+    }
+    check("invalid_indices", 1, is_read ? 1 : 0, 0.0, 0.0);
+}
+
+/**
+ * Write an OBJ file of blocks with four vertices, texture vertices and normals and two faces each.
+ * The first face of a block uses relative indices, the second one absolute indices,
+ * and the blocks cycle through the v, v/vt, v//vn and v/vt/vn face forms.
+ */
+static int write_chunked_obj(const char* filename, int n_blocks)
+{
+    static const char* relative_faces[4] = {
+        "f -4 -3 -2\n",
+        "f -4/-4 -3/-3 -2/-2\n",
+        "f -4//-4 -3//-3 -2//-2\n",
+        "f -4/-4/-4 -3/-3/-3 -2/-2/-2\n"
+    };
+    unsigned int state = 777u;
+    FILE* file;
+    int i, k, first;
+
+    file = fopen(filename, "w");
+    if (file == NULL) {
+        printf("ERROR: Unable to write '%s'!\n", filename);
+        return FALSE;
+    }
+    for (i = 0; i < n_blocks; ++i) {
+        for (k = 0; k < 4; ++k) {
+            fprintf(file, "v %.9f %.9f %.9f\n", calc_random(&state), calc_random(&state), calc_random(&state));
+            fprintf(file, "vt %.6f %.6f\n", calc_random(&state), calc_random(&state));
+            fprintf(file, "vn %.6f %.6f %.6f\n", calc_random(&state), calc_random(&state), 1.0);
+        }
+        first = 4 * i + 1;
+        fputs(relative_faces[i % 4], file);
+        switch (i % 4) {
+        case 0:
+            fprintf(file, "f %d %d %d\n", first, first + 2, first + 3);
+            break;
+        case 1:
+            fprintf(file, "f %d/%d %d/%d %d/%d\n", first, first, first + 2, first + 2, first + 3, first + 3);
+            break;
+        case 2:
+            fprintf(file, "f %d//%d %d//%d %d//%d\n", first, first, first + 2, first + 2, first + 3, first + 3);
+            break;
+        default:
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                first, first, first, first + 2, first + 2, first + 2, first + 3, first + 3, first + 3);
+            break;
+        }
+    }
+    fclose(file);
+    return TRUE;
+}
+
+/**
+ * Calculate the largest difference of the coordinates of two vertex arrays.
+ */
+static double calc_max_vertex_difference(const Vertex* a, const Vertex* b, int n_vertices)
+{
+    double max_error = 0.0;
+    int i;
+
+    for (i = 1; i <= n_vertices; ++i) {
+        max_error = fmax(max_error, fabs(a[i].x - b[i].x));
+        max_error = fmax(max_error, fabs(a[i].y - b[i].y));
+        max_error = fmax(max_error, fabs(a[i].z - b[i].z));
+    }
+    return max_error;
+}
+
+/**
+ * Count the face points whose indices differ between the two models.
+ */
+static int count_triangle_mismatches(const Model* a, const Model* b)
+{
+    const FacePoint* p;
+    const FacePoint* q;
+    int n_mismatches = 0;
+    int i, k;
+
+    for (i = 0; i < a->n_triangles; ++i) {
+        for (k = 0; k < 3; ++k) {
+            p = &(a->triangles[i].points[k]);
+            q = &(b->triangles[i].points[k]);
+            if (p->vertex_index != q->vertex_index
+                || p->texture_index != q->texture_index
+                || p->normal_index != q->normal_index) {
+                ++n_mismatches;
+            }
+        }
+    }
+    return n_mismatches;
+}
+
+/**
+ * Read an OBJ file of several chunks on one and on more threads,
+ * the parallel loader has to give exactly the model of the sequential one.
+ */
+static void test_chunked_loading(void)
+{
+    Model sequential;
+    Model parallel;
+    double max_error;
+    int is_sequential_read, is_parallel_read;
+    int n_mismatches;
+    int i;
+
+    if (write_chunked_obj(CHUNKED_OBJ_FILENAME, N_CHUNKED_BLOCKS) == FALSE) {
+        ++n_failures;
+        return;
+    }
+    set_thread_count(1);
+    is_sequential_read = read_model(&sequential, CHUNKED_OBJ_FILENAME);
+    set_thread_count(N_CHUNKED_THREADS);
+    is_parallel_read = read_model(&parallel, CHUNKED_OBJ_FILENAME);
+    set_thread_count(0);
+    remove(CHUNKED_OBJ_FILENAME);
+    if (!is_sequential_read || !is_parallel_read) {
+        if (is_sequential_read) {
+            free_model(&sequential);
+        }
+        if (is_parallel_read) {
+            free_model(&parallel);
+        }
+        check("chunked_read", N_CHUNKED_BLOCKS, 1, 0.0, 0.0);
+        return;
+    }
+    n_mismatches = 0;
+    n_mismatches += (sequential.n_vertices != 4 * N_CHUNKED_BLOCKS || parallel.n_vertices != sequential.n_vertices);
+    n_mismatches += (parallel.n_texture_vertices != sequential.n_texture_vertices);
+    n_mismatches += (parallel.n_normals != sequential.n_normals);
+    n_mismatches += (sequential.n_triangles != 2 * N_CHUNKED_BLOCKS || parallel.n_triangles != sequential.n_triangles);
+    check("chunked_counts", 4, n_mismatches, 0.0, 0.0);
+    if (n_mismatches == 0) {
+        max_error = calc_max_vertex_difference(sequential.vertices, parallel.vertices, sequential.n_vertices);
+        check("chunked_vertices", sequential.n_vertices, 0, max_error, 0.0);
+        max_error = 0.0;
+        for (i = 1; i <= sequential.n_texture_vertices; ++i) {
+            max_error = fmax(max_error, fabs(sequential.texture_vertices[i].u - parallel.texture_vertices[i].u));
+            max_error = fmax(max_error, fabs(sequential.texture_vertices[i].v - parallel.texture_vertices[i].v));
+        }
+        check("chunked_textures", sequential.n_texture_vertices, 0, max_error, 0.0);
+        max_error = calc_max_vertex_difference(sequential.normals, parallel.normals, sequential.n_normals);
+        check("chunked_normals", sequential.n_normals, 0, max_error, 0.0);
+        n_mismatches = count_triangle_mismatches(&sequential, &parallel);
+        check("chunked_triangles", sequential.n_triangles, n_mismatches, 0.0, 0.0);
+    }
+    free_model(&sequential);
+    free_model(&parallel);
+}
+
+int main(void)
+{
+    printf("%-20s %8s %10s %12s %8s\n", "check", "size", "mismatches", "max error", "result");
+    test_parse_double();
+    test_parse_int();
+    test_invalid_indices();
+    test_chunked_loading();
+    test_bvh();
+    test_half_edges();
+    test_simplify();
+    if (n_failures > 0) {
+        printf("%d checks failed\n", n_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
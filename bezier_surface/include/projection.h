@@ -0,0 +1,71 @@
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include "utils.h"
+
+#include <stdbool.h>
+
+/**
+ * Bezier surface prepared for closest point queries
+ *
+ * The surface is subdivided into quarters until the control nets of the sub-patches are flat, and the control nets
+ * are kept in double precision with their parameter ranges and bounding boxes. A sub-patch is in the convex hull
+ * of its control net, so the box gives a lower bound of its distance, and the center of the sub-patch
+ * is on the surface, so it gives an upper bound. The boxes and the centers are kept in separate coordinate arrays,
+ * because every query is tested against all of them in a single loop.
+ * The pending sub-patches of the subdivision and the Bernstein basis of the centers grow with the control points,
+ * so an update does not allocate memory for a surface of the same size.
+ */
+typedef struct SurfaceProjection
+{
+    int dim_n;
+    int dim_m;
+    int n_patches;
+    int capacity;
+    double* points;
+    double* pending_points;
+    double* basis;
+    double* begin_us;
+    double* begin_vs;
+    double* sizes;
+    double* min_xs;
+    double* min_ys;
+    double* min_zs;
+    double* max_xs;
+    double* max_ys;
+    double* max_zs;
+    double* center_xs;
+    double* center_ys;
+    double* center_zs;
+} SurfaceProjection;
+
+/**
+ * Initialize the empty projection, its arrays are allocated on the first update.
+ */
+void init_surface_projection(SurfaceProjection* projection);
+
+/**
+ * Release the arrays of the sub-patches.
+ */
+void destroy_surface_projection(SurfaceProjection* projection);
+
+/**
+ * Subdivide the surface of the dim_n by dim_m control points into flat sub-patches, and calculate their bounds.
+ * The arrays grow when the surface has more control points than before.
+ */
+bool update_surface_projection(SurfaceProjection* projection, const vec3* points, int dim_n, int dim_m);
+
+/**
+ * Find the parameters and the points of the surface closest to the queries.
+ *
+ * The queries are split into ranges on the thread pool of the obj library, and the ranges are processed in batches.
+ * The lower bounds of a batch are calculated against all sub-patches at once, then the candidate sub-patches
+ * of a query are visited in the order of their bounds until the bound exceeds the best distance.
+ * The closest point of a candidate is found by Newton iterations on the gradient of the squared distance,
+ * which keep the parameters which reached the border of the sub-patch fixed.
+ * The closest points may be NULL.
+ */
+bool project_points(const SurfaceProjection* projection, const vec3* queries, int n_queries,
+                    double* us, double* vs, vec3* closest_points);
+
+#endif /* PROJECTION_H */
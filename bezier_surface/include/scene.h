@@ -2,6 +2,7 @@
 #define SCENE_H
 
 #include "camera.h"
+#include "projection.h"
 #include "texture.h"
 
 #include <obj/model.h>
@@ -18,9 +19,20 @@ typedef struct Scene
     int dim_m;
     int res;
 
+    // scattered points and their closest points on the surface
+    SurfaceProjection projection;
+    vec3 *scan_points;
+    vec3 *projected_points;
+    double *scan_us;
+    double *scan_vs;
+
     // visibility
     int normals;
     int control_polygon;
+    int projections;
+
+    // set when the control points and the display points are evaluated
+    int is_surface_ready;
 
     GLuint texture_id;
 } Scene;
@@ -48,11 +60,15 @@ void update_scene(Scene* scene);
 
 void init_surface(Scene *scene, int dim_n, int dim_m, int res);
 void generate_surface(Scene *scene);
+void evaluate_surface(Scene *scene);
 void premap_texture(Scene *scene);
 void change_dim(Scene *scene, int target_dim, int size);
+void generate_scan_points(Scene *scene);
+void project_scan_points(Scene *scene);
 
 void toggle_control_polygon(Scene *scene);
 void toggle_normals(Scene *scene);
+void toggle_projections(Scene *scene);
 void toggle_texture();
 
 /**
@@ -1,6 +1,8 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <SDL2/SDL.h>
+
 #include <GL/gl.h>
 
 typedef GLubyte Pixel[3];
@@ -10,4 +12,14 @@ typedef GLubyte Pixel[3];
  */
 GLuint load_texture(char* filename);
 
+/**
+ * Create texture from the decoded image and returns with the texture name.
+ */
+GLuint upload_texture(const SDL_Surface* surface);
+
+/**
+ * Create a plain checkerboard texture which is shown until the real one is loaded.
+ */
+GLuint create_placeholder_texture();
+
 #endif /* TEXTURE_H */
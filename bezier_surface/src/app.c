@@ -1,14 +1,16 @@
 #include <stdio.h>
 #include "app.h"
 
-#include <SDL2/SDL_image.h>
-
 void init_app(App* app, int width, int height)
 {
     int error_code;
-    int inited_loaders;
 
     app->is_running = false;
+    app->window = NULL;
+    app->gl_context = NULL;
+
+    // decode the assets while the window and the context are created
+    start_loader(&(app->loader), &(app->scene), "assets/textures/cube.png");
 
     error_code = SDL_Init(SDL_INIT_EVERYTHING);
     if (error_code != 0) {
@@ -26,12 +28,6 @@ void init_app(App* app, int width, int height)
         return;
     }
 
-    inited_loaders = IMG_Init(IMG_INIT_PNG);
-    if (inited_loaders == 0) {
-        printf("[ERROR] IMG initialization error: %s\n", IMG_GetError());
-        return;
-    }
-
     app->gl_context = SDL_GL_CreateContext(app->window);
     if (app->gl_context == NULL) {
         printf("[ERROR] Unable to create the OpenGL context!\n");
@@ -145,6 +141,9 @@ void handle_app_events(App* app)
             case SDL_SCANCODE_T:
                 toggle_texture();
                 break; 
+            case SDL_SCANCODE_C:
+                toggle_projections(&app->scene);
+                break; 
             case SDL_SCANCODE_UP:
                 change_dim(&app->scene, 1, 1);
                 break; 
@@ -211,6 +210,7 @@ void update_app(App* app)
     elapsed_time = current_time - app->uptime;
     app->uptime = current_time;
 
+    poll_loader(&(app->loader));
     update_camera(&(app->camera), elapsed_time);
     update_scene(&(app->scene));
 }
@@ -234,9 +234,15 @@ void render_app(App* app)
 
 void destroy_app(App* app)
 {
+    stop_loader(&(app->loader));
     free(app->scene.points);
     free(app->scene.disp_points);
     free(app->scene.dz);
+    free(app->scene.scan_points);
+    free(app->scene.projected_points);
+    free(app->scene.scan_us);
+    free(app->scene.scan_vs);
+    destroy_surface_projection(&(app->scene.projection));
     if (app->gl_context != NULL) {
         SDL_GL_DeleteContext(app->gl_context);
     }
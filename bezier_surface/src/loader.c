@@ -0,0 +1,93 @@
+#include "loader.h"
+
+#include <SDL2/SDL_image.h>
+
+#include <stdio.h>
+
+static int decode_texture(void* data)
+{
+    Loader* loader = (Loader*)data;
+
+    if (IMG_Init(IMG_INIT_PNG) == 0) {
+        printf("[ERROR] IMG initialization error: %s\n", IMG_GetError());
+    }
+    else {
+        loader->texture_surface = IMG_Load(loader->texture_filename);
+        if (loader->texture_surface == NULL) {
+            printf("[ERROR] Unable to load '%s' texture: %s\n", loader->texture_filename, IMG_GetError());
+        }
+    }
+    SDL_AtomicSet(&(loader->is_texture_decoded), 1);
+
+    return 0;
+}
+
+static int evaluate_initial_surface(void* data)
+{
+    Loader* loader = (Loader*)data;
+
+    init_surface(loader->scene, 5, 4, 10);
+    evaluate_surface(loader->scene);
+    SDL_AtomicSet(&(loader->is_surface_evaluated), 1);
+
+    return 0;
+}
+
+void start_loader(Loader* loader, Scene* scene, const char* texture_filename)
+{
+    loader->scene = scene;
+    loader->texture_filename = texture_filename;
+    loader->texture_surface = NULL;
+    SDL_AtomicSet(&(loader->is_texture_decoded), 0);
+    SDL_AtomicSet(&(loader->is_surface_evaluated), 0);
+
+    scene->is_surface_ready = 0;
+
+    loader->texture_thread = SDL_CreateThread(decode_texture, "texture", loader);
+    if (loader->texture_thread == NULL) {
+        decode_texture(loader);
+    }
+    loader->surface_thread = SDL_CreateThread(evaluate_initial_surface, "surface", loader);
+    if (loader->surface_thread == NULL) {
+        evaluate_initial_surface(loader);
+    }
+}
+
+void poll_loader(Loader* loader)
+{
+    if (loader->texture_thread != NULL && SDL_AtomicGet(&(loader->is_texture_decoded))) {
+        SDL_WaitThread(loader->texture_thread, NULL);
+        loader->texture_thread = NULL;
+    }
+    // the surface pointer is written by the worker, so it is read only after the flag is set
+    if (SDL_AtomicGet(&(loader->is_texture_decoded)) && loader->texture_surface != NULL) {
+        glDeleteTextures(1, &(loader->scene->texture_id));
+        loader->scene->texture_id = upload_texture(loader->texture_surface);
+        SDL_FreeSurface(loader->texture_surface);
+        loader->texture_surface = NULL;
+    }
+
+    if (loader->surface_thread != NULL && SDL_AtomicGet(&(loader->is_surface_evaluated))) {
+        SDL_WaitThread(loader->surface_thread, NULL);
+        loader->surface_thread = NULL;
+    }
+    if (loader->scene->is_surface_ready == 0 && SDL_AtomicGet(&(loader->is_surface_evaluated))) {
+        loader->scene->is_surface_ready = 1;
+    }
+}
+
+void stop_loader(Loader* loader)
+{
+    if (loader->texture_thread != NULL) {
+        SDL_WaitThread(loader->texture_thread, NULL);
+        loader->texture_thread = NULL;
+    }
+    if (loader->surface_thread != NULL) {
+        SDL_WaitThread(loader->surface_thread, NULL);
+        loader->surface_thread = NULL;
+    }
+    if (loader->texture_surface != NULL) {
+        SDL_FreeSurface(loader->texture_surface);
+        loader->texture_surface = NULL;
+    }
+}
@@ -0,0 +1,731 @@
+#include "projection.h"
+
+#include <obj/parallel.h>
+
+#include <SDL2/SDL.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the lower bounds of this many queries are calculated together
+#define PROJECTION_BATCH 64
+// a thread gets at least this many queries
+#define MIN_PROJECTION_RANGE 256
+// a subdivision of MAX_PROJECTION_DEPTH levels has at most 4^MAX_PROJECTION_DEPTH sub-patches
+#define MAX_PROJECTION_DEPTH 5
+#define MAX_PROJECTION_PATCHES (1 << (2 * MAX_PROJECTION_DEPTH))
+// the pending sub-patches of the subdivision, every split replaces one of them with four
+#define MAX_PENDING_PATCHES (3 * MAX_PROJECTION_DEPTH + 1)
+// the control points of a flat sub-patch are within this fraction of its size from the bilinear patch of its corners
+#define PROJECTION_FLATNESS 0.1
+#define MAX_NEWTON_ITERATIONS 32
+#define PARAMETER_TOLERANCE 1e-10
+
+/**
+ * Sub-patches waiting to be split or accepted, their control nets are stored one after the other
+ */
+typedef struct PendingPatches
+{
+    double* points;
+    double begin_us[MAX_PENDING_PATCHES];
+    double begin_vs[MAX_PENDING_PATCHES];
+    double sizes[MAX_PENDING_PATCHES];
+    int depths[MAX_PENDING_PATCHES];
+    int n_patches;
+} PendingPatches;
+
+/**
+ * Work arrays of a range of the queries
+ *
+ * The basis holds the Bernstein polynomials and their first and second derivatives along u, then along v.
+ */
+typedef struct ProjectionWork
+{
+    double* bounds;
+    double* basis;
+} ProjectionWork;
+
+/**
+ * Queries of a projection, whose ranges are processed on separate threads
+ *
+ * A range which is unable to allocate its work arrays sets the failure flag.
+ */
+typedef struct ProjectionJob
+{
+    const SurfaceProjection* projection;
+    const vec3* queries;
+    double* us;
+    double* vs;
+    vec3* closest_points;
+    SDL_atomic_t is_failed;
+} ProjectionJob;
+
+/**
+ * Point and partial derivatives of the surface
+ */
+typedef struct SurfaceDerivatives
+{
+    double point[3];
+    double u[3];
+    double v[3];
+    double uu[3];
+    double uv[3];
+    double vv[3];
+} SurfaceDerivatives;
+
+static double dot(const double* a, const double* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static double clamp_parameter(double t)
+{
+    return (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+}
+
+/**
+ * Calculate the Bernstein polynomials of the curve of the n_points control points and their derivatives at t.
+ * The degree of the polynomials is raised one by one, and the derivatives are the differences
+ * of the polynomials of one and two degrees lower.
+ */
+static void calc_bernstein_basis(int n_points, double t, double* basis, double* firsts, double* seconds)
+{
+    const int degree = n_points - 1;
+
+    basis[0] = 1.0;
+    firsts[0] = 0.0;
+    seconds[0] = 0.0;
+    for (int k = 1; k <= degree; ++k) {
+        if (k == degree - 1) {
+            memcpy(seconds, basis, k * sizeof(double));
+        }
+        if (k == degree) {
+            memcpy(firsts, basis, k * sizeof(double));
+        }
+        basis[k] = t * basis[k - 1];
+        for (int i = k - 1; i > 0; --i) {
+            basis[i] = (1.0 - t) * basis[i] + t * basis[i - 1];
+        }
+        basis[0] *= 1.0 - t;
+    }
+    // the differences are taken from the last index, so the lower polynomials are read before they are overwritten
+    for (int i = degree; i >= 0; --i) {
+        firsts[i] = degree * (((i > 0) ? firsts[i - 1] : 0.0) - ((i < degree) ? firsts[i] : 0.0));
+    }
+    for (int i = degree; i >= 0; --i) {
+        seconds[i] = (degree >= 2) ? degree * (degree - 1) * (((i > 1) ? seconds[i - 2] : 0.0)
+            - 2.0 * ((i > 0 && i < degree) ? seconds[i - 1] : 0.0) + ((i < degree - 1) ? seconds[i] : 0.0)) : 0.0;
+    }
+}
+
+/**
+ * Evaluate the point and the partial derivatives of the sub-patch.
+ * The rows of the control net are summed with the basis along v first, then the sums with the basis along u.
+ */
+static void calc_surface_derivatives(const SurfaceProjection* projection, const double* patch, double s, double t,
+                                     ProjectionWork* work, SurfaceDerivatives* derivatives)
+{
+    const int dim_n = projection->dim_n;
+    const int dim_m = projection->dim_m;
+    double* basis_u = work->basis;
+    double* firsts_u = &(work->basis[dim_n]);
+    double* seconds_u = &(work->basis[2 * dim_n]);
+    double* basis_v = &(work->basis[3 * dim_n]);
+    double* firsts_v = &(work->basis[3 * dim_n + dim_m]);
+    double* seconds_v = &(work->basis[3 * dim_n + 2 * dim_m]);
+    double row[3], row_v[3], row_vv[3];
+    const double* point;
+
+    calc_bernstein_basis(dim_n, s, basis_u, firsts_u, seconds_u);
+    calc_bernstein_basis(dim_m, t, basis_v, firsts_v, seconds_v);
+    memset(derivatives, 0, sizeof(SurfaceDerivatives));
+    for (int i = 0; i < dim_n; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            row[c] = row_v[c] = row_vv[c] = 0.0;
+        }
+        for (int j = 0; j < dim_m; ++j) {
+            point = &(patch[3 * (i * dim_m + j)]);
+            for (int c = 0; c < 3; ++c) {
+                row[c] += basis_v[j] * point[c];
+                row_v[c] += firsts_v[j] * point[c];
+                row_vv[c] += seconds_v[j] * point[c];
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            derivatives->point[c] += basis_u[i] * row[c];
+            derivatives->u[c] += firsts_u[i] * row[c];
+            derivatives->uu[c] += seconds_u[i] * row[c];
+            derivatives->v[c] += basis_u[i] * row_v[c];
+            derivatives->uv[c] += firsts_u[i] * row_v[c];
+            derivatives->vv[c] += basis_u[i] * row_vv[c];
+        }
+    }
+}
+
+/**
+ * Keep the control points of the [0, t] part of the curve in place.
+ */
+static void keep_left_part(double* points, int n_points, int stride, double t)
+{
+    for (int k = 1; k < n_points; ++k) {
+        for (int i = n_points - 1; i >= k; --i) {
+            for (int c = 0; c < 3; ++c) {
+                points[3 * i * stride + c] = (1.0 - t) * points[3 * (i - 1) * stride + c] + t * points[3 * i * stride + c];
+            }
+        }
+    }
+}
+
+/**
+ * Keep the control points of the [t, 1] part of the curve in place.
+ */
+static void keep_right_part(double* points, int n_points, int stride, double t)
+{
+    for (int k = 1; k < n_points; ++k) {
+        for (int i = 0; i < n_points - k; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                points[3 * i * stride + c] = (1.0 - t) * points[3 * i * stride + c] + t * points[3 * (i + 1) * stride + c];
+            }
+        }
+    }
+}
+
+/**
+ * Replace the control net with the control net of one of the four quarters of the sub-patch.
+ * The rows are halved along v, then the columns along u.
+ */
+static void split_patch(double* patch, int dim_n, int dim_m, bool is_upper_u, bool is_upper_v)
+{
+    for (int i = 0; i < dim_n; ++i) {
+        if (is_upper_v) {
+            keep_right_part(&(patch[3 * i * dim_m]), dim_m, 1, 0.5);
+        }
+        else {
+            keep_left_part(&(patch[3 * i * dim_m]), dim_m, 1, 0.5);
+        }
+    }
+    for (int j = 0; j < dim_m; ++j) {
+        if (is_upper_u) {
+            keep_right_part(&(patch[3 * j]), dim_n, dim_m, 0.5);
+        }
+        else {
+            keep_left_part(&(patch[3 * j]), dim_n, dim_m, 0.5);
+        }
+    }
+}
+
+/**
+ * Check whether the control points are within the flatness tolerance of the bilinear patch of the corners,
+ * relative to the longest edge between the corners, and the bilinear patch itself is close to a parallelogram.
+ * The distance of the query has a single minimum on such a sub-patch, unless the query is far from it.
+ */
+static bool is_flat_patch(const double* patch, int dim_n, int dim_m)
+{
+    const double* corners[4] = {
+        patch, &(patch[3 * (dim_n - 1) * dim_m]), &(patch[3 * (dim_m - 1)]), &(patch[3 * (dim_n * dim_m - 1)])
+    };
+    const int edges[4][2] = {{0, 1}, {0, 2}, {1, 3}, {2, 3}};
+    double size = 0.0;
+    double twist = 0.0;
+    double length, a, b, bilinear, deviation;
+
+    for (int e = 0; e < 4; ++e) {
+        length = 0.0;
+        for (int c = 0; c < 3; ++c) {
+            length += (corners[edges[e][1]][c] - corners[edges[e][0]][c]) * (corners[edges[e][1]][c] - corners[edges[e][0]][c]);
+        }
+        size = fmax(size, length);
+    }
+    for (int c = 0; c < 3; ++c) {
+        twist += (corners[0][c] - corners[1][c] - corners[2][c] + corners[3][c])
+            * (corners[0][c] - corners[1][c] - corners[2][c] + corners[3][c]);
+    }
+    if (twist > PROJECTION_FLATNESS * PROJECTION_FLATNESS * size) {
+        return false;
+    }
+    for (int i = 0; i < dim_n; ++i) {
+        for (int j = 0; j < dim_m; ++j) {
+            a = (double)i / (dim_n - 1);
+            b = (double)j / (dim_m - 1);
+            deviation = 0.0;
+            for (int c = 0; c < 3; ++c) {
+                bilinear = (1.0 - a) * (1.0 - b) * corners[0][c] + a * (1.0 - b) * corners[1][c]
+                    + (1.0 - a) * b * corners[2][c] + a * b * corners[3][c];
+                deviation += (patch[3 * (i * dim_m + j) + c] - bilinear) * (patch[3 * (i * dim_m + j) + c] - bilinear);
+            }
+            if (deviation > PROJECTION_FLATNESS * PROJECTION_FLATNESS * size) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void push_pending_patch(PendingPatches* pending, const double* patch, int n_points,
+                               double begin_u, double begin_v, double size)
+{
+    const int last = pending->n_patches;
+
+    memcpy(&(pending->points[3 * last * n_points]), patch, 3 * n_points * sizeof(double));
+    pending->begin_us[last] = begin_u;
+    pending->begin_vs[last] = begin_v;
+    pending->sizes[last] = size;
+    pending->depths[last] = 0;
+    ++pending->n_patches;
+}
+
+/**
+ * Replace the last pending sub-patch with its four quarters.
+ * The quarters are filled from the top, so the parent stays in the last slot until its own quarter.
+ */
+static void split_last_patch(PendingPatches* pending, int dim_n, int dim_m)
+{
+    const int n_points = dim_n * dim_m;
+    const int last = pending->n_patches - 1;
+    const double* parent = &(pending->points[3 * last * n_points]);
+
+    for (int k = 1; k < 4; ++k) {
+        memcpy(&(pending->points[3 * (last + k) * n_points]), parent, 3 * n_points * sizeof(double));
+    }
+    for (int k = 3; k >= 0; --k) {
+        split_patch(&(pending->points[3 * (last + k) * n_points]), dim_n, dim_m, k / 2, k % 2);
+        pending->begin_us[last + k] = pending->begin_us[last] + (k / 2) * 0.5 * pending->sizes[last];
+        pending->begin_vs[last + k] = pending->begin_vs[last] + (k % 2) * 0.5 * pending->sizes[last];
+        pending->sizes[last + k] = 0.5 * pending->sizes[last];
+        pending->depths[last + k] = pending->depths[last] + 1;
+    }
+    pending->n_patches += 3;
+}
+
+static void destroy_projection_work(ProjectionWork* work)
+{
+    free(work->bounds);
+    free(work->basis);
+}
+
+static bool create_projection_work(ProjectionWork* work, const SurfaceProjection* projection)
+{
+    work->bounds = (double*)malloc(PROJECTION_BATCH * projection->n_patches * sizeof(double));
+    work->basis = (double*)malloc(3 * (projection->dim_n + projection->dim_m) * sizeof(double));
+    if (work->bounds == NULL || work->basis == NULL) {
+        printf("[ERROR] Unable to allocate memory for the projection!\n");
+        destroy_projection_work(work);
+        return false;
+    }
+    return true;
+}
+
+void init_surface_projection(SurfaceProjection* projection)
+{
+    projection->dim_n = 0;
+    projection->dim_m = 0;
+    projection->n_patches = 0;
+    projection->capacity = 0;
+    projection->points = NULL;
+    projection->pending_points = NULL;
+    projection->basis = NULL;
+    projection->begin_us = NULL;
+    projection->begin_vs = NULL;
+    projection->sizes = NULL;
+    projection->min_xs = NULL;
+    projection->min_ys = NULL;
+    projection->min_zs = NULL;
+    projection->max_xs = NULL;
+    projection->max_ys = NULL;
+    projection->max_zs = NULL;
+    projection->center_xs = NULL;
+    projection->center_ys = NULL;
+    projection->center_zs = NULL;
+}
+
+void destroy_surface_projection(SurfaceProjection* projection)
+{
+    free(projection->points);
+    free(projection->pending_points);
+    free(projection->basis);
+    free(projection->begin_us);
+    free(projection->begin_vs);
+    free(projection->sizes);
+    free(projection->min_xs);
+    free(projection->min_ys);
+    free(projection->min_zs);
+    free(projection->max_xs);
+    free(projection->max_ys);
+    free(projection->max_zs);
+    free(projection->center_xs);
+    free(projection->center_ys);
+    free(projection->center_zs);
+    init_surface_projection(projection);
+}
+
+static bool grow_surface_projection(SurfaceProjection* projection, int capacity)
+{
+    const int n_patches = MAX_PROJECTION_PATCHES;
+    double* points;
+    double* pending_points;
+    double* basis;
+
+    points = (double*)realloc(projection->points, 3 * n_patches * capacity * sizeof(double));
+    if (points != NULL) {
+        projection->points = points;
+    }
+    pending_points = (double*)realloc(projection->pending_points, 3 * MAX_PENDING_PATCHES * capacity * sizeof(double));
+    if (pending_points != NULL) {
+        projection->pending_points = pending_points;
+    }
+    // dim_n + dim_m is at most dim_n * dim_m + 1
+    basis = (double*)realloc(projection->basis, 3 * (capacity + 1) * sizeof(double));
+    if (basis != NULL) {
+        projection->basis = basis;
+    }
+    if (points == NULL || pending_points == NULL || basis == NULL) {
+        printf("[ERROR] Unable to allocate memory for the projection!\n");
+        return false;
+    }
+    projection->capacity = capacity;
+    if (projection->min_xs != NULL) {
+        return true;
+    }
+    // the bounds do not depend on the number of the control points, so they are allocated once
+    projection->begin_us = (double*)malloc(n_patches * sizeof(double));
+    projection->begin_vs = (double*)malloc(n_patches * sizeof(double));
+    projection->sizes = (double*)malloc(n_patches * sizeof(double));
+    projection->min_xs = (double*)malloc(n_patches * sizeof(double));
+    projection->min_ys = (double*)malloc(n_patches * sizeof(double));
+    projection->min_zs = (double*)malloc(n_patches * sizeof(double));
+    projection->max_xs = (double*)malloc(n_patches * sizeof(double));
+    projection->max_ys = (double*)malloc(n_patches * sizeof(double));
+    projection->max_zs = (double*)malloc(n_patches * sizeof(double));
+    projection->center_xs = (double*)malloc(n_patches * sizeof(double));
+    projection->center_ys = (double*)malloc(n_patches * sizeof(double));
+    projection->center_zs = (double*)malloc(n_patches * sizeof(double));
+    if (projection->begin_us == NULL || projection->begin_vs == NULL || projection->sizes == NULL
+        || projection->min_xs == NULL || projection->min_ys == NULL || projection->min_zs == NULL
+        || projection->max_xs == NULL || projection->max_ys == NULL || projection->max_zs == NULL
+        || projection->center_xs == NULL || projection->center_ys == NULL || projection->center_zs == NULL) {
+        printf("[ERROR] Unable to allocate memory for the projection!\n");
+        destroy_surface_projection(projection);
+        return false;
+    }
+    return true;
+}
+
+static void calc_patch_bounds(SurfaceProjection* projection, int index, ProjectionWork* work)
+{
+    const int n_points = projection->dim_n * projection->dim_m;
+    const double* patch = &(projection->points[3 * index * n_points]);
+    SurfaceDerivatives derivatives;
+
+    projection->min_xs[index] = projection->max_xs[index] = patch[0];
+    projection->min_ys[index] = projection->max_ys[index] = patch[1];
+    projection->min_zs[index] = projection->max_zs[index] = patch[2];
+    for (int i = 1; i < n_points; ++i) {
+        projection->min_xs[index] = fmin(projection->min_xs[index], patch[3 * i]);
+        projection->min_ys[index] = fmin(projection->min_ys[index], patch[3 * i + 1]);
+        projection->min_zs[index] = fmin(projection->min_zs[index], patch[3 * i + 2]);
+        projection->max_xs[index] = fmax(projection->max_xs[index], patch[3 * i]);
+        projection->max_ys[index] = fmax(projection->max_ys[index], patch[3 * i + 1]);
+        projection->max_zs[index] = fmax(projection->max_zs[index], patch[3 * i + 2]);
+    }
+    calc_surface_derivatives(projection, patch, 0.5, 0.5, work, &derivatives);
+    projection->center_xs[index] = derivatives.point[0];
+    projection->center_ys[index] = derivatives.point[1];
+    projection->center_zs[index] = derivatives.point[2];
+}
+
+bool update_surface_projection(SurfaceProjection* projection, const vec3* points, int dim_n, int dim_m)
+{
+    const int n_points = dim_n * dim_m;
+    ProjectionWork work;
+    PendingPatches pending;
+    double* patch;
+    int last;
+
+    if (n_points > projection->capacity && !grow_surface_projection(projection, n_points)) {
+        return false;
+    }
+    projection->dim_n = dim_n;
+    projection->dim_m = dim_m;
+    projection->n_patches = 0;
+    // only the centers are evaluated here, so the work arrays have no bounds
+    work.bounds = NULL;
+    work.basis = projection->basis;
+    pending.points = projection->pending_points;
+    pending.n_patches = 0;
+    // the control net is converted in the place of the first sub-patch, which is written after the subdivision
+    for (int i = 0; i < n_points; ++i) {
+        projection->points[3 * i] = points[i].x;
+        projection->points[3 * i + 1] = points[i].y;
+        projection->points[3 * i + 2] = points[i].z;
+    }
+    push_pending_patch(&pending, projection->points, n_points, 0.0, 0.0, 1.0);
+    while (pending.n_patches > 0) {
+        last = pending.n_patches - 1;
+        patch = &(pending.points[3 * last * n_points]);
+        if (pending.depths[last] < MAX_PROJECTION_DEPTH && !is_flat_patch(patch, dim_n, dim_m)) {
+            split_last_patch(&pending, dim_n, dim_m);
+            continue;
+        }
+        memcpy(&(projection->points[3 * projection->n_patches * n_points]), patch, 3 * n_points * sizeof(double));
+        projection->begin_us[projection->n_patches] = pending.begin_us[last];
+        projection->begin_vs[projection->n_patches] = pending.begin_vs[last];
+        projection->sizes[projection->n_patches] = pending.sizes[last];
+        calc_patch_bounds(projection, projection->n_patches, &work);
+        ++projection->n_patches;
+        --pending.n_patches;
+    }
+    return true;
+}
+
+/**
+ * Calculate the squared distances of the query from the boxes of all sub-patches.
+ * The loop has no branches, and the comparisons are written out instead of fmin and fmax,
+ * which are library calls because of their NaN semantics, so that it compiles to vector instructions.
+ */
+static void calc_lower_bounds(const SurfaceProjection* projection, const double* query, double* bounds)
+{
+    double dx, dy, dz;
+
+    for (int k = 0; k < projection->n_patches; ++k) {
+        dx = projection->min_xs[k] - query[0];
+        dx = (query[0] - projection->max_xs[k] > dx) ? query[0] - projection->max_xs[k] : dx;
+        dx = (dx > 0.0) ? dx : 0.0;
+        dy = projection->min_ys[k] - query[1];
+        dy = (query[1] - projection->max_ys[k] > dy) ? query[1] - projection->max_ys[k] : dy;
+        dy = (dy > 0.0) ? dy : 0.0;
+        dz = projection->min_zs[k] - query[2];
+        dz = (query[2] - projection->max_zs[k] > dz) ? query[2] - projection->max_zs[k] : dz;
+        dz = (dz > 0.0) ? dz : 0.0;
+        bounds[k] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+/**
+ * Find the closest center of the sub-patches, which is the initial upper bound of the distance.
+ */
+static int find_closest_center(const SurfaceProjection* projection, const double* query, double* distance)
+{
+    int index = 0;
+    double dx, dy, dz, d;
+
+    *distance = INFINITY;
+    for (int k = 0; k < projection->n_patches; ++k) {
+        dx = projection->center_xs[k] - query[0];
+        dy = projection->center_ys[k] - query[1];
+        dz = projection->center_zs[k] - query[2];
+        d = dx * dx + dy * dy + dz * dz;
+        if (d < *distance) {
+            *distance = d;
+            index = k;
+        }
+    }
+    return index;
+}
+
+/**
+ * Find the local closest point of the sub-patch with Newton iterations on the gradient of the squared distance.
+ *
+ * The iterations start from the projection onto the edges of the control net at the first corner.
+ * Where the Hessian is not positive definite, its second order terms are dropped for the Gauss-Newton step.
+ * The parameters on the border of the sub-patch, where the gradient points outwards, are kept fixed,
+ * and the steps which increase the distance are halved from the best parameters.
+ * Returns the squared distance of the point.
+ */
+static double find_patch_closest_point(const SurfaceProjection* projection, const double* patch, const double* query,
+                                       ProjectionWork* work, double* s, double* t, double* point)
+{
+    const int dim_n = projection->dim_n;
+    const int dim_m = projection->dim_m;
+    const double* corner = patch;
+    const double* u_corner = &(patch[3 * (dim_n - 1) * dim_m]);
+    const double* v_corner = &(patch[3 * (dim_m - 1)]);
+    double u_edge[3], v_edge[3], difference[3];
+    double best_distance = INFINITY;
+    double best_s, best_t;
+    double step_s = 0.0;
+    double step_t = 0.0;
+    double distance, gradient_u, gradient_v, huu, huv, hvv, determinant;
+    bool is_s_fixed, is_t_fixed;
+    SurfaceDerivatives derivatives;
+
+    for (int c = 0; c < 3; ++c) {
+        u_edge[c] = u_corner[c] - corner[c];
+        v_edge[c] = v_corner[c] - corner[c];
+        difference[c] = query[c] - corner[c];
+    }
+    *s = (dot(u_edge, u_edge) > 0.0) ? clamp_parameter(dot(difference, u_edge) / dot(u_edge, u_edge)) : 0.5;
+    *t = (dot(v_edge, v_edge) > 0.0) ? clamp_parameter(dot(difference, v_edge) / dot(v_edge, v_edge)) : 0.5;
+    best_s = *s;
+    best_t = *t;
+    for (int k = 0; k < MAX_NEWTON_ITERATIONS; ++k) {
+        calc_surface_derivatives(projection, patch, *s, *t, work, &derivatives);
+        for (int c = 0; c < 3; ++c) {
+            difference[c] = derivatives.point[c] - query[c];
+        }
+        distance = dot(difference, difference);
+        if (distance > best_distance) {
+            // the step overshot, so it is halved from the best parameters
+            step_s *= 0.5;
+            step_t *= 0.5;
+            if (fabs(step_s) < PARAMETER_TOLERANCE && fabs(step_t) < PARAMETER_TOLERANCE) {
+                break;
+            }
+            *s = best_s + step_s;
+            *t = best_t + step_t;
+            continue;
+        }
+        best_distance = distance;
+        best_s = *s;
+        best_t = *t;
+        memcpy(point, derivatives.point, 3 * sizeof(double));
+
+        gradient_u = dot(derivatives.u, difference);
+        gradient_v = dot(derivatives.v, difference);
+        huu = dot(derivatives.u, derivatives.u) + dot(derivatives.uu, difference);
+        huv = dot(derivatives.u, derivatives.v) + dot(derivatives.uv, difference);
+        hvv = dot(derivatives.v, derivatives.v) + dot(derivatives.vv, difference);
+        if (huu <= 0.0 || huu * hvv - huv * huv <= 0.0) {
+            huu = dot(derivatives.u, derivatives.u);
+            huv = dot(derivatives.u, derivatives.v);
+            hvv = dot(derivatives.v, derivatives.v);
+        }
+        is_s_fixed = (*s <= 0.0 && gradient_u > 0.0) || (*s >= 1.0 && gradient_u < 0.0);
+        is_t_fixed = (*t <= 0.0 && gradient_v > 0.0) || (*t >= 1.0 && gradient_v < 0.0);
+        if (is_s_fixed && is_t_fixed) {
+            break;
+        }
+        if (is_s_fixed) {
+            step_s = 0.0;
+            step_t = (hvv > 0.0) ? -gradient_v / hvv : 0.0;
+        }
+        else if (is_t_fixed) {
+            step_s = (huu > 0.0) ? -gradient_u / huu : 0.0;
+            step_t = 0.0;
+        }
+        else {
+            determinant = huu * hvv - huv * huv;
+            if (determinant <= 0.0) {
+                break;
+            }
+            step_s = -(hvv * gradient_u - huv * gradient_v) / determinant;
+            step_t = -(huu * gradient_v - huv * gradient_u) / determinant;
+        }
+        // a step which leaves the sub-patch is cut at the border, and the other parameter minimizes the model there
+        if (*s + step_s < 0.0 || *s + step_s > 1.0) {
+            step_s = clamp_parameter(*s + step_s) - *s;
+            step_t = (is_t_fixed || hvv <= 0.0) ? 0.0 : -(gradient_v + huv * step_s) / hvv;
+        }
+        if (*t + step_t < 0.0 || *t + step_t > 1.0) {
+            step_t = clamp_parameter(*t + step_t) - *t;
+            step_s = (is_s_fixed || huu <= 0.0) ? 0.0 : -(gradient_u + huv * step_t) / huu;
+        }
+        step_s = clamp_parameter(*s + step_s) - *s;
+        step_t = clamp_parameter(*t + step_t) - *t;
+        if (fabs(step_s) < PARAMETER_TOLERANCE && fabs(step_t) < PARAMETER_TOLERANCE) {
+            break;
+        }
+        *s += step_s;
+        *t += step_t;
+    }
+    *s = best_s;
+    *t = best_t;
+    return best_distance;
+}
+
+static void project_point(const SurfaceProjection* projection, vec3 query, double* bounds, ProjectionWork* work,
+                          double* u, double* v, vec3* closest_point)
+{
+    const double point_query[3] = {query.x, query.y, query.z};
+    double best_distance, distance;
+    double point[3] = {0.0, 0.0, 0.0};
+    double candidate[3] = {0.0, 0.0, 0.0};
+    double s, t;
+    int index;
+
+    index = find_closest_center(projection, point_query, &best_distance);
+    *u = projection->begin_us[index] + 0.5 * projection->sizes[index];
+    *v = projection->begin_vs[index] + 0.5 * projection->sizes[index];
+    point[0] = projection->center_xs[index];
+    point[1] = projection->center_ys[index];
+    point[2] = projection->center_zs[index];
+    while (true) {
+        // the next candidate is the sub-patch with the smallest lower bound, which may still be closer
+        index = -1;
+        for (int k = 0; k < projection->n_patches; ++k) {
+            if (bounds[k] < best_distance && (index < 0 || bounds[k] < bounds[index])) {
+                index = k;
+            }
+        }
+        if (index < 0) {
+            break;
+        }
+        bounds[index] = INFINITY;
+        distance = find_patch_closest_point(projection, &(projection->points[3 * index * projection->dim_n * projection->dim_m]),
+                                            point_query, work, &s, &t, candidate);
+        if (distance < best_distance) {
+            best_distance = distance;
+            *u = projection->begin_us[index] + s * projection->sizes[index];
+            *v = projection->begin_vs[index] + t * projection->sizes[index];
+            memcpy(point, candidate, 3 * sizeof(double));
+        }
+    }
+    closest_point->x = point[0];
+    closest_point->y = point[1];
+    closest_point->z = point[2];
+}
+
+/**
+ * Project the [begin, end) range of the queries in batches.
+ */
+static void project_range(void* data, int begin, int end)
+{
+    ProjectionJob* job = (ProjectionJob*)data;
+    const SurfaceProjection* projection = job->projection;
+    ProjectionWork work;
+    double query[3];
+    vec3 closest_point;
+    int n_batch;
+
+    if (!create_projection_work(&work, projection)) {
+        SDL_AtomicSet(&(job->is_failed), 1);
+        return;
+    }
+    for (int first = begin; first < end; first += PROJECTION_BATCH) {
+        n_batch = (end - first < PROJECTION_BATCH) ? end - first : PROJECTION_BATCH;
+        // the bounds of the whole batch are calculated first, while the boxes are in the cache
+        for (int q = 0; q < n_batch; ++q) {
+            query[0] = job->queries[first + q].x;
+            query[1] = job->queries[first + q].y;
+            query[2] = job->queries[first + q].z;
+            calc_lower_bounds(projection, query, &(work.bounds[q * projection->n_patches]));
+        }
+        for (int q = 0; q < n_batch; ++q) {
+            project_point(projection, job->queries[first + q], &(work.bounds[q * projection->n_patches]), &work,
+                          &(job->us[first + q]), &(job->vs[first + q]), &closest_point);
+            if (job->closest_points != NULL) {
+                job->closest_points[first + q] = closest_point;
+            }
+        }
+    }
+    destroy_projection_work(&work);
+}
+
+bool project_points(const SurfaceProjection* projection, const vec3* queries, int n_queries,
+                    double* us, double* vs, vec3* closest_points)
+{
+    ProjectionJob job;
+
+    if (projection->n_patches == 0 || n_queries <= 0) {
+        return true;
+    }
+    job.projection = projection;
+    job.queries = queries;
+    job.us = us;
+    job.vs = vs;
+    job.closest_points = closest_points;
+    SDL_AtomicSet(&(job.is_failed), 0);
+    parallel_for(n_queries, MIN_PROJECTION_RANGE, project_range, &job);
+    return SDL_AtomicGet(&(job.is_failed)) == 0;
+}
@@ -11,10 +11,12 @@ extern unsigned long long int fact[21];
 
 #define MAX_DIM 15
 #define MAX_RES 20
+#define N_SCAN_POINTS 4096
 
 void init_scene(Scene* scene)
 {   
-    scene->texture_id = load_texture("assets/textures/cube.png");
+    // the real texture and the surface are provided by the loader
+    scene->texture_id = create_placeholder_texture();
     glBindTexture(GL_TEXTURE_2D, scene->texture_id);
 
 
@@ -33,11 +35,10 @@ void init_scene(Scene* scene)
 
     scene->material.shininess = 0.7;
 
-    init_surface(scene, 5, 4, 10);
-
     // set visibility
     scene->normals = 0;
     scene->control_polygon = 0;
+    scene->projections = 0;
 }
 
 void set_lighting()
@@ -143,16 +144,29 @@ vec3 cross(vec3 a, vec3 b)
 
 void update_scene(Scene* scene)
 {
-    int dim_n = scene->dim_n;
-    int dim_m = scene->dim_m;
-    int res = scene->res;
+    if (scene->is_surface_ready == 0) {
+        return;
+    }
 
     // oscillate control points
-    for (int i = 0; i < dim_n * dim_m; i++) {
+    for (int i = 0; i < scene->dim_n * scene->dim_m; i++) {
         scene->dz[i] += 0.01 + 1/(((rand() % 5) + 1)*10);
         scene->points[i].z = ((sin(scene->dz[i]) + 1) / 2) * 2;
     }
 
+    evaluate_surface(scene);
+
+    if (scene->projections) {
+        project_scan_points(scene);
+    }
+}
+
+void evaluate_surface(Scene *scene)
+{
+    int dim_n = scene->dim_n;
+    int dim_m = scene->dim_m;
+    int res = scene->res;
+
     // compute bezier surface
     double u, v;
     for (int i = 0; i < dim_n * res; i++) {
@@ -215,6 +229,10 @@ void render_scene(const Scene* scene)
     set_lighting();
     draw_origin();
 
+    if (scene->is_surface_ready == 0) {
+        return;
+    }
+
     // draw bezier surface
     int dim_n = scene->dim_n;
     int dim_m = scene->dim_m;
@@ -299,6 +317,21 @@ void render_scene(const Scene* scene)
         }
         glEnd();
     }
+
+    // visualize closest points of the scan points
+
+    if (scene->projections) {
+        glBegin(GL_LINES);
+        for (int i = 0; i < N_SCAN_POINTS; i++) {
+            p1 = scene->scan_points[i];
+            p2 = scene->projected_points[i];
+
+            glColor3f(0.0, 1.0, 1.0);
+            glVertex3f(p1.x, p1.y, p1.z);
+            glVertex3f(p2.x, p2.y, p2.z);
+        }
+        glEnd();
+    }
     
 }
 
@@ -317,7 +350,14 @@ void init_surface(Scene *scene, int n, int m, int r)
     n_elements = (scene->dim_n * scene->res) * (scene->dim_m * scene->res);
     scene->disp_points = (vertex_t*)malloc(n_elements * sizeof(vertex_t));
 
+    scene->scan_points = (vec3*)malloc(N_SCAN_POINTS * sizeof(vec3));
+    scene->projected_points = (vec3*)malloc(N_SCAN_POINTS * sizeof(vec3));
+    scene->scan_us = (double*)malloc(N_SCAN_POINTS * sizeof(double));
+    scene->scan_vs = (double*)malloc(N_SCAN_POINTS * sizeof(double));
+    init_surface_projection(&(scene->projection));
+
     generate_surface(scene);
+    generate_scan_points(scene);
     premap_texture(scene);
     //precompute_bezier(scene);
 }
@@ -355,6 +395,10 @@ void premap_texture(Scene *scene)
 // eg.: 3 -> change by -1 -> 2
 void change_dim(Scene *scene, int target_dim, int size)
 {
+    if (scene->is_surface_ready == 0) {
+        return;
+    }
+
     int dim_n = scene->dim_n;
     int dim_m = scene->dim_m;
     int res = scene->res;
@@ -405,10 +449,33 @@ void change_dim(Scene *scene, int target_dim, int size)
     
     // regenerate the surface
     generate_surface(scene);
+    generate_scan_points(scene);
     premap_texture(scene);
     printf("N:%d, M:%d\n", scene->dim_n, scene->dim_m);
 }
 
+// scatter the scan points above and below the area of the control points
+void generate_scan_points(Scene *scene)
+{
+    for (int i = 0; i < N_SCAN_POINTS; i++) {
+        scene->scan_points[i].x = (scene->dim_n - 1) * ((double)rand() / RAND_MAX);
+        scene->scan_points[i].y = (scene->dim_m - 1) * ((double)rand() / RAND_MAX);
+        scene->scan_points[i].z = 4 * ((double)rand() / RAND_MAX) - 1;
+    }
+}
+
+// find the closest points of the scan points on the current surface
+void project_scan_points(Scene *scene)
+{
+    if (!update_surface_projection(&(scene->projection), scene->points, scene->dim_n, scene->dim_m) ||
+        !project_points(&(scene->projection), scene->scan_points, N_SCAN_POINTS,
+                        scene->scan_us, scene->scan_vs, scene->projected_points)) {
+        // without the closest points there is nothing to show
+        printf("Projection failed!\n");
+        scene->projections = 0;
+    }
+}
+
 void toggle_control_polygon(Scene *scene)
 {
     scene->control_polygon = ~(scene->control_polygon);
@@ -419,6 +486,11 @@ void toggle_normals(Scene *scene)
     scene->normals = ~(scene->normals);
 }
 
+void toggle_projections(Scene *scene)
+{
+    scene->projections = ~(scene->projections);
+}
+
 void toggle_texture()
 {
     if (glIsEnabled(GL_TEXTURE_2D) == GL_FALSE) {
@@ -1,14 +1,24 @@
 #include "texture.h"
 
-#include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#define PLACEHOLDER_SIZE 8
+
 GLuint load_texture(char* filename)
 {
     SDL_Surface* surface;
     GLuint texture_name;
 
     surface = IMG_Load(filename);
+    texture_name = upload_texture(surface);
+    SDL_FreeSurface(surface);
+
+    return texture_name;
+}
+
+GLuint upload_texture(const SDL_Surface* surface)
+{
+    GLuint texture_name;
 
     glGenTextures(1, &texture_name);
 
@@ -23,3 +33,33 @@ GLuint load_texture(char* filename)
 
     return texture_name;
 }
+
+GLuint create_placeholder_texture()
+{
+    Pixel pixels[PLACEHOLDER_SIZE * PLACEHOLDER_SIZE];
+    GLubyte shade;
+    GLuint texture_name;
+    int i, j;
+
+    for (i = 0; i < PLACEHOLDER_SIZE; ++i) {
+        for (j = 0; j < PLACEHOLDER_SIZE; ++j) {
+            shade = ((i + j) % 2 == 0) ? 160 : 96;
+            pixels[i * PLACEHOLDER_SIZE + j][0] = shade;
+            pixels[i * PLACEHOLDER_SIZE + j][1] = shade;
+            pixels[i * PLACEHOLDER_SIZE + j][2] = shade;
+        }
+    }
+
+    glGenTextures(1, &texture_name);
+
+    glBindTexture(GL_TEXTURE_2D, texture_name);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, PLACEHOLDER_SIZE, PLACEHOLDER_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    return texture_name;
+}
@@ -0,0 +1,463 @@
+#include "bezier.h"
+#include "bspline.h"
+#include "closest.h"
+#include "lagrange.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define N_SAMPLES 1001
+#define MIN_SECONDS 0.05
+#define N_BSPLINE_POINTS 64
+#define N_CLOSEST_POINT_QUERIES 4096
+#define N_REFERENCE_SAMPLES 100001
+
+/**
+ * Curve under measurement with the arrays of all kernels
+ */
+typedef struct Curve
+{
+    int n_points;
+    Point* points;
+    Point* work;
+    double* basis;
+    double* nodes;
+    double* weights;
+    BezierPolynomial polynomial;
+    BSpline spline;
+} Curve;
+
+/**
+ * Evaluation kernel with its name in the report
+ *
+ * The optional prepare function converts the curve for the kernel before the measurement.
+ */
+typedef struct Kernel
+{
+    const char* name;
+    Point (*evaluate)(Curve* curve, double t);
+    void (*prepare)(Curve* curve);
+} Kernel;
+
+/**
+ * Reference evaluation in long double precision
+ */
+typedef void (*Reference)(const Curve* curve, double t, long double* x, long double* y);
+
+static Point evaluate_bernstein(Curve* curve, double t)
+{
+    return calc_bernstein_point(curve->points, curve->n_points, t);
+}
+
+static Point evaluate_de_casteljau(Curve* curve, double t)
+{
+    return calc_de_casteljau_point(curve->points, curve->n_points, t, curve->work);
+}
+
+static Point evaluate_bezier(Curve* curve, double t)
+{
+    return calc_bezier_point(curve->points, curve->n_points, t);
+}
+
+static Point evaluate_polynomial(Curve* curve, double t)
+{
+    return calc_bezier_polynomial_point(&(curve->polynomial), t);
+}
+
+static void prepare_power_basis(Curve* curve)
+{
+    convert_bezier_polynomial(&(curve->polynomial), curve->points, curve->n_points, POWER_BASIS_EVALUATION);
+}
+
+static void prepare_scaled_bernstein(Curve* curve)
+{
+    convert_bezier_polynomial(&(curve->polynomial), curve->points, curve->n_points, SCALED_BERNSTEIN_EVALUATION);
+}
+
+static void prepare_polynomial(Curve* curve)
+{
+    update_bezier_polynomial(&(curve->polynomial), curve->points, curve->n_points);
+}
+
+static Point evaluate_barycentric(Curve* curve, double t)
+{
+    return calc_lagrange_point(curve->points, curve->nodes, curve->weights, curve->n_points, t);
+}
+
+static Point evaluate_lagrange_basis(Curve* curve, double t)
+{
+    return calc_lagrange_basis_point(curve->points, curve->nodes, curve->n_points, t);
+}
+
+static Point evaluate_de_boor(Curve* curve, double t)
+{
+    return de_boor(&(curve->spline), t, curve->work);
+}
+
+static Point evaluate_cox_de_boor(Curve* curve, double t)
+{
+    return calc_cox_de_boor_point(&(curve->spline), t, curve->basis);
+}
+
+static void calc_de_casteljau_reference(const Curve* curve, double t, long double* x, long double* y)
+{
+    long double* xs = (long double*)malloc(curve->n_points * sizeof(long double));
+    long double* ys = (long double*)malloc(curve->n_points * sizeof(long double));
+
+    for (int i = 0; i < curve->n_points; ++i) {
+        xs[i] = curve->points[i].x;
+        ys[i] = curve->points[i].y;
+    }
+    for (int k = 1; k < curve->n_points; ++k) {
+        for (int i = 0; i < curve->n_points - k; ++i) {
+            xs[i] = (1.0L - t) * xs[i] + t * xs[i + 1];
+            ys[i] = (1.0L - t) * ys[i] + t * ys[i + 1];
+        }
+    }
+    *x = xs[0];
+    *y = ys[0];
+    free(xs);
+    free(ys);
+}
+
+static void calc_lagrange_reference(const Curve* curve, double t, long double* x, long double* y)
+{
+    long double basis;
+
+    *x = 0.0L;
+    *y = 0.0L;
+    for (int j = 0; j < curve->n_points; ++j) {
+        basis = 1.0L;
+        for (int k = 0; k < curve->n_points; ++k) {
+            if (k != j) {
+                basis *= ((long double)t - curve->nodes[k]) / ((long double)curve->nodes[j] - curve->nodes[k]);
+            }
+        }
+        *x += basis * curve->points[j].x;
+        *y += basis * curve->points[j].y;
+    }
+}
+
+static void calc_de_boor_reference(const Curve* curve, double t, long double* x, long double* y)
+{
+    const BSpline* spline = &(curve->spline);
+    const int p = spline->degree;
+    const double* knots = spline->knots;
+    int span = find_knot_span(spline, t);
+    long double* xs = (long double*)malloc((p + 1) * sizeof(long double));
+    long double* ys = (long double*)malloc((p + 1) * sizeof(long double));
+    long double alpha;
+
+    for (int j = 0; j <= p; ++j) {
+        xs[j] = spline->points[span - p + j].x;
+        ys[j] = spline->points[span - p + j].y;
+    }
+    for (int r = 1; r <= p; ++r) {
+        for (int j = p; j >= r; --j) {
+            int i = span - p + j;
+            long double denominator = (long double)knots[i + p - r + 1] - knots[i];
+            alpha = (denominator != 0.0L) ? ((long double)t - knots[i]) / denominator : 0.0L;
+            xs[j] = (1.0L - alpha) * xs[j - 1] + alpha * xs[j];
+            ys[j] = (1.0L - alpha) * ys[j - 1] + alpha * ys[j];
+        }
+    }
+    *x = xs[p];
+    *y = ys[p];
+    free(xs);
+    free(ys);
+}
+
+/**
+ * Place the points pseudo-randomly in the 800 x 600 window, with the same sequence on every run.
+ */
+static void init_random_points(Point* points, int n_points)
+{
+    unsigned int state = 12345u;
+
+    for (int i = 0; i < n_points; ++i) {
+        state = state * 1103515245u + 12345u;
+        points[i].x = 800.0 * ((state >> 8) & 0xFFFF) / 65536.0;
+        state = state * 1103515245u + 12345u;
+        points[i].y = 600.0 * ((state >> 8) & 0xFFFF) / 65536.0;
+    }
+}
+
+static bool create_curve(Curve* curve, int n_points)
+{
+    curve->n_points = n_points;
+    curve->points = (Point*)malloc(n_points * sizeof(Point));
+    curve->work = (Point*)malloc(n_points * sizeof(Point));
+    curve->basis = (double*)malloc(3 * n_points * sizeof(double));
+    curve->nodes = (double*)malloc(n_points * sizeof(double));
+    curve->weights = (double*)malloc(n_points * sizeof(double));
+    if (curve->points == NULL || curve->work == NULL || curve->basis == NULL
+        || curve->nodes == NULL || curve->weights == NULL) {
+        printf("[ERROR] Unable to allocate memory for the curve!\n");
+        free(curve->points);
+        free(curve->work);
+        free(curve->basis);
+        free(curve->nodes);
+        free(curve->weights);
+        return false;
+    }
+    if (!create_bezier_polynomial(&(curve->polynomial), n_points)) {
+        free(curve->points);
+        free(curve->work);
+        free(curve->basis);
+        free(curve->nodes);
+        free(curve->weights);
+        return false;
+    }
+    init_random_points(curve->points, n_points);
+    return true;
+}
+
+static void destroy_curve(Curve* curve)
+{
+    free(curve->points);
+    free(curve->work);
+    free(curve->basis);
+    free(curve->nodes);
+    free(curve->weights);
+    destroy_bezier_polynomial(&(curve->polynomial));
+}
+
+/**
+ * Measure the average time of an evaluation over the uniform samples of the domain,
+ * and the largest distance of the samples from the reference.
+ */
+static void measure_kernel(const Kernel* kernel, Curve* curve, int degree, double begin, double end, Reference reference)
+{
+    volatile double sink = 0.0;
+    double max_error = 0.0;
+    double error;
+    long n_evaluations = 0;
+    clock_t start;
+    double seconds;
+    long double x, y;
+    Point point;
+
+    if (kernel->prepare != NULL) {
+        kernel->prepare(curve);
+    }
+    for (int k = 0; k < N_SAMPLES; ++k) {
+        double t = begin + (end - begin) * k / (N_SAMPLES - 1);
+        point = kernel->evaluate(curve, t);
+        reference(curve, t, &x, &y);
+        error = (double)hypotl(point.x - x, point.y - y);
+        // fmax ignores the NaN results of overflowing kernels
+        max_error = isnan(error) ? INFINITY : fmax(max_error, error);
+    }
+    start = clock();
+    do {
+        double sum = 0.0;
+        for (int k = 0; k < N_SAMPLES; ++k) {
+            point = kernel->evaluate(curve, begin + (end - begin) * k / (N_SAMPLES - 1));
+            sum += point.x + point.y;
+        }
+        sink += sum;
+        n_evaluations += N_SAMPLES;
+        seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    } while (seconds < MIN_SECONDS);
+    printf("%-16s %6d %12.1f %12.3g\n", kernel->name, degree, seconds * 1e9 / n_evaluations, max_error);
+}
+
+static void measure_bezier_kernels(void)
+{
+    const int degrees[] = {1, 3, 5, 7, 9, 11, 13, 15, 31, 63, 127, 255, 1000, 1023};
+    const Kernel kernels[] = {
+        {"bernstein", evaluate_bernstein, NULL},
+        {"de_casteljau", evaluate_de_casteljau, NULL},
+        {"bezier", evaluate_bezier, NULL},
+        {"power_basis", evaluate_polynomial, prepare_power_basis},
+        {"scaled_bernstein", evaluate_polynomial, prepare_scaled_bernstein},
+        {"polynomial", evaluate_polynomial, prepare_polynomial}
+    };
+    Curve curve;
+
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        if (!create_curve(&curve, degrees[d] + 1)) {
+            return;
+        }
+        for (int k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); ++k) {
+            measure_kernel(&kernels[k], &curve, degrees[d], 0.0, 1.0, calc_de_casteljau_reference);
+        }
+        destroy_curve(&curve);
+    }
+}
+
+/**
+ * The Lagrange curves interpolate at the Chebyshev points of the second kind,
+ * because the equispaced ones are too ill-conditioned for a meaningful comparison at high degree.
+ */
+static void measure_lagrange_kernels(void)
+{
+    const int degrees[] = {1, 3, 7, 15, 31, 63, 127, 255};
+    const Kernel kernels[] = {
+        {"barycentric", evaluate_barycentric, NULL},
+        {"lagrange_basis", evaluate_lagrange_basis, NULL}
+    };
+    Curve curve;
+
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        if (!create_curve(&curve, degrees[d] + 1)) {
+            return;
+        }
+        for (int j = 0; j <= degrees[d]; ++j) {
+            curve.nodes[j] = -cos(M_PI * j / degrees[d]);
+        }
+        calc_barycentric_weights(curve.nodes, curve.n_points, curve.weights);
+        for (int k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); ++k) {
+            measure_kernel(&kernels[k], &curve, degrees[d], -1.0, 1.0, calc_lagrange_reference);
+        }
+        destroy_curve(&curve);
+    }
+}
+
+static void measure_b_spline_kernels(void)
+{
+    const int degrees[] = {1, 2, 3, 5, 7, 11, 15};
+    const Kernel kernels[] = {
+        {"de_boor", evaluate_de_boor, NULL},
+        {"cox_de_boor", evaluate_cox_de_boor, NULL}
+    };
+    Curve curve;
+    double begin, end;
+
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        if (!create_curve(&curve, N_BSPLINE_POINTS)) {
+            return;
+        }
+        if (!create_b_spline(&(curve.spline), degrees[d], N_BSPLINE_POINTS)) {
+            destroy_curve(&curve);
+            return;
+        }
+        init_random_points(curve.spline.points, N_BSPLINE_POINTS);
+        set_clamped_knots(&(curve.spline));
+        get_domain(&(curve.spline), &begin, &end);
+        for (int k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); ++k) {
+            measure_kernel(&kernels[k], &curve, degrees[d], begin, end, calc_de_boor_reference);
+        }
+        destroy_b_spline(&(curve.spline));
+        destroy_curve(&curve);
+    }
+}
+
+/**
+ * Find the squared distance of the query from the closest of the dense uniform samples,
+ * refined by a ternary search in the neighbouring sample intervals.
+ */
+static double calc_closest_point_reference(const Curve* curve, const Point* samples, Point query)
+{
+    double best_distance = INFINITY;
+    double best_t = 0.0;
+    double begin, end, t1, t2;
+    Point point;
+
+    for (int k = 0; k < N_REFERENCE_SAMPLES; ++k) {
+        double distance = (samples[k].x - query.x) * (samples[k].x - query.x) + (samples[k].y - query.y) * (samples[k].y - query.y);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best_t = (double)k / (N_REFERENCE_SAMPLES - 1);
+        }
+    }
+    begin = fmax(best_t - 1.0 / (N_REFERENCE_SAMPLES - 1), 0.0);
+    end = fmin(best_t + 1.0 / (N_REFERENCE_SAMPLES - 1), 1.0);
+    for (int k = 0; k < 100; ++k) {
+        t1 = begin + (end - begin) / 3.0;
+        t2 = end - (end - begin) / 3.0;
+        Point p1 = calc_bezier_point(curve->points, curve->n_points, t1);
+        Point p2 = calc_bezier_point(curve->points, curve->n_points, t2);
+        if (hypot(p1.x - query.x, p1.y - query.y) < hypot(p2.x - query.x, p2.y - query.y)) {
+            end = t2;
+        }
+        else {
+            begin = t1;
+        }
+    }
+    point = calc_bezier_point(curve->points, curve->n_points, 0.5 * (begin + end));
+    return fmin(best_distance, (point.x - query.x) * (point.x - query.x) + (point.y - query.y) * (point.y - query.y));
+}
+
+/**
+ * Measure the average time of a closest point query of the points of the window,
+ * and the largest excess of the found distance over the distance of the dense reference samples.
+ */
+static void measure_closest_points(void)
+{
+    const int degrees[] = {1, 3, 5, 7, 15, 31, 63, 255, 1000};
+    Point queries[N_CLOSEST_POINT_QUERIES];
+    Point closest_points[N_CLOSEST_POINT_QUERIES];
+    double parameters[N_CLOSEST_POINT_QUERIES];
+    ClosestPointCurve closest_curve;
+    Curve curve;
+    Point* samples;
+    double max_error;
+    long n_queries;
+    int n_grid, n_batch;
+    clock_t start;
+    double seconds;
+
+    samples = (Point*)malloc(N_REFERENCE_SAMPLES * sizeof(Point));
+    if (samples == NULL) {
+        printf("[ERROR] Unable to allocate memory for the samples!\n");
+        return;
+    }
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        if (!create_curve(&curve, degrees[d] + 1)) {
+            free(samples);
+            return;
+        }
+        if (!create_closest_point_curve(&closest_curve, curve.n_points)) {
+            destroy_curve(&curve);
+            free(samples);
+            return;
+        }
+        // the queries are on a 64 x 64 grid over the window, or on a 16 x 16 one for the slow high degree queries,
+        // and the control points are random
+        n_grid = (degrees[d] <= 63) ? 64 : 16;
+        n_batch = n_grid * n_grid;
+        for (int q = 0; q < n_batch; ++q) {
+            queries[q].x = 800.0 * ((q % n_grid) + 0.5) / n_grid;
+            queries[q].y = 600.0 * ((q / n_grid) + 0.5) / n_grid;
+        }
+        start = clock();
+        n_queries = 0;
+        do {
+            update_closest_point_curve(&closest_curve, curve.points, curve.n_points);
+            find_closest_points(&closest_curve, queries, n_batch, parameters, closest_points);
+            n_queries += n_batch;
+            seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        } while (seconds < MIN_SECONDS);
+        for (int k = 0; k < N_REFERENCE_SAMPLES; ++k) {
+            samples[k] = calc_bezier_point(curve.points, curve.n_points, (double)k / (N_REFERENCE_SAMPLES - 1));
+        }
+        max_error = 0.0;
+        for (int q = 0; q < n_batch; q += n_batch / 256) {
+            double distance = hypot(closest_points[q].x - queries[q].x, closest_points[q].y - queries[q].y);
+            max_error = fmax(max_error, distance - sqrt(calc_closest_point_reference(&curve, samples, queries[q])));
+        }
+        printf("%-16s %6d %12.1f %12.3g\n", "closest_point", degrees[d], seconds * 1e9 / n_queries, max_error);
+        destroy_closest_point_curve(&closest_curve);
+        destroy_curve(&curve);
+    }
+    free(samples);
+}
+
+/**
+ * Microbenchmark of the curve kernels.
+ *
+ * Every kernel is evaluated at the same uniform samples of random curves,
+ * and its error is the largest distance from the long double evaluation of the same curve.
+ */
+int main(void)
+{
+    printf("%-16s %6s %12s %12s\n", "kernel", "degree", "ns/eval", "max error");
+    measure_bezier_kernels();
+    measure_lagrange_kernels();
+    measure_b_spline_kernels();
+    measure_closest_points();
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef CURVE_ARCLENGTH_H
+#define CURVE_ARCLENGTH_H
+
+#include "point.h"
+
+#include <stdbool.h>
+
+/**
+ * Curve given by its derivative for the arc length calculations
+ */
+typedef struct ArcLengthCurve
+{
+    Point (*calc_derivative)(const void* data, double t);
+    const void* data;
+} ArcLengthCurve;
+
+/**
+ * Cumulative arc length table of a curve
+ *
+ * The domain is divided into spans, and every span into n_intervals uniform intervals.
+ * The lengths of the intervals are integrated with Gauss-Legendre quadrature,
+ * and lengths[i] is the length of the curve from the beginning of the domain to parameters[i].
+ * Only the spans which are marked dirty are integrated again on update.
+ */
+typedef struct ArcLengthTable
+{
+    int n_spans;
+    int n_intervals;
+    double* parameters;
+    double* interval_lengths;
+    double* lengths;
+    bool* is_span_dirty;
+} ArcLengthTable;
+
+/**
+ * Create the table of the spans between the n_spans + 1 span parameters, with all spans dirty.
+ */
+bool create_arc_length_table(ArcLengthTable* table, const double* span_parameters, int n_spans, int n_intervals);
+
+/**
+ * Release the arrays of the table.
+ */
+void destroy_arc_length_table(ArcLengthTable* table);
+
+/**
+ * Mark the [first, last] range of the spans dirty, after their part of the curve has changed.
+ */
+void invalidate_arc_length_spans(ArcLengthTable* table, int first, int last);
+
+/**
+ * Integrate the lengths of the dirty spans and accumulate the lengths of the intervals.
+ */
+void update_arc_length_table(ArcLengthTable* table, const ArcLengthCurve* curve);
+
+/**
+ * Get the length of the whole curve.
+ */
+double get_arc_length(const ArcLengthTable* table);
+
+/**
+ * Calculate the length of the curve from the beginning of the domain to t.
+ */
+double calc_arc_length(const ArcLengthTable* table, const ArcLengthCurve* curve, double t);
+
+/**
+ * Find the parameter where the length of the curve from the beginning of the domain is s.
+ * The interval is found by binary search, and the parameter is refined by Newton iterations in it.
+ */
+double find_arc_length_parameter(const ArcLengthTable* table, const ArcLengthCurve* curve, double s);
+
+/**
+ * Find the parameters of the lengths.
+ * The search of an increasing length starts from the interval of the previous one.
+ */
+void find_arc_length_parameters(const ArcLengthTable* table, const ArcLengthCurve* curve,
+                                const double* lengths, int n_lengths, double* parameters);
+
+/**
+ * Find the parameters of the n_samples points which divide the curve into equal lengths, including both ends.
+ */
+void calc_equal_length_parameters(const ArcLengthTable* table, const ArcLengthCurve* curve, int n_samples, double* parameters);
+
+/**
+ * Find the start and end parameters of the dashes of the pattern along the curve.
+ * The pattern alternates the lengths of the dashes and the gaps, and it is repeated until the end of the curve.
+ * Returns the number of the parameters (twice the number of the dashes), at most max_parameters.
+ */
+int calc_dash_parameters(const ArcLengthTable* table, const ArcLengthCurve* curve,
+                         const double* pattern, int n_pattern, double* parameters, int max_parameters);
+
+#endif /* CURVE_ARCLENGTH_H */
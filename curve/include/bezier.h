@@ -0,0 +1,105 @@
+#ifndef CURVE_BEZIER_H
+#define CURVE_BEZIER_H
+
+#include "point.h"
+
+#include <stdbool.h>
+
+/**
+ * The Bezier curves are defined on the [0, 1] interval, from the first to the last control point.
+ * Their degree is one less than the number of the control points.
+ */
+
+/**
+ * Calculate the binomial coefficient as a floating point number, so that it does not overflow below degree 1000.
+ */
+double calc_binomial_coefficient(int n, int k);
+
+/**
+ * Evaluate the curve as the sum of the control points weighted by the Bernstein polynomials.
+ * The polynomials are calculated directly from their binomial coefficients and powers in O(n) steps.
+ */
+Point calc_bernstein_point(const Point* points, int n_points, double t);
+
+/**
+ * Calculate one level of the de Casteljau algorithm, the n_points - 1 points between the consecutive points at t.
+ * The level may be the same array as the points.
+ */
+void calc_de_casteljau_level(const Point* points, int n_points, double t, Point* level);
+
+/**
+ * Evaluate the curve with the de Casteljau algorithm in O(n^2) steps.
+ * The work array has room for n_points points.
+ */
+Point calc_de_casteljau_point(const Point* points, int n_points, double t, Point* work);
+
+/**
+ * Calculate the first derivative of the curve with the de Casteljau algorithm in O(n^2) steps.
+ * The work array has room for n_points points.
+ */
+Point calc_bezier_derivative(const Point* points, int n_points, double t, Point* work);
+
+/**
+ * Evaluate the curve from the ratios of the consecutive Bernstein polynomials in O(n) steps.
+ * The weights are positive and they are normalized by their sum, so it is stable for degree 1000 curves.
+ */
+Point calc_bezier_point(const Point* points, int n_points, double t);
+
+/**
+ * Split the curve at t into the control polygons of its two parts with the de Casteljau algorithm.
+ * The right polygon may be the same array as the control points.
+ */
+void split_bezier_curve(const Point* points, int n_points, double t, Point* left, Point* right);
+
+/**
+ * Evaluation scheme of the polynomial form
+ */
+typedef enum BezierEvaluation
+{
+    POWER_BASIS_EVALUATION,
+    SCALED_BERNSTEIN_EVALUATION,
+    BERNSTEIN_RATIO_EVALUATION
+} BezierEvaluation;
+
+/**
+ * Bezier curve converted once per edit for repeated evaluation
+ *
+ * The low degree curves are evaluated from their power basis coefficients with Horner's rule.
+ * The conversion cancels more and more digits at higher degree, so those curves are evaluated
+ * from their scaled Bernstein coefficients C(n, i) * P_i with Horner's rule in t / (1 - t).
+ * Above that the binomial coefficients overflow, so the control points are kept for the ratio evaluation,
+ * which is as accurate as de Casteljau in O(n) steps.
+ */
+typedef struct BezierPolynomial
+{
+    int n_points;
+    BezierEvaluation evaluation;
+    Point* coefficients;
+} BezierPolynomial;
+
+/**
+ * Allocate the coefficients of the polynomial form for the given number of control points.
+ */
+bool create_bezier_polynomial(BezierPolynomial* polynomial, int capacity);
+
+/**
+ * Release the arrays of the polynomial form.
+ */
+void destroy_bezier_polynomial(BezierPolynomial* polynomial);
+
+/**
+ * Convert the control points into the coefficients of the given evaluation scheme in O(n^2) steps.
+ */
+void convert_bezier_polynomial(BezierPolynomial* polynomial, const Point* points, int n_points, BezierEvaluation evaluation);
+
+/**
+ * Convert the control points with the fastest evaluation scheme which is still accurate at their degree.
+ */
+void update_bezier_polynomial(BezierPolynomial* polynomial, const Point* points, int n_points);
+
+/**
+ * Evaluate the polynomial form with O(n) multiply-adds.
+ */
+Point calc_bezier_polynomial_point(const BezierPolynomial* polynomial, double t);
+
+#endif /* CURVE_BEZIER_H */
@@ -0,0 +1,82 @@
+#ifndef CURVE_BSPLINE_H
+#define CURVE_BSPLINE_H
+
+#include "point.h"
+
+#include <stdbool.h>
+
+/**
+ * B-spline curve of arbitrary degree
+ *
+ * The knot vector has n_points + degree + 1 elements.
+ * The evaluation functions take their work arrays from the caller, so they do not modify the curve,
+ * and the same curve can be evaluated on separate threads.
+ */
+typedef struct BSpline
+{
+    int degree;
+    int n_points;
+    int n_knots;
+    Point* points;
+    double* knots;
+} BSpline;
+
+/**
+ * Allocate the control points and the knots of the B-spline.
+ */
+bool create_b_spline(BSpline* spline, int degree, int n_points);
+
+/**
+ * Release the arrays of the B-spline.
+ */
+void destroy_b_spline(BSpline* spline);
+
+/**
+ * Set a clamped, uniform knot vector on the [0, 1] interval,
+ * so that the curve starts at the first and ends at the last control point.
+ */
+void set_clamped_knots(BSpline* spline);
+
+/**
+ * Find the knot span [knots[i], knots[i + 1]) of u by binary search.
+ * The result is in the [degree, n_points - 1] range, the end of the domain belongs to the last span.
+ */
+int find_knot_span(const BSpline* spline, double u);
+
+/**
+ * Get the [knots[degree], knots[n_points]] parameter domain of the curve.
+ */
+void get_domain(const BSpline* spline, double* begin, double* end);
+
+/**
+ * Get the [first, last] range of the knot spans where the control point has an effect,
+ * counted from the first span of the domain.
+ */
+void get_point_spans(const BSpline* spline, int index, int* first, int* last);
+
+/**
+ * Calculate the degree + 1 non-zero basis functions of the knot span at u with the Cox-de Boor recursion.
+ * The left and right arrays have room for degree + 1 differences.
+ */
+void calc_basis_functions(const BSpline* spline, int span, double u, double* values, double* left, double* right);
+
+/**
+ * Evaluate the curve with the triangular de Boor scheme.
+ * Only the degree + 1 control points of the knot span have an effect, so it takes O(degree^2) steps.
+ * The work array has room for degree + 1 points.
+ */
+Point de_boor(const BSpline* spline, double u, Point* work);
+
+/**
+ * Evaluate the curve as the sum of the control points of the knot span weighted by their basis functions.
+ * The basis array has room for the 3 * (degree + 1) values and differences of the basis functions.
+ */
+Point calc_cox_de_boor_point(const BSpline* spline, double u, double* basis);
+
+/**
+ * Calculate the first derivative of the curve with the de Boor scheme of its derivative control points.
+ * The work array has room for degree + 1 points.
+ */
+Point calc_b_spline_derivative(const BSpline* spline, double u, Point* work);
+
+#endif /* CURVE_BSPLINE_H */
@@ -0,0 +1,68 @@
+#ifndef CURVE_CLOSEST_H
+#define CURVE_CLOSEST_H
+
+#include "point.h"
+
+#include <stdbool.h>
+
+/**
+ * Bezier curve prepared for closest point queries
+ *
+ * The curve is subdivided until the control polygons of the pieces are flat, so that their bounds are tight.
+ * The curve is in the convex hull of its control points, so the bounding box of a piece and the capsule around
+ * its chord which holds the control points give lower bounds of its distance, and the end points of the pieces
+ * are on the curve, so they give upper bounds. The bounds are kept in separate coordinate arrays,
+ * because every query is tested against all of them in a single loop.
+ */
+typedef struct ClosestPointCurve
+{
+    int n_points;
+    int capacity;
+    int n_pieces;
+    double* parameters;
+    Point* points;
+    Point* stack;
+    double* product_weights;
+    double* log_binomials;
+    double* min_xs;
+    double* min_ys;
+    double* max_xs;
+    double* max_ys;
+    double* end_xs;
+    double* end_ys;
+    double* chord_xs;
+    double* chord_ys;
+    double* inverse_lengths;
+    double* radii;
+} ClosestPointCurve;
+
+/**
+ * Allocate the pieces of the subdivision of a curve with at most capacity control points.
+ */
+bool create_closest_point_curve(ClosestPointCurve* curve, int capacity);
+
+/**
+ * Release the arrays of the subdivision.
+ */
+void destroy_closest_point_curve(ClosestPointCurve* curve);
+
+/**
+ * Subdivide the curve of the at least two control points into flat pieces, and calculate their bounds.
+ * The arrays grow when there are more control points than the capacity.
+ */
+bool update_closest_point_curve(ClosestPointCurve* curve, const Point* points, int n_points);
+
+/**
+ * Find the parameters and the points of the curve closest to the queries.
+ *
+ * The queries are bounded against all pieces in batches, and the candidate pieces are visited
+ * in the order of their lower bounds until the bound exceeds the best distance.
+ * A candidate is split until its interior minimum of the distance is isolated by the signs of the Bernstein
+ * coefficients of C'(s) . (C(s) - q), and the minimum is found by Newton iterations.
+ * The closest points may be NULL. It does not modify the curve, so the ranges of the queries
+ * can be processed on separate threads.
+ */
+bool find_closest_points(const ClosestPointCurve* curve, const Point* queries, int n_queries,
+                         double* parameters, Point* closest_points);
+
+#endif /* CURVE_CLOSEST_H */
@@ -0,0 +1,52 @@
+#ifndef CURVE_DRAW_H
+#define CURVE_DRAW_H
+
+#include "point.h"
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+/**
+ * Arrays of the renderer, which are reused for drawing the points of the curve tools
+ *
+ * The arrays grow to the largest point set, and they are kept between the frames,
+ * so the drawing does not allocate memory after the first frames.
+ * The vertices and the indices hold the two rectangles of the arms of every control point cross.
+ */
+typedef struct DrawBuffer
+{
+    int point_capacity;
+    int cross_capacity;
+    SDL_FPoint* points;
+    SDL_Vertex* vertices;
+    int* indices;
+} DrawBuffer;
+
+/**
+ * Initialize an empty buffer.
+ */
+void init_draw_buffer(DrawBuffer* buffer);
+
+/**
+ * Release the arrays of the buffer, and leave it empty.
+ */
+void destroy_draw_buffer(DrawBuffer* buffer);
+
+/**
+ * Draw the connected segments of the points with a single call.
+ */
+void draw_polyline(SDL_Renderer* renderer, DrawBuffer* buffer, const Point* points, int n_points);
+
+/**
+ * Draw the points as pixels with a single call.
+ */
+void draw_points(SDL_Renderer* renderer, DrawBuffer* buffer, const Point* points, int n_points);
+
+/**
+ * Draw the crosses of the control points with a single call, in the draw color of the renderer.
+ * The arms are one pixel wide rectangles of two triangles, which cover the same pixels as the points of the arms.
+ */
+void draw_control_points(SDL_Renderer* renderer, DrawBuffer* buffer, const Point* points, int n_points, double radius);
+
+#endif /* CURVE_DRAW_H */
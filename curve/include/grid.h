@@ -0,0 +1,62 @@
+#ifndef CURVE_GRID_H
+#define CURVE_GRID_H
+
+#include "point.h"
+
+#include <stdbool.h>
+
+/**
+ * Uniform grid of the control points for picking
+ *
+ * The cells are radius wide, so the points within the radius of a position are in its 3x3 cells.
+ * The cells are hashed into the buckets, and the points of a bucket are linked by their indices.
+ * The grid keeps a copy of the positions, and it is updated point by point while dragging.
+ */
+typedef struct PointGrid
+{
+    double radius;
+    int n_buckets;
+    int* heads;
+    int* nexts;
+    int* buckets;
+    double* xs;
+    double* ys;
+} PointGrid;
+
+/**
+ * Initialize an empty grid, which picks the points within the radius.
+ */
+void init_point_grid(PointGrid* grid, double radius);
+
+/**
+ * Release the arrays of the grid, and leave it empty.
+ */
+void destroy_point_grid(PointGrid* grid);
+
+/**
+ * Clear the grid for the given number of points, with at least twice as many buckets as points.
+ */
+bool reset_point_grid(PointGrid* grid, int n_points);
+
+/**
+ * Insert the point into the grid, or move it to its new position.
+ */
+void set_grid_point(PointGrid* grid, int index, double x, double y);
+
+/**
+ * Build the grid of the points.
+ */
+bool build_point_grid(PointGrid* grid, const Point* points, int n_points);
+
+/**
+ * Insert the last of the points into the grid, or rebuild the grid with more buckets when it is full.
+ */
+bool add_grid_point(PointGrid* grid, const Point* points, int n_points);
+
+/**
+ * Find the nearest point within the radius of the position, or -1.
+ * The points of the other cells which are hashed into the same buckets are rejected by their distances.
+ */
+int find_nearest_point(const PointGrid* grid, double x, double y);
+
+#endif /* CURVE_GRID_H */
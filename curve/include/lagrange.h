@@ -0,0 +1,46 @@
+#ifndef CURVE_LAGRANGE_H
+#define CURVE_LAGRANGE_H
+
+#include "point.h"
+
+/**
+ * The interpolating polynomial curves pass through their points at the given parameter values (nodes).
+ * The barycentric weights are only defined up to a common factor, which cancels in the evaluation.
+ */
+
+// the products of the differences of n nodes stay in range for hundreds of nodes in an interval of this length
+#define NODE_INTERVAL 4.0
+// the appended nodes are rescaled to NODE_INTERVAL once they are longer than this
+#define MAX_NODE_INTERVAL (2.0 * NODE_INTERVAL)
+
+/**
+ * Calculate the barycentric weight of the node from the product of its differences to the other nodes.
+ * The weight of a repeated node is zero.
+ */
+double calc_barycentric_weight(const double* nodes, int n_nodes, int index);
+
+/**
+ * Calculate the barycentric weights of all nodes in O(n^2) steps.
+ */
+void calc_barycentric_weights(const double* nodes, int n_nodes, double* weights);
+
+/**
+ * Append the last of the n_nodes nodes at the scaled distance after the previous one, and update the weights.
+ * The other weights are divided by their difference to the new node, and its weight is calculated, in O(n) steps.
+ * Once the nodes are longer than MAX_NODE_INTERVAL, they are rescaled to NODE_INTERVAL and the weights
+ * are recalculated in O(n^2) steps. The interval has doubled by then, so the average cost of an append stays O(n).
+ * Return the scale of the distances, which changes with the rescaling.
+ */
+double append_barycentric_node(double* nodes, double* weights, int n_nodes, double distance, double scale);
+
+/**
+ * Evaluate the curve with the second (true) barycentric formula in O(n) steps.
+ */
+Point calc_lagrange_point(const Point* points, const double* nodes, const double* weights, int n_points, double t);
+
+/**
+ * Evaluate the curve as the sum of the points weighted by the Lagrange basis polynomials in O(n^2) steps.
+ */
+Point calc_lagrange_basis_point(const Point* points, const double* nodes, int n_points, double t);
+
+#endif /* CURVE_LAGRANGE_H */
@@ -0,0 +1,13 @@
+#ifndef CURVE_POINT_H
+#define CURVE_POINT_H
+
+/**
+ * A simple point structure.
+ */
+typedef struct Point
+{
+    double x;
+    double y;
+} Point;
+
+#endif /* CURVE_POINT_H */
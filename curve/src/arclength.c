@@ -0,0 +1,255 @@
+#include "arclength.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N_QUADRATURE_NODES 5
+#define MAX_NEWTON_ITERATIONS 16
+#define ARC_LENGTH_TOLERANCE 1e-9
+
+/**
+ * The nodes and the weights of the 5 point Gauss-Legendre quadrature on [-1, 1]
+ */
+static const double QUADRATURE_NODES[N_QUADRATURE_NODES] = {
+    -0.9061798459386640, -0.5384693101056831, 0.0, 0.5384693101056831, 0.9061798459386640
+};
+static const double QUADRATURE_WEIGHTS[N_QUADRATURE_NODES] = {
+    0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891
+};
+
+static double integrate_speed(const ArcLengthCurve* curve, double begin, double end)
+{
+    double middle = 0.5 * (begin + end);
+    double half = 0.5 * (end - begin);
+    double sum = 0.0;
+    Point derivative;
+
+    for (int k = 0; k < N_QUADRATURE_NODES; ++k) {
+        derivative = curve->calc_derivative(curve->data, middle + half * QUADRATURE_NODES[k]);
+        sum += QUADRATURE_WEIGHTS[k] * hypot(derivative.x, derivative.y);
+    }
+    return sum * half;
+}
+
+bool create_arc_length_table(ArcLengthTable* table, const double* span_parameters, int n_spans, int n_intervals)
+{
+    const int n_total = n_spans * n_intervals;
+
+    table->n_spans = n_spans;
+    table->n_intervals = n_intervals;
+    table->parameters = (double*)malloc((n_total + 1) * sizeof(double));
+    table->interval_lengths = (double*)malloc((n_total + 1) * sizeof(double));
+    table->lengths = (double*)malloc((n_total + 1) * sizeof(double));
+    table->is_span_dirty = (bool*)malloc((n_spans + 1) * sizeof(bool));
+    if (table->parameters == NULL || table->interval_lengths == NULL || table->lengths == NULL || table->is_span_dirty == NULL) {
+        printf("[ERROR] Unable to allocate memory for the arc length table!\n");
+        destroy_arc_length_table(table);
+        return false;
+    }
+    for (int s = 0; s < n_spans; ++s) {
+        for (int j = 0; j < n_intervals; ++j) {
+            table->parameters[s * n_intervals + j] = span_parameters[s]
+                + (span_parameters[s + 1] - span_parameters[s]) * j / n_intervals;
+        }
+        table->is_span_dirty[s] = true;
+    }
+    table->parameters[n_total] = span_parameters[n_spans];
+    return true;
+}
+
+void destroy_arc_length_table(ArcLengthTable* table)
+{
+    free(table->parameters);
+    free(table->interval_lengths);
+    free(table->lengths);
+    free(table->is_span_dirty);
+    table->parameters = NULL;
+    table->interval_lengths = NULL;
+    table->lengths = NULL;
+    table->is_span_dirty = NULL;
+}
+
+void invalidate_arc_length_spans(ArcLengthTable* table, int first, int last)
+{
+    for (int s = (first > 0 ? first : 0); s <= last && s < table->n_spans; ++s) {
+        table->is_span_dirty[s] = true;
+    }
+}
+
+void update_arc_length_table(ArcLengthTable* table, const ArcLengthCurve* curve)
+{
+    const int n_total = table->n_spans * table->n_intervals;
+
+    for (int s = 0; s < table->n_spans; ++s) {
+        if (!table->is_span_dirty[s]) {
+            continue;
+        }
+        for (int i = s * table->n_intervals; i < (s + 1) * table->n_intervals; ++i) {
+            table->interval_lengths[i] = integrate_speed(curve, table->parameters[i], table->parameters[i + 1]);
+        }
+        table->is_span_dirty[s] = false;
+    }
+    table->lengths[0] = 0.0;
+    for (int i = 0; i < n_total; ++i) {
+        table->lengths[i + 1] = table->lengths[i] + table->interval_lengths[i];
+    }
+}
+
+double get_arc_length(const ArcLengthTable* table)
+{
+    return table->lengths[table->n_spans * table->n_intervals];
+}
+
+/**
+ * Find the last interval in the [low, n_total - 1] range which starts at or before the value of the array.
+ */
+static int find_interval(const double* values, int n_total, double value, int low)
+{
+    int high = n_total;
+    int middle;
+
+    while (high - low > 1) {
+        middle = (low + high) / 2;
+        if (value < values[middle]) {
+            high = middle;
+        }
+        else {
+            low = middle;
+        }
+    }
+    return low;
+}
+
+double calc_arc_length(const ArcLengthTable* table, const ArcLengthCurve* curve, double t)
+{
+    const int n_total = table->n_spans * table->n_intervals;
+    int i;
+
+    if (t <= table->parameters[0]) {
+        return 0.0;
+    }
+    if (t >= table->parameters[n_total]) {
+        return get_arc_length(table);
+    }
+    i = find_interval(table->parameters, n_total, t, 0);
+    return table->lengths[i] + integrate_speed(curve, table->parameters[i], t);
+}
+
+/**
+ * Find the parameter of the length in the interval, starting from the linear interpolation of its ends.
+ * The Newton steps which would leave the bracket of the root are replaced by bisection.
+ */
+static double refine_parameter(const ArcLengthTable* table, const ArcLengthCurve* curve, int i, double s)
+{
+    const double begin = table->parameters[i];
+    double low = begin;
+    double high = table->parameters[i + 1];
+    double t, next, error;
+    Point derivative;
+    double speed;
+
+    if (table->interval_lengths[i] <= 0.0) {
+        return begin;
+    }
+    t = begin + (high - begin) * (s - table->lengths[i]) / table->interval_lengths[i];
+    for (int k = 0; k < MAX_NEWTON_ITERATIONS; ++k) {
+        error = table->lengths[i] + integrate_speed(curve, begin, t) - s;
+        if (fabs(error) < ARC_LENGTH_TOLERANCE) {
+            break;
+        }
+        if (error > 0.0) {
+            high = t;
+        }
+        else {
+            low = t;
+        }
+        derivative = curve->calc_derivative(curve->data, t);
+        speed = hypot(derivative.x, derivative.y);
+        next = (speed > 0.0) ? t - error / speed : low;
+        t = (next > low && next < high) ? next : 0.5 * (low + high);
+    }
+    return t;
+}
+
+/**
+ * Find the parameter of the length, searching from the interval of the previous length.
+ */
+static double find_parameter_from(const ArcLengthTable* table, const ArcLengthCurve* curve, double s, int* interval)
+{
+    const int n_total = table->n_spans * table->n_intervals;
+
+    if (s <= 0.0) {
+        *interval = 0;
+        return table->parameters[0];
+    }
+    if (s >= table->lengths[n_total]) {
+        *interval = n_total - 1;
+        return table->parameters[n_total];
+    }
+    if (s < table->lengths[*interval]) {
+        *interval = 0;
+    }
+    *interval = find_interval(table->lengths, n_total, s, *interval);
+    return refine_parameter(table, curve, *interval, s);
+}
+
+double find_arc_length_parameter(const ArcLengthTable* table, const ArcLengthCurve* curve, double s)
+{
+    int interval = 0;
+
+    return find_parameter_from(table, curve, s, &interval);
+}
+
+void find_arc_length_parameters(const ArcLengthTable* table, const ArcLengthCurve* curve,
+                                const double* lengths, int n_lengths, double* parameters)
+{
+    int interval = 0;
+
+    for (int k = 0; k < n_lengths; ++k) {
+        parameters[k] = find_parameter_from(table, curve, lengths[k], &interval);
+    }
+}
+
+void calc_equal_length_parameters(const ArcLengthTable* table, const ArcLengthCurve* curve, int n_samples, double* parameters)
+{
+    const double length = get_arc_length(table);
+    int interval = 0;
+
+    for (int k = 0; k < n_samples; ++k) {
+        parameters[k] = find_parameter_from(table, curve, (n_samples > 1) ? length * k / (n_samples - 1) : 0.0, &interval);
+    }
+}
+
+int calc_dash_parameters(const ArcLengthTable* table, const ArcLengthCurve* curve,
+                         const double* pattern, int n_pattern, double* parameters, int max_parameters)
+{
+    const double length = get_arc_length(table);
+    double pattern_length = 0.0;
+    double s = 0.0;
+    double end;
+    bool is_dash = true;
+    int interval = 0;
+    int n_parameters = 0;
+
+    for (int j = 0; j < n_pattern; ++j) {
+        pattern_length += pattern[j];
+    }
+    if (pattern_length <= 0.0) {
+        return 0;
+    }
+    // an odd pattern swaps the dashes and the gaps in every repetition
+    for (int j = 0; s < length; j = (j + 1) % n_pattern) {
+        end = fmin(s + pattern[j], length);
+        if (is_dash) {
+            if (n_parameters + 2 > max_parameters) {
+                break;
+            }
+            parameters[n_parameters++] = find_parameter_from(table, curve, s, &interval);
+            parameters[n_parameters++] = find_parameter_from(table, curve, end, &interval);
+        }
+        s = end;
+        is_dash = !is_dash;
+    }
+    return n_parameters;
+}
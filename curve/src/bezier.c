@@ -0,0 +1,244 @@
+#include "bezier.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the weights of the ratio evaluation are rescaled above this limit
+#define MAX_BERNSTEIN_WEIGHT 1e100
+// the power basis conversion loses about a digit per degree, see the benchmark
+#define MAX_POWER_BASIS_DEGREE 10
+// the binomial coefficients and 2^n times the coordinates stay below the largest double
+#define MAX_SCALED_BERNSTEIN_DEGREE 1000
+
+double calc_binomial_coefficient(int n, int k)
+{
+    double result = 1.0;
+
+    if (k < 0 || k > n) {
+        return 0.0;
+    }
+    if (k > n - k) {
+        k = n - k;
+    }
+    for (int i = 1; i <= k; ++i) {
+        result = result * (n - k + i) / i;
+    }
+    return result;
+}
+
+Point calc_bernstein_point(const Point* points, int n_points, double t)
+{
+    const int degree = n_points - 1;
+    double coefficient = 1.0;
+    double weight;
+    Point sum = {0.0, 0.0};
+
+    for (int i = 0; i <= degree; ++i) {
+        weight = coefficient * pow(t, i) * pow(1.0 - t, degree - i);
+        sum.x += weight * points[i].x;
+        sum.y += weight * points[i].y;
+        coefficient = coefficient * (degree - i) / (i + 1);
+    }
+    return sum;
+}
+
+void calc_de_casteljau_level(const Point* points, int n_points, double t, Point* level)
+{
+    for (int i = 0; i < n_points - 1; ++i) {
+        level[i].x = (1.0 - t) * points[i].x + t * points[i + 1].x;
+        level[i].y = (1.0 - t) * points[i].y + t * points[i + 1].y;
+    }
+}
+
+Point calc_de_casteljau_point(const Point* points, int n_points, double t, Point* work)
+{
+    memcpy(work, points, n_points * sizeof(Point));
+    for (int k = 1; k < n_points; ++k) {
+        calc_de_casteljau_level(work, n_points - k + 1, t, work);
+    }
+    return work[0];
+}
+
+/**
+ * The derivative is the degree times the difference of the two points of the last but one level.
+ */
+Point calc_bezier_derivative(const Point* points, int n_points, double t, Point* work)
+{
+    const int degree = n_points - 1;
+    Point derivative = {0.0, 0.0};
+
+    if (degree < 1) {
+        return derivative;
+    }
+    memcpy(work, points, n_points * sizeof(Point));
+    for (int k = 1; k < degree; ++k) {
+        for (int i = 0; i < n_points - k; ++i) {
+            work[i].x = (1.0 - t) * work[i].x + t * work[i + 1].x;
+            work[i].y = (1.0 - t) * work[i].y + t * work[i + 1].y;
+        }
+    }
+    derivative.x = degree * (work[1].x - work[0].x);
+    derivative.y = degree * (work[1].y - work[0].y);
+    return derivative;
+}
+
+/**
+ * The ratio of the consecutive Bernstein polynomials is C(n, i + 1) / C(n, i) * s,
+ * where s <= 1 is t / (1 - t) from the nearer end of the curve.
+ */
+Point calc_bezier_point(const Point* points, int n_points, double t)
+{
+    const int degree = n_points - 1;
+    const bool is_reversed = (t > 0.5);
+    const double ratio = is_reversed ? (1.0 - t) / t : t / (1.0 - t);
+    double weight = 1.0;
+    double weight_sum = 0.0;
+    Point sum = {0.0, 0.0};
+    Point result;
+    int i;
+
+    for (int k = 0; k <= degree; ++k) {
+        i = is_reversed ? degree - k : k;
+        sum.x += weight * points[i].x;
+        sum.y += weight * points[i].y;
+        weight_sum += weight;
+        weight *= ratio * (degree - k) / (k + 1);
+        if (weight > MAX_BERNSTEIN_WEIGHT) {
+            weight /= MAX_BERNSTEIN_WEIGHT;
+            weight_sum /= MAX_BERNSTEIN_WEIGHT;
+            sum.x /= MAX_BERNSTEIN_WEIGHT;
+            sum.y /= MAX_BERNSTEIN_WEIGHT;
+        }
+    }
+    result.x = sum.x / weight_sum;
+    result.y = sum.y / weight_sum;
+    return result;
+}
+
+/**
+ * The first points of the levels form the left polygon. The levels are calculated in place,
+ * so the last point of each level stays behind in the work array, where it forms the right polygon.
+ */
+void split_bezier_curve(const Point* points, int n_points, double t, Point* left, Point* right)
+{
+    memmove(right, points, n_points * sizeof(Point));
+    for (int k = 0; k < n_points; ++k) {
+        left[k] = right[0];
+        for (int i = 0; i < n_points - k - 1; ++i) {
+            right[i].x = (1.0 - t) * right[i].x + t * right[i + 1].x;
+            right[i].y = (1.0 - t) * right[i].y + t * right[i + 1].y;
+        }
+    }
+}
+
+bool create_bezier_polynomial(BezierPolynomial* polynomial, int capacity)
+{
+    polynomial->n_points = 0;
+    polynomial->evaluation = POWER_BASIS_EVALUATION;
+    polynomial->coefficients = (Point*)malloc(capacity * sizeof(Point));
+    if (polynomial->coefficients == NULL) {
+        printf("[ERROR] Unable to allocate memory for the polynomial form!\n");
+        return false;
+    }
+    return true;
+}
+
+void destroy_bezier_polynomial(BezierPolynomial* polynomial)
+{
+    free(polynomial->coefficients);
+}
+
+/**
+ * The power basis coefficients are C(n, j) times the j-th forward differences of the control points.
+ * The differences are calculated in place, so c[j] holds the j-th difference of the first control point.
+ */
+void convert_bezier_polynomial(BezierPolynomial* polynomial, const Point* points, int n_points, BezierEvaluation evaluation)
+{
+    const int degree = n_points - 1;
+    Point* c = polynomial->coefficients;
+    double binomial = 1.0;
+
+    polynomial->n_points = n_points;
+    polynomial->evaluation = evaluation;
+    memcpy(c, points, n_points * sizeof(Point));
+    if (evaluation == BERNSTEIN_RATIO_EVALUATION) {
+        return;
+    }
+    if (evaluation == POWER_BASIS_EVALUATION) {
+        for (int k = 1; k <= degree; ++k) {
+            for (int i = degree; i >= k; --i) {
+                c[i].x -= c[i - 1].x;
+                c[i].y -= c[i - 1].y;
+            }
+        }
+    }
+    for (int j = 0; j <= degree; ++j) {
+        c[j].x *= binomial;
+        c[j].y *= binomial;
+        binomial = binomial * (degree - j) / (j + 1);
+    }
+}
+
+void update_bezier_polynomial(BezierPolynomial* polynomial, const Point* points, int n_points)
+{
+    const int degree = n_points - 1;
+
+    if (degree <= MAX_POWER_BASIS_DEGREE) {
+        convert_bezier_polynomial(polynomial, points, n_points, POWER_BASIS_EVALUATION);
+    }
+    else if (degree <= MAX_SCALED_BERNSTEIN_DEGREE) {
+        convert_bezier_polynomial(polynomial, points, n_points, SCALED_BERNSTEIN_EVALUATION);
+    }
+    else {
+        convert_bezier_polynomial(polynomial, points, n_points, BERNSTEIN_RATIO_EVALUATION);
+    }
+}
+
+/**
+ * The scaled Bernstein form is (1 - t)^n * sum(C(n, i) * P_i * s^i) with s = t / (1 - t).
+ * The binomial coefficients are symmetric, so the same coefficients are read backwards
+ * with s = (1 - t) / t above the middle, which keeps s <= 1.
+ */
+Point calc_bezier_polynomial_point(const BezierPolynomial* polynomial, double t)
+{
+    const int degree = polynomial->n_points - 1;
+    const Point* c = polynomial->coefficients;
+    Point result;
+    double s, scale;
+
+    switch (polynomial->evaluation) {
+    case POWER_BASIS_EVALUATION:
+        result = c[degree];
+        for (int j = degree - 1; j >= 0; --j) {
+            result.x = result.x * t + c[j].x;
+            result.y = result.y * t + c[j].y;
+        }
+        return result;
+    case SCALED_BERNSTEIN_EVALUATION:
+        if (t <= 0.5) {
+            s = t / (1.0 - t);
+            result = c[degree];
+            for (int i = degree - 1; i >= 0; --i) {
+                result.x = result.x * s + c[i].x;
+                result.y = result.y * s + c[i].y;
+            }
+            scale = pow(1.0 - t, degree);
+        }
+        else {
+            s = (1.0 - t) / t;
+            result = c[0];
+            for (int i = 1; i <= degree; ++i) {
+                result.x = result.x * s + c[i].x;
+                result.y = result.y * s + c[i].y;
+            }
+            scale = pow(t, degree);
+        }
+        result.x *= scale;
+        result.y *= scale;
+        return result;
+    default:
+        return calc_bezier_point(c, polynomial->n_points, t);
+    }
+}
@@ -0,0 +1,172 @@
+#include "bspline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+bool create_b_spline(BSpline* spline, int degree, int n_points)
+{
+    if (degree < 1 || n_points <= degree) {
+        printf("[ERROR] Invalid B-spline: %d points are not enough for degree %d!\n", n_points, degree);
+        return false;
+    }
+    spline->degree = degree;
+    spline->n_points = n_points;
+    spline->n_knots = n_points + degree + 1;
+    spline->points = (Point*)malloc(n_points * sizeof(Point));
+    spline->knots = (double*)malloc(spline->n_knots * sizeof(double));
+    if (spline->points == NULL || spline->knots == NULL) {
+        printf("[ERROR] Unable to allocate memory for the B-spline!\n");
+        free(spline->points);
+        free(spline->knots);
+        return false;
+    }
+    return true;
+}
+
+void destroy_b_spline(BSpline* spline)
+{
+    free(spline->points);
+    free(spline->knots);
+}
+
+void set_clamped_knots(BSpline* spline)
+{
+    int n_spans = spline->n_points - spline->degree;
+
+    for (int i = 0; i < spline->n_knots; ++i) {
+        if (i <= spline->degree) {
+            spline->knots[i] = 0.0;
+        }
+        else if (i >= spline->n_points) {
+            spline->knots[i] = 1.0;
+        }
+        else {
+            spline->knots[i] = (double)(i - spline->degree) / n_spans;
+        }
+    }
+}
+
+int find_knot_span(const BSpline* spline, double u)
+{
+    int low = spline->degree;
+    int high = spline->n_points;
+    int middle;
+
+    if (u >= spline->knots[high]) {
+        return high - 1;
+    }
+    if (u <= spline->knots[low]) {
+        return low;
+    }
+    while (high - low > 1) {
+        middle = (low + high) / 2;
+        if (u < spline->knots[middle]) {
+            high = middle;
+        }
+        else {
+            low = middle;
+        }
+    }
+    return low;
+}
+
+void get_domain(const BSpline* spline, double* begin, double* end)
+{
+    *begin = spline->knots[spline->degree];
+    *end = spline->knots[spline->n_points];
+}
+
+void get_point_spans(const BSpline* spline, int index, int* first, int* last)
+{
+    const int n_spans = spline->n_points - spline->degree;
+
+    *first = (index - spline->degree > 0) ? index - spline->degree : 0;
+    *last = (index < n_spans - 1) ? index : n_spans - 1;
+}
+
+void calc_basis_functions(const BSpline* spline, int span, double u, double* values, double* left, double* right)
+{
+    const double* knots = spline->knots;
+    double saved, term;
+
+    values[0] = 1.0;
+    for (int j = 1; j <= spline->degree; ++j) {
+        left[j] = u - knots[span + 1 - j];
+        right[j] = knots[span + j] - u;
+        saved = 0.0;
+        for (int r = 0; r < j; ++r) {
+            term = (right[r + 1] + left[j - r] != 0.0) ? values[r] / (right[r + 1] + left[j - r]) : 0.0;
+            values[r] = saved + right[r + 1] * term;
+            saved = left[j - r] * term;
+        }
+        values[j] = saved;
+    }
+}
+
+Point de_boor(const BSpline* spline, double u, Point* work)
+{
+    const int p = spline->degree;
+    const double* knots = spline->knots;
+    Point* d = work;
+    int span = find_knot_span(spline, u);
+    double alpha;
+
+    for (int j = 0; j <= p; ++j) {
+        d[j] = spline->points[span - p + j];
+    }
+    for (int r = 1; r <= p; ++r) {
+        for (int j = p; j >= r; --j) {
+            int i = span - p + j;
+            double denominator = knots[i + p - r + 1] - knots[i];
+            alpha = (denominator != 0.0) ? (u - knots[i]) / denominator : 0.0;
+            d[j].x = (1.0 - alpha) * d[j - 1].x + alpha * d[j].x;
+            d[j].y = (1.0 - alpha) * d[j - 1].y + alpha * d[j].y;
+        }
+    }
+    return d[p];
+}
+
+Point calc_cox_de_boor_point(const BSpline* spline, double u, double* basis)
+{
+    const int p = spline->degree;
+    double* values = basis;
+    int span = find_knot_span(spline, u);
+    Point result = {0.0, 0.0};
+
+    calc_basis_functions(spline, span, u, values, &values[p + 1], &values[2 * (p + 1)]);
+    for (int j = 0; j <= p; ++j) {
+        result.x += values[j] * spline->points[span - p + j].x;
+        result.y += values[j] * spline->points[span - p + j].y;
+    }
+    return result;
+}
+
+/**
+ * The derivative is a degree - 1 B-spline of the control points p * (P_i+1 - P_i) / (u_i+p+1 - u_i+1)
+ * on the knot vector without its first and last knots.
+ */
+Point calc_b_spline_derivative(const BSpline* spline, double u, Point* work)
+{
+    const int p = spline->degree;
+    const double* knots = spline->knots;
+    Point* d = work;
+    int span = find_knot_span(spline, u);
+    double length, alpha;
+
+    for (int j = 0; j < p; ++j) {
+        int i = span - p + j;
+        length = knots[i + p + 1] - knots[i + 1];
+        d[j].x = (length > 0.0) ? p * (spline->points[i + 1].x - spline->points[i].x) / length : 0.0;
+        d[j].y = (length > 0.0) ? p * (spline->points[i + 1].y - spline->points[i].y) / length : 0.0;
+    }
+    for (int r = 1; r < p; ++r) {
+        for (int j = p - 1; j >= r; --j) {
+            int i = span - p + j;
+            double denominator = knots[i + p - r + 1] - knots[i + 1];
+            alpha = (denominator != 0.0) ? (u - knots[i + 1]) / denominator : 0.0;
+            d[j].x = (1.0 - alpha) * d[j - 1].x + alpha * d[j].x;
+            d[j].y = (1.0 - alpha) * d[j - 1].y + alpha * d[j].y;
+        }
+    }
+    return d[p - 1];
+}
@@ -0,0 +1,637 @@
+#include "closest.h"
+#include "bezier.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a subdivision of MAX_CLOSEST_POINT_DEPTH levels has at most 2^MAX_CLOSEST_POINT_DEPTH pieces
+#define MAX_CLOSEST_POINT_DEPTH 8
+#define MAX_CLOSEST_POINT_PIECES (1 << MAX_CLOSEST_POINT_DEPTH)
+// the inner control points of a flat piece are within this fraction of its chord length from the chord
+#define CLOSEST_POINT_FLATNESS 0.05
+// the lower bounds of this many queries are calculated together
+#define CLOSEST_POINT_BATCH 64
+// the candidate pieces are split at most this many times for a query
+#define MAX_ISOLATION_DEPTH 16
+#define MAX_NEWTON_ITERATIONS 32
+#define PARAMETER_TOLERANCE 1e-12
+
+/**
+ * Closest point found so far for a query
+ */
+typedef struct ClosestPointResult
+{
+    double distance;
+    double parameter;
+    Point point;
+} ClosestPointResult;
+
+/**
+ * Work arrays of the queries, which are allocated once per batch call
+ */
+typedef struct ClosestPointWork
+{
+    double* bounds;
+    double* coefficients;
+    Point* pieces;
+    Point* points;
+} ClosestPointWork;
+
+static double calc_squared_distance(Point a, Point b)
+{
+    return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+static double calc_segment_distance(Point a, Point b, Point p)
+{
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double length = dx * dx + dy * dy;
+    double t = (length > 0.0) ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length : 0.0;
+
+    t = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+    return hypot(a.x + t * dx - p.x, a.y + t * dy - p.y);
+}
+
+/**
+ * Check whether the inner control points are within the flatness tolerance of the chord,
+ * and their projections onto the chord are in order, so that the piece does not turn back.
+ */
+static bool is_flat_piece(const Point* points, int n_points)
+{
+    const Point a = points[0];
+    const Point b = points[n_points - 1];
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double length = dx * dx + dy * dy;
+    const double tolerance = CLOSEST_POINT_FLATNESS * CLOSEST_POINT_FLATNESS * length;
+    double previous = 0.0;
+    double t;
+
+    for (int i = 1; i < n_points - 1; ++i) {
+        t = (length > 0.0) ? ((points[i].x - a.x) * dx + (points[i].y - a.y) * dy) / length : 0.0;
+        if (t < previous || t > 1.0 || calc_squared_distance(points[i], (Point){a.x + t * dx, a.y + t * dy}) > tolerance) {
+            return false;
+        }
+        previous = t;
+    }
+    return true;
+}
+
+/**
+ * Evaluate the point, the first and the second derivatives of the piece with the de Casteljau algorithm.
+ * The second derivative comes from the three points of the last but two level, and the first one from the two points
+ * of the last but one level. The work array has room for n_points points.
+ */
+static Point calc_piece_derivatives(const Point* points, int n_points, double s, Point* work, Point* first, Point* second)
+{
+    const int degree = n_points - 1;
+    Point result;
+
+    memcpy(work, points, n_points * sizeof(Point));
+    for (int k = 1; k < degree - 1; ++k) {
+        for (int i = 0; i < n_points - k; ++i) {
+            work[i].x = (1.0 - s) * work[i].x + s * work[i + 1].x;
+            work[i].y = (1.0 - s) * work[i].y + s * work[i + 1].y;
+        }
+    }
+    if (degree >= 2) {
+        second->x = degree * (degree - 1) * (work[0].x - 2.0 * work[1].x + work[2].x);
+        second->y = degree * (degree - 1) * (work[0].y - 2.0 * work[1].y + work[2].y);
+        for (int i = 0; i < 2; ++i) {
+            work[i].x = (1.0 - s) * work[i].x + s * work[i + 1].x;
+            work[i].y = (1.0 - s) * work[i].y + s * work[i + 1].y;
+        }
+    }
+    else {
+        second->x = 0.0;
+        second->y = 0.0;
+    }
+    first->x = degree * (work[1].x - work[0].x);
+    first->y = degree * (work[1].y - work[0].y);
+    result.x = (1.0 - s) * work[0].x + s * work[1].x;
+    result.y = (1.0 - s) * work[0].y + s * work[1].y;
+    return result;
+}
+
+/**
+ * Find the closest point of the piece to the query with Newton iterations on f(s) = C'(s) . (C(s) - q) = 0.
+ * The root is bracketed by the signs of f, and the steps which would leave the bracket are replaced by bisection.
+ * Where the second order term makes the step ascend, it is dropped for the Gauss-Newton step.
+ */
+static double find_piece_root(const Point* points, int n_points, Point query, Point* work, Point* closest)
+{
+    const Point a = points[0];
+    const Point b = points[n_points - 1];
+    const double length = calc_squared_distance(a, b);
+    double s = (length > 0.0) ? ((query.x - a.x) * (b.x - a.x) + (query.y - a.y) * (b.y - a.y)) / length : 0.5;
+    double low = 0.0;
+    double high = 1.0;
+    double next, f, df, curvature;
+    Point first, second;
+
+    s = (s < 0.0) ? 0.0 : ((s > 1.0) ? 1.0 : s);
+    for (int k = 0; k < MAX_NEWTON_ITERATIONS; ++k) {
+        *closest = calc_piece_derivatives(points, n_points, s, work, &first, &second);
+        f = first.x * (closest->x - query.x) + first.y * (closest->y - query.y);
+        df = first.x * first.x + first.y * first.y;
+        curvature = second.x * (closest->x - query.x) + second.y * (closest->y - query.y);
+        if (df + curvature > 0.0) {
+            df += curvature;
+        }
+        if (f > 0.0) {
+            high = s;
+        }
+        else if (f < 0.0) {
+            low = s;
+        }
+        else {
+            break;
+        }
+        next = (df > 0.0) ? s - f / df : low;
+        if (next < low || next > high) {
+            next = 0.5 * (low + high);
+        }
+        // the point of the last step is kept, it is within the tolerance of the root
+        if (fabs(next - s) < PARAMETER_TOLERANCE) {
+            break;
+        }
+        s = next;
+    }
+    return s;
+}
+
+static void calc_piece_bounds(ClosestPointCurve* curve, int index)
+{
+    const Point* piece = &(curve->points[index * curve->n_points]);
+    double length;
+
+    curve->min_xs[index] = curve->max_xs[index] = piece[0].x;
+    curve->min_ys[index] = curve->max_ys[index] = piece[0].y;
+    for (int i = 1; i < curve->n_points; ++i) {
+        curve->min_xs[index] = fmin(curve->min_xs[index], piece[i].x);
+        curve->min_ys[index] = fmin(curve->min_ys[index], piece[i].y);
+        curve->max_xs[index] = fmax(curve->max_xs[index], piece[i].x);
+        curve->max_ys[index] = fmax(curve->max_ys[index], piece[i].y);
+    }
+    curve->end_xs[index] = piece[0].x;
+    curve->end_ys[index] = piece[0].y;
+    curve->chord_xs[index] = piece[curve->n_points - 1].x - piece[0].x;
+    curve->chord_ys[index] = piece[curve->n_points - 1].y - piece[0].y;
+    length = curve->chord_xs[index] * curve->chord_xs[index] + curve->chord_ys[index] * curve->chord_ys[index];
+    curve->inverse_lengths[index] = (length > 0.0) ? 1.0 / length : 0.0;
+    curve->radii[index] = 0.0;
+    for (int i = 1; i < curve->n_points - 1; ++i) {
+        curve->radii[index] = fmax(curve->radii[index], calc_segment_distance(piece[0], piece[curve->n_points - 1], piece[i]));
+    }
+}
+
+bool create_closest_point_curve(ClosestPointCurve* curve, int capacity)
+{
+    curve->n_points = 0;
+    curve->capacity = capacity;
+    curve->n_pieces = 0;
+    curve->parameters = (double*)malloc((MAX_CLOSEST_POINT_PIECES + 1) * sizeof(double));
+    curve->points = (Point*)malloc(MAX_CLOSEST_POINT_PIECES * capacity * sizeof(Point));
+    curve->stack = (Point*)malloc((MAX_CLOSEST_POINT_DEPTH + 1) * capacity * sizeof(Point));
+    curve->product_weights = (double*)malloc(capacity * capacity * sizeof(double));
+    curve->log_binomials = (double*)malloc(4 * capacity * sizeof(double));
+    curve->min_xs = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    curve->min_ys = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    curve->max_xs = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    curve->max_ys = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    curve->end_xs = (double*)malloc((MAX_CLOSEST_POINT_PIECES + 1) * sizeof(double));
+    curve->end_ys = (double*)malloc((MAX_CLOSEST_POINT_PIECES + 1) * sizeof(double));
+    curve->chord_xs = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    curve->chord_ys = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    curve->inverse_lengths = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    curve->radii = (double*)malloc(MAX_CLOSEST_POINT_PIECES * sizeof(double));
+    if (curve->parameters == NULL || curve->points == NULL || curve->stack == NULL || curve->product_weights == NULL
+        || curve->log_binomials == NULL
+        || curve->min_xs == NULL || curve->min_ys == NULL || curve->max_xs == NULL || curve->max_ys == NULL
+        || curve->end_xs == NULL || curve->end_ys == NULL
+        || curve->chord_xs == NULL || curve->chord_ys == NULL
+        || curve->inverse_lengths == NULL || curve->radii == NULL) {
+        printf("[ERROR] Unable to allocate memory for the closest point curve!\n");
+        destroy_closest_point_curve(curve);
+        return false;
+    }
+    return true;
+}
+
+void destroy_closest_point_curve(ClosestPointCurve* curve)
+{
+    free(curve->parameters);
+    free(curve->points);
+    free(curve->stack);
+    free(curve->product_weights);
+    free(curve->log_binomials);
+    free(curve->min_xs);
+    free(curve->min_ys);
+    free(curve->max_xs);
+    free(curve->max_ys);
+    free(curve->end_xs);
+    free(curve->end_ys);
+    free(curve->chord_xs);
+    free(curve->chord_ys);
+    free(curve->inverse_lengths);
+    free(curve->radii);
+    curve->parameters = NULL;
+    curve->points = NULL;
+    curve->stack = NULL;
+    curve->product_weights = NULL;
+    curve->log_binomials = NULL;
+    curve->min_xs = NULL;
+    curve->min_ys = NULL;
+    curve->max_xs = NULL;
+    curve->max_ys = NULL;
+    curve->end_xs = NULL;
+    curve->end_ys = NULL;
+    curve->chord_xs = NULL;
+    curve->chord_ys = NULL;
+    curve->inverse_lengths = NULL;
+    curve->radii = NULL;
+}
+
+static bool grow_closest_point_curve(ClosestPointCurve* curve, int capacity)
+{
+    Point* points = (Point*)realloc(curve->points, MAX_CLOSEST_POINT_PIECES * capacity * sizeof(Point));
+    Point* stack;
+    double* weights;
+
+    if (points == NULL) {
+        printf("[ERROR] Unable to allocate memory for the closest point curve!\n");
+        return false;
+    }
+    curve->points = points;
+    stack = (Point*)realloc(curve->stack, (MAX_CLOSEST_POINT_DEPTH + 1) * capacity * sizeof(Point));
+    if (stack == NULL) {
+        printf("[ERROR] Unable to allocate memory for the closest point curve!\n");
+        return false;
+    }
+    curve->stack = stack;
+    weights = (double*)realloc(curve->product_weights, capacity * capacity * sizeof(double));
+    if (weights == NULL) {
+        printf("[ERROR] Unable to allocate memory for the closest point curve!\n");
+        return false;
+    }
+    curve->product_weights = weights;
+    weights = (double*)realloc(curve->log_binomials, 4 * capacity * sizeof(double));
+    if (weights == NULL) {
+        printf("[ERROR] Unable to allocate memory for the closest point curve!\n");
+        return false;
+    }
+    curve->log_binomials = weights;
+    curve->capacity = capacity;
+    return true;
+}
+
+/**
+ * Fill the row of the logarithms of the binomial coefficients C(n, 0) ... C(n, n).
+ */
+static void calc_log_binomials(int n, double* log_binomials)
+{
+    log_binomials[0] = 0.0;
+    for (int k = 1; k <= n; ++k) {
+        log_binomials[k] = log_binomials[k - 1] + log((double)(n - k + 1) / k);
+    }
+}
+
+/**
+ * Calculate the weights of the products of the Bernstein polynomials.
+ *
+ * C'(s) . (C(s) - q) is the sum of B_i^(n-1)(s) B_j^n(s) (P_i+1 - P_i) . (P_j - q) up to the factor n,
+ * and the product of the Bernstein polynomials is C(n-1, i) C(n, j) / C(2n-1, i+j) B_i+j^(2n-1)(s).
+ * The weights are at most 1, but C(2n-1, i+j) overflows above 513 control points, so the weights are combined
+ * from the rows of the logarithms in O(n) logarithms and O(n^2) exponentials, and the negligible ones underflow to zero.
+ */
+static void calc_product_weights(ClosestPointCurve* curve)
+{
+    const int n_points = curve->n_points;
+    double* first = curve->log_binomials;
+    double* second = &(first[n_points - 1]);
+    double* product = &(second[n_points]);
+
+    calc_log_binomials(n_points - 2, first);
+    calc_log_binomials(n_points - 1, second);
+    calc_log_binomials(2 * n_points - 3, product);
+    for (int i = 0; i < n_points - 1; ++i) {
+        for (int j = 0; j < n_points; ++j) {
+            curve->product_weights[i * n_points + j] = exp(first[i] + second[j] - product[i + j]);
+        }
+    }
+}
+
+/**
+ * The pending pieces are kept on a stack, which holds at most one piece per subdivision level,
+ * and the right half goes below the left one, so that the pieces are output in order.
+ */
+bool update_closest_point_curve(ClosestPointCurve* curve, const Point* points, int n_points)
+{
+    double begins[MAX_CLOSEST_POINT_DEPTH + 1];
+    double ends[MAX_CLOSEST_POINT_DEPTH + 1];
+    int depths[MAX_CLOSEST_POINT_DEPTH + 1];
+    int n_pending;
+    Point* piece;
+    int depth;
+    int last;
+
+    if (n_points > curve->capacity && !grow_closest_point_curve(curve, n_points)) {
+        return false;
+    }
+    curve->n_points = n_points;
+    curve->n_pieces = 0;
+    memcpy(curve->stack, points, n_points * sizeof(Point));
+    begins[0] = 0.0;
+    ends[0] = 1.0;
+    depths[0] = 0;
+    n_pending = 1;
+    while (n_pending > 0) {
+        last = n_pending - 1;
+        piece = &(curve->stack[last * n_points]);
+        depth = depths[last];
+        if (depth == MAX_CLOSEST_POINT_DEPTH || is_flat_piece(piece, n_points)) {
+            memcpy(&(curve->points[curve->n_pieces * n_points]), piece, n_points * sizeof(Point));
+            curve->parameters[curve->n_pieces] = begins[last];
+            curve->parameters[curve->n_pieces + 1] = ends[last];
+            calc_piece_bounds(curve, curve->n_pieces);
+            ++curve->n_pieces;
+            --n_pending;
+            continue;
+        }
+        split_bezier_curve(piece, n_points, 0.5, &(curve->stack[n_pending * n_points]), piece);
+        begins[n_pending] = begins[last];
+        ends[n_pending] = 0.5 * (begins[last] + ends[last]);
+        begins[last] = ends[n_pending];
+        depths[last] = depth + 1;
+        depths[n_pending] = depth + 1;
+        ++n_pending;
+    }
+    curve->end_xs[curve->n_pieces] = points[n_points - 1].x;
+    curve->end_ys[curve->n_pieces] = points[n_points - 1].y;
+
+    calc_product_weights(curve);
+    return true;
+}
+
+/**
+ * Calculate the lower bounds of the squared distances of the query from all pieces.
+ * The bound is the larger of the distances from the box and from the capsule of the piece.
+ * The loop has no branches, and the comparisons are written out instead of fmin and fmax,
+ * which are library calls because of their NaN semantics, so that it compiles to vector instructions.
+ */
+static void calc_lower_bounds(const ClosestPointCurve* curve, Point query, double* bounds)
+{
+    double dx, dy, box_distance, t, distance;
+
+    for (int k = 0; k < curve->n_pieces; ++k) {
+        dx = curve->min_xs[k] - query.x;
+        dx = (query.x - curve->max_xs[k] > dx) ? query.x - curve->max_xs[k] : dx;
+        dx = (dx > 0.0) ? dx : 0.0;
+        dy = curve->min_ys[k] - query.y;
+        dy = (query.y - curve->max_ys[k] > dy) ? query.y - curve->max_ys[k] : dy;
+        dy = (dy > 0.0) ? dy : 0.0;
+        box_distance = dx * dx + dy * dy;
+        t = ((query.x - curve->end_xs[k]) * curve->chord_xs[k] + (query.y - curve->end_ys[k]) * curve->chord_ys[k])
+            * curve->inverse_lengths[k];
+        t = (t > 0.0) ? ((t < 1.0) ? t : 1.0) : 0.0;
+        dx = curve->end_xs[k] + t * curve->chord_xs[k] - query.x;
+        dy = curve->end_ys[k] + t * curve->chord_ys[k] - query.y;
+        distance = sqrt(dx * dx + dy * dy) - curve->radii[k];
+        distance = (distance > 0.0) ? distance * distance : 0.0;
+        bounds[k] = (distance > box_distance) ? distance : box_distance;
+    }
+}
+
+/**
+ * Find the closest end point of the pieces, which is the initial upper bound of the distance.
+ */
+static int find_closest_end(const ClosestPointCurve* curve, Point query, double* distance)
+{
+    int index = 0;
+    double dx, dy, d;
+
+    *distance = INFINITY;
+    for (int k = 0; k <= curve->n_pieces; ++k) {
+        dx = curve->end_xs[k] - query.x;
+        dy = curve->end_ys[k] - query.y;
+        d = dx * dx + dy * dy;
+        if (d < *distance) {
+            *distance = d;
+            index = k;
+        }
+    }
+    return index;
+}
+
+/**
+ * Count the sign changes of the Bernstein coefficients of f(s) = C'(s) . (C(s) - q) on the piece.
+ * The first nonzero coefficient is negative when f starts decreasing the distance.
+ */
+static int count_sign_changes(const ClosestPointCurve* curve, const Point* piece, Point query,
+                              double* coefficients, bool* is_first_negative)
+{
+    const int n_points = curve->n_points;
+    const int n_coefficients = 2 * n_points - 2;
+    double dx, dy;
+    int n_changes = 0;
+    int sign = 0;
+
+    for (int k = 0; k < n_coefficients; ++k) {
+        coefficients[k] = 0.0;
+    }
+    for (int i = 0; i < n_points - 1; ++i) {
+        dx = piece[i + 1].x - piece[i].x;
+        dy = piece[i + 1].y - piece[i].y;
+        for (int j = 0; j < n_points; ++j) {
+            coefficients[i + j] += curve->product_weights[i * n_points + j]
+                * (dx * (piece[j].x - query.x) + dy * (piece[j].y - query.y));
+        }
+    }
+    *is_first_negative = false;
+    for (int k = 0; k < n_coefficients; ++k) {
+        if (coefficients[k] == 0.0) {
+            continue;
+        }
+        if (sign == 0) {
+            *is_first_negative = (coefficients[k] < 0.0);
+        }
+        else if ((coefficients[k] < 0.0) != (sign < 0)) {
+            ++n_changes;
+        }
+        sign = (coefficients[k] < 0.0) ? -1 : 1;
+    }
+    return n_changes;
+}
+
+static double calc_box_distance(const Point* piece, int n_points, Point query)
+{
+    double min_x = piece[0].x, max_x = piece[0].x;
+    double min_y = piece[0].y, max_y = piece[0].y;
+    double dx, dy;
+
+    for (int i = 1; i < n_points; ++i) {
+        min_x = fmin(min_x, piece[i].x);
+        max_x = fmax(max_x, piece[i].x);
+        min_y = fmin(min_y, piece[i].y);
+        max_y = fmax(max_y, piece[i].y);
+    }
+    dx = fmax(fmax(min_x - query.x, query.x - max_x), 0.0);
+    dy = fmax(fmax(min_y - query.y, query.y - max_y), 0.0);
+    return dx * dx + dy * dy;
+}
+
+static void update_closest_point_result(ClosestPointResult* result, Point point, double parameter, Point query)
+{
+    double distance = calc_squared_distance(point, query);
+
+    if (distance < result->distance) {
+        result->distance = distance;
+        result->parameter = parameter;
+        result->point = point;
+    }
+}
+
+/**
+ * Find the closest point of the candidate piece, if it is closer than the result.
+ *
+ * The Bernstein coefficients of f(s) = C'(s) . (C(s) - q) change sign at least as many times as f has roots,
+ * so without a change from negative to positive there is no interior minimum, and the closest point is an end point,
+ * which is already among the upper bounds. A single change isolates the minimum for the Newton iterations,
+ * and the other pieces are split in half, until their boxes are farther than the result.
+ */
+static void isolate_closest_point(const ClosestPointCurve* curve, int index, Point query,
+                                  ClosestPointWork* work, ClosestPointResult* result)
+{
+    const int n_points = curve->n_points;
+    double begins[MAX_ISOLATION_DEPTH + 1];
+    double ends[MAX_ISOLATION_DEPTH + 1];
+    int depths[MAX_ISOLATION_DEPTH + 1];
+    int n_pending;
+    int n_changes;
+    bool is_first_negative;
+    bool is_left_pruned, is_right_pruned;
+    Point* piece;
+    Point* left;
+    Point point;
+    double s, middle;
+    int last;
+
+    memcpy(work->pieces, &(curve->points[index * n_points]), n_points * sizeof(Point));
+    begins[0] = curve->parameters[index];
+    ends[0] = curve->parameters[index + 1];
+    depths[0] = 0;
+    n_pending = 1;
+    while (n_pending > 0) {
+        last = n_pending - 1;
+        piece = &(work->pieces[last * n_points]);
+        n_changes = count_sign_changes(curve, piece, query, work->coefficients, &is_first_negative);
+        if (n_changes == 0 || (n_changes == 1 && !is_first_negative)) {
+            --n_pending;
+            continue;
+        }
+        if (n_changes == 1 || depths[last] == MAX_ISOLATION_DEPTH) {
+            s = find_piece_root(piece, n_points, query, work->points, &point);
+            update_closest_point_result(result, point, begins[last] + s * (ends[last] - begins[last]), query);
+            --n_pending;
+            continue;
+        }
+        // the right half stays in place, and the left one is pushed above it
+        left = &(work->pieces[n_pending * n_points]);
+        split_bezier_curve(piece, n_points, 0.5, left, piece);
+        middle = 0.5 * (begins[last] + ends[last]);
+        update_closest_point_result(result, piece[0], middle, query);
+        begins[n_pending] = begins[last];
+        ends[n_pending] = middle;
+        depths[n_pending] = depths[last] + 1;
+        begins[last] = middle;
+        depths[last] = depths[last] + 1;
+        is_right_pruned = (calc_box_distance(piece, n_points, query) >= result->distance);
+        is_left_pruned = (calc_box_distance(left, n_points, query) >= result->distance);
+        if (is_right_pruned && is_left_pruned) {
+            --n_pending;
+        }
+        else if (is_right_pruned) {
+            // the left half replaces the pruned right one
+            memcpy(piece, left, n_points * sizeof(Point));
+            begins[last] = begins[n_pending];
+            ends[last] = middle;
+        }
+        else if (!is_left_pruned) {
+            ++n_pending;
+        }
+    }
+}
+
+static double find_closest_point(const ClosestPointCurve* curve, Point query, double* bounds,
+                                 ClosestPointWork* work, Point* closest)
+{
+    ClosestPointResult result;
+    int index;
+
+    index = find_closest_end(curve, query, &(result.distance));
+    result.parameter = curve->parameters[index];
+    result.point.x = curve->end_xs[index];
+    result.point.y = curve->end_ys[index];
+    while (true) {
+        // the next candidate is the piece with the smallest lower bound, which may still be closer
+        index = -1;
+        for (int k = 0; k < curve->n_pieces; ++k) {
+            if (bounds[k] < result.distance && (index < 0 || bounds[k] < bounds[index])) {
+                index = k;
+            }
+        }
+        if (index < 0) {
+            break;
+        }
+        bounds[index] = INFINITY;
+        isolate_closest_point(curve, index, query, work, &result);
+    }
+    *closest = result.point;
+    return result.parameter;
+}
+
+bool find_closest_points(const ClosestPointCurve* curve, const Point* queries, int n_queries,
+                         double* parameters, Point* closest_points)
+{
+    ClosestPointWork work;
+    Point closest;
+    int n_batch;
+
+    if (curve->n_pieces == 0 || n_queries <= 0) {
+        return true;
+    }
+    work.bounds = (double*)malloc(CLOSEST_POINT_BATCH * curve->n_pieces * sizeof(double));
+    work.coefficients = (double*)malloc(2 * curve->n_points * sizeof(double));
+    work.pieces = (Point*)malloc((MAX_ISOLATION_DEPTH + 1) * curve->n_points * sizeof(Point));
+    work.points = (Point*)malloc(curve->n_points * sizeof(Point));
+    if (work.bounds == NULL || work.coefficients == NULL || work.pieces == NULL || work.points == NULL) {
+        printf("[ERROR] Unable to allocate memory for the closest point queries!\n");
+        free(work.bounds);
+        free(work.coefficients);
+        free(work.pieces);
+        free(work.points);
+        return false;
+    }
+    for (int begin = 0; begin < n_queries; begin += CLOSEST_POINT_BATCH) {
+        n_batch = (n_queries - begin < CLOSEST_POINT_BATCH) ? n_queries - begin : CLOSEST_POINT_BATCH;
+        // the bounds of the whole batch are calculated first, while the boxes are in the cache
+        for (int q = 0; q < n_batch; ++q) {
+            calc_lower_bounds(curve, queries[begin + q], &(work.bounds[q * curve->n_pieces]));
+        }
+        for (int q = 0; q < n_batch; ++q) {
+            parameters[begin + q] = find_closest_point(curve, queries[begin + q], &(work.bounds[q * curve->n_pieces]),
+                                                       &work, &closest);
+            if (closest_points != NULL) {
+                closest_points[begin + q] = closest;
+            }
+        }
+    }
+    free(work.bounds);
+    free(work.coefficients);
+    free(work.pieces);
+    free(work.points);
+    return true;
+}
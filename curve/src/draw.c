@@ -0,0 +1,155 @@
+#include "draw.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// a cross is two rectangles of four vertices and two triangles
+#define N_CROSS_VERTICES 8
+#define N_CROSS_INDICES 12
+
+void init_draw_buffer(DrawBuffer* buffer)
+{
+    buffer->point_capacity = 0;
+    buffer->cross_capacity = 0;
+    buffer->points = NULL;
+    buffer->vertices = NULL;
+    buffer->indices = NULL;
+}
+
+void destroy_draw_buffer(DrawBuffer* buffer)
+{
+    free(buffer->points);
+    free(buffer->vertices);
+    free(buffer->indices);
+    init_draw_buffer(buffer);
+}
+
+/**
+ * Grow the float points to at least the given number, doubling the capacity.
+ */
+static bool reserve_points(DrawBuffer* buffer, int n_points)
+{
+    int capacity = (buffer->point_capacity > 0) ? buffer->point_capacity : 64;
+    SDL_FPoint* points;
+
+    if (n_points <= buffer->point_capacity) {
+        return true;
+    }
+    while (capacity < n_points) {
+        capacity *= 2;
+    }
+    points = (SDL_FPoint*)realloc(buffer->points, capacity * sizeof(SDL_FPoint));
+    if (points == NULL) {
+        printf("[ERROR] Unable to allocate memory for the points of the renderer!\n");
+        return false;
+    }
+    buffer->points = points;
+    buffer->point_capacity = capacity;
+    return true;
+}
+
+/**
+ * Grow the vertices of the crosses to at least the given number of crosses, doubling the capacity.
+ * The indices are the same for every cross apart from the offset of its vertices, so they are only set here.
+ */
+static bool reserve_crosses(DrawBuffer* buffer, int n_crosses)
+{
+    static const int CROSS_INDICES[N_CROSS_INDICES] = {0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7};
+    int capacity = (buffer->cross_capacity > 0) ? buffer->cross_capacity : 16;
+    SDL_Vertex* vertices;
+    int* indices;
+
+    if (n_crosses <= buffer->cross_capacity) {
+        return true;
+    }
+    while (capacity < n_crosses) {
+        capacity *= 2;
+    }
+    vertices = (SDL_Vertex*)realloc(buffer->vertices, capacity * N_CROSS_VERTICES * sizeof(SDL_Vertex));
+    if (vertices == NULL) {
+        printf("[ERROR] Unable to allocate memory for the control points!\n");
+        return false;
+    }
+    buffer->vertices = vertices;
+    indices = (int*)realloc(buffer->indices, capacity * N_CROSS_INDICES * sizeof(int));
+    if (indices == NULL) {
+        printf("[ERROR] Unable to allocate memory for the control points!\n");
+        return false;
+    }
+    buffer->indices = indices;
+    for (int i = buffer->cross_capacity; i < capacity; ++i) {
+        for (int k = 0; k < N_CROSS_INDICES; ++k) {
+            indices[i * N_CROSS_INDICES + k] = i * N_CROSS_VERTICES + CROSS_INDICES[k];
+        }
+    }
+    buffer->cross_capacity = capacity;
+    return true;
+}
+
+/**
+ * Convert the points to the float points of the buffer.
+ */
+static bool convert_points(DrawBuffer* buffer, const Point* points, int n_points)
+{
+    if (!reserve_points(buffer, n_points)) {
+        return false;
+    }
+    for (int i = 0; i < n_points; ++i) {
+        buffer->points[i].x = (float)points[i].x;
+        buffer->points[i].y = (float)points[i].y;
+    }
+    return true;
+}
+
+void draw_polyline(SDL_Renderer* renderer, DrawBuffer* buffer, const Point* points, int n_points)
+{
+    if (n_points < 2 || !convert_points(buffer, points, n_points)) {
+        return;
+    }
+    SDL_RenderDrawLinesF(renderer, buffer->points, n_points);
+}
+
+void draw_points(SDL_Renderer* renderer, DrawBuffer* buffer, const Point* points, int n_points)
+{
+    if (n_points < 1 || !convert_points(buffer, points, n_points)) {
+        return;
+    }
+    SDL_RenderDrawPointsF(renderer, buffer->points, n_points);
+}
+
+static void set_rectangle(SDL_Vertex* vertices, float left, float top, float right, float bottom, SDL_Color color)
+{
+    const float xs[4] = {left, right, right, left};
+    const float ys[4] = {top, top, bottom, bottom};
+
+    for (int k = 0; k < 4; ++k) {
+        vertices[k].position.x = xs[k];
+        vertices[k].position.y = ys[k];
+        vertices[k].color = color;
+        vertices[k].tex_coord.x = 0.0f;
+        vertices[k].tex_coord.y = 0.0f;
+    }
+}
+
+void draw_control_points(SDL_Renderer* renderer, DrawBuffer* buffer, const Point* points, int n_points, double radius)
+{
+    const float r = (float)(int)radius;
+    SDL_Color color;
+    SDL_Vertex* cross;
+    float x, y;
+
+    if (n_points < 1 || !reserve_crosses(buffer, n_points)) {
+        return;
+    }
+    // the geometry has its own vertex colors
+    SDL_GetRenderDrawColor(renderer, &color.r, &color.g, &color.b, &color.a);
+    for (int i = 0; i < n_points; ++i) {
+        cross = &(buffer->vertices[i * N_CROSS_VERTICES]);
+        x = (float)points[i].x;
+        y = (float)points[i].y;
+        set_rectangle(cross, x - r, y, x + r + 1.0f, y + 1.0f, color);
+        set_rectangle(&(cross[4]), x, y - r, x + 1.0f, y + r + 1.0f, color);
+    }
+    SDL_RenderGeometry(renderer, NULL, buffer->vertices, n_points * N_CROSS_VERTICES,
+                       buffer->indices, n_points * N_CROSS_INDICES);
+}
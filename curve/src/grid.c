@@ -0,0 +1,129 @@
+#include "grid.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void init_point_grid(PointGrid* grid, double radius)
+{
+    grid->radius = radius;
+    grid->n_buckets = 0;
+    grid->heads = NULL;
+    grid->nexts = NULL;
+    grid->buckets = NULL;
+    grid->xs = NULL;
+    grid->ys = NULL;
+}
+
+void destroy_point_grid(PointGrid* grid)
+{
+    free(grid->heads);
+    free(grid->nexts);
+    free(grid->buckets);
+    free(grid->xs);
+    free(grid->ys);
+    init_point_grid(grid, grid->radius);
+}
+
+static int calc_grid_bucket(const PointGrid* grid, double x, double y)
+{
+    unsigned int cell_x = (unsigned int)(int)floor(x / grid->radius);
+    unsigned int cell_y = (unsigned int)(int)floor(y / grid->radius);
+
+    return (int)(((cell_x * 73856093u) ^ (cell_y * 19349663u)) & (unsigned int)(grid->n_buckets - 1));
+}
+
+bool reset_point_grid(PointGrid* grid, int n_points)
+{
+    int n_buckets = 64;
+
+    while (n_buckets < 2 * n_points) {
+        n_buckets *= 2;
+    }
+    if (n_buckets > grid->n_buckets) {
+        destroy_point_grid(grid);
+        grid->heads = (int*)malloc(n_buckets * sizeof(int));
+        grid->nexts = (int*)malloc(n_buckets * sizeof(int));
+        grid->buckets = (int*)malloc(n_buckets * sizeof(int));
+        grid->xs = (double*)malloc(n_buckets * sizeof(double));
+        grid->ys = (double*)malloc(n_buckets * sizeof(double));
+        if (grid->heads == NULL || grid->nexts == NULL || grid->buckets == NULL || grid->xs == NULL || grid->ys == NULL) {
+            printf("[ERROR] Unable to allocate memory for the point grid!\n");
+            destroy_point_grid(grid);
+            return false;
+        }
+        grid->n_buckets = n_buckets;
+    }
+    for (int i = 0; i < grid->n_buckets; ++i) {
+        grid->heads[i] = -1;
+        grid->buckets[i] = -1;
+    }
+    return true;
+}
+
+void set_grid_point(PointGrid* grid, int index, double x, double y)
+{
+    int bucket = calc_grid_bucket(grid, x, y);
+    int* link;
+
+    grid->xs[index] = x;
+    grid->ys[index] = y;
+    if (grid->buckets[index] == bucket) {
+        return;
+    }
+    if (grid->buckets[index] >= 0) {
+        link = &grid->heads[grid->buckets[index]];
+        while (*link != index) {
+            link = &grid->nexts[*link];
+        }
+        *link = grid->nexts[index];
+    }
+    grid->buckets[index] = bucket;
+    grid->nexts[index] = grid->heads[bucket];
+    grid->heads[bucket] = index;
+}
+
+bool build_point_grid(PointGrid* grid, const Point* points, int n_points)
+{
+    if (!reset_point_grid(grid, n_points)) {
+        return false;
+    }
+    for (int i = 0; i < n_points; ++i) {
+        set_grid_point(grid, i, points[i].x, points[i].y);
+    }
+    return true;
+}
+
+bool add_grid_point(PointGrid* grid, const Point* points, int n_points)
+{
+    if (2 * n_points > grid->n_buckets) {
+        return build_point_grid(grid, points, n_points);
+    }
+    set_grid_point(grid, n_points - 1, points[n_points - 1].x, points[n_points - 1].y);
+    return true;
+}
+
+int find_nearest_point(const PointGrid* grid, double x, double y)
+{
+    double min_distance = grid->radius * grid->radius;
+    int nearest = -1;
+
+    if (grid->n_buckets == 0) {
+        return -1;
+    }
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            int bucket = calc_grid_bucket(grid, x + dx * grid->radius, y + dy * grid->radius);
+            for (int i = grid->heads[bucket]; i >= 0; i = grid->nexts[i]) {
+                double distance_x = grid->xs[i] - x;
+                double distance_y = grid->ys[i] - y;
+                double distance = distance_x * distance_x + distance_y * distance_y;
+                if (distance < min_distance) {
+                    min_distance = distance;
+                    nearest = i;
+                }
+            }
+        }
+    }
+    return nearest;
+}
@@ -0,0 +1,83 @@
+#include "lagrange.h"
+
+double calc_barycentric_weight(const double* nodes, int n_nodes, int index)
+{
+    double product = 1.0;
+
+    for (int k = 0; k < n_nodes; ++k) {
+        if (k != index) {
+            product *= nodes[index] - nodes[k];
+        }
+    }
+    return (product != 0.0) ? 1.0 / product : 0.0;
+}
+
+void calc_barycentric_weights(const double* nodes, int n_nodes, double* weights)
+{
+    for (int j = 0; j < n_nodes; ++j) {
+        weights[j] = calc_barycentric_weight(nodes, n_nodes, j);
+    }
+}
+
+double append_barycentric_node(double* nodes, double* weights, int n_nodes, double distance, double scale)
+{
+    const int n = n_nodes - 1;
+    double factor;
+
+    nodes[n] = nodes[n - 1] + scale * distance;
+    if (nodes[n] - nodes[0] > MAX_NODE_INTERVAL) {
+        factor = NODE_INTERVAL / (nodes[n] - nodes[0]);
+        for (int j = 1; j <= n; ++j) {
+            nodes[j] = nodes[0] + (nodes[j] - nodes[0]) * factor;
+        }
+        calc_barycentric_weights(nodes, n_nodes, weights);
+        return scale * factor;
+    }
+    for (int j = 0; j < n; ++j) {
+        if (nodes[j] != nodes[n]) {
+            weights[j] /= nodes[j] - nodes[n];
+        }
+    }
+    weights[n] = calc_barycentric_weight(nodes, n_nodes, n);
+    return scale;
+}
+
+Point calc_lagrange_point(const Point* points, const double* nodes, const double* weights, int n_points, double t)
+{
+    Point result = {0.0, 0.0};
+    double denominator = 0.0;
+    double term;
+
+    for (int j = 0; j < n_points; ++j) {
+        if (t == nodes[j]) {
+            return points[j];
+        }
+        term = weights[j] / (t - nodes[j]);
+        result.x += term * points[j].x;
+        result.y += term * points[j].y;
+        denominator += term;
+    }
+    if (denominator != 0.0) {
+        result.x /= denominator;
+        result.y /= denominator;
+    }
+    return result;
+}
+
+Point calc_lagrange_basis_point(const Point* points, const double* nodes, int n_points, double t)
+{
+    Point result = {0.0, 0.0};
+    double basis;
+
+    for (int j = 0; j < n_points; ++j) {
+        basis = 1.0;
+        for (int k = 0; k < n_points; ++k) {
+            if (k != j) {
+                basis *= (t - nodes[k]) / (nodes[j] - nodes[k]);
+            }
+        }
+        result.x += basis * points[j].x;
+        result.y += basis * points[j].y;
+    }
+    return result;
+}
@@ -0,0 +1,721 @@
+#include "arclength.h"
+#include "bezier.h"
+#include "bspline.h"
+#include "closest.h"
+#include "grid.h"
+#include "lagrange.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N_SAMPLES 257
+#define N_BSPLINE_POINTS 32
+// the local points of the B-splines up to degree 11
+#define MAX_DEGREE_POINTS 12
+// the points are in the 800 x 600 window, where the stable kernels stay below 1e-10 up to degree 1000
+#define TOLERANCE 1e-9
+// update_bezier_polynomial only uses the power basis up to this degree
+#define MAX_POWER_BASIS_DEGREE 10
+// the appended weights are divided once per node after the last rescaling, relative to the largest weight
+#define APPENDED_NODE_TOLERANCE 1e-11
+// the closest points are checked against the closest of the dense samples, refined in their neighbourhood
+#define N_REFERENCE_SAMPLES 100001
+#define N_CLOSEST_POINT_QUERIES 192
+// the arc lengths are checked against the sum of this many chords, and the tables have 4 times as many intervals
+// per span as the tools, where the quadrature of the random control polygons is within 1e-6 of the length
+#define N_REFERENCE_CHORDS 1000000
+#define N_ARC_LENGTH_INTERVALS 16
+#define N_ARC_LENGTH_SAMPLES 101
+// the picking radius of the tools
+#define GRID_RADIUS 10.0
+#define N_GRID_QUERIES 10000
+
+static int n_failures = 0;
+
+/**
+ * Report the largest error of a kernel, and count it as a failure above the tolerance.
+ * The tolerance grows with the magnitude of the checked values, e.g. the derivatives are degree times larger.
+ */
+static void check(const char* name, int degree, double max_error, double tolerance)
+{
+    // the NaN errors of overflowing kernels fail too
+    bool is_passed = (max_error <= tolerance);
+
+    printf("%-16s %6d %12.3g %8s\n", name, degree, max_error, is_passed ? "ok" : "FAILED");
+    if (!is_passed) {
+        ++n_failures;
+    }
+}
+
+static double calc_error(Point point, long double x, long double y)
+{
+    return (double)hypotl(point.x - x, point.y - y);
+}
+
+/**
+ * Place the points pseudo-randomly in the 800 x 600 window, with the same sequence on every run.
+ */
+static void init_random_points(Point* points, int n_points)
+{
+    unsigned int state = 54321u;
+
+    for (int i = 0; i < n_points; ++i) {
+        state = state * 1103515245u + 12345u;
+        points[i].x = 800.0 * ((state >> 8) & 0xFFFF) / 65536.0;
+        state = state * 1103515245u + 12345u;
+        points[i].y = 600.0 * ((state >> 8) & 0xFFFF) / 65536.0;
+    }
+}
+
+/**
+ * Evaluate the Bezier curve, and its derivative when it is not NULL, with the de Casteljau algorithm in long double.
+ * The derivative is the degree times the difference of the two points of the last but one level.
+ */
+static void calc_bezier_reference(const Point* points, int n_points, double t, long double* x, long double* y,
+                                  long double* derivative)
+{
+    long double* xs = (long double*)malloc(n_points * sizeof(long double));
+    long double* ys = (long double*)malloc(n_points * sizeof(long double));
+
+    for (int i = 0; i < n_points; ++i) {
+        xs[i] = points[i].x;
+        ys[i] = points[i].y;
+    }
+    for (int k = 1; k < n_points; ++k) {
+        if (k == n_points - 1 && derivative != NULL) {
+            derivative[0] = (n_points - 1) * (xs[1] - xs[0]);
+            derivative[1] = (n_points - 1) * (ys[1] - ys[0]);
+        }
+        for (int i = 0; i < n_points - k; ++i) {
+            xs[i] = (1.0L - t) * xs[i] + t * xs[i + 1];
+            ys[i] = (1.0L - t) * ys[i] + t * ys[i + 1];
+        }
+    }
+    if (n_points == 1 && derivative != NULL) {
+        derivative[0] = 0.0L;
+        derivative[1] = 0.0L;
+    }
+    *x = xs[0];
+    *y = ys[0];
+    free(xs);
+    free(ys);
+}
+
+static void test_bezier_kernels(void)
+{
+    const int degrees[] = {1, 2, 3, 5, 7, 10, 15, 31, 63, 255, 1000};
+    Point* points;
+    Point* work;
+    Point* left;
+    Point* right;
+    BezierPolynomial power_basis, scaled_bernstein, polynomial;
+
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        const int n_points = degrees[d] + 1;
+        double errors[9] = {0.0};
+        long double x, y, split_x, split_y;
+        long double derivative[2];
+
+        points = (Point*)malloc(n_points * sizeof(Point));
+        work = (Point*)malloc(n_points * sizeof(Point));
+        left = (Point*)malloc(n_points * sizeof(Point));
+        right = (Point*)malloc(n_points * sizeof(Point));
+        if (points == NULL || work == NULL || left == NULL || right == NULL) {
+            printf("[ERROR] Unable to allocate memory for the curve!\n");
+            exit(1);
+        }
+        if (!create_bezier_polynomial(&power_basis, n_points) || !create_bezier_polynomial(&scaled_bernstein, n_points)
+            || !create_bezier_polynomial(&polynomial, n_points)) {
+            exit(1);
+        }
+        init_random_points(points, n_points);
+        convert_bezier_polynomial(&power_basis, points, n_points, POWER_BASIS_EVALUATION);
+        convert_bezier_polynomial(&scaled_bernstein, points, n_points, SCALED_BERNSTEIN_EVALUATION);
+        update_bezier_polynomial(&polynomial, points, n_points);
+        // the curve is split at an inner parameter, whose halves are checked at the same samples
+        split_bezier_curve(points, n_points, 0.375, left, right);
+        for (int k = 0; k < N_SAMPLES; ++k) {
+            double t = (double)k / (N_SAMPLES - 1);
+            calc_bezier_reference(points, n_points, t, &x, &y, derivative);
+            errors[0] = fmax(errors[0], calc_error(calc_bernstein_point(points, n_points, t), x, y));
+            errors[1] = fmax(errors[1], calc_error(calc_de_casteljau_point(points, n_points, t, work), x, y));
+            errors[2] = fmax(errors[2], calc_error(calc_bezier_point(points, n_points, t), x, y));
+            errors[3] = fmax(errors[3], calc_error(calc_bezier_derivative(points, n_points, t, work), derivative[0], derivative[1]));
+            errors[4] = fmax(errors[4], calc_error(calc_bezier_polynomial_point(&power_basis, t), x, y));
+            errors[5] = fmax(errors[5], calc_error(calc_bezier_polynomial_point(&scaled_bernstein, t), x, y));
+            errors[6] = fmax(errors[6], calc_error(calc_bezier_polynomial_point(&polynomial, t), x, y));
+            calc_bezier_reference(points, n_points, 0.375 * t, &x, &y, NULL);
+            calc_bezier_reference(left, n_points, t, &split_x, &split_y, NULL);
+            errors[7] = fmax(errors[7], (double)hypotl(split_x - x, split_y - y));
+            calc_bezier_reference(points, n_points, 0.375 + 0.625 * t, &x, &y, NULL);
+            calc_bezier_reference(right, n_points, t, &split_x, &split_y, NULL);
+            errors[8] = fmax(errors[8], (double)hypotl(split_x - x, split_y - y));
+        }
+        check("bernstein", degrees[d], errors[0], TOLERANCE);
+        check("de_casteljau", degrees[d], errors[1], TOLERANCE);
+        check("bezier", degrees[d], errors[2], TOLERANCE);
+        check("derivative", degrees[d], errors[3], degrees[d] * TOLERANCE);
+        if (degrees[d] <= MAX_POWER_BASIS_DEGREE) {
+            check("power_basis", degrees[d], errors[4], TOLERANCE);
+        }
+        check("scaled_bernstein", degrees[d], errors[5], TOLERANCE);
+        check("polynomial", degrees[d], errors[6], TOLERANCE);
+        check("split_left", degrees[d], errors[7], TOLERANCE);
+        check("split_right", degrees[d], errors[8], TOLERANCE);
+        destroy_bezier_polynomial(&power_basis);
+        destroy_bezier_polynomial(&scaled_bernstein);
+        destroy_bezier_polynomial(&polynomial);
+        free(points);
+        free(work);
+        free(left);
+        free(right);
+    }
+}
+
+/**
+ * Evaluate the Lagrange basis polynomials of the nodes in long double.
+ */
+static void calc_lagrange_reference(const Point* points, const double* nodes, int n_points, double t,
+                                    long double* x, long double* y)
+{
+    long double basis;
+
+    *x = 0.0L;
+    *y = 0.0L;
+    for (int j = 0; j < n_points; ++j) {
+        basis = 1.0L;
+        for (int k = 0; k < n_points; ++k) {
+            if (k != j) {
+                basis *= ((long double)t - nodes[k]) / ((long double)nodes[j] - nodes[k]);
+            }
+        }
+        *x += basis * points[j].x;
+        *y += basis * points[j].y;
+    }
+}
+
+/**
+ * The curves interpolate at the Chebyshev points of the second kind,
+ * because the equispaced ones are too ill-conditioned to compare at high degree.
+ */
+static void test_lagrange_kernels(void)
+{
+    const int degrees[] = {1, 2, 3, 7, 15, 31, 63, 127};
+    Point* points;
+    double* nodes;
+    double* weights;
+
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        const int n_points = degrees[d] + 1;
+        double errors[3] = {0.0};
+        long double x, y;
+
+        points = (Point*)malloc(n_points * sizeof(Point));
+        nodes = (double*)malloc(n_points * sizeof(double));
+        weights = (double*)malloc(n_points * sizeof(double));
+        if (points == NULL || nodes == NULL || weights == NULL) {
+            printf("[ERROR] Unable to allocate memory for the curve!\n");
+            exit(1);
+        }
+        init_random_points(points, n_points);
+        for (int j = 0; j < n_points; ++j) {
+            nodes[j] = -cos(M_PI * j / degrees[d]);
+        }
+        calc_barycentric_weights(nodes, n_points, weights);
+        for (int k = 0; k < N_SAMPLES; ++k) {
+            double t = -1.0 + 2.0 * k / (N_SAMPLES - 1);
+            calc_lagrange_reference(points, nodes, n_points, t, &x, &y);
+            errors[0] = fmax(errors[0], calc_error(calc_lagrange_point(points, nodes, weights, n_points, t), x, y));
+            errors[1] = fmax(errors[1], calc_error(calc_lagrange_basis_point(points, nodes, n_points, t), x, y));
+        }
+        // the curve passes through its points at their nodes
+        for (int j = 0; j < n_points; ++j) {
+            errors[2] = fmax(errors[2], calc_error(calc_lagrange_point(points, nodes, weights, n_points, nodes[j]),
+                                                   points[j].x, points[j].y));
+        }
+        check("barycentric", degrees[d], errors[0], TOLERANCE);
+        check("lagrange_basis", degrees[d], errors[1], TOLERANCE);
+        check("interpolation", degrees[d], errors[2], TOLERANCE);
+        free(points);
+        free(nodes);
+        free(weights);
+    }
+}
+
+/**
+ * Append chord based nodes one by one, as the lagrange tool does, and compare the weights
+ * to a full recalculation on the same nodes, and the nodes to the scaled sums of the chords.
+ * The nodes are rescaled several times on the way, which keeps the weights from underflowing.
+ */
+static void test_appended_nodes(void)
+{
+    const int counts[] = {10, 100, 300, 600};
+    const double exponents[] = {0.5, 0.25};
+    const char* names[] = {"append_chordal", "append_centrip"};
+    const int n_points = counts[sizeof(counts) / sizeof(counts[0]) - 1];
+    Point* points = (Point*)malloc(n_points * sizeof(Point));
+    double* nodes = (double*)malloc(n_points * sizeof(double));
+    double* weights = (double*)malloc(n_points * sizeof(double));
+    double* reference = (double*)malloc(n_points * sizeof(double));
+    double* chords = (double*)malloc(n_points * sizeof(double));
+
+    if (points == NULL || nodes == NULL || weights == NULL || reference == NULL || chords == NULL) {
+        printf("[ERROR] Unable to allocate memory for the curve!\n");
+        exit(1);
+    }
+    init_random_points(points, n_points);
+    for (int e = 0; e < 2; ++e) {
+        double scale = 1.0;
+        int c = 0;
+
+        nodes[0] = 0.0;
+        weights[0] = 1.0;
+        chords[0] = 0.0;
+        for (int n = 2; n <= n_points; ++n) {
+            double dx = points[n - 1].x - points[n - 2].x;
+            double dy = points[n - 1].y - points[n - 2].y;
+            double distance = pow(dx * dx + dy * dy, exponents[e]);
+
+            chords[n - 1] = chords[n - 2] + distance;
+            scale = append_barycentric_node(nodes, weights, n, distance, scale);
+            if (n == counts[c]) {
+                double max_weight = 0.0;
+                double max_error = 0.0;
+
+                calc_barycentric_weights(nodes, n, reference);
+                for (int j = 0; j < n; ++j) {
+                    max_weight = fmax(max_weight, fabs(reference[j]));
+                }
+                for (int j = 0; j < n; ++j) {
+                    max_error = fmax(max_error, fabs(weights[j] - reference[j]) / max_weight);
+                    max_error = fmax(max_error, fabs(nodes[j] - chords[j] * scale) / NODE_INTERVAL);
+                }
+                // the underflowed or overflowed weights fail too
+                if (!(max_weight > 0.0 && isfinite(max_weight) && nodes[n - 1] <= MAX_NODE_INTERVAL)) {
+                    max_error = NAN;
+                }
+                check(names[e], n - 1, max_error, APPENDED_NODE_TOLERANCE);
+                ++c;
+            }
+        }
+    }
+    free(points);
+    free(nodes);
+    free(weights);
+    free(reference);
+    free(chords);
+}
+
+/**
+ * Evaluate the B-spline of the degree + 1 points of the knot span with the de Boor scheme in long double.
+ * The points are overwritten.
+ */
+static void calc_de_boor_reference(long double* xs, long double* ys, const double* knots, int degree, int span,
+                                   double t, long double* x, long double* y)
+{
+    long double alpha;
+
+    for (int r = 1; r <= degree; ++r) {
+        for (int j = degree; j >= r; --j) {
+            int i = span - degree + j;
+            long double denominator = (long double)knots[i + degree - r + 1] - knots[i];
+            alpha = (denominator != 0.0L) ? ((long double)t - knots[i]) / denominator : 0.0L;
+            xs[j] = (1.0L - alpha) * xs[j - 1] + alpha * xs[j];
+            ys[j] = (1.0L - alpha) * ys[j - 1] + alpha * ys[j];
+        }
+    }
+    *x = xs[degree];
+    *y = ys[degree];
+}
+
+/**
+ * Evaluate the B-spline and its derivative in long double.
+ * The derivative is the B-spline of degree p - 1 of the control points p * (P_i+1 - P_i) / (u_i+p+1 - u_i+1)
+ * on the knot vector without its first and last knots.
+ */
+static void calc_b_spline_reference(const BSpline* spline, double t, long double* x, long double* y,
+                                    long double* derivative_x, long double* derivative_y)
+{
+    const int p = spline->degree;
+    const double* knots = spline->knots;
+    const Point* points = spline->points;
+    long double xs[MAX_DEGREE_POINTS];
+    long double ys[MAX_DEGREE_POINTS];
+    int span = p;
+
+    // the last span is closed, so that the end of the domain is evaluated
+    while (span < spline->n_points - 1 && knots[span + 1] <= t) {
+        ++span;
+    }
+    for (int j = 0; j <= p; ++j) {
+        xs[j] = points[span - p + j].x;
+        ys[j] = points[span - p + j].y;
+    }
+    calc_de_boor_reference(xs, ys, knots, p, span, t, x, y);
+    for (int j = 0; j < p; ++j) {
+        int i = span - p + j;
+        long double scale = p / ((long double)knots[i + p + 1] - knots[i + 1]);
+        xs[j] = scale * ((long double)points[i + 1].x - points[i].x);
+        ys[j] = scale * ((long double)points[i + 1].y - points[i].y);
+    }
+    calc_de_boor_reference(xs, ys, &(knots[1]), p - 1, span - 1, t, derivative_x, derivative_y);
+}
+
+static void test_b_spline_kernels(void)
+{
+    const int degrees[] = {1, 2, 3, 5, 7, 11};
+    BSpline spline;
+    Point work[MAX_DEGREE_POINTS];
+    double basis[3 * MAX_DEGREE_POINTS];
+    double begin, end;
+
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        double errors[3] = {0.0};
+        long double x, y, derivative_x, derivative_y;
+
+        if (!create_b_spline(&spline, degrees[d], N_BSPLINE_POINTS)) {
+            exit(1);
+        }
+        init_random_points(spline.points, N_BSPLINE_POINTS);
+        set_clamped_knots(&spline);
+        get_domain(&spline, &begin, &end);
+        for (int k = 0; k < N_SAMPLES; ++k) {
+            double t = begin + (end - begin) * k / (N_SAMPLES - 1);
+            calc_b_spline_reference(&spline, t, &x, &y, &derivative_x, &derivative_y);
+            errors[0] = fmax(errors[0], calc_error(de_boor(&spline, t, work), x, y));
+            errors[1] = fmax(errors[1], calc_error(calc_cox_de_boor_point(&spline, t, basis), x, y));
+            errors[2] = fmax(errors[2], calc_error(calc_b_spline_derivative(&spline, t, work), derivative_x, derivative_y));
+        }
+        check("de_boor", degrees[d], errors[0], TOLERANCE);
+        check("cox_de_boor", degrees[d], errors[1], TOLERANCE);
+        // the derivative is scaled by the degree and the inverse knot spacing
+        check("b_spline_deriv", degrees[d], errors[2], degrees[d] * N_BSPLINE_POINTS * TOLERANCE);
+        destroy_b_spline(&spline);
+    }
+}
+
+/**
+ * B-spline with its work array for the arc length tables
+ */
+typedef struct SplineEvaluation
+{
+    const BSpline* spline;
+    Point* work;
+} SplineEvaluation;
+
+static Point calc_spline_derivative(const void* data, double u)
+{
+    const SplineEvaluation* evaluation = (const SplineEvaluation*)data;
+
+    return calc_b_spline_derivative(evaluation->spline, u, evaluation->work);
+}
+
+/**
+ * Sum the lengths of the dense chords of the B-spline in long double.
+ * The chords are placed span by span, so that they do not cut the corners at the knots.
+ */
+static long double calc_arc_length_reference(const BSpline* spline, Point* work)
+{
+    const int n_spans = spline->n_points - spline->degree;
+    const int n_chords = N_REFERENCE_CHORDS / n_spans;
+    long double length = 0.0L;
+    double begin, end;
+    Point previous, point;
+
+    for (int s = spline->degree; s < spline->n_points; ++s) {
+        begin = spline->knots[s];
+        end = spline->knots[s + 1];
+        previous = de_boor(spline, begin, work);
+        for (int k = 1; k <= n_chords; ++k) {
+            // the end of the span is evaluated just before the knot, in the same span
+            point = de_boor(spline, (k < n_chords) ? begin + (end - begin) * k / n_chords : nextafter(end, begin), work);
+            length += hypotl((long double)point.x - previous.x, (long double)point.y - previous.y);
+            previous = point;
+        }
+    }
+    return length;
+}
+
+/**
+ * The length of the table is checked against the dense chords, the equal length samples and the dashes
+ * against the lengths of the table, and the table whose moved spans are updated against a new one.
+ */
+static void test_arc_length_tables(void)
+{
+    const int degrees[] = {1, 2, 3, 5};
+    const double pattern[] = {40.0, 15.0, 5.0};
+    BSpline spline;
+    Point work[MAX_DEGREE_POINTS];
+    SplineEvaluation evaluation = {&spline, work};
+    ArcLengthCurve curve = {calc_spline_derivative, &evaluation};
+    ArcLengthTable table, new_table;
+    double parameters[N_ARC_LENGTH_SAMPLES];
+    double dashes[2 * N_ARC_LENGTH_SAMPLES];
+    double length, dash_length;
+    int n_spans, n_dashes, moved;
+
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        double errors[4] = {0.0};
+
+        if (!create_b_spline(&spline, degrees[d], N_BSPLINE_POINTS)) {
+            exit(1);
+        }
+        init_random_points(spline.points, N_BSPLINE_POINTS);
+        set_clamped_knots(&spline);
+        n_spans = N_BSPLINE_POINTS - degrees[d];
+        if (!create_arc_length_table(&table, &(spline.knots[degrees[d]]), n_spans, N_ARC_LENGTH_INTERVALS)) {
+            exit(1);
+        }
+        update_arc_length_table(&table, &curve);
+        length = get_arc_length(&table);
+        errors[0] = fabs((double)(length - calc_arc_length_reference(&spline, work))) / length;
+
+        calc_equal_length_parameters(&table, &curve, N_ARC_LENGTH_SAMPLES, parameters);
+        for (int k = 0; k < N_ARC_LENGTH_SAMPLES; ++k) {
+            errors[1] = fmax(errors[1], fabs(calc_arc_length(&table, &curve, parameters[k]) - length * k / (N_ARC_LENGTH_SAMPLES - 1)));
+        }
+        // every dash but the last one is as long as its element of the pattern, which alternates dashes and gaps
+        n_dashes = calc_dash_parameters(&table, &curve, pattern, 3, dashes, 2 * N_ARC_LENGTH_SAMPLES) / 2;
+        for (int k = 0; k + 1 < n_dashes; ++k) {
+            dash_length = calc_arc_length(&table, &curve, dashes[2 * k + 1]) - calc_arc_length(&table, &curve, dashes[2 * k]);
+            errors[2] = fmax(errors[2], fabs(dash_length - pattern[(2 * k) % 3]));
+        }
+
+        // the moved point changes the degree + 1 spans after it
+        moved = N_BSPLINE_POINTS / 2;
+        spline.points[moved].x += 100.0;
+        spline.points[moved].y -= 50.0;
+        invalidate_arc_length_spans(&table, moved - degrees[d], moved);
+        update_arc_length_table(&table, &curve);
+        if (!create_arc_length_table(&new_table, &(spline.knots[degrees[d]]), n_spans, N_ARC_LENGTH_INTERVALS)) {
+            exit(1);
+        }
+        update_arc_length_table(&new_table, &curve);
+        for (int i = 0; i <= n_spans * N_ARC_LENGTH_INTERVALS; ++i) {
+            errors[3] = fmax(errors[3], fabs(table.lengths[i] - new_table.lengths[i]));
+        }
+        // the error of the quadrature is relative to the length of the curve
+        check("arc_length", degrees[d], errors[0], 1e-6);
+        check("equal_lengths", degrees[d], errors[1], TOLERANCE * length);
+        check("dashes", degrees[d], errors[2], TOLERANCE * length);
+        check("dirty_spans", degrees[d], errors[3], TOLERANCE);
+        destroy_arc_length_table(&table);
+        destroy_arc_length_table(&new_table);
+        destroy_b_spline(&spline);
+    }
+}
+
+/**
+ * Find the distance of the query from the closest of the dense samples, refined by a ternary search
+ * in the neighbouring sample intervals.
+ */
+static double calc_closest_point_reference(const Point* points, int n_points, const Point* samples, Point query)
+{
+    double best_distance = INFINITY;
+    int best_k = 0;
+    double begin, end, t1, t2, distance;
+    Point p1, p2;
+
+    for (int k = 0; k < N_REFERENCE_SAMPLES; ++k) {
+        distance = hypot(samples[k].x - query.x, samples[k].y - query.y);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best_k = k;
+        }
+    }
+    begin = (double)((best_k > 0) ? best_k - 1 : 0) / (N_REFERENCE_SAMPLES - 1);
+    end = (double)((best_k < N_REFERENCE_SAMPLES - 1) ? best_k + 1 : best_k) / (N_REFERENCE_SAMPLES - 1);
+    for (int k = 0; k < 100; ++k) {
+        t1 = begin + (end - begin) / 3.0;
+        t2 = end - (end - begin) / 3.0;
+        p1 = calc_bezier_point(points, n_points, t1);
+        p2 = calc_bezier_point(points, n_points, t2);
+        if (hypot(p1.x - query.x, p1.y - query.y) < hypot(p2.x - query.x, p2.y - query.y)) {
+            end = t2;
+        }
+        else {
+            begin = t1;
+        }
+    }
+    p1 = calc_bezier_point(points, n_points, 0.5 * (begin + end));
+    return fmin(best_distance, hypot(p1.x - query.x, p1.y - query.y));
+}
+
+/**
+ * The closest points of the queries on a grid over the window must not be farther than the dense samples,
+ * and they must be on the curve at their parameters. The degrees go above 513,
+ * where the binomial coefficients of the product weights overflow.
+ */
+static void test_closest_points(void)
+{
+    const int degrees[] = {1, 2, 3, 7, 15, 63, 255, 600, 1000};
+    Point queries[N_CLOSEST_POINT_QUERIES];
+    Point closest_points[N_CLOSEST_POINT_QUERIES];
+    double parameters[N_CLOSEST_POINT_QUERIES];
+    ClosestPointCurve closest_curve;
+    Point* points;
+    Point* samples;
+
+    for (int q = 0; q < N_CLOSEST_POINT_QUERIES; ++q) {
+        queries[q].x = 800.0 * ((q % 16) + 0.5) / 16;
+        queries[q].y = 600.0 * ((q / 16) + 0.5) / 12;
+    }
+    samples = (Point*)malloc(N_REFERENCE_SAMPLES * sizeof(Point));
+    if (samples == NULL) {
+        printf("[ERROR] Unable to allocate memory for the samples!\n");
+        exit(1);
+    }
+    for (int d = 0; d < (int)(sizeof(degrees) / sizeof(degrees[0])); ++d) {
+        const int n_points = degrees[d] + 1;
+        double errors[2] = {0.0};
+
+        points = (Point*)malloc(n_points * sizeof(Point));
+        if (points == NULL) {
+            printf("[ERROR] Unable to allocate memory for the curve!\n");
+            exit(1);
+        }
+        init_random_points(points, n_points);
+        for (int k = 0; k < N_REFERENCE_SAMPLES; ++k) {
+            samples[k] = calc_bezier_point(points, n_points, (double)k / (N_REFERENCE_SAMPLES - 1));
+        }
+        // the curve starts with a smaller capacity, so the arrays have to grow
+        if (!create_closest_point_curve(&closest_curve, 2)
+            || !update_closest_point_curve(&closest_curve, points, n_points)
+            || !find_closest_points(&closest_curve, queries, N_CLOSEST_POINT_QUERIES, parameters, closest_points)) {
+            exit(1);
+        }
+        for (int q = 0; q < N_CLOSEST_POINT_QUERIES; ++q) {
+            double distance = hypot(closest_points[q].x - queries[q].x, closest_points[q].y - queries[q].y);
+            Point point = calc_bezier_point(points, n_points, parameters[q]);
+
+            errors[0] = fmax(errors[0], distance - calc_closest_point_reference(points, n_points, samples, queries[q]));
+            errors[1] = fmax(errors[1], hypot(point.x - closest_points[q].x, point.y - closest_points[q].y));
+        }
+        check("closest_point", degrees[d], errors[0], TOLERANCE);
+        check("closest_param", degrees[d], errors[1], TOLERANCE);
+        destroy_closest_point_curve(&closest_curve);
+        free(points);
+    }
+    free(samples);
+}
+
+/**
+ * Find the nearest of the points within the radius of the position by brute force, or -1.
+ */
+static int find_nearest_reference(const Point* points, int n_points, double x, double y)
+{
+    double min_distance = GRID_RADIUS * GRID_RADIUS;
+    double distance;
+    int nearest = -1;
+
+    for (int i = 0; i < n_points; ++i) {
+        distance = (points[i].x - x) * (points[i].x - x) + (points[i].y - y) * (points[i].y - y);
+        if (distance < min_distance) {
+            min_distance = distance;
+            nearest = i;
+        }
+    }
+    return nearest;
+}
+
+/**
+ * Count the picks of the grid which are not as near as the brute force ones.
+ * The points at equal distances may be picked in either order, so the distances are compared.
+ */
+static int count_wrong_picks(const PointGrid* grid, const Point* points, int n_points, const Point* queries)
+{
+    int n_wrong = 0;
+    int index, reference;
+
+    for (int q = 0; q < N_GRID_QUERIES; ++q) {
+        index = find_nearest_point(grid, queries[q].x, queries[q].y);
+        reference = find_nearest_reference(points, n_points, queries[q].x, queries[q].y);
+        if ((index < 0) != (reference < 0) || (index >= 0
+            && hypot(points[index].x - queries[q].x, points[index].y - queries[q].y)
+               != hypot(points[reference].x - queries[q].x, points[reference].y - queries[q].y))) {
+            ++n_wrong;
+        }
+    }
+    return n_wrong;
+}
+
+/**
+ * The picks of random queries are checked against brute force after the grid is built,
+ * after half of the points have been dragged, and after new points have been added until it is rebuilt.
+ */
+static void test_point_grid(void)
+{
+    const int counts[] = {4, 64, 1000};
+    PointGrid grid;
+    Point queries[N_GRID_QUERIES];
+    Point* points;
+    int n_points, capacity;
+
+    for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); ++c) {
+        int n_wrong[3];
+
+        n_points = counts[c];
+        capacity = 2 * n_points + 64;
+        points = (Point*)malloc(capacity * sizeof(Point));
+        if (points == NULL) {
+            printf("[ERROR] Unable to allocate memory for the points!\n");
+            exit(1);
+        }
+        // the queries are near the points, so that most of them pick one
+        init_random_points(points, capacity);
+        for (int q = 0; q < N_GRID_QUERIES; ++q) {
+            queries[q].x = points[q % n_points].x + GRID_RADIUS * (2.0 * (q % 7) / 6.0 - 1.0);
+            queries[q].y = points[q % n_points].y + GRID_RADIUS * (2.0 * (q % 5) / 4.0 - 1.0);
+        }
+        init_point_grid(&grid, GRID_RADIUS);
+        if (!build_point_grid(&grid, points, n_points)) {
+            exit(1);
+        }
+        n_wrong[0] = count_wrong_picks(&grid, points, n_points, queries);
+        for (int i = 0; i < n_points; i += 2) {
+            points[i].x = 800.0 - points[i].x;
+            points[i].y += 3.0;
+            set_grid_point(&grid, i, points[i].x, points[i].y);
+        }
+        n_wrong[1] = count_wrong_picks(&grid, points, n_points, queries);
+        while (n_points < capacity) {
+            ++n_points;
+            if (!add_grid_point(&grid, points, n_points)) {
+                exit(1);
+            }
+        }
+        n_wrong[2] = count_wrong_picks(&grid, points, n_points, queries);
+        check("grid_build", counts[c], n_wrong[0], 0.0);
+        check("grid_move", counts[c], n_wrong[1], 0.0);
+        check("grid_add", counts[c], n_wrong[2], 0.0);
+        destroy_point_grid(&grid);
+        free(points);
+    }
+}
+
+/**
+ * Correctness tests of the curve kernels.
+ *
+ * Every kernel is evaluated at the uniform samples of random curves, and its error is the largest distance
+ * from the long double evaluation of the same curve. The arc length tables, the closest points and the picks
+ * of the point grid are checked against dense sampling and brute force. Returns non-zero if any error is above its tolerance.
+ */
+int main(void)
+{
+    printf("%-16s %6s %12s %8s\n", "kernel", "degree", "max error", "result");
+    test_bezier_kernels();
+    test_lagrange_kernels();
+    test_appended_nodes();
+    test_b_spline_kernels();
+    test_arc_length_tables();
+    test_closest_points();
+    test_point_grid();
+    if (n_failures > 0) {
+        printf("%d checks failed\n", n_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
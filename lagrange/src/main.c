@@ -1,70 +1,256 @@
 #include <SDL2/SDL.h>
 
+#include "draw.h"
+#include "grid.h"
+#include "lagrange.h"
+
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 const double POINT_RADIUS = 10.0;
 const int N_POINTS = 4;
-const int INTERP_RES = 100;
+const int INTERP_RES = 1000;
+
+/**
+ * Parameter values (nodes) of the interpolated points
+ */
+typedef enum Parameterization
+{
+    EQUISPACED_NODES,
+    CHEBYSHEV_NODES,
+    CHORDAL_NODES,
+    CENTRIPETAL_NODES
+} Parameterization;
 
 /**
- * A simple point structure.
+ * Interpolating polynomial curve in barycentric form
+ *
+ * The weights are only defined up to a common factor, which cancels in the evaluation.
+ * The chord based nodes are scaled by node_scale, so that the weights do not overflow.
  */
-typedef struct Point
+typedef struct LagrangeCurve
 {
-  double x;
-  double y;
-} Point;
-
-
-// Lagrange interpolation basis
-float lagrange_basis(int i, float t) {
-    float result = 1.0;
-    for (int j = 0; j < N_POINTS; j++) {
-        if (j != i) {
-            //result *= (t - points[j].x) / (points[i].x - points[j].x);
-            result *= (t - j) / (i - j);
+    int n_points;
+    int capacity;
+    Parameterization parameterization;
+    Point* points;
+    double* nodes;
+    double* weights;
+    double node_scale;
+} LagrangeCurve;
+
+bool is_chord_based(Parameterization parameterization)
+{
+    return parameterization == CHORDAL_NODES || parameterization == CENTRIPETAL_NODES;
+}
+
+/**
+ * Calculate the nodes as the (scaled) sum of the chord lengths with the given exponent.
+ */
+void calc_chord_nodes(LagrangeCurve* curve)
+{
+    double exponent = (curve->parameterization == CHORDAL_NODES) ? 1.0 : 0.5;
+
+    curve->nodes[0] = 0.0;
+    for (int j = 1; j < curve->n_points; ++j) {
+        double dx = curve->points[j].x - curve->points[j - 1].x;
+        double dy = curve->points[j].y - curve->points[j - 1].y;
+        curve->nodes[j] = curve->nodes[j - 1] + pow(dx * dx + dy * dy, exponent * 0.5);
+    }
+    // the products of the node differences stay in range on a short interval
+    curve->node_scale = (curve->nodes[curve->n_points - 1] > 0.0) ? NODE_INTERVAL / curve->nodes[curve->n_points - 1] : 1.0;
+    for (int j = 1; j < curve->n_points; ++j) {
+        curve->nodes[j] *= curve->node_scale;
+    }
+}
+
+/**
+ * Calculate the nodes and the weights of the points.
+ * The equispaced and the Chebyshev weights have closed forms, so they take O(n) steps.
+ * The chord based nodes depend on all points before them, so their weights take O(n^2) steps.
+ */
+void calc_weights(LagrangeCurve* curve)
+{
+    const int n = curve->n_points;
+
+    switch (curve->parameterization) {
+    case EQUISPACED_NODES:
+        // the weights are the binomial coefficients with alternating signs
+        for (int j = 0; j < n; ++j) {
+            curve->nodes[j] = j;
+            curve->weights[j] = (j == 0) ? 1.0 : -curve->weights[j - 1] * (n - j) / j;
         }
+        break;
+    case CHEBYSHEV_NODES:
+        // the Chebyshev points of the second kind, which include the ends of the [-1, 1] interval
+        for (int j = 0; j < n; ++j) {
+            curve->nodes[j] = (n > 1) ? -cos(M_PI * j / (n - 1)) : 0.0;
+            curve->weights[j] = (j % 2 == 0) ? 1.0 : -1.0;
+            if (j == 0 || j == n - 1) {
+                curve->weights[j] *= 0.5;
+            }
+        }
+        break;
+    case CHORDAL_NODES:
+    case CENTRIPETAL_NODES:
+        calc_chord_nodes(curve);
+        calc_barycentric_weights(curve->nodes, n, curve->weights);
+        break;
     }
-    return result;
 }
 
-// compute Lagrange interpolated point
-Point lagrange_interpolation(Point *points, float t) {
-    Point result = {0.0f, 0.0f};
-    for (int i = 0; i < N_POINTS; i++) {
-        float L_i = lagrange_basis(i, t);
-        result.x += points[i].x * L_i;
-        result.y += points[i].y * L_i;
+bool create_lagrange_curve(LagrangeCurve* curve, int capacity, Parameterization parameterization)
+{
+    curve->n_points = 0;
+    curve->capacity = capacity;
+    curve->parameterization = parameterization;
+    curve->points = (Point*)malloc(capacity * sizeof(Point));
+    curve->nodes = (double*)malloc(capacity * sizeof(double));
+    curve->weights = (double*)malloc(capacity * sizeof(double));
+    curve->node_scale = 1.0;
+    if (curve->points == NULL || curve->nodes == NULL || curve->weights == NULL) {
+        printf("[ERROR] Unable to allocate memory for the interpolated points!\n");
+        free(curve->points);
+        free(curve->nodes);
+        free(curve->weights);
+        return false;
     }
-    return result;
+    return true;
 }
 
-void interpolate_curve(Point *interp_points, Point *points, SDL_Renderer *renderer) {
-    for (int k = 0; k < INTERP_RES; k++) {  
-        //float t = (float)k * (N_POINTS - 1.0)/ (INTERP_RES - 1);
-        float t = (float)k / (INTERP_RES - 1);
-        interp_points[k].x = 0;
-        interp_points[k].y = 0;
+void destroy_lagrange_curve(LagrangeCurve* curve)
+{
+    free(curve->points);
+    free(curve->nodes);
+    free(curve->weights);
+}
 
-        Point p = lagrange_interpolation(points, t);
+/**
+ * Append a point to the curve.
+ * A new chord based node only divides the other weights by its difference to them,
+ * which is O(n) on average instead of the full recalculation.
+ */
+bool add_point(LagrangeCurve* curve, double x, double y)
+{
+    const int n = curve->n_points;
+    Point* points;
+    double* nodes;
+    double* weights;
+    double dx, dy;
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-        SDL_RenderDrawPoint(renderer, p.x, p.y);
+    if (n == curve->capacity) {
+        points = (Point*)realloc(curve->points, 2 * curve->capacity * sizeof(Point));
+        if (points != NULL) {
+            curve->points = points;
+        }
+        nodes = (double*)realloc(curve->nodes, 2 * curve->capacity * sizeof(double));
+        if (nodes != NULL) {
+            curve->nodes = nodes;
+        }
+        weights = (double*)realloc(curve->weights, 2 * curve->capacity * sizeof(double));
+        if (weights != NULL) {
+            curve->weights = weights;
+        }
+        if (points == NULL || nodes == NULL || weights == NULL) {
+            printf("[ERROR] Unable to allocate memory for the interpolated points!\n");
+            return false;
+        }
+        curve->capacity *= 2;
+    }
+    curve->points[n].x = x;
+    curve->points[n].y = y;
+    curve->n_points = n + 1;
+    if (is_chord_based(curve->parameterization) == false || n < 2) {
+        calc_weights(curve);
+        return true;
     }
+    dx = x - curve->points[n - 1].x;
+    dy = y - curve->points[n - 1].y;
+    // the nodes grow with every point, so they are rescaled from time to time
+    curve->node_scale = append_barycentric_node(curve->nodes, curve->weights, n + 1,
+        pow(dx * dx + dy * dy, (curve->parameterization == CHORDAL_NODES) ? 0.5 : 0.25), curve->node_scale);
+    return true;
 }
 
-void draw_curve(SDL_Renderer *renderer, Point *interp_points) {
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    for (int i = 0; i < INTERP_RES - 1; i++) {
-        SDL_RenderDrawLine(renderer, interp_points[i].x, interp_points[i].y,
-                           interp_points[i + 1].x, interp_points[i + 1].y);
+/**
+ * Move a point of the curve.
+ * The equispaced and the Chebyshev weights do not depend on the positions, so only the chord based ones are updated.
+ */
+void move_point(LagrangeCurve* curve, int index, double x, double y)
+{
+    curve->points[index].x = x;
+    curve->points[index].y = y;
+    if (is_chord_based(curve->parameterization)) {
+        calc_weights(curve);
     }
 }
 
+/**
+ * Sample the curve uniformly between its first and last nodes.
+ */
+void interpolate_curve(Point *interp_points, const LagrangeCurve *curve) {
+    double begin = curve->nodes[0];
+    double end = curve->nodes[curve->n_points - 1];
+
+    for (int k = 0; k < INTERP_RES; k++) {
+        double t = begin + (end - begin) * k / (INTERP_RES - 1);
+        interp_points[k] = calc_lagrange_point(curve->points, curve->nodes, curve->weights, curve->n_points, t);
+    }
+}
+
+void draw_curve(SDL_Renderer *renderer, DrawBuffer *buffer, Point *interp_points) {
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+    draw_polyline(renderer, buffer, interp_points, INTERP_RES);
+}
+
+/**
+ * Draw the interpolated points, their polygon and the curve.
+ */
+void draw_scene(SDL_Renderer *renderer, DrawBuffer *buffer, const LagrangeCurve *curve, Point *interp_points)
+{
+  const Point* points = curve->points;
+
+  SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+  SDL_RenderClear(renderer);
+  // Draw the control points
+  SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
+  draw_control_points(renderer, buffer, points, curve->n_points, POINT_RADIUS);
+  // Draw the segments
+  SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
+  draw_polyline(renderer, buffer, points, curve->n_points);
+
+  interpolate_curve(interp_points, curve);
+  draw_curve(renderer, buffer, interp_points);
+
+  // Display the results
+  SDL_RenderPresent(renderer);
+}
+
+/**
+ * Parse the name of the parameterization.
+ */
+Parameterization parse_parameterization(const char* name)
+{
+  if (strcmp(name, "chebyshev") == 0) {
+    return CHEBYSHEV_NODES;
+  }
+  if (strcmp(name, "chordal") == 0) {
+    return CHORDAL_NODES;
+  }
+  if (strcmp(name, "centripetal") == 0) {
+    return CENTRIPETAL_NODES;
+  }
+  return EQUISPACED_NODES;
+}
+
 /**
  * C/SDL2 framework for experimentation with curves.
+ *
+ * Usage: splines [equispaced|chebyshev|chordal|centripetal]
+ * The right mouse button adds a new point to the end of the curve.
  */
 int main(int argc, char* argv[])
 {
@@ -74,26 +260,35 @@ int main(int argc, char* argv[])
   SDL_Event event;
   SDL_Renderer* renderer;
 
-  const int N = 4;
-
   int mouse_x, mouse_y;
-  int i;
 
-  Point* selected_point = NULL;
-  Point points[N_POINTS];
+  LagrangeCurve curve;
+  PointGrid grid;
+  DrawBuffer buffer;
+  int selected_index = -1;
+  bool need_redraw = true;
   Point interp_points[INTERP_RES];
-  points[0].x = 200;
-  points[0].y = 200;
-  points[1].x = 400;
-  points[1].y = 200;
-  points[2].x = 300;
-  points[2].y = 400;
-  points[3].x = 500;
-  points[3].y = 400;
+
+  if (!create_lagrange_curve(&curve, N_POINTS, (argc > 1) ? parse_parameterization(argv[1]) : EQUISPACED_NODES)) {
+    return 1;
+  }
+  add_point(&curve, 200, 200);
+  add_point(&curve, 400, 200);
+  add_point(&curve, 300, 400);
+  add_point(&curve, 500, 400);
+  init_point_grid(&grid, POINT_RADIUS);
+  if (!build_point_grid(&grid, curve.points, curve.n_points)) {
+    destroy_lagrange_curve(&curve);
+    return 1;
+  }
+  init_draw_buffer(&buffer);
 
   error_code = SDL_Init(SDL_INIT_EVERYTHING);
   if (error_code != 0) {
     printf("[ERROR] SDL initialization error: %s\n", SDL_GetError());
+    destroy_draw_buffer(&buffer);
+    destroy_point_grid(&grid);
+    destroy_lagrange_curve(&curve);
     return error_code;
   }
 
@@ -116,50 +311,42 @@ int main(int argc, char* argv[])
 
   need_run = true;
   while (need_run) {
-    while (SDL_PollEvent(&event)) {
+    if (need_redraw) {
+      draw_scene(renderer, &buffer, &curve, interp_points);
+      need_redraw = false;
+    }
+
+    // wait for the next events instead of spinning
+    if (SDL_WaitEvent(&event) == 0) {
+      printf("[ERROR] SDL event error: %s\n", SDL_GetError());
+      break;
+    }
+    do {
       switch (event.type) {
       case SDL_MOUSEBUTTONDOWN:
         SDL_GetMouseState(&mouse_x, &mouse_y);
-        selected_point = NULL;
-        for (int i = 0; i < N_POINTS; ++i) {
-          double dx = points[i].x - mouse_x;
-          double dy = points[i].y - mouse_y;
-          double distance = sqrt(dx * dx + dy * dy);
-          if (distance < POINT_RADIUS) {
-            selected_point = points + i;
+        if (event.button.button == SDL_BUTTON_RIGHT) {
+          if (add_point(&curve, mouse_x, mouse_y)) {
+            need_run = add_grid_point(&grid, curve.points, curve.n_points);
+            need_redraw = true;
           }
+          break;
         }
+        selected_index = find_nearest_point(&grid, mouse_x, mouse_y);
         break;
       case SDL_MOUSEMOTION:
-        if (selected_point != NULL) {
+        if (selected_index >= 0) {
           SDL_GetMouseState(&mouse_x, &mouse_y);
-          selected_point->x = mouse_x;
-          selected_point->y = mouse_y;
-        }
-        // NOTE: It has not optimized for efficient redraw!
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-        SDL_RenderClear(renderer);
-        // Draw the control points 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
-        for (int i = 0; i < N_POINTS; ++i) {
-          SDL_RenderDrawLine(renderer, points[i].x - POINT_RADIUS, points[i].y, points[i].x + POINT_RADIUS, points[i].y);
-          SDL_RenderDrawLine(renderer, points[i].x, points[i].y - POINT_RADIUS, points[i].x, points[i].y + POINT_RADIUS);
-        }
-        // Draw the segments
-        SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
-        for (int i = 1; i < N_POINTS; ++i) {
-          SDL_RenderDrawLine(renderer, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
+          move_point(&curve, selected_index, mouse_x, mouse_y);
+          set_grid_point(&grid, selected_index, mouse_x, mouse_y);
+          need_redraw = true;
         }
-
-        interpolate_curve(interp_points, points, renderer);
-        draw_curve(renderer, interp_points);
-
-
-        // Display the results
-        SDL_RenderPresent(renderer);
         break;
       case SDL_MOUSEBUTTONUP:
-        selected_point = NULL;
+        selected_index = -1;
+        break;
+      case SDL_WINDOWEVENT:
+        need_redraw = true;
         break;
       case SDL_KEYDOWN:
         case SDL_SCANCODE_Q:
@@ -169,12 +356,15 @@ int main(int argc, char* argv[])
         need_run = false;
         break;
       }
-    }
+    } while (SDL_PollEvent(&event));
   }
 
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
+  destroy_draw_buffer(&buffer);
+  destroy_point_grid(&grid);
+  destroy_lagrange_curve(&curve);
 
   return 0;
 }
@@ -1,59 +1,79 @@
 #include <SDL2/SDL.h>
 
+#include "arclength.h"
+#include "bezier.h"
+#include "draw.h"
+
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 const double POINT_RADIUS = 10.0;
 const int N_POINTS = 4;
 const int INTERP_RES = 100;
+const int N_ARC_LENGTH_INTERVALS = 16;
 
 /**
- * A simple point structure.
+ * Calculate the derivative of the curve of the control points for the arc length table.
  */
-typedef struct Point
+Point calc_curve_derivative(const void *data, double t)
 {
-  double x;
-  double y;
-} Point;
-
+    Point work[N_POINTS];
 
-// De Casteljau algorithm
-Point de_casteljau(Point *points, float t) {
-  Point pts[N_POINTS];
-  for (int i = 0; i < N_POINTS; i++) {
-    pts[i] = points[i];
-  }
+    return calc_bezier_derivative((const Point*)data, N_POINTS, t, work);
+}
 
-  for (int k = 0; k < N_POINTS - 1; k++) {
-    for(int i = 0; i < N_POINTS - k; i++) {
-      pts[i].x = t*pts[i].x + (1-t)*pts[i+1].x;
-      pts[i].y = t*pts[i].y + (1-t)*pts[i+1].y;
+/**
+ * Sample the curve at equal arc lengths instead of equal parameter steps,
+ * so that the samples are evenly spaced along the curve.
+ */
+void interpolate_curve(Point *interp_points, Point *points, ArcLengthTable *table) {
+    ArcLengthCurve curve = {calc_curve_derivative, points};
+    double parameters[INTERP_RES];
+    Point work[N_POINTS];
+
+    // the whole curve is a single span, which depends on every control point
+    invalidate_arc_length_spans(table, 0, 0);
+    update_arc_length_table(table, &curve);
+    calc_equal_length_parameters(table, &curve, INTERP_RES, parameters);
+    for (int k = 0; k < INTERP_RES; k++) {
+        interp_points[k] = calc_de_casteljau_point(points, N_POINTS, parameters[k], work);
     }
-  }
-  return pts[0];
 }
 
-void interpolate_curve(Point *interp_points, Point *points, SDL_Renderer *renderer) {
-    for (int k = 0; k < INTERP_RES; k++) {  
-        //float t = (float)k * (N_POINTS - 1.0)/ (INTERP_RES - 1);
-        float t = (float)k / (INTERP_RES - 1);
-        interp_points[k].x = 0;
-        interp_points[k].y = 0;
-
-        Point p = de_casteljau(points, t);
-
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-        SDL_RenderDrawPoint(renderer, p.x, p.y);
+/**
+ * Find the nearest point within POINT_RADIUS of the position, or NULL.
+ * A grid is not worth it for the few control points, but the squared distances are compared as in the other tools.
+ */
+Point* find_nearest_point(Point *points, int n_points, double x, double y)
+{
+    double min_distance = POINT_RADIUS * POINT_RADIUS;
+    Point* nearest = NULL;
+
+    for (int i = 0; i < n_points; ++i) {
+        double dx = points[i].x - x;
+        double dy = points[i].y - y;
+        double distance = dx * dx + dy * dy;
+        if (distance < min_distance) {
+            min_distance = distance;
+            nearest = points + i;
+        }
     }
+    return nearest;
 }
 
-void draw_curve(SDL_Renderer *renderer, Point *interp_points) {
+void draw_curve(SDL_Renderer *renderer, DrawBuffer *buffer, Point *interp_points) {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    for (int i = 0; i < INTERP_RES - 1; i++) {
-        SDL_RenderDrawLine(renderer, interp_points[i].x, interp_points[i].y,
-                           interp_points[i + 1].x, interp_points[i + 1].y);
-    }
+    draw_polyline(renderer, buffer, interp_points, INTERP_RES);
+}
+
+/**
+ * Draw the samples of the curve with a single call.
+ */
+void draw_samples(SDL_Renderer *renderer, DrawBuffer *buffer, Point *interp_points) {
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
+    draw_points(renderer, buffer, interp_points, INTERP_RES);
 }
 
 /**
@@ -73,8 +93,12 @@ int main(int argc, char* argv[])
   int i;
 
   Point* selected_point = NULL;
+  bool need_redraw = true;
   Point points[N_POINTS];
   Point interp_points[INTERP_RES];
+  const double domain[] = {0.0, 1.0};
+  ArcLengthTable table;
+  DrawBuffer buffer;
   points[0].x = 200;
   points[0].y = 200;
   points[1].x = 400;
@@ -83,10 +107,15 @@ int main(int argc, char* argv[])
   points[2].y = 400;
   points[3].x = 500;
   points[3].y = 400;
+  if (!create_arc_length_table(&table, domain, 1, N_ARC_LENGTH_INTERVALS)) {
+    return 1;
+  }
+  init_draw_buffer(&buffer);
 
   error_code = SDL_Init(SDL_INIT_EVERYTHING);
   if (error_code != 0) {
     printf("[ERROR] SDL initialization error: %s\n", SDL_GetError());
+    destroy_arc_length_table(&table);
     return error_code;
   }
 
@@ -109,51 +138,51 @@ int main(int argc, char* argv[])
 
   need_run = true;
   while (need_run) {
-    while (SDL_PollEvent(&event)) {
+    if (need_redraw) {
+      SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+      SDL_RenderClear(renderer);
+      // Draw the control points 
+      SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
+      draw_control_points(renderer, &buffer, points, N_POINTS, POINT_RADIUS);
+      // Draw the segments
+      SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
+      draw_polyline(renderer, &buffer, points, N_POINTS);
+
+      interpolate_curve(interp_points, points, &table);
+      draw_curve(renderer, &buffer, interp_points);
+      draw_samples(renderer, &buffer, interp_points);
+
+
+      // Display the results
+      SDL_RenderPresent(renderer);
+      need_redraw = false;
+    }
+
+    // wait for the next events instead of spinning
+    if (SDL_WaitEvent(&event) == 0) {
+      printf("[ERROR] SDL event error: %s\n", SDL_GetError());
+      break;
+    }
+    do {
       switch (event.type) {
       case SDL_MOUSEBUTTONDOWN:
         SDL_GetMouseState(&mouse_x, &mouse_y);
-        selected_point = NULL;
-        for (int i = 0; i < N_POINTS; ++i) {
-          double dx = points[i].x - mouse_x;
-          double dy = points[i].y - mouse_y;
-          double distance = sqrt(dx * dx + dy * dy);
-          if (distance < POINT_RADIUS) {
-            selected_point = points + i;
-          }
-        }
+        selected_point = find_nearest_point(points, N_POINTS, mouse_x, mouse_y);
         break;
       case SDL_MOUSEMOTION:
         if (selected_point != NULL) {
           SDL_GetMouseState(&mouse_x, &mouse_y);
           selected_point->x = mouse_x;
           selected_point->y = mouse_y;
+          need_redraw = true;
         }
-        // NOTE: It has not optimized for efficient redraw!
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-        SDL_RenderClear(renderer);
-        // Draw the control points 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
-        for (int i = 0; i < N_POINTS; ++i) {
-          SDL_RenderDrawLine(renderer, points[i].x - POINT_RADIUS, points[i].y, points[i].x + POINT_RADIUS, points[i].y);
-          SDL_RenderDrawLine(renderer, points[i].x, points[i].y - POINT_RADIUS, points[i].x, points[i].y + POINT_RADIUS);
-        }
-        // Draw the segments
-        SDL_SetRenderDrawColor(renderer, 160, 160, 160, SDL_ALPHA_OPAQUE);
-        for (int i = 1; i < N_POINTS; ++i) {
-          SDL_RenderDrawLine(renderer, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
-        }
-
-        interpolate_curve(interp_points, points, renderer);
-        draw_curve(renderer, interp_points);
-
-
-        // Display the results
-        SDL_RenderPresent(renderer);
         break;
       case SDL_MOUSEBUTTONUP:
         selected_point = NULL;
         break;
+      case SDL_WINDOWEVENT:
+        need_redraw = true;
+        break;
       case SDL_KEYDOWN:
         case SDL_SCANCODE_Q:
         need_run = false;
@@ -162,12 +191,14 @@ int main(int argc, char* argv[])
         need_run = false;
         break;
       }
-    }
+    } while (SDL_PollEvent(&event));
   }
 
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
+  destroy_draw_buffer(&buffer);
+  destroy_arc_length_table(&table);
 
   return 0;
 }